@@ -1,5 +1,10 @@
 ﻿#include <iostream>         // cout, cerr
 #include <cstdlib>          // EXIT_FAILURE
+#include <cmath>            // exp2
+#include <algorithm>        // max
+#include <cstring>          // strcmp
+#include <atomic>           // atomic
+#include <thread>           // thread
 #include <GL/glew.h>        // GLEW library
 #include <GLFW/glfw3.h>     // GLFW library
 
@@ -10,6 +15,20 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "meshes.h"
+#include "scene.h"
+#include "renderer.h"
+#include "programreflection.h"
+#include "frameblock.h"
+#include "glstate.h"
+#include "culling.h"
+#include "bvh.h"
+#include "occlusion.h"
+#include "occlusionqueries.h"
+#include "lod.h"
+#include "workerpool.h"
+#include "framesnapshot.h"
+#include "simulationclock.h"
+#include "benchmark.h"
 #include "camera.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -31,6 +50,9 @@ namespace
 	const int WINDOW_WIDTH = 800;
 	const int WINDOW_HEIGHT = 600;
 
+	// Processed meshes are cooked here, next to the working directory, and loaded on the next start
+	const char* const MESH_CACHE_PATH = "meshes.cache";
+
 	// Stores the GL data relative to a given mesh
 	struct GLMesh
 	{
@@ -57,9 +79,70 @@ namespace
 	// Shader program
 	GLuint gProgramId;
 	GLuint gLightProgramId;
+	GLuint gBoxProgramId;
+	GLuint gDepthProgramId;
+
+	// Per-batch uniform locations, resolved once from the program reflection after linking
+	SurfaceUniforms gSurfaceUniforms;
+
+	// Camera and frame-wide lighting shared by every program
+	FrameBlockBuffer gFrameBlock;
 
 	//Shape Meshes from Professor Brian
 	Meshes meshes;
+	// Sides of the thin rods of the lamp and the stand, a few pixels across at most
+	const GLuint ROD_SEGMENTS = 12;
+
+	// Every object drawn by URender, stored column by column
+	Scene gScene;
+	// Batches the scene into instanced draw calls
+	SceneRenderer gRenderer;
+
+	// Frustum culling of the scene store, one visibility flag per entity
+	FrustumCuller gCuller;
+	std::vector<unsigned char> gVisible;
+
+	// Hierarchy over the scene, refitted when objects move; used for picking and optionally culling
+	SceneBvh gBvh;
+
+	// Software depth buffer of the big solid props, hides what is behind them before submission
+	OcclusionCuller gOcclusion;
+
+	// GPU box queries, answers from earlier frames skip hidden entities
+	OcclusionQueries gQueries;
+
+	// Detail level of every entity, kept between frames for the hysteresis
+	LodSelector gLods;
+	std::vector<unsigned char> gLodLevels;
+
+	// Work-stealing job threads for culling, occlusion and draw list building; GL calls stay on the render thread
+	WorkerPool gWorkers;
+
+	// Toggles flipped by the keys on the input thread, the render thread reads them from the snapshot
+	RenderSettings gSettings = {
+		true,                           // frustum culling
+		false,                          // culling walks the flat bounds arrays, not the BVH
+		true,                           // software occlusion culling
+		true,                           // depth pre-pass, then shade each visible pixel once
+		true,                           // cull and build the draw list on gWorkers
+		OcclusionQueries::OFF,          // GPU box queries
+		0.0f,                           // smallest projected radius in pixels still drawn, 0 keeps everything in the frustum
+		true,                           // detail levels picked by projected size
+		0.0f                            // LOD bias, each step doubles the pixel error allowed
+	};
+
+	// The input thread publishes a snapshot every tick, the render thread draws the latest one
+	SnapshotExchange gSnapshots;
+	// Cleared by the input thread when the window closes, the render thread then hands the context back
+	std::atomic<bool> gRendering{ false };
+	// Nodes the input thread animates with their local transforms at the two latest steps, none while the room is static
+	std::vector<TransformState> gDrivenTransforms;
+	// Bumped by the input thread, the render thread acts once per change
+	unsigned long gPickRequests = 0;
+	unsigned long gStatsRequests = 0;
+	// Last size reported by GLFW, applied with glViewport on the render thread
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
 
 	// camera
 	Camera gCamera(glm::vec3(0.0f, 5.0f, 15.0f));
@@ -67,9 +150,13 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// timing
-	float gDeltaTime = 0.0f; // time between current frame and last frame
-	float gLastFrame = 0.0f;
+	// fixed-step simulation clock, and the camera as the step before the latest left it
+	SimulationClock gClock;
+	CameraState gPreviousCamera;
+	// mouse look and scroll gathered by the callbacks, applied at the next step
+	float gMouseOffsetX = 0.0f;
+	float gMouseOffsetY = 0.0f;
+	float gScrollOffset = 0.0f;
 
 	int viewProj = 0;
 }
@@ -79,17 +166,40 @@ namespace
 const GLchar* surfaceVertexShaderSource = GLSL(440,
 
 	layout(location = 0) in vec3 vertexPosition; // VAP position 0 for vertex position data
-	layout(location = 1) in vec3 vertexNormal; // VAP position 1 for normals
+	layout(location = 1) in vec4 vertexNormal; // VAP position 1 for normals: xyz with w = 1, or packed octahedral xy with w = 0
 	layout(location = 2) in vec2 textureCoordinate;
+	layout(location = 3) in mat4 model; // Per-draw model matrix, VAP positions 3 to 6
+	layout(location = 7) in uint material; // Per-draw index into MaterialBlock
+
+	invariant gl_Position; // must match the depth pre-pass bit for bit for GL_EQUAL
 
 	out vec3 vertexFragmentNormal; // For outgoing normals to fragment shader
 	out vec3 vertexFragmentPos; // For outgoing color / pixels to fragment shader
 	out vec2 vertexTextureCoordinate;
+	flat out uint vertexMaterial;
 
-	//Uniform / Global variables for the  transform matrices
-	uniform mat4 model;
-	uniform mat4 view;
-	uniform mat4 projection;
+	// Per-frame camera and lighting, must match FrameBlock in frameblock.h
+	layout(std140) uniform FrameBlock
+	{
+		mat4 view;
+		mat4 projection;
+		vec4 viewPosition;
+		vec4 ambientLight; // rgb colour, a strength
+		vec4 light2Color;
+		vec4 light2Position;
+		vec4 light2Specular; // x intensity, y highlight size
+		vec2 uvScale;
+		int hasTexture;
+	};
+
+	// Unit normal of the packed vertex layout, the same steps as DecodeOctahedral() in vertexformat.cpp
+	vec3 DecodeOctahedral(vec2 encoded)
+	{
+		vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+		if (normal.z < 0.0f)
+			normal.xy = (1.0f - abs(encoded.yx)) * vec2(encoded.x < 0.0f ? -1.0f : 1.0f, encoded.y < 0.0f ? -1.0f : 1.0f);
+		return normalize(normal);
+	}
 
 	void main()
 	{
@@ -97,8 +207,10 @@ const GLchar* surfaceVertexShaderSource = GLSL(440,
 
 		vertexFragmentPos = vec3(model * vec4(vertexPosition, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
 
-		vertexFragmentNormal = mat3(transpose(inverse(model))) * vertexNormal; // get normal vectors in world space only and exclude normal translation properties
+		vec3 normal = vertexNormal.w > 0.5f ? vertexNormal.xyz : DecodeOctahedral(vertexNormal.xy);
+		vertexFragmentNormal = mat3(transpose(inverse(model))) * normal; // get normal vectors in world space only and exclude normal translation properties
 		vertexTextureCoordinate = textureCoordinate;
+		vertexMaterial = material;
 	}
 );
 
@@ -108,52 +220,72 @@ const GLchar* surfaceFragmentShaderSource = GLSL(440,
 	in vec3 vertexFragmentNormal; // For incoming normals
 	in vec3 vertexFragmentPos; // For incoming fragment position
 	in vec2 vertexTextureCoordinate;
+	flat in uint vertexMaterial; // For incoming index into MaterialBlock
 
 	out vec4 fragmentColor; // For outgoing cube color to the GPU
 
-	// Uniform / Global variables for object color, light color, light position, and camera/view position
-	uniform vec4 objectColor;
-	uniform vec3 ambientColor;
-	uniform vec3 light1Color;
-	uniform vec3 light1Position;
-	uniform vec3 light2Color;
-	uniform vec3 light2Position;
-	uniform vec3 viewPosition;
 	uniform sampler2D uTexture; // Useful when working with multiple textures
-	uniform vec2 uvScale;
-	uniform bool ubHasTexture;
-	uniform float ambientStrength = 0.8f; // Set ambient or global lighting strength
-	uniform float specularIntensity1 = 1.0f;
-	uniform float highlightSize1 = 16.0f;
-	uniform float specularIntensity2 = 0.1f;
-	uniform float highlightSize2 = 16.0f;
+
+	// Object color and key light of one material, must match MaterialRecord in renderer.h
+	struct Material
+	{
+		vec4 objectColor;
+		vec4 light1Color;
+		vec4 light1Position;
+		vec4 light1Specular; // x intensity, y highlight size
+	};
+
+	// Every material of the scene, array size must match SceneRenderer::MAX_MATERIALS
+	layout(std140) uniform MaterialBlock
+	{
+		Material materials[64];
+	};
+
+	// Per-frame camera and lighting, must match FrameBlock in frameblock.h
+	layout(std140) uniform FrameBlock
+	{
+		mat4 view;
+		mat4 projection;
+		vec4 viewPosition;
+		vec4 ambientLight; // rgb colour, a strength
+		vec4 light2Color;
+		vec4 light2Position;
+		vec4 light2Specular; // x intensity, y highlight size
+		vec2 uvScale;
+		int hasTexture;
+	};
 
 	void main()
 	{
 		/*Phong lighting model calculations to generate ambient, diffuse, and specular components*/
+		vec4 objectColor = materials[vertexMaterial].objectColor;
+		vec3 light1Color = materials[vertexMaterial].light1Color.rgb;
+		vec3 light1Position = materials[vertexMaterial].light1Position.xyz;
+		float specularIntensity1 = materials[vertexMaterial].light1Specular.x;
+		float highlightSize1 = materials[vertexMaterial].light1Specular.y;
 
 		//Calculate Ambient lighting
-		vec3 ambient = ambientStrength * ambientColor; // Generate ambient light color
+		vec3 ambient = ambientLight.a * ambientLight.rgb; // Generate ambient light color
 
 		//**Calculate Diffuse lighting**
 		vec3 norm = normalize(vertexFragmentNormal); // Normalize vectors to 1 unit
 		vec3 light1Direction = normalize(light1Position - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
 		float impact1 = max(dot(norm, light1Direction), 0.0);// Calculate diffuse impact by generating dot product of normal and light
 		vec3 diffuse1 = impact1 * light1Color; // Generate diffuse light color
-		vec3 light2Direction = normalize(light2Position - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
+		vec3 light2Direction = normalize(light2Position.xyz - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
 		float impact2 = max(dot(norm, light2Direction), 0.0);// Calculate diffuse impact by generating dot product of normal and light
-		vec3 diffuse2 = impact2 * light2Color; // Generate diffuse light color
+		vec3 diffuse2 = impact2 * light2Color.rgb; // Generate diffuse light color
 
 		//**Calculate Specular lighting**
-		vec3 viewDir = normalize(viewPosition - vertexFragmentPos); // Calculate view direction
+		vec3 viewDir = normalize(viewPosition.xyz - vertexFragmentPos); // Calculate view direction
 		vec3 reflectDir1 = reflect(-light1Direction, norm);// Calculate reflection vector
 		//Calculate specular component
 		float specularComponent1 = pow(max(dot(viewDir, reflectDir1), 0.0), highlightSize1);
 		vec3 specular1 = specularIntensity1 * specularComponent1 * light1Color;
 		vec3 reflectDir2 = reflect(-light2Direction, norm);// Calculate reflection vector
 		//Calculate specular component
-		float specularComponent2 = pow(max(dot(viewDir, reflectDir2), 0.0), highlightSize2);
-		vec3 specular2 = specularIntensity2 * specularComponent2 * light2Color;
+		float specularComponent2 = pow(max(dot(viewDir, reflectDir2), 0.0), light2Specular.y);
+		vec3 specular2 = light2Specular.x * specularComponent2 * light2Color.rgb;
 
 		//**Calculate phong result**
 		//Texture holds the color to be used for all three components
@@ -161,7 +293,7 @@ const GLchar* surfaceFragmentShaderSource = GLSL(440,
 		vec3 phong1;
 		vec3 phong2;
 
-		if (ubHasTexture == true)
+		if (hasTexture != 0)
 		{
 			phong1 = (ambient + diffuse1 + specular1) * textureColor.xyz;
 			phong2 = (ambient + diffuse2 + specular2) * textureColor.xyz;
@@ -172,7 +304,7 @@ const GLchar* surfaceFragmentShaderSource = GLSL(440,
 			phong2 = (ambient + diffuse2 + specular2) * objectColor.xyz;
 		}
 
-		fragmentColor = vec4(phong1 + phong2, 1.0); // Send lighting results to GPU
+		fragmentColor = vec4(phong1 + phong2, objectColor.a); // Send lighting results to GPU, alpha below 1 is blended
 		//fragmentColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
 	}
 );
@@ -182,8 +314,20 @@ const GLchar* lightVertexShaderSource = GLSL(330,
 	layout(location = 0) in vec3 aPos;
 
 	uniform mat4 model;
-	uniform mat4 view;
-	uniform mat4 projection;
+
+	// Per-frame camera and lighting, must match FrameBlock in frameblock.h
+	layout(std140) uniform FrameBlock
+	{
+		mat4 view;
+		mat4 projection;
+		vec4 viewPosition;
+		vec4 ambientLight; // rgb colour, a strength
+		vec4 light2Color;
+		vec4 light2Position;
+		vec4 light2Specular; // x intensity, y highlight size
+		vec2 uvScale;
+		int hasTexture;
+	};
 
 	void main()
 	{
@@ -201,6 +345,78 @@ const GLchar* lightFragmentShaderSource = GLSL(330,
 	}
 );
 
+/* Depth Pre-Pass Vertex Shader Source Code*/
+const GLchar* depthVertexShaderSource = GLSL(440,
+	layout(location = 0) in vec3 vertexPosition; // Position-only stream, 12 bytes per vertex
+	layout(location = 3) in mat4 model; // Per-draw model matrix, VAP positions 3 to 6
+
+	invariant gl_Position; // same expression as the surface shader, so depths compare equal
+
+	// Per-frame camera and lighting, must match FrameBlock in frameblock.h
+	layout(std140) uniform FrameBlock
+	{
+		mat4 view;
+		mat4 projection;
+		vec4 viewPosition;
+		vec4 ambientLight; // rgb colour, a strength
+		vec4 light2Color;
+		vec4 light2Position;
+		vec4 light2Specular; // x intensity, y highlight size
+		vec2 uvScale;
+		int hasTexture;
+	};
+
+	void main()
+	{
+		gl_Position = projection * view * model * vec4(vertexPosition, 1.0f);
+	}
+);
+
+/* Depth Pre-Pass Fragment Shader Source Code*/
+const GLchar* depthFragmentShaderSource = GLSL(440,
+	void main()
+	{
+		// depth only, colour writes are masked off
+	}
+);
+
+/* Occlusion Query Box Shader Source Code*/
+const GLchar* boxVertexShaderSource = GLSL(440,
+	layout(location = 0) in vec3 corner; // Unit box corner, 0 or 1 per axis
+
+	uniform vec3 uBoxMin; // World space box of the queried entity
+	uniform vec3 uBoxMax;
+
+	// Per-frame camera and lighting, must match FrameBlock in frameblock.h
+	layout(std140) uniform FrameBlock
+	{
+		mat4 view;
+		mat4 projection;
+		vec4 viewPosition;
+		vec4 ambientLight; // rgb colour, a strength
+		vec4 light2Color;
+		vec4 light2Position;
+		vec4 light2Specular; // x intensity, y highlight size
+		vec2 uvScale;
+		int hasTexture;
+	};
+
+	void main()
+	{
+		gl_Position = projection * view * vec4(mix(uBoxMin, uBoxMax, corner), 1.0);
+	}
+);
+
+/* Occlusion Query Box Shader Source Code*/
+const GLchar* boxFragmentShaderSource = GLSL(440,
+	out vec4 fragmentColor;
+
+	void main()
+	{
+		fragmentColor = vec4(1.0); // colour writes are masked off, only the samples count
+	}
+);
+
 /* User-defined Function prototypes to:
  * initialize the program, set the window size,
  * redraw graphics on the window when resized,
@@ -209,14 +425,25 @@ const GLchar* lightFragmentShaderSource = GLSL(330,
 bool UInitialize(int, char* [], GLFWwindow** window);
 void UResizeWindow(GLFWwindow* window, int width, int height);
 void UProcessInput(GLFWwindow* window);
+void USimulateStep();
+CameraState UCameraState();
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+void UKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void UPrintStats(const FrameSnapshot& snapshot);
+void UPrintMeshMemory();
+glm::mat4 UProjectionMatrix(float zoom);
+void UPickObject(const CameraState& camera, double xpos, double ypos);
+void UPublishSnapshot();
+void URenderLoop();
 bool UCreateTexture(const char* filename, GLuint& textureId);
 void UDestroyTexture(GLuint textureId);
-void URender();
+void UCreateScene();
+void URender(const FrameSnapshot& snapshot, const CameraState& camera);
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
 void UDestroyShaderProgram(GLuint programId);
+void UResolveUniforms();
 
 
 // Images are loaded with Y axis going down, but OpenGL's Y axis goes up, so let's flip it
@@ -241,15 +468,36 @@ void flipImageVertically(unsigned char* image, int width, int height, int channe
 
 int main(int argc, char* argv[])
 {
+	// --bench-* flags run a CPU benchmark instead of the scene
+	if (RunBenchmark(argc, argv))
+		return EXIT_SUCCESS;
+
 	if (!UInitialize(argc, argv, &gWindow))
 		return EXIT_FAILURE;
 
 	// Create the mesh
 	//UCreateMesh(gMesh); // Calls the function to create the Vertex Buffer Object
+	meshes.RequestPrimitive(PRIMITIVE_CYLINDER, ROD_SEGMENTS, 1);
+	// --packed-vertices halves the vertex memory, see vertexformat.h
+	// --recook-meshes generates the meshes even when the cooked file is current
+	bool recook = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--packed-vertices") == 0)
+			meshes.SetPackedVertices(true);
+		else if (strcmp(argv[i], "--recook-meshes") == 0)
+			recook = true;
+	}
+	meshes.SetCachePath(MESH_CACHE_PATH, recook);
 	meshes.CreateMeshes();
+	UPrintMeshMemory();
+	gRenderer.Create(meshes);
 
-	// tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-	glUseProgram(gProgramId);
+	// Per-object frame work is split across one thread per core
+	gWorkers.Start();
+
+	// Lay out the objects of the room
+	UCreateScene();
 
 	// Create the shader program
 	if (!UCreateShaderProgram(surfaceVertexShaderSource, surfaceFragmentShaderSource, gProgramId))
@@ -257,6 +505,26 @@ int main(int argc, char* argv[])
 
 	if (!UCreateShaderProgram(lightVertexShaderSource, lightFragmentShaderSource, gLightProgramId))
 		return EXIT_FAILURE;
+
+	if (!UCreateShaderProgram(boxVertexShaderSource, boxFragmentShaderSource, gBoxProgramId))
+		return EXIT_FAILURE;
+
+	if (!UCreateShaderProgram(depthVertexShaderSource, depthFragmentShaderSource, gDepthProgramId))
+		return EXIT_FAILURE;
+
+	// Look up every uniform location once, URender only uses the cached handles
+	UResolveUniforms();
+
+	// Both programs read the camera and lighting from the same per-frame buffer
+	gFrameBlock.Create();
+	gFrameBlock.Attach(gProgramId);
+	gFrameBlock.Attach(gLightProgramId);
+	gFrameBlock.Attach(gBoxProgramId);
+	gFrameBlock.Attach(gDepthProgramId);
+	gRenderer.Attach(gProgramId);
+
+	gQueries.Create();
+	gQueries.Attach(gBoxProgramId);
 	
 	const char* texFilename = "C:/Users/jway2/source/repos/CS330 Final/Resources/Textures/woodfloor.jpg";
 	if (!UCreateTexture(texFilename, gTextureIdFloor))
@@ -322,66 +590,76 @@ int main(int argc, char* argv[])
 	}
 
 	//copy texture data for gTextureIdFloor into slot 0
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdFloor);
+	GLState::BindTexture(0, GL_TEXTURE_2D, gTextureIdFloor);
 
 	//copy texture data for gTextureIdLampTop into slot 1
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdLampTop);
+	GLState::BindTexture(1, GL_TEXTURE_2D, gTextureIdLampTop);
 
 	//copy texture data for gTextureIdLamp into slot 2
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdLamp);
+	GLState::BindTexture(2, GL_TEXTURE_2D, gTextureIdLamp);
 
 	//copy texture data for gTextureIdAmp into slot 3
-	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdAmp);
+	GLState::BindTexture(3, GL_TEXTURE_2D, gTextureIdAmp);
 
 	//copy texture data for gTextureIdCatToy into slot 4
-	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdCatToy);
+	GLState::BindTexture(4, GL_TEXTURE_2D, gTextureIdCatToy);
 
 	//copy texture data for gTextureIdHeat into slot 5
-	glActiveTexture(GL_TEXTURE5);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdHeat);
+	GLState::BindTexture(5, GL_TEXTURE_2D, gTextureIdHeat);
 
 	//copy texture data for gTextureIdGuitar1 into slot 6
-	glActiveTexture(GL_TEXTURE6);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdGuitar1);
+	GLState::BindTexture(6, GL_TEXTURE_2D, gTextureIdGuitar1);
 
 	//copy texture data for gTextureIdNeck into slot 7
-	glActiveTexture(GL_TEXTURE7);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdNeck);
+	GLState::BindTexture(7, GL_TEXTURE_2D, gTextureIdNeck);
 
 	//copy texture data for gTextureIdHead into slot 8
-	glActiveTexture(GL_TEXTURE8);
-	glBindTexture(GL_TEXTURE_2D, gTextureIdHead);
+	GLState::BindTexture(8, GL_TEXTURE_2D, gTextureIdHead);
 
 	// Sets the background color of the window to black (it will be implicitely used by glClear)
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	// render loop
+	// Publish the first snapshot, then hand the context over to the render thread
+	glfwGetFramebufferSize(gWindow, &gFramebufferWidth, &gFramebufferHeight);
+	gClock.Start(glfwGetTime());
+	gPreviousCamera = UCameraState();
+	UPublishSnapshot();
+	glfwMakeContextCurrent(NULL);
+	gRendering = true;
+	std::thread renderThread(URenderLoop);
+
+	// input loop: events, camera and toggles only, so a slow frame never holds up input
 	// -----------
 	while (!glfwWindowShouldClose(gWindow))
 	{
-		// per-frame timing
-		// --------------------
-		float currentFrame = glfwGetTime();
-		gDeltaTime = currentFrame - gLastFrame;
-		gLastFrame = currentFrame;
-
-		// input
-		// -----
-		UProcessInput(gWindow);
+		// wake on every event, or when the next simulation step is due
+		const double wait = gClock.TimeToNextStep(glfwGetTime());
+		if (wait > 0.0)
+			glfwWaitEventsTimeout(wait);
+		else
+			glfwPollEvents();
 
-		// Render this frame
-		URender();
+		// simulation: one fixed step per STEP of time passed, the remainder waits for a later tick
+		// --------------------
+		const GLuint steps = gClock.Advance(glfwGetTime());
+		for (GLuint i = 0; i < steps; ++i)
+			USimulateStep();
 
-		glfwPollEvents();
+		// Hand the camera and toggles to the render thread
+		UPublishSnapshot();
 	}
 
+	// Let the render thread finish its frame and take the context back for teardown
+	gRendering = false;
+	renderThread.join();
+	glfwMakeContextCurrent(gWindow);
+
 	// Release mesh data
+	gQueries.Destroy();
+	gFrameBlock.Destroy();
+	gRenderer.Destroy();
 	meshes.DestroyMeshes();
+	gWorkers.Stop();
 
 	// Destroy texture
 	UDestroyTexture(gTextureIdFloor);
@@ -395,6 +673,8 @@ int main(int argc, char* argv[])
 	// Release shader program
 	UDestroyShaderProgram(gProgramId);
 	UDestroyShaderProgram(gLightProgramId);
+	UDestroyShaderProgram(gBoxProgramId);
+	UDestroyShaderProgram(gDepthProgramId);
 
 	exit(EXIT_SUCCESS); // Terminates the program successfully
 }
@@ -428,6 +708,7 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
 	glfwSetCursorPosCallback(*window, UMousePositionCallback);
 	glfwSetScrollCallback(*window, UMouseScrollCallback);
 	glfwSetMouseButtonCallback(*window, UMouseButtonCallback);
+	glfwSetKeyCallback(*window, UKeyCallback);
 
 	// tell GLFW to capture our mouse
 	glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -470,24 +751,53 @@ void UProcessInput(GLFWwindow* window) {
 	}
 
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(FORWARD, gDeltaTime);
+		gCamera.ProcessKeyboard(FORWARD, (float)SimulationClock::STEP);
 	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(BACKWARD, gDeltaTime);
+		gCamera.ProcessKeyboard(BACKWARD, (float)SimulationClock::STEP);
 	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(LEFT, gDeltaTime);
+		gCamera.ProcessKeyboard(LEFT, (float)SimulationClock::STEP);
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(RIGHT, gDeltaTime);
+		gCamera.ProcessKeyboard(RIGHT, (float)SimulationClock::STEP);
 	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(DOWN, gDeltaTime);
+		gCamera.ProcessKeyboard(DOWN, (float)SimulationClock::STEP);
 	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(UP, gDeltaTime);
+		gCamera.ProcessKeyboard(UP, (float)SimulationClock::STEP);
 
 }
 
 
+// One fixed step of the simulation: mouse look gathered since the last step, then the held keys
+void USimulateStep()
+{
+	gPreviousCamera = UCameraState();
+	for (TransformState& transform : gDrivenTransforms)
+		transform.previousLocal = transform.local;
+
+	// only touch the camera when there is something to apply, the O and P views set its vectors directly
+	if (gMouseOffsetX != 0.0f || gMouseOffsetY != 0.0f)
+		gCamera.ProcessMouseMovement(gMouseOffsetX, gMouseOffsetY);
+	if (gScrollOffset != 0.0f)
+		gCamera.ProcessMouseScroll(gScrollOffset);
+	gMouseOffsetX = 0.0f;
+	gMouseOffsetY = 0.0f;
+	gScrollOffset = 0.0f;
+
+	UProcessInput(gWindow);
+}
+
+
+// The camera as the snapshot carries it
+CameraState UCameraState()
+{
+	return { gCamera.Position, gCamera.Front, gCamera.Up, gCamera.Zoom };
+}
+
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
+// there is no context on the input thread, the render thread picks the size up from the snapshot
 void UResizeWindow(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
 }
 
 
@@ -507,14 +817,17 @@ void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos) {
 	gLastX = xpos;
 	gLastY = ypos;
 
-	gCamera.ProcessMouseMovement(xoffset, yoffset);
+	// applied at the next simulation step
+	gMouseOffsetX += xoffset;
+	gMouseOffsetY += yoffset;
 }
 
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
-	gCamera.ProcessMouseScroll(yoffset);
+	// applied at the next simulation step
+	gScrollOffset += (float)yoffset;
 }
 
 
@@ -525,10 +838,10 @@ void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 	{
 	case GLFW_MOUSE_BUTTON_LEFT:
 	{
+		// the cursor is captured for mouse look, so picking goes through the centre of the view
+		// the BVH belongs to the render thread, which picks after its next frame
 		if (action == GLFW_PRESS)
-			cout << "Left mouse button pressed" << endl;
-		else
-			cout << "Left mouse button released" << endl;
+			gPickRequests++;
 	}
 	break;
 
@@ -557,836 +870,468 @@ void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 }
 
 
-// Functioned called to render a frame
-void URender() {
-	glm::mat4 scale;
-	glm::mat4 rotation;
-	glm::mat4 translation;
-	glm::mat4 model;
-	glm::mat4 view;
-	glm::mat4 projection;
-	GLint modelLoc;
-	GLint viewLoc;
-	GLint projLoc;
-	GLint objectColorLoc;
-	GLint viewPosLoc;
-	GLint ambStrLoc;
-	GLint ambColLoc;
-	GLint light1ColLoc;
-	GLint light1PosLoc;
-	GLint light2ColLoc;
-	GLint light2PosLoc;
-	GLint specInt1Loc;
-	GLint highlghtSz1Loc;
-	GLint specInt2Loc;
-	GLint highlghtSz2Loc;
-	GLint uHasTextureLoc;
-	bool ubHasTextureVal;
+// glfw: handle one-shot key presses (toggles and reports)
+// ------------------------------------------------------
+// F1  print the frame counters      C  frustum culling
+// H   software occlusion culling    G  cycle the occlusion query mode
+// B   BVH or flat frustum culling   M  parallel frame work
+// Z   depth pre-pass                L  detail levels
+// [ ] lower or raise the LOD bias
+// W A S D Q E move the camera and O P jump to the preset views, see UProcessInput
+void UKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	if (action != GLFW_PRESS)
+		return;
 
-	// Enable z-depth
-	glEnable(GL_DEPTH_TEST);
+	switch (key)
+	{
+	case GLFW_KEY_F1:
+		// the counters belong to the render thread, which prints them after its next frame
+		gStatsRequests++;
+		break;
 
-	// Clear the frame and z buffers
-	glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	case GLFW_KEY_C:
+		gSettings.culling = !gSettings.culling;
+		cout << "Frustum culling " << (gSettings.culling ? "enabled" : "disabled") << endl;
+		break;
 
-	// Transforms the camera
-	view = gCamera.GetViewMatrix();
+	case GLFW_KEY_H:
+		gSettings.occlusion = !gSettings.occlusion;
+		cout << "Software occlusion culling " << (gSettings.occlusion ? "enabled" : "disabled") << endl;
+		break;
+
+	case GLFW_KEY_G:
+		gSettings.queryMode = (gSettings.queryMode + 1) % OcclusionQueries::MODE_COUNT;
+		cout << "Occlusion queries: " << OcclusionQueries::ModeName((OcclusionQueries::Mode)gSettings.queryMode) << endl;
+		break;
+
+	case GLFW_KEY_B:
+		gSettings.bvhCulling = !gSettings.bvhCulling;
+		cout << "Frustum culling walks the " << (gSettings.bvhCulling ? "BVH" : "flat bounds arrays") << endl;
+		break;
+
+	case GLFW_KEY_M:
+		gSettings.parallelFrame = !gSettings.parallelFrame;
+		cout << "Culling, occlusion and draw list building on " << (gSettings.parallelFrame ? gWorkers.ThreadCount() : 1) << " thread(s)" << endl;
+		break;
+
+	case GLFW_KEY_Z:
+		gSettings.depthPrePass = !gSettings.depthPrePass;
+		cout << "Depth pre-pass " << (gSettings.depthPrePass ? "enabled" : "disabled") << endl;
+		break;
+
+	case GLFW_KEY_L:
+		gSettings.lod = !gSettings.lod;
+		cout << "Detail levels " << (gSettings.lod ? "enabled" : "disabled") << endl;
+		break;
+
+	case GLFW_KEY_LEFT_BRACKET:
+	case GLFW_KEY_RIGHT_BRACKET:
+		gSettings.lodBias += key == GLFW_KEY_RIGHT_BRACKET ? 1.0f : -1.0f;
+		cout << "LOD bias " << gSettings.lodBias << " (" << LodSelector::PIXEL_ERROR * std::exp2(gSettings.lodBias) << " pixel error allowed)" << endl;
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+// Print the counters of the last rendered frame, on the render thread
+void UPrintStats(const FrameSnapshot& snapshot)
+{
+	const RenderSettings& settings = snapshot.settings;
+
+	const RenderStats& render = gRenderer.stats;
+	cout << "Render" << (settings.depthPrePass ? " (depth pre-pass)" : "") << ": " << render.entities << " entities, " << render.batches << " batches, "
+		<< render.commands << " commands, " << render.drawCalls << " draw calls, " << render.textureChanges << " texture changes, "
+		<< render.transparent << " transparent, " << render.stalls << " ring stalls" << endl;
+
+	const QueueStats& queue = gRenderer.QueueStatistics();
+	cout << "Render queue: " << queue.items << " keys, " << queue.radixPasses << " radix passes, " << queue.skippedPasses << " skipped" << endl;
+
+	const CullStats& cull = gCuller.stats;
+	const JobStats jobs = gWorkers.Statistics();
+	cout << "Frame work on " << (settings.parallelFrame ? gWorkers.ThreadCount() : 1) << " thread(s), jobs since start: "
+		<< jobs.executed << " run, " << jobs.stolen << " stolen, " << jobs.overflowed << " overflowed" << endl;
+
+	cout << "Simulation: " << snapshot.step << " steps of " << SimulationClock::STEP * 1000.0 << " ms, "
+		<< snapshot.droppedTime << " s dropped to keep up" << endl;
+
+	const SnapshotStats& snapshots = gSnapshots.stats;
+	cout << "Snapshots since start: " << snapshot.sequence << " published, " << snapshots.acquired << " rendered, "
+		<< snapshots.dropped << " dropped, " << snapshots.repeated << " frames without a new one" << endl;
+
+	cout << "Culling" << (settings.culling ? "" : " (disabled)") << ": " << cull.tested << " tested, "
+		<< cull.visible << " visible, " << cull.culled << " culled" << endl;
+
+	const OcclusionStats& occlusion = gOcclusion.stats;
+	cout << "Occlusion" << (settings.culling && settings.occlusion ? "" : " (disabled)") << ": " << occlusion.occluders << " occluders, "
+		<< occlusion.triangles << " triangles, " << occlusion.tested << " tested, " << occlusion.occluded << " occluded" << endl;
+
+	const LodStats& lod = gLods.stats;
+	cout << "Detail levels" << (settings.lod ? "" : " (disabled)") << ", bias " << settings.lodBias << ":";
+	for (GLuint level = 0; level < Meshes::MAX_LODS; ++level)
+		cout << " " << lod.levels[level];
+	cout << " entities per level, " << lod.switches << " switched, " << lod.triangles << " of " << lod.fullTriangles << " triangles" << endl;
+
+	const Meshes::MeshStats& mesh = meshes.stats;
+	cout << "Meshes: " << mesh.meshes << " meshes and levels, " << mesh.vertices << " vertices (" << mesh.sourceVertices << " before welding), " << mesh.triangles << " triangles, ACMR "
+		<< (float)mesh.missesBefore / std::max(mesh.triangles, 1u) << " as generated, " << (float)mesh.missesAfter / std::max(mesh.triangles, 1u)
+		<< " reordered" << endl;
 
+	const QueryStats& queries = gQueries.stats;
+	cout << "Occlusion queries (" << OcclusionQueries::ModeName(gQueries.mode) << "): " << queries.issued << " issued, "
+		<< queries.unqueried << " unconditioned, " << queries.hidden << " hidden, " << queries.pending << " pending" << endl;
+
+	const GLStateStats& state = GLState::Stats();
+	cout << "GL state: " << state.calls << " calls, " << state.elided << " elided" << endl;
+
+	cout << "BVH: " << gBvh.Nodes().size() << " nodes, " << gBvh.stats.builds << " builds, " << gBvh.stats.refits << " refits" << endl;
+}
+
+
+// List the vertex memory each mesh and detail level takes before and after welding
+void UPrintMeshMemory()
+{
+	const size_t vertexBytes = sizeof(GLfloat) * Meshes::FLOATS_PER_VERTEX;
+	cout << "INFO: Mesh vertex memory, welded:" << endl;
+	for (const Meshes::MeshWeld& weld : meshes.weldReport)
+	{
+		cout << "  " << weld.name << ": " << weld.sourceVertices << " -> " << weld.vertices << " vertices, "
+			<< weld.sourceVertices * vertexBytes << " -> " << weld.vertices * vertexBytes << " bytes" << endl;
+	}
+
+	const Meshes::MeshStats& stats = meshes.stats;
+	cout << "  total: " << stats.sourceVertices * vertexBytes / 1024 << " KB -> " << stats.vertices * vertexBytes / 1024 << " KB" << endl;
+	cout << "INFO: Uploaded " << (meshes.PackedVertices() ? "packed" : "float") << " vertices: " << stats.vertexBytes / 1024 << " KB with the position stream, "
+		<< (meshes.GetIndexType() == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices: " << stats.indexBytes / 1024 << " KB" << endl;
+
+	if (stats.cache == MESH_CACHE_LOADED)
+		cout << "INFO: Meshes loaded from " << meshes.CachePath() << endl;
+	else if (stats.cooked)
+		cout << "INFO: Meshes cooked into " << meshes.CachePath() << ", the old file was " << MeshCacheStatusName(stats.cache) << endl;
+	else
+		cout << "ERROR: Could not write " << meshes.CachePath() << endl;
+}
+
+
+// Projection used by URender and by picking
+glm::mat4 UProjectionMatrix(float zoom)
+{
 	// Creates a orthographic projection
-	//projection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f);
+	//return glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f);
 
 	// Creates a perspective projection
-	projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	return glm::perspective(glm::radians(zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+}
 
 
-	// Set the shader to be used
-	glUseProgram(gProgramId);
-
-	// Retrieves and passes transform matrices to the Shader program
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	viewLoc = glGetUniformLocation(gProgramId, "view");
-	projLoc = glGetUniformLocation(gProgramId, "projection");
-	viewPosLoc = glGetUniformLocation(gProgramId, "viewPosition");
-	ambStrLoc = glGetUniformLocation(gProgramId, "ambientStrength");
-	ambColLoc = glGetUniformLocation(gProgramId, "ambientColor");
-	light1ColLoc = glGetUniformLocation(gProgramId, "light1Color");
-	light1PosLoc = glGetUniformLocation(gProgramId, "light1Position");
-	light2ColLoc = glGetUniformLocation(gProgramId, "light2Color");
-	light2PosLoc = glGetUniformLocation(gProgramId, "light2Position");
-	objectColorLoc = glGetUniformLocation(gProgramId, "objectColor");
-	specInt1Loc = glGetUniformLocation(gProgramId, "specularIntensity1");
-	highlghtSz1Loc = glGetUniformLocation(gProgramId, "highlightSize1");
-	specInt2Loc = glGetUniformLocation(gProgramId, "specularIntensity2");
-	highlghtSz2Loc = glGetUniformLocation(gProgramId, "highlightSize2");
-	uHasTextureLoc = glGetUniformLocation(gProgramId, "ubHasTexture");
-	uHasTextureLoc = glGetUniformLocation(gProgramId, "ubHasTexture");
-
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-	//set ambient lighting strength
-	glUniform1f(ambStrLoc, 0.5f);
-	//set ambient color
-	glUniform3f(ambColLoc, 0.5f, 0.5f, 0.5f);
-	glUniform3f(light1ColLoc, 0.8f, 0.8f, 0.3f);
-	glUniform3f(light1PosLoc, -1.5f, 10.0f, -5.0f);
-	glUniform3f(light2ColLoc, 0.2f, 0.2f, 0.2f);
-	glUniform3f(light2PosLoc, 0.0f, 5.0f, 3.0f);
-	//set specular intensity
-	glUniform1f(specInt1Loc, 1.0f);
-	glUniform1f(specInt2Loc, 0.1f);
-	//set specular highlight size
-	glUniform1f(highlghtSz1Loc, 2.0f);
-	glUniform1f(highlghtSz2Loc, 10.0f);
-
-	ubHasTextureVal = true;
-	glUniform1i(uHasTextureLoc, ubHasTextureVal);
-
-	GLint UVScaleLoc = glGetUniformLocation(gProgramId, "uvScale");
-	glUniform2fv(UVScaleLoc, 1, glm::value_ptr(gUVScale));
+// Cast a ray from the camera through a window position and report the closest object it hits
+void UPickObject(const CameraState& camera, double xpos, double ypos)
+{
+	// window position to normalized device coordinates, y points up in NDC
+	const float x = (float)(2.0 * xpos / WINDOW_WIDTH - 1.0);
+	const float y = (float)(1.0 - 2.0 * ypos / WINDOW_HEIGHT);
+
+	// unproject the matching points on the near and far planes
+	const glm::mat4 toWorld = glm::inverse(UProjectionMatrix(camera.zoom) * CameraView(camera));
+	const glm::vec4 nearPoint = toWorld * glm::vec4(x, y, -1.0f, 1.0f);
+	const glm::vec4 farPoint = toWorld * glm::vec4(x, y, 1.0f, 1.0f);
+	const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	const glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+	// the ray spans near to far plane as its parameter goes from 0 to 1
+	const double start = glfwGetTime();
+	const RayHit hit = gBvh.Raycast(gScene, origin, direction, 1.0f);
+	const double elapsed = glfwGetTime() - start;
+
+	if (hit.entity < 0)
+		cout << "Picked nothing";
+	else
+		cout << "Picked " << gScene.names[hit.entity] << " at distance " << glm::length(direction) * hit.distance;
+	cout << " (" << hit.nodesVisited << " nodes, " << hit.leafTests << " objects, " << elapsed * 1.0e6 << " us)" << endl;
+}
 
 
-	///////////////////////////////////////////////////////////////////////////////
+// Fill the scene store with every object in the room
+void UCreateScene()
+{
+	const glm::vec3 noAxis(1.0f, 1.0f, 1.0f);
+	const Meshes::GLMesh& rod = meshes.GetPrimitive(PRIMITIVE_CYLINDER, ROD_SEGMENTS, 1);
+
+	gScene.Clear();
+
+	// Materials: object colour plus the key light each group of objects is lit by
+	const glm::vec3 roomLightColor(0.8f, 0.8f, 0.3f);
+	const glm::vec3 roomLightPos(-1.5f, 10.0f, -5.0f);
+	const glm::vec3 propLightColor(0.6f, 0.6f, 0.3f);
+	const glm::vec3 ampLightPos(2.0f, 5.0f, -4.8f);
+
+	GLuint matRed = gScene.AddMaterial({ glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), roomLightColor, roomLightPos, 1.0f, 2.0f });
+	GLuint matFrostedGlass = gScene.AddMaterial({ glm::vec4(1.0f, 0.0f, 0.0f, 0.6f), roomLightColor, roomLightPos, 1.0f, 2.0f });
+	GLuint matLamp = gScene.AddMaterial({ glm::vec4(1.0f, 1.0f, 0.0f, 1.0f), roomLightColor, roomLightPos, 1.0f, 2.0f });
+	GLuint matAmp = gScene.AddMaterial({ glm::vec4(0.5f, 0.5f, 0.0f, 1.0f), propLightColor, ampLightPos, 0.1f, 10.0f });
+	GLuint matMetal = gScene.AddMaterial({ glm::vec4(1.0f, 1.0f, 0.0f, 1.0f), propLightColor, ampLightPos, 0.1f, 10.0f });
+	GLuint matCatToy = gScene.AddMaterial({ glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), propLightColor, ampLightPos, 0.1f, 10.0f });
+	GLuint matGuitarLower = gScene.AddMaterial({ glm::vec4(1.0f, 1.0f, 0.0f, 1.0f), propLightColor, glm::vec3(-3.1f, 1.18f, -1.0f), 0.1f, 0.5f });
+	GLuint matGuitarUpper = gScene.AddMaterial({ glm::vec4(1.0f, 1.0f, 0.0f, 1.0f), propLightColor, glm::vec3(-3.1f, 2.2f, -1.0f), 0.1f, 0.5f });
+	GLuint matGuitarNeck = gScene.AddMaterial({ glm::vec4(0.5f, 0.5f, 0.0f, 1.0f), propLightColor, glm::vec3(-3.1f, 2.2f, -1.0f), 0.1f, 0.5f });
+
 	// Floor
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPlaneMesh.vao);
+	gScene.AddEntity("Floor", meshes.gPlaneMesh, matRed, 0, glm::vec3(6.0f, 1.0f, 6.0f), 0.0f, noAxis, glm::vec3(0.0f, 0.0f, 0.0f));
+
+	// Lamp, anchored at the centre of its base
+	const glm::vec3 lampPos(-1.5f, 0.01f, -5.0f);
+	GLint lamp = gScene.AddGroup("Lamp", Scene::NO_PARENT, lampPos);
+	gScene.AddEntity("Lamp Base", meshes.gCylinderMesh, matLamp, 2, glm::vec3(1.0f, 0.2f, 1.0f), 0.0f, noAxis, glm::vec3(-1.5f, 0.01f, -5.0f) - lampPos, lamp);
+	gScene.AddEntity("Lamp Shaft", rod, matLamp, 2, glm::vec3(0.1f, 9.0f, 0.1f), 0.0f, noAxis, glm::vec3(-1.5f, 0.01f, -5.0f) - lampPos, lamp);
+	gScene.AddEntity("Lamp Top", meshes.gConeMesh, matFrostedGlass, 1, glm::vec3(1.2f, 1.2f, 1.2f), glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.5f, 10.0f, -5.0f) - lampPos, lamp);
+
+	// Amps and heater
+	GLuint largeAmp = gScene.AddEntity("Large Amp", meshes.gBoxMesh, matAmp, 3, glm::vec3(4.0f, 2.5f, 2.2f), 0.0f, noAxis, glm::vec3(2.0f, 1.27f, -4.8f));
+	GLuint smallAmp = gScene.AddEntity("Small Amp", meshes.gBoxMesh, matAmp, 3, glm::vec3(2.6f, 1.8f, 1.5f), 0.0f, noAxis, glm::vec3(3.25f, 0.91f, -2.8f));
+	GLuint heater = gScene.AddEntity("Space Heater", meshes.gCylinderMesh, matMetal, 5, glm::vec3(0.45f, 2.0f, 0.45f), 0.0f, noAxis, glm::vec3(3.5f, 0.01f, -0.5f));
+
+	// The amps and heater are solid enough to hide what is behind them; the heater's
+	// box is the square that fits inside the unit cylinder
+	gScene.AddOccluder(largeAmp, meshes.gBoxMesh.boundsMin, meshes.gBoxMesh.boundsMax);
+	gScene.AddOccluder(smallAmp, meshes.gBoxMesh.boundsMin, meshes.gBoxMesh.boundsMax);
+	gScene.AddOccluder(heater, glm::vec3(-0.7f, 0.0f, -0.7f), glm::vec3(0.7f, 1.0f, 0.7f));
+
+	// Cat toy, anchored on the floor below the stacked rings
+	const glm::vec3 catToyPos(0.0f, 0.0f, 1.0f);
+	GLint catToy = gScene.AddGroup("Cat Toy", Scene::NO_PARENT, catToyPos);
+	gScene.AddEntity("Cat Toy Base", meshes.gTorusMesh, matCatToy, 4, glm::vec3(0.8f, 0.8f, 1.5f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.15f, 1.0f) - catToyPos, catToy);
+	gScene.AddEntity("Cat Toy Middle", meshes.gTorusMesh, matCatToy, 4, glm::vec3(0.7f, 0.7f, 1.5f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.45f, 1.0f) - catToyPos, catToy);
+	gScene.AddEntity("Cat Toy Top", meshes.gTorusMesh, matCatToy, 4, glm::vec3(0.6f, 0.6f, 1.5f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.7f, 1.0f) - catToyPos, catToy);
+
+	// Guitar Stand, anchored at the bottom of the main post
+	const glm::vec3 standPos(-4.05f, 0.4f, -1.7f);
+	GLint stand = gScene.AddGroup("Guitar Stand", Scene::NO_PARENT, standPos);
+	gScene.AddEntity("Stand Right Leg", rod, matMetal, 2, glm::vec3(0.1f, 1.5f, 0.1f), glm::radians(80.0f), glm::vec3(0.0f, 0.2f, 1.0f), glm::vec3(-2.5f, 0.1f, -2.0f) - standPos, stand);
+	gScene.AddEntity("Stand Left Leg", rod, matMetal, 2, glm::vec3(0.1f, 1.5f, 0.1f), glm::radians(80.0f), glm::vec3(-1.2f, 0.3f, -1.0f), glm::vec3(-4.8f, 0.1f, -0.4f) - standPos, stand);
+	gScene.AddEntity("Stand Back Leg", rod, matMetal, 2, glm::vec3(0.1f, 0.7f, 0.1f), glm::radians(60.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-4.5f, 0.1f, -2.2f) - standPos, stand);
+	gScene.AddEntity("Stand Main Post", rod, matMetal, 2, glm::vec3(0.1f, 3.0f, 0.1f), 0.0f, noAxis, glm::vec3(-4.05f, 0.4f, -1.7f) - standPos, stand);
+	gScene.AddEntity("Stand Bottom Holder Connection", rod, matMetal, 2, glm::vec3(0.1f, 0.4f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-4.05f, 0.5f, -1.7f) - standPos, stand);
+	gScene.AddEntity("Stand Bottom Holder Back", rod, matMetal, 2, glm::vec3(0.1f, 1.3f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(-3.3f, 0.5f, -1.8f) - standPos, stand);
+	gScene.AddEntity("Stand Bottom Holder Right", rod, matMetal, 2, glm::vec3(0.1f, 1.0f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-3.4f, 0.5f, -1.8f) - standPos, stand);
+	gScene.AddEntity("Stand Bottom Holder Left", rod, matMetal, 2, glm::vec3(0.1f, 1.0f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-4.2f, 0.5f, -1.0f) - standPos, stand);
+	gScene.AddEntity("Stand Top Holder Connection", rod, matMetal, 2, glm::vec3(0.1f, 0.4f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-4.05f, 3.3f, -1.7f) - standPos, stand);
+	gScene.AddEntity("Stand Top Holder Back", rod, matMetal, 2, glm::vec3(0.1f, 0.5f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(-3.55f, 3.3f, -1.55f) - standPos, stand);
+	gScene.AddEntity("Stand Top Holder Right", rod, matMetal, 2, glm::vec3(0.1f, 0.5f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-3.55f, 3.3f, -1.65f) - standPos, stand);
+	gScene.AddEntity("Stand Top Holder Left", rod, matMetal, 2, glm::vec3(0.1f, 0.5f, 0.1f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-4.0f, 3.3f, -1.2f) - standPos, stand);
+
+	// Guitar, resting in the stand so it follows the stand when that moves
+	const glm::vec3 guitarPos(-3.6f, 1.18f, -1.2f);
+	GLint guitar = gScene.AddGroup("Guitar", stand, guitarPos - standPos);
+	gScene.AddEntity("Guitar Lower Body", meshes.gCylinderMesh, matGuitarLower, 6, glm::vec3(0.8f, 0.25f, 0.8f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-3.6f, 1.18f, -1.2f) - guitarPos, guitar);
+	gScene.AddEntity("Guitar Upper Body", meshes.gCylinderMesh, matGuitarUpper, 6, glm::vec3(0.6f, 0.23f, 0.6f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-3.59f, 2.2f, -1.19f) - guitarPos, guitar);
+	gScene.AddEntity("Guitar Neck", meshes.gBoxMesh, matGuitarNeck, 7, glm::vec3(0.25f, 2.0f, 0.1f), glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(-3.5f, 3.6f, -1.1f) - guitarPos, guitar);
+	gScene.AddEntity("Guitar Head", meshes.gBoxMesh, matGuitarNeck, 8, glm::vec3(0.35f, 0.5f, 0.08f), glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(-3.5f, 4.8f, -1.1f) - guitarPos, guitar);
+}
 
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(6.0f, 1.0f, 6.0f));
-	// 2. Rotate the object
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(0.0f, 0.0f, 0.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 0.0f, 0.0f, 1.0f);
+// Copy the camera, toggles and requests into the back snapshot and hand it to the render thread
+void UPublishSnapshot()
+{
+	FrameSnapshot& snapshot = gSnapshots.Back();
+	snapshot.step = gClock.stats.steps;
+	snapshot.stepTime = gClock.StepTime();
+	snapshot.droppedTime = gClock.stats.dropped;
+	snapshot.previousCamera = gPreviousCamera;
+	snapshot.camera = UCameraState();
+	snapshot.framebufferWidth = gFramebufferWidth;
+	snapshot.framebufferHeight = gFramebufferHeight;
+	snapshot.settings = gSettings;
+	snapshot.transforms = gDrivenTransforms;    // reuses the slot's capacity once it has grown
+	snapshot.pickRequests = gPickRequests;
+	snapshot.statsRequests = gStatsRequests;
+	gSnapshots.Publish();
+}
 
-	//reference texture slot 0 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+// Render thread: owns the GL context and draws the latest snapshot until the input thread stops it
+void URenderLoop()
+{
+	glfwMakeContextCurrent(gWindow);
 
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	///////////////////////////////////////////////////////////////////////////////
+	int viewportWidth = 0;
+	int viewportHeight = 0;
+	unsigned long picksDone = 0;
+	unsigned long statsDone = 0;
 
+	while (gRendering)
+	{
+		// a frame without a new snapshot draws the previous one again
+		gSnapshots.Acquire();
+		const FrameSnapshot& snapshot = gSnapshots.Front();
 
-	///////////////////////////////////////////////////////////////////////////////
-	// Lamp
-	// Lamp Base
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(1.0f, 0.2f, 1.0f));
-	// 2. Rotate the object
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-1.5f, 0.01f, -5.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Lamp Shaft
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 9.0f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-1.5f, 0.01f, -5.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Lamp Top
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gConeMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(1.2f, 1.2f, 1.2f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(180.0f), glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-1.5f, 10.0f, -5.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	//reference texture slot 1 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 1);
-
-	//glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 0.0f, 1.0f, 1.0f);
-	glUniform4f(objectColorLoc, 1.0f, 0.0f, 0.0f, 1.0f);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	///////////////////////////////////////////////////////////////////////////////
+		// draw one step behind, between the two latest steps, whatever rate frames come at
+		const float alpha = SimulationClock::Alpha(snapshot.stepTime, glfwGetTime());
+		const CameraState camera = InterpolateCamera(snapshot.previousCamera, snapshot.camera, alpha);
 
+		if (snapshot.framebufferWidth != viewportWidth || snapshot.framebufferHeight != viewportHeight)
+		{
+			viewportWidth = snapshot.framebufferWidth;
+			viewportHeight = snapshot.framebufferHeight;
+			glViewport(0, 0, viewportWidth, viewportHeight);
+		}
 
-	///////////////////////////////////////////////////////////////////////////////
-	// Large Amp
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gBoxMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(4.0f, 2.5f, 2.2f));
-	// 2. Rotate the object
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(2.0f, 1.27f, -4.8f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 0.5f, 0.5f, 0.0f, 1.0f);
-
-	//reference texture slot 3 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 3);
-
-	glUniform3f(light1ColLoc, 0.6f, 0.6f, 0.3f);
-	glUniform3f(light1PosLoc, 2.0f, 5.0f, -4.8f);
-	//set specular intensity
-	glUniform1f(specInt1Loc, 0.1f);
-	//set specular highlight size
-	glUniform1f(highlghtSz1Loc, 10.0f);
-
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	///////////////////////////////////////////////////////////////////////////////
+		gQueries.mode = (OcclusionQueries::Mode)snapshot.settings.queryMode;
+		gRenderer.SetWorkerPool(snapshot.settings.parallelFrame ? &gWorkers : nullptr);
+		gCuller.SetWorkerPool(snapshot.settings.parallelFrame ? &gWorkers : nullptr);
+		gOcclusion.SetWorkerPool(snapshot.settings.parallelFrame ? &gWorkers : nullptr);
+		gLods.SetWorkerPool(snapshot.settings.parallelFrame ? &gWorkers : nullptr);
 
+		// driven nodes move between steps too, so they are set every frame
+		for (const TransformState& transform : snapshot.transforms)
+			gScene.SetLocalTransform(transform.node, InterpolateTransform(transform, alpha));
 
-	///////////////////////////////////////////////////////////////////////////////
-	// Small Amp
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gBoxMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(2.6f, 1.8f, 1.5f));
-	// 2. Rotate the object
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(3.25f, 0.91f, -2.8f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 0.5f, 0.5f, 0.0f, 1.0f);
-
-	//reference texture slot 3 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 3);
-
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	///////////////////////////////////////////////////////////////////////////////
+		URender(snapshot, camera);
 
+		// requests are counters, clicks that land between two frames are answered once
+		if (snapshot.pickRequests != picksDone)
+		{
+			picksDone = snapshot.pickRequests;
+			// the cursor is captured for mouse look, so picking goes through the centre of the view
+			UPickObject(camera, WINDOW_WIDTH / 2.0, WINDOW_HEIGHT / 2.0);
+		}
+		if (snapshot.statsRequests != statsDone)
+		{
+			statsDone = snapshot.statsRequests;
+			UPrintStats(snapshot);
+		}
+	}
 
-	///////////////////////////////////////////////////////////////////////////////
-	// Space Heater
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.45f, 2.0f, 0.45f));
-	// 2. Rotate the object
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(3.5f, 0.01f, -0.5f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 5 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 5);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	///////////////////////////////////////////////////////////////////////////////
+	glfwMakeContextCurrent(NULL);
+}
 
 
-	///////////////////////////////////////////////////////////////////////////////
-	// Cat toy
-	// Base
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTorusMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.8f, 0.8f, 1.5f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(0.0f, 0.15f, 1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 0.0f, 0.0f, 1.0f, 1.0f);
-
-	//reference texture slot 4 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Middle
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTorusMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.7f, 0.7f, 1.5f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(0.0f, 0.45f, 1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 0.0f, 0.0f, 1.0f, 1.0f);
-
-	//reference texture slot 4 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Top
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTorusMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.6f, 0.6f, 1.5f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(0.0f, 0.7f, 1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 0.0f, 0.0f, 1.0f, 1.0f);
-
-	//reference texture slot 4 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	///////////////////////////////////////////////////////////////////////////////
+// Functioned called to render a frame from a snapshot and the camera blended for it, on the render thread
+void URender(const FrameSnapshot& snapshot, const CameraState& camera) {
+	const RenderSettings& settings = snapshot.settings;
 
+	glm::mat4 view;
+	glm::mat4 projection;
+	// Nothing below may query a uniform location, compare the counter across the frame
+	const unsigned long locationQueries = ProgramReflection::LocationQueries();
 
-	///////////////////////////////////////////////////////////////////////////////
-	// Guitar Stand
-	// Right leg
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 1.5f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(80.0f), glm::vec3(0.0, 0.2f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-2.5f, 0.1f, -2.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Left leg
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 1.5f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(80.0f), glm::vec3(-1.2f, 0.3f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-4.8f, 0.1f, -0.4f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Back leg
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 0.7f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(60.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-4.5f, 0.1f, -2.2f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Main post
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 3.0f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-4.05f, 0.4f, -1.7f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Bottom Holder Connection
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 0.4f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-4.05f, 0.5f, -1.7f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Bottom Holder Back
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 1.3f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.3f, 0.5f, -1.8f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Bottom Holder Right
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 1.0f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.4f, 0.5f, -1.8f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Bottom Holder Left
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 1.0f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-4.2f, 0.5f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	
-	// Top Holder Connection
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 0.4f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-4.05f, 3.3f, -1.7f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Top Holder Back
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 0.5f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.55f, 3.3f, -1.55f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Top Holder Right
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 0.5f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.55f, 3.3f, -1.65f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Top Holder Left
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.1f, 0.5f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-4.0f, 3.3f, -1.2f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-	///////////////////////////////////////////////////////////////////////////////
+	// Count this frame's state calls from here
+	GLState::BeginFrame();
 
+	// Enable z-depth
+	GLState::Enable(GL_DEPTH_TEST);
 
-	///////////////////////////////////////////////////////////////////////////////
-	// Guitar
-	// Lower Body
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.8f, 0.25f, 0.8f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.6f, 1.18f, -1.2f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 6);
+	// Clear the frame and z buffers
+	glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glUniform3f(light1ColLoc, 0.6f, 0.6f, 0.3f);
-	glUniform3f(light1PosLoc, -3.1f, 1.18f, -1.0f);
-	//set specular intensity
-	glUniform1f(specInt1Loc, 0.1f);
-
-	//set specular highlight size
-	glUniform1f(highlghtSz1Loc, 0.5f);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-
-	// Upper Body
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.6f, 0.23f, 0.6f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, -1.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.59f, 2.2f, -1.19f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 1.0f, 1.0f, 0.0f, 1.0f);
-
-	//reference texture slot 2 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 6);
-
-	glUniform3f(light1ColLoc, 0.6f, 0.6f, 0.3f);
-	glUniform3f(light1PosLoc, -3.1f, 2.2f, -1.0f);
-	//set specular intensity
-	glUniform1f(specInt1Loc, 0.1f);
-
-	//set specular highlight size
-	glUniform1f(highlghtSz1Loc, 0.5f);
-
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-
-	// Neck
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gBoxMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.25f, 2.0f, 0.1f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.5f, 3.6f, -1.1f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glProgramUniform4f(gProgramId, objectColorLoc, 0.5f, 0.5f, 0.0f, 1.0f);
-
-	//reference texture slot 7 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 7);
-
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
-
-	// Head
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gBoxMesh.vao);
-
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.35f, 0.5f, 0.08f));
-	// 2. Rotate the object
-	rotation = glm::rotate(glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	// 3. Position the object
-	translation = glm::translate(glm::vec3(-3.5f, 4.8f, -1.1f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+	// Transforms the camera
+	view = CameraView(camera);
+
+	// Creates the perspective projection
+	projection = UProjectionMatrix(camera.zoom);
+
+
+	// Camera and frame-wide lighting, uploaded once and shared by every program
+	FrameBlock frame;
+	frame.view = view;
+	frame.projection = projection;
+	frame.viewPosition = glm::vec4(camera.position, 1.0f);
+	//set ambient color and lighting strength
+	frame.ambientLight = glm::vec4(0.5f, 0.5f, 0.5f, 0.5f);
+	frame.light2Color = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+	frame.light2Position = glm::vec4(0.0f, 5.0f, 3.0f, 1.0f);
+	//set specular intensity and highlight size of the fill light
+	frame.light2Specular = glm::vec4(0.1f, 10.0f, 0.0f, 0.0f);
+	frame.uvScale = gUVScale;
+	frame.hasTexture = true;
+	frame.pad0 = 0;
+	gFrameBlock.Update(frame);
+
+
+	// Refresh the world matrices of anything that moved, a static frame does no matrix math
+	const GLuint moved = gScene.UpdateTransforms();
+	// Keep the hierarchy in step, a refit when something moved and a rebuild when it degraded
+	gBvh.Update(gScene, moved > 0);
+
+	// Only entities whose bounds touch the view frustum reach draw submission
+	if (settings.culling)
+	{
+		gCuller.SetFrustum(view, projection, (float)WINDOW_HEIGHT, settings.minPixelRadius);
+		if (settings.bvhCulling)
+			gCuller.CullHierarchy(gScene, gBvh, gVisible);
+		else
+			gCuller.Cull(gScene, gVisible);
 
-	glProgramUniform4f(gProgramId, objectColorLoc, 0.5f, 0.5f, 0.0f, 1.0f);
+		// then drop what the occluders hide
+		if (settings.occlusion)
+		{
+			gOcclusion.Render(gScene, projection * view, gVisible.data());
+			gOcclusion.Cull(gScene, gVisible);
+		}
+	}
+	else
+	{
+		gVisible.assign(gScene.Count(), 1);
+	}
 
-	//reference texture slot 7 before drawing
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 8);
+	// Answers of earlier frames' box queries, hidden entities are skipped or drawn conditionally
+	gQueries.BeginFrame(gScene, gVisible);
 
-	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	// What is left is drawn at the coarsest level that still looks the same at its size on screen
+	if (settings.lod)
+	{
+		gLods.SetView(view, projection, (float)WINDOW_HEIGHT, settings.lodBias);
+		gLods.Select(gScene, gVisible.data(), gLodLevels);
+	}
+	else
+	{
+		gLodLevels.assign(gScene.Count(), 0);
+		gLods.stats = {};
+	}
 
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
 	///////////////////////////////////////////////////////////////////////////////
+	// Draw every entity in the scene store, sorted by state and depth, one indirect multi-draw per texture
+	gRenderer.Prepare(gScene, view, gVisible.data(), gLodLevels.data());
 
+	if (settings.depthPrePass)
+	{
+		// depth only, fetching 12 bytes per vertex and running no lighting
+		GLState::UseProgram(gDepthProgramId);
+		GLState::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		gRenderer.DrawDepth();
+		GLState::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		// only the nearest fragment of each pixel passes, so Phong runs once per pixel
+		GLState::DepthFunc(GL_EQUAL);
+		GLState::DepthMask(GL_FALSE);
+	}
 
 	// Set the shader to be used
-	glUseProgram(gLightProgramId);
+	GLState::UseProgram(gProgramId);
+	gRenderer.DrawSurface(gSurfaceUniforms, gQueries.Conditions());
+
+	// Transparent surfaces last, back to front, tested against the opaque depth but not writing it
+	GLState::DepthFunc(GL_LESS);
+	GLState::DepthMask(GL_FALSE);
+	GLState::Enable(GL_BLEND);
+	GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gRenderer.DrawTransparent(gSurfaceUniforms, gQueries.Conditions());
+	GLState::Disable(GL_BLEND);
+	gRenderer.Finish();
+
+	GLState::DepthMask(GL_TRUE);
+	///////////////////////////////////////////////////////////////////////////////
 
-	// Retrieves and passes transform matrices to the Shader program
-	modelLoc = glGetUniformLocation(gLightProgramId, "model");
-	viewLoc = glGetUniformLocation(gLightProgramId, "view");
-	projLoc = glGetUniformLocation(gLightProgramId, "projection");
+	// Test the boxes against the finished depth buffer, read back in later frames
+	gQueries.IssueQueries(gScene, camera.position);
 
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
-	glUseProgram(0);
+	if (ProgramReflection::LocationQueries() != locationQueries)
+		cout << "WARNING: " << ProgramReflection::LocationQueries() - locationQueries << " uniform location queries in a steady-state frame" << endl;
 	 
-	// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+	// glfw: swap buffers, events are polled on the input thread
 	glfwSwapBuffers(gWindow);    // Flips the the back buffer with the front buffer every frame.
 }
 
@@ -1445,7 +1390,8 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 		return false;
 	}
 
-	glUseProgram(programId);    // Uses the shader program
+	// Enumerate uniforms, blocks and samplers once while the program is fresh
+	ProgramReflection::Reflect(programId);
 
 	return true;
 }
@@ -1453,7 +1399,16 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 
 void UDestroyShaderProgram(GLuint programId)
 {
-	glDeleteProgram(programId);
+	ProgramReflection::Forget(programId);
+	GLState::DeleteProgram(programId);
+}
+
+
+// Resolve every uniform location URender uses from the cached program reflection
+void UResolveUniforms()
+{
+	const ProgramReflection& surface = *ProgramReflection::Find(gProgramId);
+	gSurfaceUniforms.texture = surface.Location("uTexture");
 }
 
 /*Generate and load the texture*/
@@ -1461,46 +1416,54 @@ bool UCreateTexture(const char* filename, GLuint& textureId)
 {
 	int width, height, channels;
 	unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
-	if (image)
+	if (!image)
+		return false; // Error loading the image
+
+	GLenum internalFormat, format;
+	if (channels == 3)
 	{
-		flipImageVertically(image, width, height, channels);
-
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		if (channels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		else if (channels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			cout << "Not implemented to handle image with " << channels << " channels" << endl;
-			return false;
-		}
+		internalFormat = GL_RGB8;
+		format = GL_RGB;
+	}
+	else if (channels == 4)
+	{
+		internalFormat = GL_RGBA8;
+		format = GL_RGBA;
+	}
+	else
+	{
+		cout << "Not implemented to handle image with " << channels << " channels" << endl;
+		stbi_image_free(image);
+		return false;
+	}
 
-		glGenerateMipmap(GL_TEXTURE_2D);
+	flipImageVertically(image, width, height, channels);
 
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	glGenTextures(1, &textureId);
+	// through the shadow, so unit 0 is known to hold this texture afterwards
+	GLState::BindTexture(0, GL_TEXTURE_2D, textureId);
 
-		return true;
-	}
-	
-	// Error loading the image
-	return false;
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, image);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	stbi_image_free(image);
+	GLState::BindTexture(0, GL_TEXTURE_2D, 0); // Unbind the texture
+
+	return true;
 }
 
 
 void UDestroyTexture(GLuint textureId)
 {
-	glGenTextures(1, &textureId);
+	// clears every texture unit shadow that still holds it
+	GLState::DeleteTextures(1, &textureId);
 }
 
 
@@ -0,0 +1,1344 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.cpp
+// ========
+// command line benchmarks of the CPU side systems, run instead of the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "bvh.h"
+#include "culling.h"
+#include "drawlist.h"
+#include "lod.h"
+#include "meshcache.h"
+#include "meshgeometry.h"
+#include "occlusion.h"
+#include "primitives.h"
+#include "scene.h"
+#include "vertexcache.h"
+#include "vertexformat.h"
+#include "workerpool.h"
+
+using namespace std;
+
+namespace
+{
+	typedef chrono::steady_clock Clock;
+
+	// Microseconds elapsed since start
+	double UMicroseconds(Clock::time_point start)
+	{
+		return chrono::duration<double, micro>(Clock::now() - start).count();
+	}
+
+	// Unit box mesh centred on the origin, only the bounds are read on the CPU
+	Meshes::GLMesh UUnitBox()
+	{
+		Meshes::GLMesh box = {};
+		box.boundsMin = glm::vec3(-0.5f);
+		box.boundsMax = glm::vec3(0.5f);
+		box.sphereCenter = glm::vec3(0.0f);
+		box.sphereRadius = glm::length(glm::vec3(0.5f));
+		return box;
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkBvh()
+	//
+	//	For growing prop counts, time a full build, a
+	//	refit after a tenth of the props moved and
+	//	random ray casts. Rays are also cast against
+	//	every prop without the tree on the smaller
+	//	scenes, to check the tree finds the same hits.
+	///////////////////////////////////////////////////
+	void UBenchmarkBvh()
+	{
+		const GLuint counts[] = { 1000, 10000, 100000 };
+		const int BUILDS = 5;
+		const int RAYS = 100000;
+
+		const Meshes::GLMesh box = UUnitBox();
+
+		cout << "BVH benchmark (times in microseconds)" << endl;
+		cout << setw(8) << "props" << setw(8) << "nodes" << setw(12) << "build" << setw(12) << "refit"
+			<< setw(12) << "ray" << setw(12) << "ray nodes" << setw(12) << "brute ray" << setw(12) << "mismatches" << endl;
+
+		for (GLuint count : counts)
+		{
+			mt19937 random(1234);
+			// keep the density constant: roughly one prop per 8 cubic units
+			const float side = 2.0f * std::cbrt((float)count);
+			uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+			uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+			Scene scene;
+			scene.AddMaterial({ glm::vec4(1.0f), glm::vec3(1.0f), glm::vec3(0.0f), 0.0f, 0.0f });
+			for (GLuint i = 0; i < count; ++i)
+			{
+				const glm::vec3 scale(0.2f + unit(random), 0.2f + unit(random), 0.2f + unit(random));
+				const glm::vec3 axis(unit(random) - 0.5f, unit(random) + 0.1f, unit(random) - 0.5f);
+				const glm::vec3 translation(position(random), position(random), position(random));
+				scene.AddEntity("Prop", box, 0, 0, scale, unit(random) * 6.28f, axis, translation);
+			}
+
+			SceneBvh bvh;
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < BUILDS; ++i)
+				bvh.Build(scene);
+			const double buildTime = UMicroseconds(start) / BUILDS;
+
+			// move a tenth of the props a short distance, then time the refit alone
+			for (GLuint i = 0; i < count; i += 10)
+			{
+				const GLuint node = scene.entityNodes[i];
+				scene.SetLocalTransform(node, glm::translate(glm::vec3(unit(random) - 0.5f, 0.0f, unit(random) - 0.5f)) * scene.nodeLocals[node]);
+			}
+			scene.UpdateTransforms();
+			start = Clock::now();
+			bvh.Refit(scene);
+			const double refitTime = UMicroseconds(start);
+
+			// rays from random points aimed at random props, like a click on something in view
+			vector<glm::vec3> origins(RAYS);
+			vector<glm::vec3> directions(RAYS);
+			for (int i = 0; i < RAYS; ++i)
+			{
+				const GLuint target = (GLuint)(unit(random) * (count - 1));
+				origins[i] = glm::vec3(position(random), position(random), position(random));
+				directions[i] = glm::vec3(scene.boundsX[target], scene.boundsY[target], scene.boundsZ[target]) - origins[i];
+			}
+
+			GLint checksum = 0;
+			unsigned long nodesVisited = 0;
+			start = Clock::now();
+			for (int i = 0; i < RAYS; ++i)
+			{
+				const RayHit hit = bvh.Raycast(scene, origins[i], directions[i], 2.0f);
+				checksum += hit.entity;
+				nodesVisited += hit.nodesVisited;
+			}
+			const double rayTime = UMicroseconds(start) / RAYS;
+
+			// reference: test every prop with the same exact box test the leaves use
+			double bruteTime = 0.0;
+			GLuint mismatches = 0;
+			if (count <= 10000)
+			{
+				const int bruteRays = RAYS / 100;
+				vector<float> bruteHits(bruteRays);
+				start = Clock::now();
+				for (int i = 0; i < bruteRays; ++i)
+				{
+					float closest = 2.0f;
+					for (GLuint e = 0; e < count; ++e)
+					{
+						const glm::mat4 toObject = glm::inverse(scene.models[e]);
+						const glm::vec3 o(toObject * glm::vec4(origins[i], 1.0f));
+						const glm::vec3 inverseDirection = glm::vec3(1.0f) / glm::vec3(toObject * glm::vec4(directions[i], 0.0f));
+						const glm::vec3 t0 = (box.boundsMin - o) * inverseDirection;
+						const glm::vec3 t1 = (box.boundsMax - o) * inverseDirection;
+						const glm::vec3 tNear = glm::min(t0, t1);
+						const glm::vec3 tFar = glm::max(t0, t1);
+						const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+						const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, closest));
+						if (enter <= exit)
+							closest = std::min(closest, enter);
+					}
+					bruteHits[i] = closest;
+				}
+				bruteTime = UMicroseconds(start) / bruteRays;
+
+				// compared by distance, a ray starting inside two props may report either one
+				for (int i = 0; i < bruteRays; ++i)
+				{
+					if (bruteHits[i] != bvh.Raycast(scene, origins[i], directions[i], 2.0f).distance)
+						mismatches++;
+				}
+			}
+
+			cout << setw(8) << count << setw(8) << bvh.Nodes().size() << fixed << setprecision(1)
+				<< setw(12) << buildTime << setw(12) << refitTime << setprecision(3) << setw(12) << rayTime
+				<< setprecision(1) << setw(12) << (double)nodesVisited / RAYS;
+			if (count <= 10000)
+				cout << setprecision(3) << setw(12) << bruteTime << setw(12) << mismatches;
+			else
+				cout << setw(12) << "-" << setw(12) << "-";
+			cout << defaultfloat << "    (checksum " << checksum << ")" << endl;
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkOcclusion()
+	//
+	//	A room with a wall and a row of pillars as
+	//	occluders and small props scattered in front of
+	//	and behind them. Time the occluder pass for each
+	//	thread count and the per-prop test, and check
+	//	that no prop whose centre can be seen from the
+	//	camera is culled.
+	///////////////////////////////////////////////////
+	void UBenchmarkOcclusion()
+	{
+		const GLuint counts[] = { 1000, 10000 };
+		const unsigned threadCounts[] = { 1, 2, 4, 8 };
+		const int FRAMES = 50;
+
+		const Meshes::GLMesh box = UUnitBox();
+		const glm::vec3 eye(0.0f, 1.5f, 10.0f);
+		const glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f)
+			* glm::lookAt(eye, glm::vec3(0.0f, 1.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		cout << "Occlusion benchmark (" << OcclusionCuller::WIDTH << "x" << OcclusionCuller::HEIGHT << " buffer, times in microseconds)" << endl;
+		cout << setw(8) << "props" << setw(10) << "threads" << setw(12) << "raster" << setw(12) << "test"
+			<< setw(10) << "occluded" << setw(10) << "errors" << endl;
+
+		for (GLuint count : counts)
+		{
+			mt19937 random(1234);
+			uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+			Scene scene;
+			scene.AddMaterial({ glm::vec4(1.0f), glm::vec3(1.0f), glm::vec3(0.0f), 0.0f, 0.0f });
+
+			// a wall across the middle of the room and pillars in front of it
+			const GLuint wall = scene.AddEntity("Wall", box, 0, 0, glm::vec3(8.0f, 3.0f, 0.5f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.5f, 0.0f));
+			scene.AddOccluder(wall, box.boundsMin, box.boundsMax);
+			for (int i = 0; i < 6; ++i)
+			{
+				const GLuint pillar = scene.AddEntity("Pillar", box, 0, 0, glm::vec3(0.6f, 3.0f, 0.6f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(-5.0f + 2.0f * i, 1.5f, 3.0f));
+				scene.AddOccluder(pillar, box.boundsMin, box.boundsMax);
+			}
+			const size_t firstProp = scene.Count();
+
+			for (GLuint i = 0; i < count; ++i)
+			{
+				const glm::vec3 position(unit(random) * 12.0f - 6.0f, unit(random) * 3.0f, unit(random) * 14.0f - 10.0f);
+				scene.AddEntity("Prop", box, 0, 0, glm::vec3(0.2f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f), position);
+			}
+
+			for (unsigned threads : threadCounts)
+			{
+				WorkerPool pool;
+				pool.Start(threads);
+
+				OcclusionCuller culler;
+				culler.SetWorkerPool(&pool);
+
+				vector<unsigned char> visible;
+				double rasterTime = 0.0;
+				double testTime = 0.0;
+				for (int frame = 0; frame < FRAMES; ++frame)
+				{
+					visible.assign(scene.Count(), 1);
+
+					Clock::time_point start = Clock::now();
+					culler.Render(scene, viewProjection, nullptr);
+					rasterTime += UMicroseconds(start);
+
+					start = Clock::now();
+					culler.Cull(scene, visible);
+					testTime += UMicroseconds(start);
+				}
+
+				// a culled prop whose centre the camera can see through every occluder is an error
+				GLuint errors = 0;
+				for (size_t i = firstProp; i < scene.Count(); ++i)
+				{
+					if (visible[i])
+						continue;
+
+					const glm::vec3 center(scene.boundsX[i], scene.boundsY[i], scene.boundsZ[i]);
+					const glm::vec3 inverseDirection = glm::vec3(1.0f) / (center - eye);
+					bool hidden = false;
+					for (const SceneOccluder& occluder : scene.occluders)
+					{
+						const glm::vec3 t0 = (scene.boundsMin[occluder.entity] - eye) * inverseDirection;
+						const glm::vec3 t1 = (scene.boundsMax[occluder.entity] - eye) * inverseDirection;
+						const glm::vec3 tNear = glm::min(t0, t1);
+						const glm::vec3 tFar = glm::max(t0, t1);
+						const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+						const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, 1.0f));
+						hidden = hidden || enter <= exit;
+					}
+					if (!hidden)
+						errors++;
+				}
+
+				cout << setw(8) << count << setw(10) << threads << fixed << setprecision(1)
+					<< setw(12) << rasterTime / FRAMES << setw(12) << testTime / FRAMES
+					<< setw(10) << culler.stats.occluded << setw(10) << errors << defaultfloat << endl;
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkFrame()
+	//
+	//	Large scenes of props spread over a few meshes
+	//	and textures, seen from inside. Time frustum
+	//	culling and draw list building for each thread
+	//	count, and check that the draw records and
+	//	commands match the single threaded build.
+	///////////////////////////////////////////////////
+	void UBenchmarkFrame()
+	{
+		const GLuint counts[] = { 50000, 200000 };
+		const unsigned threadCounts[] = { 1, 2, 4, 8 };
+		const GLuint MESHES = 6;
+		const GLuint TEXTURES = 8;
+		const int FRAMES = 20;
+
+		// distinct meshes as far as batching is concerned, same bounds
+		Meshes::GLMesh meshes[MESHES];
+		for (GLuint m = 0; m < MESHES; ++m)
+		{
+			meshes[m] = UUnitBox();
+			meshes[m].nIndices = 36;
+			meshes[m].firstIndex = 36 * m;
+		}
+
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.2f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		cout << "Frame benchmark: culling and draw list building (times in microseconds, " << std::thread::hardware_concurrency() << " hardware threads)" << endl;
+		cout << setw(8) << "props" << setw(10) << "threads" << setw(12) << "cull" << setw(12) << "queue"
+			<< setw(12) << "write" << setw(12) << "total" << setw(10) << "speedup" << setw(10) << "drawn"
+			<< setw(10) << "commands" << setw(12) << "mismatches" << endl;
+
+		for (GLuint count : counts)
+		{
+			mt19937 random(1234);
+			const float side = 2.0f * std::cbrt((float)count);
+			uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+			uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+			Scene scene;
+			scene.AddMaterial({ glm::vec4(1.0f), glm::vec3(1.0f), glm::vec3(0.0f), 0.0f, 0.0f });
+			for (GLuint i = 0; i < count; ++i)
+			{
+				const glm::vec3 translation(position(random), position(random), position(random));
+				scene.AddEntity("Prop", meshes[i % MESHES], 0, (GLint)((i / MESHES) % TEXTURES), glm::vec3(0.5f),
+					unit(random) * 6.28f, glm::vec3(0.0f, 1.0f, 0.0f), translation);
+			}
+			scene.UpdateTransforms();
+
+			vector<DrawRecord> referenceRecords;
+			vector<DrawElementsIndirectCommand> referenceCommands;
+			double singleThreadTime = 0.0;
+
+			for (unsigned threads : threadCounts)
+			{
+				WorkerPool pool;
+				pool.Start(threads);
+
+				FrustumCuller culler;
+				culler.SetWorkerPool(&pool);
+				culler.SetFrustum(view, projection, 600.0f, 0.0f);
+
+				DrawListBuilder builder;
+				builder.SetWorkerPool(&pool);
+				builder.SetStates(scene);
+
+				vector<unsigned char> visible;
+				vector<DrawRecord> records(count);
+				double cullTime = 0.0;
+				double queueTime = 0.0;
+				double writeTime = 0.0;
+				GLuint drawn = 0;
+				for (int frame = 0; frame < FRAMES; ++frame)
+				{
+					Clock::time_point start = Clock::now();
+					culler.Cull(scene, visible);
+					cullTime += UMicroseconds(start);
+
+					start = Clock::now();
+					drawn = builder.Queue(scene, view, visible.data());
+					queueTime += UMicroseconds(start);
+
+					start = Clock::now();
+					builder.Write(scene, records.data());
+					writeTime += UMicroseconds(start);
+				}
+
+				const double total = (cullTime + queueTime + writeTime) / FRAMES;
+				if (threads == 1)
+				{
+					singleThreadTime = total;
+					referenceRecords.assign(records.begin(), records.begin() + drawn);
+					referenceCommands = builder.Commands();
+				}
+
+				// any thread count must produce the same records and commands
+				GLuint mismatches = 0;
+				if (referenceCommands.size() != builder.Commands().size() || referenceRecords.size() != drawn)
+					mismatches++;
+				for (size_t c = 0; c < std::min(referenceCommands.size(), builder.Commands().size()); ++c)
+				{
+					if (memcmp(&referenceCommands[c], &builder.Commands()[c], sizeof(DrawElementsIndirectCommand)) != 0)
+						mismatches++;
+				}
+				for (GLuint r = 0; r < std::min((GLuint)referenceRecords.size(), drawn); ++r)
+				{
+					if (memcmp(&referenceRecords[r], &records[r], sizeof(DrawRecord)) != 0)
+						mismatches++;
+				}
+
+				cout << setw(8) << count << setw(10) << pool.ThreadCount() << fixed << setprecision(1)
+					<< setw(12) << cullTime / FRAMES << setw(12) << queueTime / FRAMES << setw(12) << writeTime / FRAMES
+					<< setw(12) << total << setprecision(2) << setw(10) << singleThreadTime / total << defaultfloat
+					<< setw(10) << drawn << setw(10) << builder.Commands().size() << setw(12) << mismatches << endl;
+			}
+		}
+	}
+
+	// Shared by the jobs of UBenchmarkJobs()
+	struct JobBench
+	{
+		WorkerPool* pool;
+		JobCounter* counter;
+		GLuint batch;
+		vector<GLuint> stage;           // Written by the first stage of the dependency test
+		vector<GLuint> sums;            // Written by the second stage
+	};
+
+	void UEmptyJob(void*, GLuint, GLuint)
+	{
+	}
+
+	// Queue a batch of empty jobs from inside the pool, where Run() takes no lock
+	void USpawnJobs(void* data, GLuint, GLuint)
+	{
+		JobBench& bench = *(JobBench*)data;
+		for (GLuint i = 0; i < bench.batch; ++i)
+			bench.pool->Run(UEmptyJob, nullptr, 0, 0, *bench.counter);
+		bench.pool->Wait(*bench.counter);
+	}
+
+	void UWriteStage(void* data, GLuint begin, GLuint)
+	{
+		JobBench& bench = *(JobBench*)data;
+		bench.stage[begin] = begin + 1;
+	}
+
+	// Depends on every UWriteStage() job, so must see all of them
+	void USumStage(void* data, GLuint begin, GLuint)
+	{
+		JobBench& bench = *(JobBench*)data;
+		GLuint sum = 0;
+		for (GLuint value : bench.stage)
+			sum += value;
+		bench.sums[begin] = sum;
+	}
+
+	// Busy work with a result the compiler cannot drop
+	float UWork(GLuint begin, GLuint end)
+	{
+		float sum = 0.0f;
+		for (GLuint i = begin; i < end; ++i)
+			sum += std::sqrt((float)i) * std::sin((float)i);
+		return sum;
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkJobs()
+	//
+	//	For each thread count, time empty jobs queued
+	//	from inside the pool and empty ParallelFor()
+	//	chunks to get the cost of scheduling one job,
+	//	then a loop of real work to get the scaling.
+	//	A two stage job graph checks that a job never
+	//	starts before the counter it depends on.
+	///////////////////////////////////////////////////
+	void UBenchmarkJobs()
+	{
+		const unsigned threadCounts[] = { 1, 2, 4, 8 };
+		const GLuint BATCH = WorkerPool::DEQUE_CAPACITY / 2;
+		const GLuint BATCHES = 50;
+		const GLuint CHUNKS = 100000;
+		const GLuint WORK_ITEMS = 4000000;
+		const GLuint WORK_GRAIN = 4096;
+		const GLuint STAGE_JOBS = 64;
+		const int ROUNDS = 20;
+
+		cout << "Job benchmark (" << std::thread::hardware_concurrency() << " hardware threads, spawn and chunk costs in nanoseconds, work in microseconds)" << endl;
+		cout << setw(10) << "threads" << setw(12) << "spawn" << setw(12) << "chunk" << setw(12) << "work"
+			<< setw(10) << "speedup" << setw(10) << "stolen" << setw(12) << "overflowed" << setw(10) << "errors" << endl;
+
+		double singleThreadWork = 0.0;
+		for (unsigned threads : threadCounts)
+		{
+			WorkerPool pool;
+			pool.Start(threads);
+
+			JobBench bench;
+			bench.pool = &pool;
+			bench.batch = BATCH;
+			bench.stage.assign(STAGE_JOBS, 0);
+			bench.sums.assign(STAGE_JOBS, 0);
+
+			// empty jobs queued and run, one batch at a time so the deque never fills
+			Clock::time_point start = Clock::now();
+			for (GLuint b = 0; b < BATCHES; ++b)
+			{
+				JobCounter spawned;
+				JobCounter root;
+				bench.counter = &spawned;
+				pool.Run(USpawnJobs, &bench, 0, 0, root);
+				pool.Wait(root);
+			}
+			const double spawnTime = UMicroseconds(start) * 1000.0 / (BATCH * BATCHES);
+
+			// empty chunks, split and stolen the way every system's loops are
+			start = Clock::now();
+			pool.ParallelFor(CHUNKS, 1, [](GLuint, GLuint, GLuint) {});
+			const double chunkTime = UMicroseconds(start) * 1000.0 / CHUNKS;
+
+			vector<float> partial(WorkerPool::ChunkCount(WORK_ITEMS, WORK_GRAIN));
+			double workTime = 0.0;
+			for (int round = 0; round < ROUNDS; ++round)
+			{
+				start = Clock::now();
+				pool.ParallelFor(WORK_ITEMS, WORK_GRAIN, [&partial](GLuint begin, GLuint end, GLuint chunk) {
+					partial[chunk] = UWork(begin, end);
+				});
+				workTime += UMicroseconds(start);
+			}
+			workTime /= ROUNDS;
+			if (threads == 1)
+				singleThreadWork = workTime;
+
+			// the second stage is queued right behind the first, each of its jobs must see every write
+			GLuint errors = 0;
+			for (int round = 0; round < ROUNDS; ++round)
+			{
+				std::fill(bench.stage.begin(), bench.stage.end(), 0);
+				JobCounter written;
+				JobCounter summed;
+				for (GLuint j = 0; j < STAGE_JOBS; ++j)
+					pool.Run(UWriteStage, &bench, j, j + 1, written);
+				for (GLuint j = 0; j < STAGE_JOBS; ++j)
+					pool.Run(USumStage, &bench, j, j + 1, summed, &written);
+				pool.Wait(summed);
+
+				for (GLuint sum : bench.sums)
+				{
+					if (sum != STAGE_JOBS * (STAGE_JOBS + 1) / 2)
+						errors++;
+				}
+			}
+
+			const JobStats stats = pool.Statistics();
+			cout << setw(10) << pool.ThreadCount() << fixed << setprecision(1)
+				<< setw(12) << spawnTime << setw(12) << chunkTime << setw(12) << workTime
+				<< setprecision(2) << setw(10) << singleThreadWork / workTime << defaultfloat
+				<< setw(10) << stats.stolen << setw(12) << stats.overflowed << setw(10) << errors << endl;
+		}
+	}
+
+	// Mesh with the detail chain Meshes builds for a round primitive, in no real buffer
+	Meshes::GLMesh UChainMesh(PrimitiveType type, GLuint segments, GLuint rings)
+	{
+		GLuint levelSegments[Meshes::MAX_LODS];
+		GLuint levelRings[Meshes::MAX_LODS];
+		const GLuint levels = PrimitiveLodChain(type, segments, rings, Meshes::MAX_LODS, levelSegments, levelRings);
+
+		Meshes::GLMesh mesh = {};
+		PrimitiveGeometry geometry;
+		for (GLuint level = levels; level-- > 0;)
+		{
+			GeneratePrimitive(type, levelSegments[level], levelRings[level], geometry);
+			Meshes::GLMeshLod& lod = mesh.lods[level];
+			lod.nVertices = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+			lod.nIndices = (GLuint)geometry.indices.size();
+			lod.error = PrimitiveError(type, levelSegments[level], levelRings[level]);
+		}
+		mesh.nLods = levels;
+		mesh.nVertices = mesh.lods[0].nVertices;
+		mesh.nIndices = mesh.lods[0].nIndices;
+
+		// geometry holds level 0 now
+		mesh.boundsMin = glm::vec3(FLT_MAX);
+		mesh.boundsMax = glm::vec3(-FLT_MAX);
+		for (size_t v = 0; v < geometry.vertices.size(); v += Meshes::FLOATS_PER_VERTEX)
+		{
+			const glm::vec3 p(geometry.vertices[v], geometry.vertices[v + 1], geometry.vertices[v + 2]);
+			mesh.boundsMin = glm::min(mesh.boundsMin, p);
+			mesh.boundsMax = glm::max(mesh.boundsMax, p);
+		}
+		mesh.sphereCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+		mesh.sphereRadius = glm::length(mesh.boundsMax - mesh.sphereCenter);
+		return mesh;
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkLod()
+	//
+	//	Scatter cylinders and spheres down a long view
+	//	and count the triangles the chosen levels keep
+	//	for a range of biases. Then dolly the camera
+	//	through the scene and jitter it in place, and
+	//	count how often entities change level: each
+	//	entity should switch a few times on the way
+	//	in and not at all while jittering.
+	///////////////////////////////////////////////////
+	void UBenchmarkLod()
+	{
+		const GLuint COUNT = 20000;
+		const float biases[] = { -2.0f, -1.0f, 0.0f, 1.0f, 2.0f };
+		const int ROUNDS = 20;
+		const int DOLLY_FRAMES = 400;
+		const int JITTER_FRAMES = 200;
+		const float VIEWPORT_HEIGHT = 600.0f;
+
+		const Meshes::GLMesh cylinder = UChainMesh(PRIMITIVE_CYLINDER, Meshes::DEFAULT_SEGMENTS, 1);
+		const Meshes::GLMesh sphere = UChainMesh(PRIMITIVE_SPHERE, Meshes::DEFAULT_SPHERE_SEGMENTS, Meshes::DEFAULT_SPHERE_RINGS);
+
+		mt19937 random(1234);
+		uniform_real_distribution<float> unit(0.0f, 1.0f);
+		Scene scene;
+		scene.AddMaterial({ glm::vec4(1.0f), glm::vec3(1.0f), glm::vec3(0.0f), 0.0f, 0.0f });
+		for (GLuint i = 0; i < COUNT; ++i)
+		{
+			const glm::vec3 translation(unit(random) * 100.0f - 50.0f, unit(random) * 10.0f - 5.0f, -5.0f - unit(random) * 400.0f);
+			scene.AddEntity("Prop", i % 2 == 0 ? cylinder : sphere, 0, 0, glm::vec3(0.3f + unit(random)),
+				unit(random) * 6.28f, glm::vec3(0.0f, 1.0f, 0.0f), translation);
+		}
+
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		cout << "LOD benchmark (" << COUNT << " props, times in microseconds)" << endl;
+		cout << setw(8) << "bias" << setw(10) << "level 0" << setw(10) << "level 1" << setw(10) << "level 2" << setw(10) << "level 3"
+			<< setw(12) << "triangles" << setw(10) << "of full" << setw(10) << "select" << endl;
+
+		LodSelector selector;
+		for (float bias : biases)
+		{
+			vector<unsigned char> levels;
+			selector.SetView(view, projection, VIEWPORT_HEIGHT, bias);
+			selector.Select(scene, nullptr, levels);
+
+			Clock::time_point start = Clock::now();
+			for (int round = 0; round < ROUNDS; ++round)
+				selector.Select(scene, nullptr, levels);
+			const double selectTime = UMicroseconds(start) / ROUNDS;
+
+			const LodStats& stats = selector.stats;
+			cout << setw(8) << bias;
+			for (GLuint level = 0; level < Meshes::MAX_LODS; ++level)
+				cout << setw(10) << stats.levels[level];
+			cout << setw(12) << stats.triangles << fixed << setprecision(1) << setw(9) << 100.0 * stats.triangles / stats.fullTriangles << "%"
+				<< setw(10) << selectTime << defaultfloat << endl;
+		}
+
+		// fly in from behind the scene, then hover, stepping back and forth where the flight ended
+		vector<unsigned char> levels;
+		unsigned long dollySwitches = 0;
+		unsigned long jitterSwitches = 0;
+		const float dollyEnd = 100.0f - (DOLLY_FRAMES - 1) * 0.5f;
+		for (int frame = 0; frame < DOLLY_FRAMES + JITTER_FRAMES; ++frame)
+		{
+			const float z = frame < DOLLY_FRAMES ? 100.0f - frame * 0.5f : dollyEnd + ((frame - DOLLY_FRAMES) & 1) * 0.1f;
+			const glm::mat4 frameView = glm::lookAt(glm::vec3(0.0f, 0.0f, z), glm::vec3(0.0f, 0.0f, z - 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			selector.SetView(frameView, projection, VIEWPORT_HEIGHT, 0.0f);
+			selector.Select(scene, nullptr, levels);
+			// the first frame sets every level from scratch
+			if (frame == 0)
+				continue;
+			(frame < DOLLY_FRAMES ? dollySwitches : jitterSwitches) += selector.stats.switches;
+		}
+		cout << "Dolly over " << DOLLY_FRAMES << " frames: " << dollySwitches << " level switches ("
+			<< setprecision(2) << (double)dollySwitches / COUNT << " per prop)" << defaultfloat << endl;
+		cout << "Jitter over " << JITTER_FRAMES << " frames: " << jitterSwitches << " level switches" << endl;
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkPrimitives()
+	//
+	//	Time SinCos() against std::sin and std::cos and
+	//	report its largest error, then generate every
+	//	round primitive at growing resolutions. Each
+	//	triangle is checked to face the same way as
+	//	the normals of its corners, which catches a
+	//	flipped winding or an index out of place.
+	///////////////////////////////////////////////////
+	void UBenchmarkPrimitives()
+	{
+		const GLuint ANGLES = 1000000;
+		const GLuint resolutions[] = { 8, 16, 36, 64, 128, 256 };
+		const int ROUNDS = 20;
+
+		vector<float> angles(ANGLES), sines(ANGLES), cosines(ANGLES);
+		for (GLuint i = 0; i < ANGLES; ++i)
+			angles[i] = -100.0f + 200.0f * i / ANGLES;
+
+		Clock::time_point start = Clock::now();
+		SinCos(angles.data(), ANGLES, sines.data(), cosines.data());
+		const double simdTime = UMicroseconds(start) * 1000.0 / ANGLES;
+
+		float maxError = 0.0f;
+		start = Clock::now();
+		for (GLuint i = 0; i < ANGLES; ++i)
+		{
+			const float s = std::sin(angles[i]);
+			const float c = std::cos(angles[i]);
+			maxError = std::max(maxError, std::max(std::fabs(s - sines[i]), std::fabs(c - cosines[i])));
+		}
+		const double scalarTime = UMicroseconds(start) * 1000.0 / ANGLES;
+
+		cout << "SinCos: " << fixed << setprecision(2) << simdTime << " ns per angle, std::sin + std::cos "
+			<< scalarTime << " ns, max error " << scientific << maxError << defaultfloat << endl << endl;
+
+		cout << "Primitive benchmark (times in microseconds)" << endl;
+		cout << setw(10) << "primitive" << setw(10) << "segments" << setw(10) << "vertices" << setw(10) << "triangles"
+			<< setw(12) << "generate" << setw(10) << "errors" << endl;
+
+		PrimitiveGeometry geometry;
+		for (GLuint type = 0; type < PRIMITIVE_COUNT; ++type)
+		{
+			for (GLuint segments : resolutions)
+			{
+				// spheres and tori get as many rings as columns, like the default 16 x 16 and 30 x 30 meshes
+				const GLuint rings = type == PRIMITIVE_SPHERE || type == PRIMITIVE_TORUS ? segments : 1;
+
+				start = Clock::now();
+				for (int round = 0; round < ROUNDS; ++round)
+					GeneratePrimitive((PrimitiveType)type, segments, rings, geometry);
+				const double generateTime = UMicroseconds(start) / ROUNDS;
+
+				const GLuint vertexCount = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+				GLuint errors = 0;
+				for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3)
+				{
+					const GLuint* corner = &geometry.indices[i];
+					if (corner[0] >= vertexCount || corner[1] >= vertexCount || corner[2] >= vertexCount)
+					{
+						errors++;
+						continue;
+					}
+
+					glm::vec3 p[3], n(0.0f);
+					for (int k = 0; k < 3; ++k)
+					{
+						const GLfloat* v = &geometry.vertices[corner[k] * Meshes::FLOATS_PER_VERTEX];
+						p[k] = glm::vec3(v[0], v[1], v[2]);
+						n += glm::vec3(v[3], v[4], v[5]);
+					}
+					if (glm::dot(glm::cross(p[1] - p[0], p[2] - p[0]), n) <= 0.0f)
+						errors++;
+				}
+
+				cout << setw(10) << PrimitiveName((PrimitiveType)type) << setw(10) << segments << setw(10) << vertexCount
+					<< setw(10) << geometry.indices.size() / 3 << fixed << setprecision(1) << setw(12) << generateTime
+					<< defaultfloat << setw(10) << errors << endl;
+			}
+		}
+	}
+
+	// Corner positions of a triangle, rotated to start at the smallest so the same
+	// triangle compares equal whichever corner an index list starts it at
+	typedef array<GLfloat, 9> CornerTriangle;
+
+	vector<CornerTriangle> UCornerTriangles(const vector<GLfloat>& vertices, const vector<GLuint>& indices)
+	{
+		vector<CornerTriangle> triangles(indices.size() / 3);
+		for (size_t t = 0; t < triangles.size(); ++t)
+		{
+			CornerTriangle rotations[3];
+			for (int rotation = 0; rotation < 3; ++rotation)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					const GLfloat* v = &vertices[indices[t * 3 + (k + rotation) % 3] * Meshes::FLOATS_PER_VERTEX];
+					copy(v, v + 3, &rotations[rotation][k * 3]);
+				}
+			}
+			triangles[t] = *min_element(rotations, rotations + 3);
+		}
+		sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkVertexCache()
+	//
+	//	Reorder every round primitive at growing
+	//	resolutions, once as generated and once from a
+	//	shuffled triangle order, and report the ACMR
+	//	of each input and result. Every triangle is
+	//	checked to keep its corner positions and
+	//	winding through both reorders.
+	///////////////////////////////////////////////////
+	void UBenchmarkVertexCache()
+	{
+		const GLuint resolutions[] = { 8, 16, 36, 64, 128, 256 };
+		const int ROUNDS = 20;
+
+		cout << "Vertex cache benchmark (" << VERTEX_CACHE_SIZE << " entry FIFO, ACMR in vertices per triangle, times in microseconds)" << endl;
+		cout << setw(10) << "primitive" << setw(10) << "segments" << setw(10) << "triangles" << setw(11) << "generated"
+			<< setw(10) << "->" << setw(10) << "shuffled" << setw(10) << "->" << setw(10) << "optimize" << setw(10) << "errors" << endl;
+
+		mt19937 random(1234);
+		PrimitiveGeometry geometry;
+		for (GLuint type = 0; type < PRIMITIVE_COUNT; ++type)
+		{
+			for (GLuint segments : resolutions)
+			{
+				const GLuint rings = type == PRIMITIVE_SPHERE || type == PRIMITIVE_TORUS ? segments : 1;
+				GeneratePrimitive((PrimitiveType)type, segments, rings, geometry);
+				const GLuint vertexCount = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+				const size_t indexCount = geometry.indices.size();
+				const double triangles = (double)(indexCount / 3);
+
+				// the same triangles in random order, each keeping its winding
+				vector<GLuint> shuffled(geometry.indices);
+				vector<GLuint> order(indexCount / 3);
+				for (GLuint t = 0; t < order.size(); ++t)
+					order[t] = t;
+				shuffle(order.begin(), order.end(), random);
+				for (size_t t = 0; t < order.size(); ++t)
+					copy(&geometry.indices[order[t] * 3], &geometry.indices[order[t] * 3] + 3, &shuffled[t * 3]);
+
+				double acmr[4];
+				double optimizeTime = 0.0;
+				GLuint errors = 0;
+				for (int input = 0; input < 2; ++input)
+				{
+					const vector<GLuint>& source = input == 0 ? geometry.indices : shuffled;
+					acmr[input * 2] = SimulateCacheMisses(source.data(), indexCount, vertexCount) / triangles;
+
+					vector<GLfloat> vertices;
+					vector<GLuint> indices;
+					Clock::time_point start = Clock::now();
+					for (int round = 0; round < ROUNDS; ++round)
+					{
+						vertices = geometry.vertices;
+						indices = source;
+						OptimizeVertexCache(indices.data(), indexCount, vertexCount);
+						OptimizeVertexFetch(vertices.data(), Meshes::FLOATS_PER_VERTEX, vertexCount, indices.data(), indexCount);
+					}
+					if (input == 0)
+						optimizeTime = UMicroseconds(start) / ROUNDS;
+					acmr[input * 2 + 1] = SimulateCacheMisses(indices.data(), indexCount, vertexCount) / triangles;
+
+					// the corner positions of every triangle, sorted, must match the source's
+					const vector<CornerTriangle> before = UCornerTriangles(geometry.vertices, source);
+					const vector<CornerTriangle> after = UCornerTriangles(vertices, indices);
+					for (size_t t = 0; t < before.size(); ++t)
+					{
+						if (before[t] != after[t])
+							errors++;
+					}
+				}
+
+				cout << setw(10) << PrimitiveName((PrimitiveType)type) << setw(10) << segments << setw(10) << indexCount / 3 << fixed << setprecision(3)
+					<< setw(11) << acmr[0] << setw(10) << acmr[1] << setw(10) << acmr[2] << setw(10) << acmr[3]
+					<< setprecision(1) << setw(10) << optimizeTime << defaultfloat << setw(10) << errors << endl;
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkPacking()
+	//
+	//	Pack every round primitive at its default
+	//	resolution, decode it again the way the vertex
+	//	shader does and report the worst position,
+	//	normal and texture coordinate error next to the
+	//	sizes of both layouts. Then time the packing
+	//	and check the octahedral normals over a million
+	//	random directions.
+	///////////////////////////////////////////////////
+	void UBenchmarkPacking()
+	{
+		const GLuint DIRECTIONS = 1000000;
+		const GLuint BENCH_SEGMENTS = 256;
+		const int ROUNDS = 20;
+		const double RADIANS_TO_DEGREES = 57.29577951308232;
+
+		cout << "Packing benchmark (errors: positions in units of the mesh size, normals in degrees)" << endl;
+		cout << setw(10) << "primitive" << setw(10) << "vertices" << setw(12) << "float KB" << setw(12) << "packed KB"
+			<< setw(12) << "position" << setw(10) << "normal" << setw(12) << "uv" << endl;
+
+		PrimitiveGeometry geometry;
+		vector<PackedVertex> packed;
+		for (GLuint type = 0; type < PRIMITIVE_COUNT; ++type)
+		{
+			GLuint segments = Meshes::DEFAULT_SEGMENTS;
+			GLuint rings = 1;
+			if (type == PRIMITIVE_SPHERE)
+			{
+				segments = Meshes::DEFAULT_SPHERE_SEGMENTS;
+				rings = Meshes::DEFAULT_SPHERE_RINGS;
+			}
+			else if (type == PRIMITIVE_TORUS)
+			{
+				segments = Meshes::DEFAULT_TORUS_SEGMENTS;
+				rings = Meshes::DEFAULT_TORUS_RINGS;
+			}
+			GeneratePrimitive((PrimitiveType)type, segments, rings, geometry);
+			const GLuint vertexCount = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+
+			// the cube Meshes packs in: the box corner and its largest side
+			glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+			for (GLuint v = 0; v < vertexCount; ++v)
+			{
+				const GLfloat* p = &geometry.vertices[v * Meshes::FLOATS_PER_VERTEX];
+				low = glm::min(low, glm::vec3(p[0], p[1], p[2]));
+				high = glm::max(high, glm::vec3(p[0], p[1], p[2]));
+			}
+			const glm::vec3 size = high - low;
+			const float scale = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
+
+			packed.resize(vertexCount);
+			PackVertices(geometry.vertices.data(), vertexCount, low, scale, packed.data());
+
+			double positionError = 0.0, normalError = 0.0, uvError = 0.0;
+			for (GLuint v = 0; v < vertexCount; ++v)
+			{
+				const GLfloat* source = &geometry.vertices[v * Meshes::FLOATS_PER_VERTEX];
+				const PackedVertex& vertex = packed[v];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const float decoded = low[axis] + scale * (vertex.position[axis] / 65535.0f);
+					positionError = std::max(positionError, (double)std::fabs(decoded - source[axis]) / scale);
+				}
+
+				const glm::vec3 normal = glm::normalize(glm::vec3(source[3], source[4], source[5]));
+				const float cosine = std::min(glm::dot(normal, DecodeOctahedral(vertex.normal)), 1.0f);
+				normalError = std::max(normalError, std::acos(cosine) * RADIANS_TO_DEGREES);
+
+				uvError = std::max(uvError, (double)std::fabs(HalfToFloat(vertex.uv[0]) - source[6]));
+				uvError = std::max(uvError, (double)std::fabs(HalfToFloat(vertex.uv[1]) - source[7]));
+			}
+
+			cout << setw(10) << PrimitiveName((PrimitiveType)type) << setw(10) << vertexCount << fixed << setprecision(2)
+				<< setw(12) << sizeof(GLfloat) * geometry.vertices.size() / 1024.0 << setw(12) << sizeof(PackedVertex) * vertexCount / 1024.0
+				<< scientific << setprecision(1) << setw(12) << positionError << fixed << setprecision(3) << setw(10) << normalError
+				<< scientific << setprecision(1) << setw(12) << uvError << defaultfloat << endl;
+		}
+
+		GeneratePrimitive(PRIMITIVE_SPHERE, BENCH_SEGMENTS, BENCH_SEGMENTS, geometry);
+		const GLuint vertexCount = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+		packed.resize(vertexCount);
+		Clock::time_point start = Clock::now();
+		for (int round = 0; round < ROUNDS; ++round)
+			PackVertices(geometry.vertices.data(), vertexCount, glm::vec3(-1.0f), 2.0f, packed.data());
+		cout << "Packing a " << vertexCount << " vertex sphere: " << fixed << setprecision(1) << UMicroseconds(start) / ROUNDS
+			<< " us" << defaultfloat << endl;
+
+		mt19937 random(1234);
+		normal_distribution<float> gaussian;
+		double worst = 0.0, total = 0.0;
+		for (GLuint i = 0; i < DIRECTIONS; ++i)
+		{
+			glm::vec3 direction(gaussian(random), gaussian(random), gaussian(random));
+			if (glm::dot(direction, direction) < 1e-12f)
+				continue;
+			direction = glm::normalize(direction);
+			const float cosine = std::min(glm::dot(direction, DecodeOctahedral(EncodeOctahedral(direction))), 1.0f);
+			const double error = std::acos(cosine) * RADIANS_TO_DEGREES;
+			worst = std::max(worst, error);
+			total += error;
+		}
+		cout << "Octahedral normals over " << DIRECTIONS << " directions: " << fixed << setprecision(3) << total / DIRECTIONS
+			<< " degrees mean, " << worst << " worst" << defaultfloat << endl;
+	}
+
+	// Same layout as Vertex in mesh.h, which pulls in the Shader class and its GL calls
+	struct FrameVertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+		glm::vec3 tangent;
+		glm::vec3 bitangent;
+	};
+
+	const GeometryLayout FRAME_VERTEX_LAYOUT = { sizeof(FrameVertex), offsetof(FrameVertex, position), offsetof(FrameVertex, normal),
+		offsetof(FrameVertex, uv), offsetof(FrameVertex, tangent), offsetof(FrameVertex, bitangent) };
+
+	glm::vec3 UVec3(const GLfloat* source)
+	{
+		return glm::vec3(source[0], source[1], source[2]);
+	}
+
+	// Copy interleaved generator vertices into frame vertices, the normals, tangents and bitangents zeroed
+	void UToFrameVertices(const PrimitiveGeometry& geometry, vector<FrameVertex>& vertices)
+	{
+		vertices.resize(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+		for (size_t v = 0; v < vertices.size(); ++v)
+		{
+			const GLfloat* source = &geometry.vertices[v * Meshes::FLOATS_PER_VERTEX];
+			vertices[v] = {};
+			vertices[v].position = glm::vec3(source[0], source[1], source[2]);
+			vertices[v].uv = glm::vec2(source[6], source[7]);
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkGeometry()
+	//
+	//	Recompute the normals of every round primitive
+	//	at its default resolution in the Meshes layout
+	//	and compare them with the generator's exact
+	//	ones; vertices on a texture seam only see the
+	//	faces on their side, which makes the largest
+	//	error. Build tangent frames in the layout of
+	//	mesh.h and check they are orthogonal to the
+	//	normals and agree with the texture directions
+	//	of the faces around them. Then time both on a
+	//	large sphere per thread count, next to a plain
+	//	scalar loop that scatters face normals.
+	///////////////////////////////////////////////////
+	void UBenchmarkGeometry()
+	{
+		const unsigned threadCounts[] = { 1, 2, 4, 8 };
+		const GLuint BENCH_SEGMENTS = 512;
+		const int ROUNDS = 10;
+		const double RADIANS_TO_DEGREES = 57.29577951308232;
+
+		cout << "Geometry benchmark (angles in degrees)" << endl;
+		cout << setw(10) << "primitive" << setw(10) << "vertices" << setw(12) << "normal mean" << setw(12) << "normal max"
+			<< setw(12) << "tangent" << setw(10) << "|n.t|" << setw(10) << "flipped" << endl;
+
+		PrimitiveGeometry geometry;
+		vector<GLfloat> computed;
+		vector<FrameVertex> frames;
+		for (GLuint type = 0; type < PRIMITIVE_COUNT; ++type)
+		{
+			GLuint segments = Meshes::DEFAULT_SEGMENTS;
+			GLuint rings = 1;
+			if (type == PRIMITIVE_SPHERE)
+			{
+				segments = Meshes::DEFAULT_SPHERE_SEGMENTS;
+				rings = Meshes::DEFAULT_SPHERE_RINGS;
+			}
+			else if (type == PRIMITIVE_TORUS)
+			{
+				segments = Meshes::DEFAULT_TORUS_SEGMENTS;
+				rings = Meshes::DEFAULT_TORUS_RINGS;
+			}
+			GeneratePrimitive((PrimitiveType)type, segments, rings, geometry);
+			const GLuint vertexCount = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+			const size_t indexCount = geometry.indices.size();
+
+			computed = geometry.vertices;
+			ComputeNormals(computed.data(), Meshes::VERTEX_LAYOUT, vertexCount, geometry.indices.data(), indexCount);
+			double normalTotal = 0.0, normalWorst = 0.0;
+			for (GLuint v = 0; v < vertexCount; ++v)
+			{
+				const GLfloat* exact = &geometry.vertices[v * Meshes::FLOATS_PER_VERTEX + 3];
+				const GLfloat* normal = &computed[v * Meshes::FLOATS_PER_VERTEX + 3];
+				const float cosine = glm::dot(glm::normalize(glm::vec3(exact[0], exact[1], exact[2])), glm::vec3(normal[0], normal[1], normal[2]));
+				const double error = std::acos(std::min(std::max(cosine, -1.0f), 1.0f)) * RADIANS_TO_DEGREES;
+				normalTotal += error;
+				normalWorst = std::max(normalWorst, error);
+			}
+
+			// the frames are built on the exact normals, so only the tangent code is measured
+			UToFrameVertices(geometry, frames);
+			for (GLuint v = 0; v < vertexCount; ++v)
+			{
+				const GLfloat* exact = &geometry.vertices[v * Meshes::FLOATS_PER_VERTEX + 3];
+				frames[v].normal = glm::normalize(glm::vec3(exact[0], exact[1], exact[2]));
+			}
+			ComputeTangentFrames(frames.data(), FRAME_VERTEX_LAYOUT, vertexCount, geometry.indices.data(), indexCount);
+
+			// every corner's tangent against the u direction of its face, in the plane of the normal
+			double tangentWorst = 0.0, orthogonality = 0.0;
+			GLuint flipped = 0;
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				const FrameVertex& a = frames[geometry.indices[i]];
+				const FrameVertex& b = frames[geometry.indices[i + 1]];
+				const FrameVertex& c = frames[geometry.indices[i + 2]];
+				const glm::vec2 duv1 = b.uv - a.uv, duv2 = c.uv - a.uv;
+				const float area = duv1.x * duv2.y - duv1.y * duv2.x;
+				if (area == 0.0f)
+					continue;
+				const glm::vec3 e1 = b.position - a.position, e2 = c.position - a.position;
+				const glm::vec3 faceTangent = (e1 * duv2.y - e2 * duv1.y) / area;
+				const glm::vec3 faceBitangent = (e2 * duv1.x - e1 * duv2.x) / area;
+
+				for (const FrameVertex* corner : { &a, &b, &c })
+				{
+					const glm::vec3 projected = faceTangent - corner->normal * glm::dot(corner->normal, faceTangent);
+					if (glm::dot(projected, projected) > 1e-12f)
+					{
+						const float cosine = glm::dot(glm::normalize(projected), corner->tangent);
+						tangentWorst = std::max(tangentWorst, std::acos(std::min(std::max(cosine, -1.0f), 1.0f)) * RADIANS_TO_DEGREES);
+					}
+					orthogonality = std::max(orthogonality, (double)std::fabs(glm::dot(corner->normal, corner->tangent)));
+					if (glm::dot(corner->bitangent, faceBitangent) < 0.0f)
+						flipped++;
+				}
+			}
+
+			cout << setw(10) << PrimitiveName((PrimitiveType)type) << setw(10) << vertexCount << fixed << setprecision(3)
+				<< setw(12) << normalTotal / vertexCount << setw(12) << normalWorst << setw(12) << tangentWorst
+				<< scientific << setprecision(1) << setw(10) << orthogonality << defaultfloat << setw(10) << flipped << endl;
+		}
+
+		GeneratePrimitive(PRIMITIVE_SPHERE, BENCH_SEGMENTS, BENCH_SEGMENTS, geometry);
+		const GLuint vertexCount = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+		const size_t indexCount = geometry.indices.size();
+		computed = geometry.vertices;
+		UToFrameVertices(geometry, frames);
+
+		// reference: scatter every face normal into its three vertices, then normalize into the vertices
+		vector<glm::vec3> reference(vertexCount);
+		vector<GLfloat> referenceVertices = geometry.vertices;
+		Clock::time_point start = Clock::now();
+		for (int round = 0; round < ROUNDS; ++round)
+		{
+			std::fill(reference.begin(), reference.end(), glm::vec3(0.0f));
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				const GLuint* triangle = &geometry.indices[i];
+				const glm::vec3 p0 = UVec3(&geometry.vertices[triangle[0] * Meshes::FLOATS_PER_VERTEX]);
+				const glm::vec3 p1 = UVec3(&geometry.vertices[triangle[1] * Meshes::FLOATS_PER_VERTEX]);
+				const glm::vec3 p2 = UVec3(&geometry.vertices[triangle[2] * Meshes::FLOATS_PER_VERTEX]);
+				const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				reference[triangle[0]] += normal;
+				reference[triangle[1]] += normal;
+				reference[triangle[2]] += normal;
+			}
+			for (GLuint v = 0; v < vertexCount; ++v)
+			{
+				const glm::vec3 normal = glm::normalize(reference[v]);
+				GLfloat* target = &referenceVertices[v * Meshes::FLOATS_PER_VERTEX + 3];
+				target[0] = normal.x;
+				target[1] = normal.y;
+				target[2] = normal.z;
+			}
+		}
+		const double referenceTime = UMicroseconds(start) / ROUNDS;
+
+		cout << "Sphere of " << vertexCount << " vertices and " << indexCount / 3 << " triangles (times in microseconds), scalar scatter normals: "
+			<< fixed << setprecision(1) << referenceTime << defaultfloat << endl;
+		cout << setw(10) << "threads" << setw(12) << "normals" << setw(12) << "frames" << setw(10) << "speedup" << setw(12) << "difference"
+			<< setw(12) << "mismatches" << endl;
+
+		// the threads split the work, the bits must not depend on it
+		double singleThreadTime = 0.0;
+		vector<FrameVertex> singleThreadFrames;
+		for (unsigned threads : threadCounts)
+		{
+			WorkerPool pool;
+			pool.Start(threads);
+			WorkerPool* runner = threads > 1 ? &pool : nullptr;
+
+			start = Clock::now();
+			for (int round = 0; round < ROUNDS; ++round)
+				ComputeNormals(computed.data(), Meshes::VERTEX_LAYOUT, vertexCount, geometry.indices.data(), indexCount, runner);
+			const double normalTime = UMicroseconds(start) / ROUNDS;
+
+			for (GLuint v = 0; v < vertexCount; ++v)
+				frames[v].normal = UVec3(&computed[v * Meshes::FLOATS_PER_VERTEX + 3]);
+			start = Clock::now();
+			for (int round = 0; round < ROUNDS; ++round)
+				ComputeTangentFrames(frames.data(), FRAME_VERTEX_LAYOUT, vertexCount, geometry.indices.data(), indexCount, runner);
+			const double frameTime = UMicroseconds(start) / ROUNDS;
+
+			if (threads == 1)
+			{
+				singleThreadTime = normalTime + frameTime;
+				singleThreadFrames = frames;
+			}
+			GLuint mismatches = 0;
+			for (GLuint v = 0; v < vertexCount; ++v)
+			{
+				if (memcmp(&frames[v], &singleThreadFrames[v], sizeof(FrameVertex)) != 0)
+					mismatches++;
+			}
+
+			double difference = 0.0;
+			for (GLuint v = 0; v < vertexCount; ++v)
+				difference = std::max(difference, (double)glm::length(frames[v].normal - UVec3(&referenceVertices[v * Meshes::FLOATS_PER_VERTEX + 3])));
+
+			cout << setw(10) << threads << fixed << setprecision(1) << setw(12) << normalTime << setw(12) << frameTime
+				<< setprecision(2) << setw(10) << singleThreadTime / (normalTime + frameTime)
+				<< scientific << setprecision(1) << setw(12) << difference << defaultfloat << setw(12) << mismatches << endl;
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UBenchmarkMeshCache()
+	//
+	//	Build a large sphere the way Meshes does, up to
+	//	packed vertices and 32-bit indices, cook it and
+	//	time opening the cooked file, the mapping and
+	//	the checksum over every byte, against building
+	//	it again. Then check that another key, a flipped
+	//	byte, a cut off end and a missing file are all
+	//	refused.
+	///////////////////////////////////////////////////
+	void UBenchmarkMeshCache()
+	{
+		const GLuint BENCH_SEGMENTS = 512;
+		const int ROUNDS = 10;
+		const uint64_t KEY = 1;
+		const char* const PATH = "bench.cache";
+
+		PrimitiveGeometry geometry;
+		vector<PackedVertex> packed;
+		Clock::time_point start = Clock::now();
+		for (int round = 0; round < ROUNDS; ++round)
+		{
+			GeneratePrimitive(PRIMITIVE_SPHERE, BENCH_SEGMENTS, BENCH_SEGMENTS, geometry);
+			const GLuint vertexCount = (GLuint)(geometry.vertices.size() / Meshes::FLOATS_PER_VERTEX);
+			OptimizeVertexCache(geometry.indices.data(), geometry.indices.size(), vertexCount);
+			OptimizeVertexFetch(geometry.vertices.data(), Meshes::FLOATS_PER_VERTEX, vertexCount, geometry.indices.data(), geometry.indices.size());
+			packed.resize(vertexCount);
+			PackVertices(geometry.vertices.data(), vertexCount, glm::vec3(-1.0f), 2.0f, packed.data());
+		}
+		const double buildTime = UMicroseconds(start) / ROUNDS;
+
+		MeshCacheWriter writer;
+		writer.AddSection(packed.data(), sizeof(PackedVertex) * packed.size());
+		writer.AddSection(geometry.indices.data(), sizeof(GLuint) * geometry.indices.size());
+		start = Clock::now();
+		const bool written = writer.Write(PATH, KEY);
+		const double writeTime = UMicroseconds(start);
+
+		MeshCache cache;
+		bool identical = written;
+		start = Clock::now();
+		for (int round = 0; round < ROUNDS && identical; ++round)
+		{
+			identical = cache.Open(PATH, KEY, 2) == MESH_CACHE_LOADED;
+			cache.Close();
+		}
+		const double loadTime = UMicroseconds(start) / ROUNDS;
+		if (identical && cache.Open(PATH, KEY, 2) == MESH_CACHE_LOADED)
+		{
+			identical = cache.SectionBytes(0) == sizeof(PackedVertex) * packed.size() && memcmp(cache.Section(0), packed.data(), cache.SectionBytes(0)) == 0 &&
+				cache.SectionBytes(1) == sizeof(GLuint) * geometry.indices.size() && memcmp(cache.Section(1), geometry.indices.data(), cache.SectionBytes(1)) == 0;
+			cache.Close();
+		}
+
+		const size_t bytes = sizeof(PackedVertex) * packed.size() + sizeof(GLuint) * geometry.indices.size();
+		cout << "Mesh cache benchmark, a " << packed.size() << " vertex sphere, " << bytes / 1024 << " KB cooked (times in microseconds)" << endl;
+		cout << fixed << setprecision(1) << setw(12) << "build" << setw(12) << "write" << setw(12) << "load" << setw(12) << "GB/s" << endl;
+		cout << setw(12) << buildTime << setw(12) << writeTime << setw(12) << loadTime << setprecision(2) << setw(12) << bytes / loadTime / 1000.0
+			<< defaultfloat << endl;
+		cout << "Sections read back identical: " << (identical ? "yes" : "no") << endl;
+
+		cout << "Another key: " << MeshCacheStatusName(cache.Open(PATH, KEY + 1, 2)) << endl;
+		cache.Close();
+		{
+			std::fstream file(PATH, std::ios::in | std::ios::out | std::ios::binary);
+			file.seekp(4096);
+			file.put('x');
+		}
+		cout << "Flipped byte: " << MeshCacheStatusName(cache.Open(PATH, KEY, 2)) << endl;
+		cache.Close();
+
+		writer.Write(PATH, KEY);
+		{
+			std::ifstream source(PATH, std::ios::binary);
+			vector<char> contents((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+			source.close();
+			std::ofstream file(PATH, std::ios::binary | std::ios::trunc);
+			file.write(contents.data(), contents.size() - MESH_CACHE_ALIGNMENT);
+		}
+		cout << "Cut off end: " << MeshCacheStatusName(cache.Open(PATH, KEY, 2)) << endl;
+		cache.Close();
+
+		std::remove(PATH);
+		cout << "No file: " << MeshCacheStatusName(cache.Open(PATH, KEY, 2)) << endl;
+	}
+}
+
+///////////////////////////////////////////////////
+//	RunBenchmark(int, char*[])
+//
+//	argc, argv: command line of the program
+//
+//	Return true when a benchmark flag was found and
+//	its benchmark has run
+///////////////////////////////////////////////////
+bool RunBenchmark(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--bench-bvh") == 0)
+		{
+			UBenchmarkBvh();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-occlusion") == 0)
+		{
+			UBenchmarkOcclusion();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-frame") == 0)
+		{
+			UBenchmarkFrame();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-jobs") == 0)
+		{
+			UBenchmarkJobs();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-primitives") == 0)
+		{
+			UBenchmarkPrimitives();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-lod") == 0)
+		{
+			UBenchmarkLod();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-vertexcache") == 0)
+		{
+			UBenchmarkVertexCache();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-packing") == 0)
+		{
+			UBenchmarkPacking();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-geometry") == 0)
+		{
+			UBenchmarkGeometry();
+			return true;
+		}
+
+		if (strcmp(argv[i], "--bench-meshcache") == 0)
+		{
+			UBenchmarkMeshCache();
+			return true;
+		}
+	}
+
+	return false;
+}
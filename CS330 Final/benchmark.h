@@ -0,0 +1,15 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.h
+// ========
+// command line benchmarks of the CPU side systems, run instead of the scene
+//
+// Each benchmark is selected by a flag on the command line, for example
+// "CS330 Final.exe --bench-bvh", prints a table to cout and exits. None of
+// them open a window or need an OpenGL context.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// Run the benchmark named by the first matching flag in argv. Return false
+// when no benchmark flag is present so the caller starts the scene instead.
+bool RunBenchmark(int argc, char* argv[]);
@@ -0,0 +1,438 @@
+///////////////////////////////////////////////////////////////////////////////
+// bvh.cpp
+// ========
+// bounding volume hierarchy over the world space boxes of the scene store
+///////////////////////////////////////////////////////////////////////////////
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+const float SceneBvh::REBUILD_RATIO = 1.5f;
+
+namespace
+{
+	// Centroid bins evaluated per axis when splitting a node
+	const int SAH_BINS = 12;
+
+	// Traversal stack reserved up front, far deeper than a SAH tree of a few million
+	// objects; a degenerate tree grows it instead of losing nodes
+	const size_t STACK_RESERVE = 64;
+
+	// Half the surface area of a box, enough to compare split costs
+	float UHalfArea(glm::vec3 boxMin, glm::vec3 boxMax)
+	{
+		const glm::vec3 e = boxMax - boxMin;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	///////////////////////////////////////////////////
+	//	URayBox(glm::vec3, glm::vec3, glm::vec3, glm::vec3, float)
+	//
+	//	origin, inverseDirection: the ray, direction
+	//		stored as its reciprocal
+	//	boxMin, boxMax: box to test
+	//	maxDistance: end of the ray
+	//
+	//	Slab test, return the entry distance or FLT_MAX
+	//	when the ray misses within maxDistance
+	///////////////////////////////////////////////////
+	float URayBox(glm::vec3 origin, glm::vec3 inverseDirection, glm::vec3 boxMin, glm::vec3 boxMax, float maxDistance)
+	{
+		const glm::vec3 t0 = (boxMin - origin) * inverseDirection;
+		const glm::vec3 t1 = (boxMax - origin) * inverseDirection;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+
+		const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		return enter <= exit ? enter : FLT_MAX;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Build(const Scene&)
+//
+//	scene: entities whose world boxes are indexed
+//
+//	Discard the tree and build a new one from the
+//	current world boxes
+///////////////////////////////////////////////////
+void SceneBvh::Build(const Scene& scene)
+{
+	const GLuint count = (GLuint)scene.Count();
+
+	mNodes.clear();
+	mEntities.resize(count);
+	for (GLuint i = 0; i < count; ++i)
+		mEntities[i] = i;
+
+	stats.builds++;
+	mBuildCost = 0.0f;
+	if (count == 0)
+		return;
+
+	std::vector<glm::vec3> centroids(count);
+	for (GLuint i = 0; i < count; ++i)
+		centroids[i] = (scene.boundsMin[i] + scene.boundsMax[i]) * 0.5f;
+
+	// a binary tree over n leaves never needs more than 2n - 1 nodes
+	mNodes.reserve(2 * count);
+	Node root;
+	root.leftFirst = 0;
+	root.count = count;
+	UFitLeaf(scene, root);
+	mNodes.push_back(root);
+
+	USubdivide(scene, 0, centroids);
+	mBuildCost = UCost();
+}
+
+///////////////////////////////////////////////////
+//	Refit(const Scene&)
+//
+//	scene: the store the tree was built from
+//
+//	Keep the topology and re-grow every box from the
+//	current world boxes. Children always follow their
+//	parent, so one reverse pass sees both children
+//	before the parent.
+///////////////////////////////////////////////////
+void SceneBvh::Refit(const Scene& scene)
+{
+	for (size_t i = mNodes.size(); i-- > 0;)
+	{
+		Node& node = mNodes[i];
+		if (node.count > 0)
+		{
+			UFitLeaf(scene, node);
+			continue;
+		}
+
+		const Node& left = mNodes[node.leftFirst];
+		const Node& right = mNodes[node.leftFirst + 1];
+		node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+		node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+	}
+
+	stats.refits++;
+}
+
+///////////////////////////////////////////////////
+//	Update(const Scene&, bool)
+//
+//	scene: the store the tree indexes
+//	moved: some world matrix changed this frame
+//
+//	Rebuild when entities were added or removed,
+//	otherwise refit, and rebuild anyway once the
+//	refitted tree costs REBUILD_RATIO times more to
+//	traverse than when it was built
+///////////////////////////////////////////////////
+void SceneBvh::Update(const Scene& scene, bool moved)
+{
+	if (mEntities.size() != scene.Count())
+	{
+		Build(scene);
+		return;
+	}
+
+	if (!moved || mNodes.empty())
+		return;
+
+	Refit(scene);
+	if (UCost() > mBuildCost * REBUILD_RATIO)
+		Build(scene);
+}
+
+///////////////////////////////////////////////////
+//	Raycast(const Scene&, glm::vec3, glm::vec3, float)
+//
+//	scene: the store the tree indexes
+//	origin, direction: the ray, direction need not
+//		be normalised
+//	maxDistance: end of the ray in direction units
+//
+//	Walk the tree near child first and skip every
+//	node that starts beyond the closest hit so far.
+//	Leaves test the ray against each entity's mesh
+//	box in object space, which is tighter than the
+//	world box for rotated objects.
+///////////////////////////////////////////////////
+RayHit SceneBvh::Raycast(const Scene& scene, glm::vec3 origin, glm::vec3 direction, float maxDistance) const
+{
+	RayHit hit = { -1, maxDistance, 0, 0 };
+	if (mNodes.empty())
+		return hit;
+
+	const glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+
+	std::vector<GLuint> stack;
+	stack.reserve(STACK_RESERVE);
+
+	hit.nodesVisited++;
+	if (URayBox(origin, inverseDirection, mNodes[0].boundsMin, mNodes[0].boundsMax, hit.distance) == FLT_MAX)
+		return hit;
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (node.count > 0)
+		{
+			for (GLuint i = 0; i < node.count; ++i)
+			{
+				const GLuint entity = mEntities[node.leftFirst + i];
+				const Meshes::GLMesh& mesh = *scene.meshes[entity];
+
+				// an affine transform keeps the ray parameter, so t in object space is t in world space
+				const glm::mat4 toObject = glm::inverse(scene.models[entity]);
+				const glm::vec3 objectOrigin(toObject * glm::vec4(origin, 1.0f));
+				const glm::vec3 objectDirection(toObject * glm::vec4(direction, 0.0f));
+
+				const float t = URayBox(objectOrigin, glm::vec3(1.0f) / objectDirection, mesh.boundsMin, mesh.boundsMax, hit.distance);
+				if (t < hit.distance)
+				{
+					hit.distance = t;
+					hit.entity = (GLint)entity;
+				}
+			}
+			hit.leafTests += node.count;
+			continue;
+		}
+
+		GLuint nearChild = node.leftFirst;
+		GLuint farChild = node.leftFirst + 1;
+		float nearT = URayBox(origin, inverseDirection, mNodes[nearChild].boundsMin, mNodes[nearChild].boundsMax, hit.distance);
+		float farT = URayBox(origin, inverseDirection, mNodes[farChild].boundsMin, mNodes[farChild].boundsMax, hit.distance);
+		hit.nodesVisited += 2;
+
+		if (farT < nearT)
+		{
+			std::swap(nearChild, farChild);
+			std::swap(nearT, farT);
+		}
+
+		// pushed far first so the near child is popped next
+		if (farT != FLT_MAX)
+			stack.push_back(farChild);
+		if (nearT != FLT_MAX)
+			stack.push_back(nearChild);
+	}
+
+	return hit;
+}
+
+///////////////////////////////////////////////////
+//	Overlap(glm::vec3, glm::vec3, std::vector<GLuint>&)
+//
+//	boxMin, boxMax: world space query box
+//	result: receives the entity indices
+//
+//	Append every entity whose world box overlaps the
+//	query box
+///////////////////////////////////////////////////
+void SceneBvh::Overlap(glm::vec3 boxMin, glm::vec3 boxMax, std::vector<GLuint>& result) const
+{
+	if (mNodes.empty())
+		return;
+
+	std::vector<GLuint> stack;
+	stack.reserve(STACK_RESERVE);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (node.boundsMin.x > boxMax.x || node.boundsMax.x < boxMin.x ||
+			node.boundsMin.y > boxMax.y || node.boundsMax.y < boxMin.y ||
+			node.boundsMin.z > boxMax.z || node.boundsMax.z < boxMin.z)
+			continue;
+
+		if (node.count > 0)
+		{
+			for (GLuint i = 0; i < node.count; ++i)
+				result.push_back(mEntities[node.leftFirst + i]);
+			continue;
+		}
+
+		stack.push_back(node.leftFirst + 1);
+		stack.push_back(node.leftFirst);
+	}
+}
+
+///////////////////////////////////////////////////
+//	USubdivide(const Scene&, GLuint, std::vector<glm::vec3>&)
+//
+//	scene: the store being indexed
+//	nodeIndex: node to split, already fitted
+//	centroids: world box centre of every entity
+//
+//	Bin the entity centroids along each axis, pick
+//	the plane with the lowest surface area cost and
+//	recurse into both halves. A node stays a leaf when
+//	no split is cheaper than testing its entities.
+///////////////////////////////////////////////////
+void SceneBvh::USubdivide(const Scene& scene, GLuint nodeIndex, std::vector<glm::vec3>& centroids)
+{
+	const GLuint first = mNodes[nodeIndex].leftFirst;
+	const GLuint count = mNodes[nodeIndex].count;
+	if (count <= MAX_LEAF_SIZE)
+		return;
+
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (GLuint i = first; i < first + count; ++i)
+	{
+		centroidMin = glm::min(centroidMin, centroids[mEntities[i]]);
+		centroidMax = glm::max(centroidMax, centroids[mEntities[i]]);
+	}
+
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = UHalfArea(mNodes[nodeIndex].boundsMin, mNodes[nodeIndex].boundsMax) * count;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+			continue;
+		const float binScale = SAH_BINS / extent;
+
+		glm::vec3 binMin[SAH_BINS];
+		glm::vec3 binMax[SAH_BINS];
+		GLuint binCount[SAH_BINS] = {};
+		for (int b = 0; b < SAH_BINS; ++b)
+		{
+			binMin[b] = glm::vec3(FLT_MAX);
+			binMax[b] = glm::vec3(-FLT_MAX);
+		}
+
+		for (GLuint i = first; i < first + count; ++i)
+		{
+			const GLuint entity = mEntities[i];
+			const int b = std::min(SAH_BINS - 1, (int)((centroids[entity][axis] - centroidMin[axis]) * binScale));
+			binCount[b]++;
+			binMin[b] = glm::min(binMin[b], scene.boundsMin[entity]);
+			binMax[b] = glm::max(binMax[b], scene.boundsMax[entity]);
+		}
+
+		// sweep from the right to get the area and count of every right-hand side
+		float rightArea[SAH_BINS];
+		GLuint rightCount[SAH_BINS];
+		glm::vec3 sweepMin(FLT_MAX);
+		glm::vec3 sweepMax(-FLT_MAX);
+		GLuint sweepCount = 0;
+		for (int b = SAH_BINS - 1; b > 0; --b)
+		{
+			sweepCount += binCount[b];
+			if (binCount[b] > 0)
+			{
+				sweepMin = glm::min(sweepMin, binMin[b]);
+				sweepMax = glm::max(sweepMax, binMax[b]);
+			}
+			rightArea[b] = sweepCount > 0 ? UHalfArea(sweepMin, sweepMax) : 0.0f;
+			rightCount[b] = sweepCount;
+		}
+
+		// then from the left, the split sits between bin b - 1 and bin b
+		sweepMin = glm::vec3(FLT_MAX);
+		sweepMax = glm::vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (int b = 1; b < SAH_BINS; ++b)
+		{
+			sweepCount += binCount[b - 1];
+			if (binCount[b - 1] > 0)
+			{
+				sweepMin = glm::min(sweepMin, binMin[b - 1]);
+				sweepMax = glm::max(sweepMax, binMax[b - 1]);
+			}
+			if (sweepCount == 0 || rightCount[b] == 0)
+				continue;
+
+			const float cost = UHalfArea(sweepMin, sweepMax) * sweepCount + rightArea[b] * rightCount[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	if (bestAxis < 0)
+		return;
+
+	const float binScale = SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	GLuint* middle = std::partition(mEntities.data() + first, mEntities.data() + first + count, [&](GLuint entity) {
+		return std::min(SAH_BINS - 1, (int)((centroids[entity][bestAxis] - centroidMin[bestAxis]) * binScale)) < bestSplit;
+	});
+	const GLuint leftCount = (GLuint)(middle - (mEntities.data() + first));
+	if (leftCount == 0 || leftCount == count)
+		return;
+
+	const GLuint left = (GLuint)mNodes.size();
+	Node child;
+	child.leftFirst = first;
+	child.count = leftCount;
+	UFitLeaf(scene, child);
+	mNodes.push_back(child);
+
+	child.leftFirst = first + leftCount;
+	child.count = count - leftCount;
+	UFitLeaf(scene, child);
+	mNodes.push_back(child);
+
+	mNodes[nodeIndex].leftFirst = left;
+	mNodes[nodeIndex].count = 0;
+
+	USubdivide(scene, left, centroids);
+	USubdivide(scene, left + 1, centroids);
+}
+
+///////////////////////////////////////////////////
+//	UFitLeaf(const Scene&, Node&)
+//
+//	scene: the store being indexed
+//	node: node whose entity run is set
+//
+//	Set the node box to the union of its entity boxes
+///////////////////////////////////////////////////
+void SceneBvh::UFitLeaf(const Scene& scene, Node& node) const
+{
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	for (GLuint i = 0; i < node.count; ++i)
+	{
+		const GLuint entity = mEntities[node.leftFirst + i];
+		node.boundsMin = glm::min(node.boundsMin, scene.boundsMin[entity]);
+		node.boundsMax = glm::max(node.boundsMax, scene.boundsMax[entity]);
+	}
+}
+
+///////////////////////////////////////////////////
+//	UCost()
+//
+//	Surface area cost of the whole tree relative to
+//	its root: every node box weighted by the work a
+//	ray entering it does (one test per child or per
+//	entity). Only compared against itself, so the
+//	constants are left out.
+///////////////////////////////////////////////////
+float SceneBvh::UCost() const
+{
+	if (mNodes.empty())
+		return 0.0f;
+
+	float cost = 0.0f;
+	for (const Node& node : mNodes)
+		cost += UHalfArea(node.boundsMin, node.boundsMax) * (node.count > 0 ? node.count : 2);
+
+	const float rootArea = UHalfArea(mNodes[0].boundsMin, mNodes[0].boundsMax);
+	return rootArea > 0.0f ? cost / rootArea : cost;
+}
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// bvh.h
+// ========
+// bounding volume hierarchy over the world space boxes of the scene store
+//
+// The tree is built top-down with a binned surface area heuristic and
+// stored as a flat array of 32 byte nodes. The two children of a node are
+// always adjacent and placed after their parent. When objects move, Refit()
+// re-grows the boxes bottom-up in one reverse pass and keeps the topology.
+// Update() falls back to a full rebuild when the entity count changes or
+// when refitting has made the tree too loose.
+//
+// The same tree answers ray casts (mouse picking), box overlap queries and
+// the hierarchical frustum test in culling.cpp.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "scene.h"
+
+// Closest entity found by a ray cast
+struct RayHit
+{
+	GLint entity;           // Entity index, -1 when nothing was hit
+	float distance;         // Ray parameter of the hit, in units of the ray direction
+	GLuint nodesVisited;    // Tree nodes whose box was tested
+	GLuint leafTests;       // Entities tested against their exact mesh box
+};
+
+// Counters describing the maintenance of the tree
+struct BvhStats
+{
+	GLuint builds;      // Full rebuilds so far
+	GLuint refits;      // Refits so far
+};
+
+class SceneBvh
+{
+public:
+	// One node, children at leftFirst and leftFirst + 1 when count is 0,
+	// otherwise count entities starting at entities()[leftFirst]
+	struct Node
+	{
+		glm::vec3 boundsMin;
+		GLuint leftFirst;
+		glm::vec3 boundsMax;
+		GLuint count;
+	};
+
+	// Largest number of entities stored in one leaf
+	static const GLuint MAX_LEAF_SIZE = 4;
+	// Refit is abandoned for a rebuild once the tree cost grows past this factor
+	static const float REBUILD_RATIO;
+
+	BvhStats stats = {};
+
+public:
+	void Build(const Scene& scene);
+	void Refit(const Scene& scene);
+	// Refit after objects moved, rebuild when the count changed or the tree degraded
+	void Update(const Scene& scene, bool moved);
+
+	// Closest entity whose transformed mesh box the ray hits within maxDistance
+	RayHit Raycast(const Scene& scene, glm::vec3 origin, glm::vec3 direction, float maxDistance) const;
+	// Append every entity whose world box overlaps [boxMin, boxMax]
+	void Overlap(glm::vec3 boxMin, glm::vec3 boxMax, std::vector<GLuint>& result) const;
+
+	const std::vector<Node>& Nodes() const { return mNodes; }
+	const std::vector<GLuint>& Entities() const { return mEntities; }
+	bool Empty() const { return mNodes.empty(); }
+
+private:
+	void USubdivide(const Scene& scene, GLuint node, std::vector<glm::vec3>& centroids);
+	void UFitLeaf(const Scene& scene, Node& node) const;
+	float UCost() const;
+
+	std::vector<Node> mNodes;
+	std::vector<GLuint> mEntities;  // Entity indices, leaves reference contiguous runs
+	float mBuildCost = 0.0f;        // UCost() right after the last build
+};
@@ -0,0 +1,366 @@
+///////////////////////////////////////////////////////////////////////////////
+// culling.cpp
+// ========
+// SIMD view frustum culling of the scene's world space bounding spheres
+///////////////////////////////////////////////////////////////////////////////
+
+#include "culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <xmmintrin.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Smallest depth used by the size test, keeps spheres crossing the near plane
+	const float MIN_DEPTH = 1e-4f;
+
+	// Inputs shared by every kernel width
+	struct CullInput
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		const float* r;
+		size_t count;
+		const FrustumPlanes* planes;
+		float projectionScale;
+		float minPixels;
+	};
+
+#ifdef __AVX__
+	///////////////////////////////////////////////////
+	//	UCullAVX(const CullInput&, size_t, unsigned char*, GLuint&)
+	//
+	//	Test 8 spheres per iteration, return the index
+	//	of the first sphere left for narrower kernels
+	///////////////////////////////////////////////////
+	size_t UCullAVX(const CullInput& in, size_t first, unsigned char* visible, GLuint& visibleCount)
+	{
+		__m256 nx[FrustumPlanes::COUNT], ny[FrustumPlanes::COUNT], nz[FrustumPlanes::COUNT], d[FrustumPlanes::COUNT];
+		for (int p = 0; p < FrustumPlanes::COUNT; ++p)
+		{
+			nx[p] = _mm256_set1_ps(in.planes->nx[p]);
+			ny[p] = _mm256_set1_ps(in.planes->ny[p]);
+			nz[p] = _mm256_set1_ps(in.planes->nz[p]);
+			d[p] = _mm256_set1_ps(in.planes->d[p]);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 scale = _mm256_set1_ps(in.projectionScale);
+		const __m256 pixels = _mm256_set1_ps(in.minPixels);
+		const __m256 minDepth = _mm256_set1_ps(MIN_DEPTH);
+
+		size_t i = first;
+		for (; i + 8 <= in.count; i += 8)
+		{
+			const __m256 cx = _mm256_loadu_ps(in.x + i);
+			const __m256 cy = _mm256_loadu_ps(in.y + i);
+			const __m256 cz = _mm256_loadu_ps(in.z + i);
+			const __m256 r = _mm256_loadu_ps(in.r + i);
+			const __m256 negR = _mm256_sub_ps(zero, r);
+
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			__m256 nearDistance = zero;
+			for (int p = 0; p < FrustumPlanes::COUNT; ++p)
+			{
+				const __m256 dist = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)),
+					_mm256_add_ps(_mm256_mul_ps(nz[p], cz), d[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negR, _CMP_GE_OQ));
+				if (p == FrustumPlanes::NEAR_PLANE)
+					nearDistance = dist;
+			}
+
+			// projected radius in pixels must reach the threshold: r * scale >= minPixels * depth
+			const __m256 depth = _mm256_max_ps(nearDistance, minDepth);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_mul_ps(r, scale), _mm256_mul_ps(pixels, depth), _CMP_GE_OQ));
+
+			const int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				visible[i + lane] = (unsigned char)((mask >> lane) & 1);
+				visibleCount += visible[i + lane];
+			}
+		}
+		return i;
+	}
+#endif
+
+	///////////////////////////////////////////////////
+	//	UCullSSE(const CullInput&, size_t, unsigned char*, GLuint&)
+	//
+	//	Test 4 spheres per iteration, return the index
+	//	of the first sphere left for the scalar tail
+	///////////////////////////////////////////////////
+	size_t UCullSSE(const CullInput& in, size_t first, unsigned char* visible, GLuint& visibleCount)
+	{
+		__m128 nx[FrustumPlanes::COUNT], ny[FrustumPlanes::COUNT], nz[FrustumPlanes::COUNT], d[FrustumPlanes::COUNT];
+		for (int p = 0; p < FrustumPlanes::COUNT; ++p)
+		{
+			nx[p] = _mm_set1_ps(in.planes->nx[p]);
+			ny[p] = _mm_set1_ps(in.planes->ny[p]);
+			nz[p] = _mm_set1_ps(in.planes->nz[p]);
+			d[p] = _mm_set1_ps(in.planes->d[p]);
+		}
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 scale = _mm_set1_ps(in.projectionScale);
+		const __m128 pixels = _mm_set1_ps(in.minPixels);
+		const __m128 minDepth = _mm_set1_ps(MIN_DEPTH);
+
+		size_t i = first;
+		for (; i + 4 <= in.count; i += 4)
+		{
+			const __m128 cx = _mm_loadu_ps(in.x + i);
+			const __m128 cy = _mm_loadu_ps(in.y + i);
+			const __m128 cz = _mm_loadu_ps(in.z + i);
+			const __m128 r = _mm_loadu_ps(in.r + i);
+			const __m128 negR = _mm_sub_ps(zero, r);
+
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			__m128 nearDistance = zero;
+			for (int p = 0; p < FrustumPlanes::COUNT; ++p)
+			{
+				const __m128 dist = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+					_mm_add_ps(_mm_mul_ps(nz[p], cz), d[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+				if (p == FrustumPlanes::NEAR_PLANE)
+					nearDistance = dist;
+			}
+
+			// projected radius in pixels must reach the threshold: r * scale >= minPixels * depth
+			const __m128 depth = _mm_max_ps(nearDistance, minDepth);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_mul_ps(r, scale), _mm_mul_ps(pixels, depth)));
+
+			const int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				visible[i + lane] = (unsigned char)((mask >> lane) & 1);
+				visibleCount += visible[i + lane];
+			}
+		}
+		return i;
+	}
+
+	///////////////////////////////////////////////////
+	//	UCullScalar(const CullInput&, size_t, unsigned char*, GLuint&)
+	//
+	//	Same test one sphere at a time for the tail
+	///////////////////////////////////////////////////
+	void UCullScalar(const CullInput& in, size_t first, unsigned char* visible, GLuint& visibleCount)
+	{
+		for (size_t i = first; i < in.count; ++i)
+		{
+			bool inside = true;
+			float nearDistance = 0.0f;
+			for (int p = 0; p < FrustumPlanes::COUNT; ++p)
+			{
+				const float dist = in.planes->nx[p] * in.x[i] + in.planes->ny[p] * in.y[i] + in.planes->nz[p] * in.z[i] + in.planes->d[p];
+				inside = inside && dist >= -in.r[i];
+				if (p == FrustumPlanes::NEAR_PLANE)
+					nearDistance = dist;
+			}
+			inside = inside && in.r[i] * in.projectionScale >= in.minPixels * std::max(nearDistance, MIN_DEPTH);
+
+			visible[i] = inside ? 1 : 0;
+			visibleCount += visible[i];
+		}
+	}
+
+	// Every plane still to be tested, one bit per FrustumPlanes entry
+	const GLuint ALL_PLANES = (1u << FrustumPlanes::COUNT) - 1;
+}
+
+///////////////////////////////////////////////////
+//	SetFrustum(const glm::mat4&, const glm::mat4&, float, float)
+//
+//	view, projection: camera of the frame
+//	viewportHeight: render target height in pixels
+//	minPixels: smallest projected radius kept
+//
+//	Extract the six planes from the rows of the
+//	view-projection matrix (Gribb/Hartmann) and
+//	normalise them so plane distances are in world
+//	units
+///////////////////////////////////////////////////
+void FrustumCuller::SetFrustum(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float minPixels)
+{
+	const glm::mat4 m = projection * view;
+
+	// row i of the column-major matrix
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+	glm::vec4 planes[FrustumPlanes::COUNT];
+	planes[FrustumPlanes::LEFT] = rows[3] + rows[0];
+	planes[FrustumPlanes::RIGHT] = rows[3] - rows[0];
+	planes[FrustumPlanes::BOTTOM] = rows[3] + rows[1];
+	planes[FrustumPlanes::TOP] = rows[3] - rows[1];
+	planes[FrustumPlanes::NEAR_PLANE] = rows[3] + rows[2];
+	planes[FrustumPlanes::FAR_PLANE] = rows[3] - rows[2];
+
+	for (int p = 0; p < FrustumPlanes::COUNT; ++p)
+	{
+		const float length = std::sqrt(planes[p].x * planes[p].x + planes[p].y * planes[p].y + planes[p].z * planes[p].z);
+		mPlanes.nx[p] = planes[p].x / length;
+		mPlanes.ny[p] = planes[p].y / length;
+		mPlanes.nz[p] = planes[p].z / length;
+		mPlanes.d[p] = planes[p].w / length;
+	}
+
+	// projection[1][1] is cot(fovy / 2): world units at distance 1 to half the viewport
+	mProjectionScale = projection[1][1] * viewportHeight * 0.5f;
+	mMinPixels = minPixels;
+}
+
+///////////////////////////////////////////////////
+//	Cull(const Scene&, std::vector<unsigned char>&)
+//
+//	scene: entities whose world bounds are tested
+//	visible: one flag per entity, resized as needed
+//
+//	Run the widest kernel available over the SoA
+//	bounding sphere columns, then narrower kernels
+//	over what is left. On a pool every chunk does
+//	this over its own slice of the columns.
+///////////////////////////////////////////////////
+void FrustumCuller::Cull(const Scene& scene, std::vector<unsigned char>& visible)
+{
+	const size_t count = scene.Count();
+	visible.resize(count);
+
+	const auto cullRange = [&](GLuint begin, GLuint end, GLuint chunk)
+	{
+		CullInput in;
+		in.x = scene.boundsX.data() + begin;
+		in.y = scene.boundsY.data() + begin;
+		in.z = scene.boundsZ.data() + begin;
+		in.r = scene.boundsRadius.data() + begin;
+		in.count = end - begin;
+		in.planes = &mPlanes;
+		in.projectionScale = mProjectionScale;
+		in.minPixels = mMinPixels;
+
+		GLuint chunkVisible = 0;
+		size_t next = 0;
+#ifdef __AVX__
+		next = UCullAVX(in, next, visible.data() + begin, chunkVisible);
+#endif
+		next = UCullSSE(in, next, visible.data() + begin, chunkVisible);
+		UCullScalar(in, next, visible.data() + begin, chunkVisible);
+		mChunkVisible[chunk] = chunkVisible;
+	};
+
+	const GLuint chunkSize = mPool != nullptr ? CHUNK_SIZE : (GLuint)std::max(count, (size_t)1);
+	mChunkVisible.assign(WorkerPool::ChunkCount((GLuint)count, chunkSize), 0);
+	if (mPool != nullptr)
+		mPool->ParallelFor((GLuint)count, chunkSize, cullRange);
+	else if (count > 0)
+		cullRange(0, (GLuint)count, 0);
+
+	GLuint visibleCount = 0;
+	for (GLuint chunkVisible : mChunkVisible)
+		visibleCount += chunkVisible;
+
+	stats.tested = (GLuint)count;
+	stats.visible = visibleCount;
+	stats.culled = (GLuint)count - visibleCount;
+}
+
+///////////////////////////////////////////////////
+//	CullHierarchy(const Scene&, const SceneBvh&, std::vector<unsigned char>&)
+//
+//	scene: entities whose world bounds are tested
+//	bvh: tree built over the scene's world boxes
+//	visible: one flag per entity, resized as needed
+//
+//	Test node boxes against the planes still left in
+//	the node's mask. A box behind any plane drops the
+//	subtree, a box in front of a plane clears its bit
+//	for the subtree. Leaf entities get the sphere and
+//	size test against the planes that remain.
+///////////////////////////////////////////////////
+void FrustumCuller::CullHierarchy(const Scene& scene, const SceneBvh& bvh, std::vector<unsigned char>& visible)
+{
+	const size_t count = scene.Count();
+	visible.assign(count, 0);
+
+	GLuint visibleCount = 0;
+	const std::vector<SceneBvh::Node>& nodes = bvh.Nodes();
+	const std::vector<GLuint>& entities = bvh.Entities();
+
+	// node index and the plane mask it inherits; the stacks keep their capacity between frames
+	mStackNodes.clear();
+	mStackMasks.clear();
+	if (!nodes.empty())
+	{
+		mStackNodes.push_back(0);
+		mStackMasks.push_back(ALL_PLANES);
+	}
+
+	while (!mStackNodes.empty())
+	{
+		const SceneBvh::Node& node = nodes[mStackNodes.back()];
+		GLuint mask = mStackMasks.back();
+		mStackNodes.pop_back();
+		mStackMasks.pop_back();
+
+		const glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+		const glm::vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+		bool outside = false;
+		for (int p = 0; p < FrustumPlanes::COUNT && !outside; ++p)
+		{
+			if (!(mask & (1u << p)))
+				continue;
+
+			// box centre distance and the box's projected half size along the normal
+			const float dist = mPlanes.nx[p] * center.x + mPlanes.ny[p] * center.y + mPlanes.nz[p] * center.z + mPlanes.d[p];
+			const float radius = std::fabs(mPlanes.nx[p]) * extent.x + std::fabs(mPlanes.ny[p]) * extent.y + std::fabs(mPlanes.nz[p]) * extent.z;
+			if (dist < -radius)
+				outside = true;
+			else if (dist >= radius)
+				mask &= ~(1u << p);
+		}
+		if (outside)
+			continue;
+
+		if (node.count == 0)
+		{
+			mStackNodes.push_back(node.leftFirst + 1);
+			mStackMasks.push_back(mask);
+			mStackNodes.push_back(node.leftFirst);
+			mStackMasks.push_back(mask);
+			continue;
+		}
+
+		for (GLuint i = 0; i < node.count; ++i)
+		{
+			const GLuint e = entities[node.leftFirst + i];
+			bool inside = true;
+			for (int p = 0; p < FrustumPlanes::COUNT && inside; ++p)
+			{
+				if (mask & (1u << p))
+					inside = mPlanes.nx[p] * scene.boundsX[e] + mPlanes.ny[p] * scene.boundsY[e] + mPlanes.nz[p] * scene.boundsZ[e] + mPlanes.d[p] >= -scene.boundsRadius[e];
+			}
+
+			if (inside && mMinPixels > 0.0f)
+			{
+				const int p = FrustumPlanes::NEAR_PLANE;
+				const float nearDistance = mPlanes.nx[p] * scene.boundsX[e] + mPlanes.ny[p] * scene.boundsY[e] + mPlanes.nz[p] * scene.boundsZ[e] + mPlanes.d[p];
+				inside = scene.boundsRadius[e] * mProjectionScale >= mMinPixels * std::max(nearDistance, MIN_DEPTH);
+			}
+
+			visible[e] = inside ? 1 : 0;
+			visibleCount += visible[e];
+		}
+	}
+
+	stats.tested = (GLuint)count;
+	stats.visible = visibleCount;
+	stats.culled = (GLuint)count - visibleCount;
+}
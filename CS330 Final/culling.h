@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// culling.h
+// ========
+// SIMD view frustum culling of the scene's world space bounding spheres
+//
+// The six planes are extracted from the view-projection matrix and splatted
+// across SIMD lanes. The kernel then tests 4 spheres per SSE instruction
+// (8 with AVX) against every plane, reading the SoA bounds columns of the
+// scene directly. An optional threshold also drops objects whose projected
+// radius is smaller than a given number of pixels.
+//
+// CullHierarchy() runs the same test over a SceneBvh instead: subtrees
+// outside a plane are dropped whole and subtrees inside a plane stop
+// testing it, which wins once the scene is much larger than the view.
+//
+// With a WorkerPool set, Cull() splits the columns into chunks that are
+// culled on the pool's threads.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "bvh.h"
+#include "scene.h"
+#include "workerpool.h"
+
+// Normalised frustum planes (nx, ny, nz, d), inside when dot(n, p) + d >= 0
+struct FrustumPlanes
+{
+	enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, COUNT };
+
+	float nx[COUNT];
+	float ny[COUNT];
+	float nz[COUNT];
+	float d[COUNT];
+};
+
+// Counters describing the last cull
+struct CullStats
+{
+	GLuint tested;      // Entities tested
+	GLuint visible;     // Entities that survived
+	GLuint culled;      // Entities outside the frustum or below the size threshold
+};
+
+class FrustumCuller
+{
+public:
+	// Spheres per chunk when culling on a pool, a multiple of the widest kernel
+	static const GLuint CHUNK_SIZE = 8192;
+
+	CullStats stats;
+
+public:
+	// Run Cull() on the pool's threads, nullptr culls on the calling thread
+	void SetWorkerPool(WorkerPool* pool) { mPool = pool; }
+
+	// projection: used to turn the pixel threshold into a world space ratio
+	// viewportHeight: height of the render target in pixels
+	// minPixels: smallest projected radius kept, 0 keeps everything in the frustum
+	void SetFrustum(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float minPixels);
+
+	// Fill visible[i] with 1 for every entity that survives, 0 otherwise
+	void Cull(const Scene& scene, std::vector<unsigned char>& visible);
+	// Same result, found by walking the tree built over the scene
+	void CullHierarchy(const Scene& scene, const SceneBvh& bvh, std::vector<unsigned char>& visible);
+
+private:
+	FrustumPlanes mPlanes;
+	float mProjectionScale = 0.0f;  // Pixels per world unit at distance 1
+	float mMinPixels = 0.0f;
+
+	WorkerPool* mPool = nullptr;
+	std::vector<GLuint> mChunkVisible;  // Survivors counted by each chunk
+
+	// Nodes still to visit in CullHierarchy() and the plane masks they inherit
+	std::vector<GLuint> mStackNodes;
+	std::vector<GLuint> mStackMasks;
+};
@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawlist.cpp
+// ========
+// CPU side of draw submission: sort keys, draw records and indirect commands
+///////////////////////////////////////////////////////////////////////////////
+
+#include "drawlist.h"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////
+//	SetStates(const Scene&)
+//
+//	scene: entities to classify
+//
+//	Meshes get small ids in the order they first
+//	appear, spaced MAX_LODS apart so Queue() can add
+//	the detail level. Entities whose material is not
+//	fully opaque go to the transparent pass. Materials
+//	are read per instance, so they don't split
+//	commands.
+///////////////////////////////////////////////////
+void DrawListBuilder::SetStates(const Scene& scene)
+{
+	const size_t entityCount = scene.Count();
+
+	std::vector<const Meshes::GLMesh*> meshIds;
+	std::vector<uint64_t> uniqueStates;
+	mEntityStates.resize(entityCount);
+	mEntityPasses.resize(entityCount);
+	for (size_t i = 0; i < entityCount; ++i)
+	{
+		std::vector<const Meshes::GLMesh*>::iterator found = std::find(meshIds.begin(), meshIds.end(), scene.meshes[i]);
+		const GLuint meshId = (GLuint)(found - meshIds.begin());
+		if (found == meshIds.end())
+			meshIds.push_back(scene.meshes[i]);
+
+		// one surface program today, its id stays 0
+		mEntityStates[i] = RenderQueue::MakeState(0, (GLuint)scene.textureSlots[i], meshId * Meshes::MAX_LODS);
+		mEntityPasses[i] = scene.materialTable[scene.materials[i]].objectColor.w < 1.0f
+			? RenderQueue::PASS_TRANSPARENT : RenderQueue::PASS_OPAQUE;
+
+		uniqueStates.push_back(mEntityStates[i] | ((uint64_t)mEntityPasses[i] << 62));
+	}
+
+	std::sort(uniqueStates.begin(), uniqueStates.end());
+	mStateCount = (GLuint)(std::unique(uniqueStates.begin(), uniqueStates.end()) - uniqueStates.begin());
+}
+
+///////////////////////////////////////////////////
+//	Queue(const Scene&, const glm::mat4&, const unsigned char*, const unsigned char*)
+//
+//	scene: entities to draw, SetStates() must be current
+//	view: camera view matrix, for the depth in the keys
+//	visible: one flag per entity, or nullptr for all
+//	levels: detail level per entity, or nullptr for 0
+//
+//	Each chunk of entities keys its visible entities
+//	into its own list; the lists are appended in
+//	chunk order and sorted on the calling thread.
+//	Levels of one mesh get their own state, so they
+//	end up in separate commands.
+///////////////////////////////////////////////////
+GLuint DrawListBuilder::Queue(const Scene& scene, const glm::mat4& view, const unsigned char* visible, const unsigned char* levels)
+{
+	const GLuint entityCount = (GLuint)scene.Count();
+
+	// view space depth of the bounding sphere centre, larger is farther
+	const glm::vec4 depthRow(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+
+	mChunkItems.resize(WorkerPool::ChunkCount(entityCount, QUEUE_GRAIN));
+	URun(entityCount, QUEUE_GRAIN, [&](GLuint begin, GLuint end, GLuint chunk)
+	{
+		std::vector<RenderQueue::Item>& items = mChunkItems[chunk];
+		items.clear();
+		for (GLuint e = begin; e < end; ++e)
+		{
+			if (visible != nullptr && !visible[e])
+				continue;
+
+			const float depth = depthRow.x * scene.boundsX[e] + depthRow.y * scene.boundsY[e] +
+				depthRow.z * scene.boundsZ[e] + depthRow.w;
+			const uint64_t state = mEntityStates[e] + (levels != nullptr ? levels[e] : 0);
+			items.push_back({ RenderQueue::MakeKey((RenderQueue::Pass)mEntityPasses[e], state, depth), e });
+		}
+	});
+
+	mQueue.Clear();
+	for (const std::vector<RenderQueue::Item>& items : mChunkItems)
+		mQueue.Append(items);
+	mQueue.Sort();
+
+	return (GLuint)mQueue.Items().size();
+}
+
+///////////////////////////////////////////////////
+//	Write(const Scene&, DrawRecord*)
+//
+//	scene: entities that were queued
+//	records: room for the count Queue() returned
+//
+//	Each chunk of the sorted queue writes its draw
+//	records and starts a command wherever the pass
+//	or state changes. Merging the chunk lists joins
+//	a command split across a chunk boundary, so the
+//	commands match a single threaded build.
+///////////////////////////////////////////////////
+void DrawListBuilder::Write(const Scene& scene, DrawRecord* records)
+{
+	const std::vector<RenderQueue::Item>& items = mQueue.Items();
+	const GLuint itemCount = (GLuint)items.size();
+
+	mRecordEntities.resize(itemCount);
+	mChunkCommands.resize(WorkerPool::ChunkCount(itemCount, WRITE_GRAIN));
+	URun(itemCount, WRITE_GRAIN, [&](GLuint begin, GLuint end, GLuint chunk)
+	{
+		std::vector<ChunkCommand>& commands = mChunkCommands[chunk];
+		commands.clear();
+		for (GLuint i = begin; i < end; ++i)
+		{
+			const GLuint e = items[i].entity;
+			const Meshes::GLMesh* mesh = scene.meshes[e];
+			const glm::mat4& model = scene.models[e];
+			records[i].model = model;
+			if (mesh->positionScale != 1.0f || mesh->positionOffset != glm::vec3(0.0f))
+			{
+				// packed positions decode by a uniform scale and an offset, applied before the model matrix
+				for (int column = 0; column < 3; ++column)
+					records[i].model[column] = model[column] * mesh->positionScale;
+				records[i].model[3] = model * glm::vec4(mesh->positionOffset, 1.0f);
+			}
+			records[i].material = scene.materials[e];
+			mRecordEntities[i] = e;
+
+			const RenderQueue::Pass pass = RenderQueue::KeyPass(items[i].key);
+			const uint64_t state = RenderQueue::KeyState(items[i].key);
+			if (commands.empty() || commands.back().pass != pass || commands.back().state != state)
+			{
+				// the low bits of the state's mesh id are the detail level Queue() added
+				const GLuint level = (GLuint)(state % Meshes::MAX_LODS);
+				ChunkCommand command;
+				if (level < mesh->nLods)
+				{
+					command.command.count = mesh->lods[level].nIndices;
+					command.command.firstIndex = mesh->lods[level].firstIndex;
+					command.command.baseVertex = mesh->lods[level].baseVertex;
+				}
+				else
+				{
+					command.command.count = mesh->nIndices;
+					command.command.firstIndex = mesh->firstIndex;
+					command.command.baseVertex = mesh->baseVertex;
+				}
+				command.command.instanceCount = 0;
+				command.command.baseInstance = i;
+				command.state = state;
+				command.pass = pass;
+				command.textureSlot = scene.textureSlots[e];
+				commands.push_back(command);
+			}
+			commands.back().command.instanceCount++;
+		}
+	});
+
+	mCommands.clear();
+	mGroups.clear();
+	mOpaqueCommandCount = 0;
+	mTransparentCount = 0;
+
+	const ChunkCommand* last = nullptr;
+	for (const std::vector<ChunkCommand>& commands : mChunkCommands)
+	{
+		for (const ChunkCommand& command : commands)
+		{
+			if (last != nullptr && last->pass == command.pass && last->state == command.state)
+			{
+				// the previous chunk ended inside this command
+				mCommands.back().instanceCount += command.command.instanceCount;
+			}
+			else
+			{
+				if (mGroups.empty() || mGroups.back().pass != command.pass || mGroups.back().textureSlot != command.textureSlot)
+				{
+					Group group;
+					group.pass = command.pass;
+					group.textureSlot = command.textureSlot;
+					group.firstCommand = (GLuint)mCommands.size();
+					group.commandCount = 0;
+					mGroups.push_back(group);
+				}
+				mGroups.back().commandCount++;
+				mCommands.push_back(command.command);
+
+				if (command.pass == RenderQueue::PASS_OPAQUE)
+					mOpaqueCommandCount++;
+			}
+
+			if (command.pass == RenderQueue::PASS_TRANSPARENT)
+				mTransparentCount += command.command.instanceCount;
+			last = &command;
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	URun(GLuint, GLuint, const WorkerPool::ChunkFunction&)
+//
+//	Run the chunks on the pool, or inline without one
+///////////////////////////////////////////////////
+void DrawListBuilder::URun(GLuint count, GLuint grain, const WorkerPool::ChunkFunction& function)
+{
+	if (mPool != nullptr)
+	{
+		mPool->ParallelFor(count, grain, function);
+		return;
+	}
+
+	const GLuint chunks = WorkerPool::ChunkCount(count, grain);
+	for (GLuint c = 0; c < chunks; ++c)
+		function(c * grain, std::min(count, (c + 1) * grain), c);
+}
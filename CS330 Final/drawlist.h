@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawlist.h
+// ========
+// CPU side of draw submission: sort keys, draw records and indirect commands
+//
+// The visible entities are cut into chunks and handed to a WorkerPool. Each
+// chunk computes its sort keys into its own list; the lists are appended in
+// chunk order and radix sorted. The sorted queue is then cut into chunks
+// again, and each chunk writes its draw records straight to the destination
+// and builds its own command list. The GL thread merges the command lists,
+// joining a command that a chunk boundary split in two, and groups them by
+// pass and texture. The result is identical for any thread count.
+//
+// Nothing here touches OpenGL, SceneRenderer submits what is built.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "renderqueue.h"
+#include "scene.h"
+#include "workerpool.h"
+
+// Per-draw record fetched by the surface vertex shader, one per instance
+struct DrawRecord
+{
+	glm::mat4 model;
+	GLuint material;    // Index into MaterialBlock
+	GLuint pad[3];
+};
+
+// Layout consumed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+class DrawListBuilder
+{
+	// Command built by one chunk, with what the merge compares
+	struct ChunkCommand
+	{
+		DrawElementsIndirectCommand command;
+		uint64_t state;
+		RenderQueue::Pass pass;
+		GLint textureSlot;
+	};
+
+public:
+	// Run of consecutive commands sharing a pass and texture slot
+	struct Group
+	{
+		RenderQueue::Pass pass;
+		GLint textureSlot;
+		GLuint firstCommand;
+		GLuint commandCount;
+	};
+
+	// Items per chunk while queueing and while writing records
+	static const GLuint QUEUE_GRAIN = 4096;
+	static const GLuint WRITE_GRAIN = 2048;
+
+public:
+	// Chunks run on the pool when one is set, inline otherwise
+	void SetWorkerPool(WorkerPool* pool) { mPool = pool; }
+
+	// Work out the pass and the state key field of every entity; call when the scene changes
+	void SetStates(const Scene& scene);
+
+	// Queue and sort the visible entities, return the number of draw records Write() needs.
+	// levels: detail level of each entity's mesh (see LodSelector), nullptr draws level 0.
+	GLuint Queue(const Scene& scene, const glm::mat4& view, const unsigned char* visible, const unsigned char* levels = nullptr);
+	// Write the queued draw records to records and build the commands and groups
+	void Write(const Scene& scene, DrawRecord* records);
+
+	const std::vector<DrawElementsIndirectCommand>& Commands() const { return mCommands; }
+	const std::vector<Group>& Groups() const { return mGroups; }
+	// Entity index of each draw record
+	const std::vector<GLuint>& RecordEntities() const { return mRecordEntities; }
+	// Opaque commands come first
+	GLuint OpaqueCommandCount() const { return mOpaqueCommandCount; }
+	GLuint TransparentCount() const { return mTransparentCount; }
+	// Unique pass/mesh/texture combinations in the scene
+	GLuint StateCount() const { return mStateCount; }
+
+	const QueueStats& QueueStatistics() const { return mQueue.stats; }
+
+private:
+	void URun(GLuint count, GLuint grain, const WorkerPool::ChunkFunction& function);
+
+	WorkerPool* mPool = nullptr;
+	RenderQueue mQueue;
+
+	std::vector<uint64_t> mEntityStates;        // Sort key state field of each entity
+	std::vector<unsigned char> mEntityPasses;   // RenderQueue::Pass of each entity
+	GLuint mStateCount = 0;
+
+	std::vector<std::vector<RenderQueue::Item>> mChunkItems;    // Keys queued by each chunk
+	std::vector<std::vector<ChunkCommand>> mChunkCommands;      // Commands built by each chunk
+
+	std::vector<DrawElementsIndirectCommand> mCommands;
+	std::vector<Group> mGroups;
+	std::vector<GLuint> mRecordEntities;
+	GLuint mOpaqueCommandCount = 0;
+	GLuint mTransparentCount = 0;
+};
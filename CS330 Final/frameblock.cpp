@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameblock.cpp
+// ========
+// per-frame uniform buffer holding the camera and the frame-wide lighting
+///////////////////////////////////////////////////////////////////////////////
+
+#include "frameblock.h"
+
+#include "glstate.h"
+#include "programreflection.h"
+
+///////////////////////////////////////////////////
+//	Create()
+//
+//	Allocate the uniform buffer and bind it to the
+//	FrameBlock binding point for the lifetime of
+//	the context
+///////////////////////////////////////////////////
+void FrameBlockBuffer::Create()
+{
+	glGenBuffers(1, &mUbo);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, mUbo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL, GL_DYNAMIC_DRAW);
+
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, BINDING, mUbo);
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Release the uniform buffer
+///////////////////////////////////////////////////
+void FrameBlockBuffer::Destroy()
+{
+	GLState::DeleteBuffers(1, &mUbo);
+	mUbo = 0;
+}
+
+///////////////////////////////////////////////////
+//	Attach(GLuint)
+//
+//	program: linked and reflected program
+//
+//	Assign the program's FrameBlock to BINDING. The
+//	block index comes from the program reflection so
+//	shaders don't need GLSL 4.20 binding layouts.
+///////////////////////////////////////////////////
+void FrameBlockBuffer::Attach(GLuint program) const
+{
+	const ProgramReflection* reflection = ProgramReflection::Find(program);
+	if (reflection == NULL)
+		return;
+
+	const GLuint blockIndex = reflection->BlockIndex("FrameBlock");
+	if (blockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, blockIndex, BINDING);
+}
+
+///////////////////////////////////////////////////
+//	Update(const FrameBlock&)
+//
+//	block: camera and lighting for this frame
+//
+//	Replace the whole buffer in one upload, shared by
+//	every attached program
+///////////////////////////////////////////////////
+void FrameBlockBuffer::Update(const FrameBlock& block)
+{
+	// usually still bound from last frame, the bind is then elided
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, mUbo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &block);
+}
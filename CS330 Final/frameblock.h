@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameblock.h
+// ========
+// per-frame uniform buffer holding the camera and the frame-wide lighting
+//
+// The camera matrices, ambient term, fill light and surface options are the
+// same for every draw of a frame. They are written into one std140 uniform
+// buffer once per frame, and every program that declares FrameBlock reads
+// it from the same binding point.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// CPU mirror of the GLSL FrameBlock, std140 layout. Only vec4/mat4 members
+// are used ahead of the tail so no vec3 padding rules come into play.
+struct FrameBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 viewPosition;     // xyz camera position
+	glm::vec4 ambientLight;     // rgb colour, a strength
+	glm::vec4 light2Color;      // rgb fill light colour
+	glm::vec4 light2Position;   // xyz fill light position
+	glm::vec4 light2Specular;   // x specular intensity, y highlight size
+	glm::vec2 uvScale;          // Texture coordinate scale
+	GLint hasTexture;           // Sample uTexture instead of objectColor
+	GLint pad0;
+};
+
+static_assert(sizeof(FrameBlock) == 224, "FrameBlock must match the std140 layout of the GLSL block");
+
+class FrameBlockBuffer
+{
+public:
+	// Uniform buffer binding point every program reads FrameBlock from
+	static const GLuint BINDING = 0;
+
+public:
+	void Create();
+	void Destroy();
+
+	// Point the program's FrameBlock (if it declares one) at BINDING
+	void Attach(GLuint program) const;
+	// Write the whole block, once per frame
+	void Update(const FrameBlock& block);
+
+private:
+	GLuint mUbo = 0;
+};
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// framesnapshot.cpp
+// ========
+// what the input thread hands the render thread each tick, and the lock-free
+// triple buffer it travels through
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framesnapshot.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+///////////////////////////////////////////////////
+//	InterpolateCamera(const CameraState&, const CameraState&, float)
+//
+//	The direction vectors are blended, not renormalized:
+//	glm::lookAt() normalizes what it is given.
+///////////////////////////////////////////////////
+CameraState InterpolateCamera(const CameraState& previous, const CameraState& current, float alpha)
+{
+	CameraState camera;
+	camera.position = glm::mix(previous.position, current.position, alpha);
+	camera.front = glm::mix(previous.front, current.front, alpha);
+	camera.up = glm::mix(previous.up, current.up, alpha);
+	camera.zoom = previous.zoom + (current.zoom - previous.zoom) * alpha;
+	return camera;
+}
+
+///////////////////////////////////////////////////
+//	CameraView(const CameraState&)
+///////////////////////////////////////////////////
+glm::mat4 CameraView(const CameraState& camera)
+{
+	return glm::lookAt(camera.position, camera.position + camera.front, camera.up);
+}
+
+///////////////////////////////////////////////////
+//	InterpolateTransform(const TransformState&, float)
+///////////////////////////////////////////////////
+glm::mat4 InterpolateTransform(const TransformState& transform, float alpha)
+{
+	glm::mat4 local;
+	for (int c = 0; c < 4; ++c)
+		local[c] = glm::mix(transform.previousLocal[c], transform.local[c], alpha);
+	return local;
+}
+
+///////////////////////////////////////////////////
+//	Publish()
+//
+//	Stamp the back slot and swap it with the middle
+//	one. The release half of the exchange makes the
+//	slot's contents visible to the reader that
+//	swaps it out; whatever the middle held becomes
+//	the new back slot, dropped unread or not.
+///////////////////////////////////////////////////
+void SnapshotExchange::Publish()
+{
+	mSlots[mBack].sequence = ++mPublished;
+	mBack = mMiddle.exchange(mBack | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+///////////////////////////////////////////////////
+//	Acquire()
+//
+//	Swap the front slot with the middle one when the
+//	middle holds an unread snapshot. Only the reader
+//	clears FRESH, so the check cannot go stale
+//	before the exchange: the writer can only replace
+//	the middle with another fresh slot.
+///////////////////////////////////////////////////
+bool SnapshotExchange::Acquire()
+{
+	if ((mMiddle.load(std::memory_order_relaxed) & FRESH) == 0)
+	{
+		stats.repeated++;
+		return false;
+	}
+
+	const unsigned long previous = mSlots[mFront].sequence;
+	mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX_MASK;
+
+	const unsigned long sequence = mSlots[mFront].sequence;
+	stats.acquired++;
+	if (previous != 0 && sequence > previous + 1)
+		stats.dropped += sequence - previous - 1;
+	return true;
+}
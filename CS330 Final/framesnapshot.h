@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// framesnapshot.h
+// ========
+// what the input thread hands the render thread each tick, and the lock-free
+// triple buffer it travels through
+//
+// The input thread polls GLFW, moves the camera and flips toggles, then
+// fills the back slot and publishes it. The render thread takes whichever
+// snapshot was published last and renders from it alone, so neither side
+// ever waits on the other: a slow frame only means some snapshots are
+// never rendered.
+//
+// Because snapshots can be skipped, everything in one is absolute state,
+// never a delta. Driven transforms carry their current local matrix, and
+// one-shot requests (pick, print stats) are counters the render thread
+// compares with the last value it acted on.
+//
+// Moving state is recorded at the two latest simulation steps, and the
+// render thread blends between them (see SimulationClock::Alpha()).
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <vector>
+
+// Toggles owned by the input thread and applied by the render thread
+struct RenderSettings
+{
+	bool culling;           // Frustum culling
+	bool bvhCulling;        // Frustum culling walks the BVH instead of the flat arrays
+	bool occlusion;         // Software occlusion culling
+	bool depthPrePass;      // Depth from the position-only stream first
+	bool parallelFrame;     // Cull and build the draw list on the worker pool
+	GLuint queryMode;       // OcclusionQueries::Mode
+	float minPixelRadius;   // Smallest projected radius still drawn, 0 keeps everything
+	bool lod;               // Draw distant entities at coarser detail levels
+	float lodBias;          // LodSelector bias, each step doubles the error allowed
+};
+
+// Camera at the end of one simulation step
+struct CameraState
+{
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 up;
+	float zoom;                 // Vertical field of view in degrees
+};
+
+// Local transform of a scene node the input thread drives, at the two latest steps
+struct TransformState
+{
+	GLuint node;
+	glm::mat4 previousLocal;
+	glm::mat4 local;
+};
+
+struct FrameSnapshot
+{
+	unsigned long sequence;     // Set by Publish(), counts up from 1
+
+	unsigned long step;         // Simulation steps run so far
+	double stepTime;            // SimulationClock::StepTime() of the latest step
+	double droppedTime;         // Seconds the simulation skipped to keep up
+
+	CameraState previousCamera;
+	CameraState camera;
+	int framebufferWidth;
+	int framebufferHeight;
+
+	RenderSettings settings;
+	// Every node the input thread drives, with its current local transform
+	std::vector<TransformState> transforms;
+
+	// One-shot requests, acted on whenever the count moves
+	unsigned long pickRequests;
+	unsigned long statsRequests;
+};
+
+// Camera between the previous step (alpha 0) and the latest one (alpha 1)
+CameraState InterpolateCamera(const CameraState& previous, const CameraState& current, float alpha);
+glm::mat4 CameraView(const CameraState& camera);
+// Local transform between the two steps. Blending the columns is exact for
+// translation and scale, and close enough for the rotation of a single step.
+glm::mat4 InterpolateTransform(const TransformState& transform, float alpha);
+
+// Counters kept by the render thread side
+struct SnapshotStats
+{
+	unsigned long acquired;     // Snapshots taken by Acquire()
+	unsigned long dropped;      // Snapshots published but replaced before they were taken
+	unsigned long repeated;     // Acquire() calls that found nothing newer
+};
+
+class SnapshotExchange
+{
+public:
+	SnapshotExchange() = default;
+
+	SnapshotExchange(const SnapshotExchange&) = delete;
+	SnapshotExchange& operator=(const SnapshotExchange&) = delete;
+
+	// Input thread: the slot to fill, private to that thread until Publish(). It holds
+	// an old snapshot, so every field must be written again.
+	FrameSnapshot& Back() { return mSlots[mBack]; }
+	// Input thread: hand the back slot over and take a free one in its place
+	void Publish();
+
+	// Render thread: swap in the snapshot published last, false when nothing newer
+	// was published and Front() is unchanged
+	bool Acquire();
+	// Render thread: the snapshot to render, stays put until the next Acquire()
+	const FrameSnapshot& Front() const { return mSlots[mFront]; }
+
+	SnapshotStats stats = {};
+
+private:
+	// Set on the middle index while it holds a snapshot the reader has not taken
+	static const GLuint FRESH = 4;
+	static const GLuint INDEX_MASK = 3;
+
+	FrameSnapshot mSlots[3] = {};
+	GLuint mBack = 0;                       // Owned by the input thread
+	GLuint mFront = 1;                      // Owned by the render thread
+	std::atomic<GLuint> mMiddle{ 2 };       // Index plus FRESH, the only shared word
+	unsigned long mPublished = 0;           // Owned by the input thread
+};
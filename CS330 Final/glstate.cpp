@@ -0,0 +1,389 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstate.cpp
+// ========
+// shadow of the bound GL state that skips calls which would change nothing
+///////////////////////////////////////////////////////////////////////////////
+
+#include "glstate.h"
+
+namespace
+{
+	// Shadow value of a binding that GL has not been told about yet
+	const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+	// Buffer targets with a shadow slot
+	const GLenum BUFFER_TARGETS[] = { GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_DRAW_INDIRECT_BUFFER };
+	const GLuint BUFFER_TARGET_COUNT = sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]);
+
+	// Capabilities with a shadow slot
+	const GLenum CAPS[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE };
+	const GLuint CAP_COUNT = sizeof(CAPS) / sizeof(CAPS[0]);
+
+	// Last value handed to GL for each shadowed piece of state
+	struct Shadow
+	{
+		GLuint program;
+		GLuint vao;
+		GLuint buffers[BUFFER_TARGET_COUNT];
+		GLuint activeUnit;
+		GLuint textures[GLState::MAX_TEXTURE_UNITS];
+		GLenum textureTargets[GLState::MAX_TEXTURE_UNITS];
+		GLuint caps[CAP_COUNT];         // 0 disabled, 1 enabled
+		GLuint depthFunc;
+		GLuint depthMask;
+		GLuint colorMask;               // One bit per channel
+		GLuint blendSource;
+		GLuint blendDestination;
+	};
+
+	Shadow gShadow;
+	bool gShadowValid = false;
+	GLStateStats gStats = {};
+
+	Shadow& UShadow()
+	{
+		if (!gShadowValid)
+			GLState::Invalidate();
+		return gShadow;
+	}
+
+	// True when the call must reach GL; records the new value either way
+	bool UChange(GLuint& shadow, GLuint value)
+	{
+		gStats.calls++;
+		if (shadow == value)
+		{
+			gStats.elided++;
+			return false;
+		}
+		shadow = value;
+		return true;
+	}
+
+	GLint UBufferSlot(GLenum target)
+	{
+		for (GLuint i = 0; i < BUFFER_TARGET_COUNT; ++i)
+		{
+			if (BUFFER_TARGETS[i] == target)
+				return (GLint)i;
+		}
+		return -1;
+	}
+
+	GLint UCapSlot(GLenum cap)
+	{
+		for (GLuint i = 0; i < CAP_COUNT; ++i)
+		{
+			if (CAPS[i] == cap)
+				return (GLint)i;
+		}
+		return -1;
+	}
+}
+
+///////////////////////////////////////////////////
+//	UseProgram(GLuint)
+///////////////////////////////////////////////////
+void GLState::UseProgram(GLuint program)
+{
+	if (UChange(UShadow().program, program))
+		glUseProgram(program);
+}
+
+///////////////////////////////////////////////////
+//	BindVertexArray(GLuint)
+///////////////////////////////////////////////////
+void GLState::BindVertexArray(GLuint vao)
+{
+	if (UChange(UShadow().vao, vao))
+		glBindVertexArray(vao);
+}
+
+///////////////////////////////////////////////////
+//	BindBuffer(GLenum, GLuint)
+//
+//	target: buffer binding point
+//	buffer: buffer to bind, 0 to unbind
+///////////////////////////////////////////////////
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+	const GLint slot = UBufferSlot(target);
+	if (slot < 0)
+	{
+		gStats.calls++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (UChange(UShadow().buffers[slot], buffer))
+		glBindBuffer(target, buffer);
+}
+
+///////////////////////////////////////////////////
+//	BindElementBuffer(GLuint, GLuint)
+//
+//	vao: vertex array the index buffer belongs to
+//	buffer: index buffer, 0 to detach it
+//
+//	GL_ELEMENT_ARRAY_BUFFER is state of whichever
+//	VAO is bound, so the VAO goes through the shadow
+//	first and the binding cannot land on another one
+///////////////////////////////////////////////////
+void GLState::BindElementBuffer(GLuint vao, GLuint buffer)
+{
+	BindVertexArray(vao);
+	gStats.calls++;
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+}
+
+///////////////////////////////////////////////////
+//	BindBufferBase(GLenum, GLuint, GLuint)
+//
+//	target: indexed binding target
+//	index: binding point
+//	buffer: buffer to bind
+//
+//	The indexed bindings are not shadowed, so the
+//	call always goes through
+///////////////////////////////////////////////////
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	gStats.calls++;
+	glBindBufferBase(target, index, buffer);
+
+	const GLint slot = UBufferSlot(target);
+	if (slot >= 0)
+		UShadow().buffers[slot] = buffer;
+}
+
+///////////////////////////////////////////////////
+//	BindTexture(GLuint, GLenum, GLuint)
+//
+//	unit: texture unit, 0 for GL_TEXTURE0
+//	target: GL_TEXTURE_2D, ...
+//	texture: texture to bind, 0 to unbind
+//
+//	A unit keeps one binding per target in GL; the
+//	shadow keeps the last one, so switching targets
+//	on a unit always goes through
+///////////////////////////////////////////////////
+void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	Shadow& shadow = UShadow();
+	if (unit >= MAX_TEXTURE_UNITS)
+	{
+		gStats.calls++;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		shadow.activeUnit = unit;
+		return;
+	}
+
+	gStats.calls++;
+	if (shadow.textures[unit] == texture && shadow.textureTargets[unit] == target)
+	{
+		gStats.elided++;
+		return;
+	}
+
+	if (shadow.activeUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		shadow.activeUnit = unit;
+	}
+	glBindTexture(target, texture);
+	shadow.textures[unit] = texture;
+	shadow.textureTargets[unit] = target;
+}
+
+///////////////////////////////////////////////////
+//	Enable(GLenum)
+///////////////////////////////////////////////////
+void GLState::Enable(GLenum cap)
+{
+	const GLint slot = UCapSlot(cap);
+	if (slot < 0)
+	{
+		gStats.calls++;
+		glEnable(cap);
+		return;
+	}
+
+	if (UChange(UShadow().caps[slot], 1))
+		glEnable(cap);
+}
+
+///////////////////////////////////////////////////
+//	Disable(GLenum)
+///////////////////////////////////////////////////
+void GLState::Disable(GLenum cap)
+{
+	const GLint slot = UCapSlot(cap);
+	if (slot < 0)
+	{
+		gStats.calls++;
+		glDisable(cap);
+		return;
+	}
+
+	if (UChange(UShadow().caps[slot], 0))
+		glDisable(cap);
+}
+
+///////////////////////////////////////////////////
+//	DepthFunc(GLenum)
+///////////////////////////////////////////////////
+void GLState::DepthFunc(GLenum func)
+{
+	if (UChange(UShadow().depthFunc, func))
+		glDepthFunc(func);
+}
+
+///////////////////////////////////////////////////
+//	DepthMask(GLboolean)
+///////////////////////////////////////////////////
+void GLState::DepthMask(GLboolean flag)
+{
+	if (UChange(UShadow().depthMask, flag ? 1 : 0))
+		glDepthMask(flag);
+}
+
+///////////////////////////////////////////////////
+//	ColorMask(GLboolean, GLboolean, GLboolean, GLboolean)
+///////////////////////////////////////////////////
+void GLState::ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	const GLuint mask = (red ? 1u : 0u) | (green ? 2u : 0u) | (blue ? 4u : 0u) | (alpha ? 8u : 0u);
+	if (UChange(UShadow().colorMask, mask))
+		glColorMask(red, green, blue, alpha);
+}
+
+///////////////////////////////////////////////////
+//	BlendFunc(GLenum, GLenum)
+///////////////////////////////////////////////////
+void GLState::BlendFunc(GLenum source, GLenum destination)
+{
+	Shadow& shadow = UShadow();
+	gStats.calls++;
+	if (shadow.blendSource == source && shadow.blendDestination == destination)
+	{
+		gStats.elided++;
+		return;
+	}
+
+	shadow.blendSource = source;
+	shadow.blendDestination = destination;
+	glBlendFunc(source, destination);
+}
+
+///////////////////////////////////////////////////
+//	DeleteProgram(GLuint)
+//
+//	program: program to delete
+//
+//	A deleted program stays in use until another one
+//	is, so the shadow can no longer vouch for it
+///////////////////////////////////////////////////
+void GLState::DeleteProgram(GLuint program)
+{
+	Shadow& shadow = UShadow();
+	if (shadow.program == program)
+		shadow.program = UNKNOWN;
+	glDeleteProgram(program);
+}
+
+///////////////////////////////////////////////////
+//	DeleteVertexArrays(GLsizei, const GLuint*)
+//
+//	Deleting the bound VAO reverts the binding to 0
+///////////////////////////////////////////////////
+void GLState::DeleteVertexArrays(GLsizei count, const GLuint* vaos)
+{
+	Shadow& shadow = UShadow();
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		if (vaos[i] != 0 && shadow.vao == vaos[i])
+			shadow.vao = 0;
+	}
+	glDeleteVertexArrays(count, vaos);
+}
+
+///////////////////////////////////////////////////
+//	DeleteBuffers(GLsizei, const GLuint*)
+//
+//	Deleting a bound buffer reverts its bindings to 0
+///////////////////////////////////////////////////
+void GLState::DeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+	Shadow& shadow = UShadow();
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		for (GLuint slot = 0; slot < BUFFER_TARGET_COUNT; ++slot)
+		{
+			if (buffers[i] != 0 && shadow.buffers[slot] == buffers[i])
+				shadow.buffers[slot] = 0;
+		}
+	}
+	glDeleteBuffers(count, buffers);
+}
+
+///////////////////////////////////////////////////
+//	DeleteTextures(GLsizei, const GLuint*)
+//
+//	Deleting a bound texture reverts every unit it
+//	was bound to back to 0
+///////////////////////////////////////////////////
+void GLState::DeleteTextures(GLsizei count, const GLuint* textures)
+{
+	Shadow& shadow = UShadow();
+	for (GLsizei i = 0; i < count; ++i)
+	{
+		for (GLuint unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+		{
+			if (textures[i] != 0 && shadow.textures[unit] == textures[i])
+				shadow.textures[unit] = 0;
+		}
+	}
+	glDeleteTextures(count, textures);
+}
+
+///////////////////////////////////////////////////
+//	Invalidate()
+///////////////////////////////////////////////////
+void GLState::Invalidate()
+{
+	gShadow.program = UNKNOWN;
+	gShadow.vao = UNKNOWN;
+	for (GLuint i = 0; i < BUFFER_TARGET_COUNT; ++i)
+		gShadow.buffers[i] = UNKNOWN;
+	gShadow.activeUnit = UNKNOWN;
+	for (GLuint i = 0; i < MAX_TEXTURE_UNITS; ++i)
+	{
+		gShadow.textures[i] = UNKNOWN;
+		gShadow.textureTargets[i] = UNKNOWN;
+	}
+	for (GLuint i = 0; i < CAP_COUNT; ++i)
+		gShadow.caps[i] = UNKNOWN;
+	gShadow.depthFunc = UNKNOWN;
+	gShadow.depthMask = UNKNOWN;
+	gShadow.colorMask = UNKNOWN;
+	gShadow.blendSource = UNKNOWN;
+	gShadow.blendDestination = UNKNOWN;
+	gShadowValid = true;
+}
+
+///////////////////////////////////////////////////
+//	BeginFrame()
+///////////////////////////////////////////////////
+void GLState::BeginFrame()
+{
+	gStats = {};
+}
+
+///////////////////////////////////////////////////
+//	Stats()
+///////////////////////////////////////////////////
+const GLStateStats& GLState::Stats()
+{
+	return gStats;
+}
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstate.h
+// ========
+// shadow of the bound GL state that skips calls which would change nothing
+//
+// Every bind and toggle the renderer makes goes through here. The last
+// value handed to GL is remembered per binding point, and a call with the
+// same value is dropped before it reaches the driver. Bindings start out
+// unknown, so the first call after startup or Invalidate() always goes
+// through. Objects that may still be bound must be deleted through the
+// Delete* helpers so a recycled name is never mistaken for a live binding.
+//
+// Element array buffer bindings are part of the VAO, so they are set with
+// BindElementBuffer(), which binds the VAO they belong to first.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+// Call counters, reset by BeginFrame()
+struct GLStateStats
+{
+	GLuint calls;   // Calls made through the cache
+	GLuint elided;  // Calls dropped because the state already matched
+};
+
+class GLState
+{
+public:
+	// Texture units shadowed, matches the texture slots the scene uses and then some
+	static const GLuint MAX_TEXTURE_UNITS = 16;
+
+public:
+	static void UseProgram(GLuint program);
+	static void BindVertexArray(GLuint vao);
+	// GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER and GL_DRAW_INDIRECT_BUFFER are shadowed,
+	// other targets always go through
+	static void BindBuffer(GLenum target, GLuint buffer);
+	// Also binds the generic target, which the shadow records; never elided
+	static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	// Bind vao, then make buffer its index buffer; the buffer bind is never elided
+	static void BindElementBuffer(GLuint vao, GLuint buffer);
+	// Selects the unit with glActiveTexture only when it differs
+	static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	// GL_DEPTH_TEST, GL_BLEND and GL_CULL_FACE are shadowed, other caps always go through
+	static void Enable(GLenum cap);
+	static void Disable(GLenum cap);
+	static void DepthFunc(GLenum func);
+	static void DepthMask(GLboolean flag);
+	static void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+	static void BlendFunc(GLenum source, GLenum destination);
+
+	static void DeleteProgram(GLuint program);
+	static void DeleteVertexArrays(GLsizei count, const GLuint* vaos);
+	static void DeleteBuffers(GLsizei count, const GLuint* buffers);
+	static void DeleteTextures(GLsizei count, const GLuint* textures);
+
+	// Forget everything, for code that changed state behind the cache's back
+	static void Invalidate();
+
+	// Start counting a new frame
+	static void BeginFrame();
+	// Counters of the frame so far
+	static const GLStateStats& Stats();
+};
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// lod.cpp
+// ========
+// per-frame choice of the detail level each visible entity is drawn at
+///////////////////////////////////////////////////////////////////////////////
+
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////
+//	SetView(const glm::mat4&, const glm::mat4&, float, float)
+//
+//	view, projection: camera of the frame
+//	viewportHeight: render target height in pixels
+//	bias: log2 scale of the allowed error
+///////////////////////////////////////////////////
+void LodSelector::SetView(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float bias)
+{
+	mDepthRow = glm::vec4(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+
+	// projection[1][1] is cot(fovy / 2): world units at distance 1 to half the viewport
+	mProjectionScale = projection[1][1] * viewportHeight * 0.5f;
+	mAllowedError = PIXEL_ERROR * std::exp2(bias);
+}
+
+///////////////////////////////////////////////////
+//	Select(const Scene&, const unsigned char*, std::vector<unsigned char>&)
+//
+//	scene: entities to choose levels for
+//	visible: one flag per entity, or nullptr for all
+//	levels: level of each entity, resized as needed
+//
+//	The error of a level in pixels is its object
+//	space error over the mesh's sphere radius, times
+//	the projected radius of the entity's sphere.
+//	Hidden entities keep their level for when they
+//	come back into view.
+///////////////////////////////////////////////////
+void LodSelector::Select(const Scene& scene, const unsigned char* visible, std::vector<unsigned char>& levels)
+{
+	const GLuint count = (GLuint)scene.Count();
+	levels.resize(count, 0);
+
+	const float refineAbove = mAllowedError * (1.0f + HYSTERESIS);
+	const float coarsenBelow = mAllowedError * (1.0f - HYSTERESIS);
+
+	const auto selectRange = [&](GLuint begin, GLuint end, GLuint chunk)
+	{
+		LodStats chunkStats = {};
+		for (GLuint e = begin; e < end; ++e)
+		{
+			if (visible != nullptr && !visible[e])
+				continue;
+
+			const Meshes::GLMesh& mesh = *scene.meshes[e];
+			const GLuint previous = levels[e];
+			GLuint level = 0;
+
+			// a sphere reaching past the camera plane counts as touching it, which projects it at its largest
+			const float radius = scene.boundsRadius[e];
+			const float depth = std::max(radius, mDepthRow.x * scene.boundsX[e] + mDepthRow.y * scene.boundsY[e] +
+				mDepthRow.z * scene.boundsZ[e] + mDepthRow.w);
+			if (mesh.nLods > 1 && depth > 0.0f && mesh.sphereRadius > 0.0f)
+			{
+				// pixels per object space unit of error
+				const float pixelsPerError = radius * mProjectionScale / (depth * mesh.sphereRadius);
+
+				level = std::min(previous, mesh.nLods - 1);
+				while (level > 0 && mesh.lods[level].error * pixelsPerError > refineAbove)
+					level--;
+				while (level + 1 < mesh.nLods && mesh.lods[level + 1].error * pixelsPerError <= coarsenBelow)
+					level++;
+			}
+
+			levels[e] = (unsigned char)level;
+			if (level != previous)
+				chunkStats.switches++;
+			chunkStats.levels[level]++;
+			chunkStats.triangles += (mesh.nLods > 0 ? mesh.lods[level].nIndices : mesh.nIndices) / 3;
+			chunkStats.fullTriangles += mesh.nIndices / 3;
+		}
+		mChunkStats[chunk] = chunkStats;
+	};
+
+	const GLuint chunkSize = mPool != nullptr ? CHUNK_SIZE : std::max(count, 1u);
+	mChunkStats.assign(WorkerPool::ChunkCount(count, chunkSize), LodStats());
+	if (mPool != nullptr)
+		mPool->ParallelFor(count, chunkSize, selectRange);
+	else if (count > 0)
+		selectRange(0, count, 0);
+
+	stats = {};
+	for (const LodStats& chunkStats : mChunkStats)
+	{
+		for (GLuint level = 0; level < Meshes::MAX_LODS; ++level)
+			stats.levels[level] += chunkStats.levels[level];
+		stats.switches += chunkStats.switches;
+		stats.triangles += chunkStats.triangles;
+		stats.fullTriangles += chunkStats.fullTriangles;
+	}
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// lod.h
+// ========
+// per-frame choice of the detail level each visible entity is drawn at
+//
+// Every mesh carries a chain of levels, finest first, each with the largest
+// distance between its facets and the exact shape (Meshes::GLMeshLod). That
+// error is scaled by the entity's projected bounding sphere: a level whose
+// error covers less than PIXEL_ERROR pixels looks the same as the finest
+// one, so the coarsest such level is drawn. The LOD bias doubles (or halves)
+// that allowance per step, trading detail for triangles across the board.
+//
+// Levels are sticky. Moving to a coarser level needs its error to fall
+// HYSTERESIS below the allowance and moving back needs the current one to
+// rise HYSTERESIS above it, so an entity sitting at a boundary does not
+// flicker between two levels as the camera drifts.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "meshes.h"
+#include "scene.h"
+#include "workerpool.h"
+
+// Counters describing the last selection
+struct LodStats
+{
+	GLuint levels[Meshes::MAX_LODS];    // Visible entities drawn at each level
+	GLuint switches;                    // Visible entities whose level changed this frame
+	unsigned long triangles;            // Triangles of the chosen levels
+	unsigned long fullTriangles;        // Triangles had every entity been drawn at level 0
+};
+
+class LodSelector
+{
+public:
+	// Projected error in pixels a level may have and still be chosen, at bias 0
+	static constexpr float PIXEL_ERROR = 1.0f;
+	// Fraction of the allowance an error must pass it by before the level changes
+	static constexpr float HYSTERESIS = 0.25f;
+	// Entities per chunk when selecting on a pool
+	static const GLuint CHUNK_SIZE = 8192;
+
+	LodStats stats = {};
+
+public:
+	// Run Select() on the pool's threads, nullptr selects on the calling thread
+	void SetWorkerPool(WorkerPool* pool) { mPool = pool; }
+
+	// viewportHeight: height of the render target in pixels
+	// bias: log2 scale of the allowed error, positive picks coarser levels
+	void SetView(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float bias);
+
+	// Update levels[i] for every visible entity. levels keeps its values between
+	// frames, they are what the hysteresis starts from; new entities start at 0.
+	void Select(const Scene& scene, const unsigned char* visible, std::vector<unsigned char>& levels);
+
+private:
+	glm::vec4 mDepthRow = glm::vec4(0.0f);  // View space depth of a world point, larger is farther
+	float mProjectionScale = 0.0f;          // Pixels per world unit at distance 1
+	float mAllowedError = PIXEL_ERROR;
+
+	WorkerPool* mPool = nullptr;
+	std::vector<LodStats> mChunkStats;
+};
@@ -1,11 +1,12 @@
 #ifndef MESH_H
 #define MESH_H
 
-#include <glad/glad.h> // holds all OpenGL type declarations
+#include <GL/glew.h> // holds all OpenGL type declarations
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "meshgeometry.h"
 #include "shader.h"
 
 #include <string>
@@ -38,6 +39,9 @@ public:
 	vector<unsigned int> indices;
 	vector<Texture>      textures;
 	unsigned int VAO;
+	// sampler locations of textures[i] for the program they were resolved against
+	vector<GLint> samplerLocations;
+	unsigned int samplerProgram = 0;
 
 	// constructor
 	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -46,6 +50,12 @@ public:
 		this->indices = indices;
 		this->textures = textures;
 
+		// fill in what the loader left out: normals first, the tangent frames are built on them
+		if (attributeMissing(&Vertex::Normal))
+			ComputeNormals(this->vertices.data(), layout(), (uint32_t)this->vertices.size(), this->indices.data(), this->indices.size());
+		if (attributeMissing(&Vertex::Tangent))
+			ComputeTangentFrames(this->vertices.data(), layout(), (uint32_t)this->vertices.size(), this->indices.data(), this->indices.size());
+
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
 		setupMesh();
 	}
@@ -53,28 +63,16 @@ public:
 	// render the mesh
 	void Draw(Shader &shader)
 	{
+		// sampler names only depend on the texture list, resolve them once per program
+		if (samplerProgram != shader.ID || samplerLocations.size() != textures.size())
+			resolveSamplers(shader);
+
 		// bind appropriate textures
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		unsigned int normalNr = 1;
-		unsigned int heightNr = 1;
 		for (unsigned int i = 0; i < textures.size(); i++)
 		{
 			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-			// retrieve texture number (the N in diffuse_textureN)
-			string number;
-			string name = textures[i].type;
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-			else if (name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-			else if (name == "texture_height")
-				number = std::to_string(heightNr++); // transfer unsigned int to stream
-
 			// now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+			glUniform1i(samplerLocations[i], i);
 			// and finally bind the texture
 			glBindTexture(GL_TEXTURE_2D, textures[i].id);
 		}
@@ -92,6 +90,50 @@ private:
 	// render data 
 	unsigned int VBO, EBO;
 
+	// where ComputeNormals() and ComputeTangentFrames() find the attributes of a Vertex
+	static GeometryLayout layout()
+	{
+		return { sizeof(Vertex), offsetof(Vertex, Position), offsetof(Vertex, Normal), offsetof(Vertex, TexCoords), offsetof(Vertex, Tangent), offsetof(Vertex, Bitangent) };
+	}
+
+	// true when no vertex has a non-zero value for the attribute
+	bool attributeMissing(glm::vec3 Vertex::*attribute) const
+	{
+		for (const Vertex& vertex : vertices)
+		{
+			if (vertex.*attribute != glm::vec3(0.0f))
+				return false;
+		}
+		return true;
+	}
+
+	// look up the location of every texture's sampler in the shader's reflection
+	void resolveSamplers(Shader &shader)
+	{
+		unsigned int diffuseNr = 1;
+		unsigned int specularNr = 1;
+		unsigned int normalNr = 1;
+		unsigned int heightNr = 1;
+		samplerLocations.resize(textures.size());
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			// retrieve texture number (the N in diffuse_textureN)
+			string number;
+			string name = textures[i].type;
+			if (name == "texture_diffuse")
+				number = std::to_string(diffuseNr++);
+			else if (name == "texture_specular")
+				number = std::to_string(specularNr++); // transfer unsigned int to stream
+			else if (name == "texture_normal")
+				number = std::to_string(normalNr++); // transfer unsigned int to stream
+			else if (name == "texture_height")
+				number = std::to_string(heightNr++); // transfer unsigned int to stream
+
+			samplerLocations[i] = shader.reflection->Location(name + number);
+		}
+		samplerProgram = shader.ID;
+	}
+
 	// initializes all the buffer objects/arrays
 	void setupMesh()
 	{
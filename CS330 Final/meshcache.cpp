@@ -0,0 +1,282 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.cpp
+// ========
+// cooked binary files: aligned sections behind a checked header, read back
+// through a memory mapping
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char MAGIC[8] = { 'C', 'S', '3', '3', '0', 'M', 'C', 0 };
+	const uint64_t FNV_PRIME = 1099511628211ull;
+
+	size_t UAlign(size_t bytes)
+	{
+		return (bytes + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+	}
+
+	// Checksum of one section and the padding behind it, hashed apart since they need not be adjacent in memory
+	uint64_t UHashSection(const void* data, size_t bytes, const void* padding, uint64_t hash)
+	{
+		hash = HashBytes(data, bytes, hash);
+		return HashBytes(padding, UAlign(bytes) - bytes, hash);
+	}
+
+	// Bytes before the first section: the header and the table
+	size_t UDataStart(uint32_t sectionCount)
+	{
+		return UAlign(sizeof(MeshCacheHeader) + sizeof(MeshCacheSection) * sectionCount);
+	}
+}
+
+const char* MeshCacheStatusName(MeshCacheStatus status)
+{
+	switch (status)
+	{
+	case MESH_CACHE_LOADED: return "loaded";
+	case MESH_CACHE_MISSING: return "missing";
+	case MESH_CACHE_STALE: return "stale";
+	default: return "damaged";
+	}
+}
+
+///////////////////////////////////////////////////
+//	HashBytes(const void*, size_t, uint64_t)
+//
+//	data, bytes: memory to hash
+//	hash: result of the previous call, to hash
+//		several pieces as one
+///////////////////////////////////////////////////
+uint64_t HashBytes(const void* data, size_t bytes, uint64_t hash)
+{
+	const unsigned char* source = (const unsigned char*)data;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, source + i, sizeof(word));
+		hash = (hash ^ word) * FNV_PRIME;
+	}
+	for (; i < bytes; ++i)
+		hash = (hash ^ source[i]) * FNV_PRIME;
+	return hash;
+}
+
+///////////////////////////////////////////////////
+//	MappedFile::Open(const std::string&)
+//
+//	path: file to map
+///////////////////////////////////////////////////
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = (const unsigned char*)view;
+	mSize = (size_t)size.QuadPart;
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	// the mapping keeps its own reference to the file
+	void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (view == MAP_FAILED)
+		return false;
+
+	mData = (const unsigned char*)view;
+	mSize = (size_t)status.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+	CloseHandle((HANDLE)mMapping);
+	CloseHandle((HANDLE)mFile);
+	mFile = mMapping = nullptr;
+#else
+	munmap((void*)mData, mSize);
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
+
+void MeshCacheWriter::AddSection(const void* data, size_t bytes)
+{
+	mSections.push_back({ 0, bytes });
+	mData.push_back(data);
+}
+
+///////////////////////////////////////////////////
+//	MeshCacheWriter::Write(const std::string&, uint64_t)
+//
+//	path: file to replace
+//	key: hash of what the sections were cooked from
+//
+//	The layout and checksum are worked out first so
+//	the header can be written ahead of the data.
+///////////////////////////////////////////////////
+bool MeshCacheWriter::Write(const std::string& path, uint64_t key) const
+{
+	const uint32_t sectionCount = (uint32_t)mSections.size();
+	std::vector<MeshCacheSection> table = mSections;
+	const size_t dataStart = UDataStart(sectionCount);
+
+	size_t offset = dataStart;
+	for (MeshCacheSection& section : table)
+	{
+		section.offset = offset;
+		offset = UAlign(offset + (size_t)section.bytes);
+	}
+
+	const std::vector<unsigned char> padding(MESH_CACHE_ALIGNMENT, 0);
+	MeshCacheHeader header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.format = MESH_CACHE_FORMAT;
+	header.sectionCount = sectionCount;
+	header.key = key;
+	header.fileBytes = offset;
+	header.checksum = HashBytes(nullptr, 0);
+	for (uint32_t s = 0; s < sectionCount; ++s)
+		header.checksum = UHashSection(mData[s], (size_t)table[s].bytes, padding.data(), header.checksum);
+
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)table.data(), sizeof(MeshCacheSection) * sectionCount);
+		file.write((const char*)padding.data(), dataStart - sizeof(header) - sizeof(MeshCacheSection) * sectionCount);
+		for (uint32_t s = 0; s < sectionCount; ++s)
+		{
+			file.write((const char*)mData[s], (std::streamsize)table[s].bytes);
+			file.write((const char*)padding.data(), UAlign((size_t)table[s].bytes) - (size_t)table[s].bytes);
+		}
+		if (!file)
+			return false;
+	}
+
+	// rename does not replace an existing file everywhere
+	std::remove(path.c_str());
+	return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+///////////////////////////////////////////////////
+//	MeshCache::Open(const std::string&, uint64_t, uint32_t)
+//
+//	path: cooked file
+//	key: hash the caller would cook the file with now
+//	sectionCount: sections the caller expects
+//
+//	Check everything that can be checked before a
+//	section is handed out: the checksum reads the
+//	whole file, which the upload does anyway.
+///////////////////////////////////////////////////
+MeshCacheStatus MeshCache::Open(const std::string& path, uint64_t key, uint32_t sectionCount)
+{
+	Close();
+	if (!mFile.Open(path))
+		return MESH_CACHE_MISSING;
+
+	const size_t dataStart = UDataStart(sectionCount);
+	MeshCacheHeader header;
+	if (mFile.Size() < dataStart)
+	{
+		Close();
+		return MESH_CACHE_DAMAGED;
+	}
+	std::memcpy(&header, mFile.Data(), sizeof(header));
+
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.format != MESH_CACHE_FORMAT ||
+		header.key != key || header.sectionCount != sectionCount)
+	{
+		Close();
+		return MESH_CACHE_STALE;
+	}
+
+	// the sections must tile the file behind the table the way MeshCacheWriter lays them out
+	const MeshCacheSection* sections = (const MeshCacheSection*)(mFile.Data() + sizeof(header));
+	size_t offset = dataStart;
+	uint64_t checksum = HashBytes(nullptr, 0);
+	bool valid = header.fileBytes == mFile.Size();
+	for (uint32_t s = 0; valid && s < sectionCount; ++s)
+	{
+		const size_t bytes = (size_t)sections[s].bytes;
+		valid = sections[s].offset == offset && bytes <= mFile.Size() - offset && UAlign(bytes) <= mFile.Size() - offset;
+		if (valid)
+		{
+			checksum = UHashSection(mFile.Data() + offset, bytes, mFile.Data() + offset + bytes, checksum);
+			offset += UAlign(bytes);
+		}
+	}
+	if (!valid || offset != mFile.Size() || checksum != header.checksum)
+	{
+		Close();
+		return MESH_CACHE_DAMAGED;
+	}
+
+	mSections = sections;
+	return MESH_CACHE_LOADED;
+}
+
+void MeshCache::Close()
+{
+	mFile.Close();
+	mSections = nullptr;
+}
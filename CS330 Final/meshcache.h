@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.h
+// ========
+// cooked binary files: aligned sections behind a checked header, read back
+// through a memory mapping
+//
+// MeshCacheWriter lays its sections out one after the other behind a
+// header and a table of section offsets and sizes, each section starting
+// on a MESH_CACHE_ALIGNMENT boundary. The header carries the format
+// version, a key the caller hashes from everything the contents were built
+// from, and a checksum of the section data. MeshCache maps a file
+// read-only, with mmap or MapViewOfFile, and accepts it only when the
+// magic, format, key, size and checksum all match. A changed parameter, a
+// file of another build or a half written one all read as a miss and the
+// caller cooks again. Accepted sections are used in place: pointers into
+// the mapping go straight to glBufferData().
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Every section starts on a multiple of this many bytes
+const size_t MESH_CACHE_ALIGNMENT = 64;
+// Bumped when the header or the section table change
+const uint32_t MESH_CACHE_FORMAT = 1;
+
+// First bytes of a file
+struct MeshCacheHeader
+{
+	char magic[8];
+	uint32_t format;        // MESH_CACHE_FORMAT
+	uint32_t sectionCount;
+	uint64_t key;           // Hash of what the contents were cooked from
+	uint64_t checksum;      // HashBytes() of everything behind the section table
+	uint64_t fileBytes;
+};
+
+// Entry of the section table that follows the header
+struct MeshCacheSection
+{
+	uint64_t offset;        // From the start of the file
+	uint64_t bytes;
+};
+
+// Why MeshCache::Open() gave up, or that it did not
+enum MeshCacheStatus { MESH_CACHE_LOADED, MESH_CACHE_MISSING, MESH_CACHE_STALE, MESH_CACHE_DAMAGED };
+
+const char* MeshCacheStatusName(MeshCacheStatus status);
+
+// 64-bit FNV-1a of bytes, continuing from hash; 8 bytes at a time while 8 are left
+uint64_t HashBytes(const void* data, size_t bytes, uint64_t hash = 14695981039346656037ull);
+
+// Read-only view of a whole file
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// False when the file is missing, empty or cannot be mapped
+	bool Open(const std::string& path);
+	void Close();
+
+	const unsigned char* Data() const { return mData; }
+	size_t Size() const { return mSize; }
+
+private:
+	const unsigned char* mData = nullptr;
+	size_t mSize = 0;
+	void* mFile = nullptr;      // Windows file and mapping handles
+	void* mMapping = nullptr;
+};
+
+class MeshCacheWriter
+{
+public:
+	// Append a section; data is read by Write(), so it must stay valid until then
+	void AddSection(const void* data, size_t bytes);
+
+	// Write the file next to path and rename it over path, so a reader never maps half of one
+	bool Write(const std::string& path, uint64_t key) const;
+
+private:
+	std::vector<MeshCacheSection> mSections;
+	std::vector<const void*> mData;
+};
+
+class MeshCache
+{
+public:
+	// Map path and check it was cooked with key and has sectionCount sections
+	MeshCacheStatus Open(const std::string& path, uint64_t key, uint32_t sectionCount);
+	void Close();
+
+	// Start of section index inside the mapping, valid until Close()
+	const void* Section(uint32_t index) const { return mFile.Data() + mSections[index].offset; }
+	size_t SectionBytes(uint32_t index) const { return (size_t)mSections[index].bytes; }
+
+private:
+	MappedFile mFile;
+	const MeshCacheSection* mSections = nullptr;
+};
@@ -9,12 +9,54 @@
 
 #include "meshes.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
 #include <vector>
 
+#include "glstate.h"
+#include "vertexcache.h"
+#include "vertexformat.h"
+#include "vertexweld.h"
+
+const GeometryLayout Meshes::VERTEX_LAYOUT = {
+	sizeof(GLfloat) * FLOATS_PER_VERTEX,
+	0,
+	sizeof(GLfloat) * 3,
+	sizeof(GLfloat) * 6,
+	NO_ATTRIBUTE,
+	NO_ATTRIBUTE
+};
+
 namespace
 {
-	const double M_PI = 3.14159265358979323846f;
-	const double M_PI_2 = 1.571428571428571;
+	// Sections of the cooked file, in the order they are written
+	enum CookedSection
+	{
+		COOKED_MESHES,      // GLMesh of every mesh, in UAllMeshes() order
+		COOKED_WELDS,       // CookedWeld per weldReport entry
+		COOKED_SUMMARY,     // One CookedSummary
+		COOKED_VERTICES,    // The three buffers, as uploaded
+		COOKED_POSITIONS,
+		COOKED_INDICES,
+		COOKED_SECTION_COUNT
+	};
+
+	// weldReport entry with the name in place, so the section is read without parsing
+	struct CookedWeld
+	{
+		char name[52];
+		GLuint sourceVertices;
+		GLuint vertices;
+		GLuint triangles;
+	};
+
+	struct CookedSummary
+	{
+		Meshes::MeshStats stats;
+		GLenum indexType;
+	};
 }
 
 ///////////////////////////////////////////////////
@@ -25,16 +67,52 @@ namespace
 ///////////////////////////////////////////////////
 void Meshes::CreateMeshes()
 {
-	UCreatePlaneMesh(gPlaneMesh);
-	UCreatePrismMesh(gPrismMesh);
-	UCreateBoxMesh(gBoxMesh);
-	UCreateConeMesh(gConeMesh);
-	UCreateCylinderMesh(gCylinderMesh);
-	UCreateTaperedCylinderMesh(gTaperedCylinderMesh);
-	UCreatePyramid3Mesh(gPyramid3Mesh);
-	UCreatePyramid4Mesh(gPyramid4Mesh);
-	UCreateSphereMesh(gSphereMesh);
-	UCreateTorusMesh(gTorusMesh);
+	mPoolVertices.clear();
+	mPoolIndices.clear();
+	stats = {};
+	weldReport.clear();
+
+	// the round meshes come from the primitive cache at their default resolution,
+	// together with every resolution requested before; all of them are part of the cook key
+	RequestPrimitive(PRIMITIVE_CONE, DEFAULT_SEGMENTS, 1);
+	RequestPrimitive(PRIMITIVE_CYLINDER, DEFAULT_SEGMENTS, 1);
+	RequestPrimitive(PRIMITIVE_TAPERED_CYLINDER, DEFAULT_SEGMENTS, 1);
+	RequestPrimitive(PRIMITIVE_SPHERE, DEFAULT_SPHERE_SEGMENTS, DEFAULT_SPHERE_RINGS);
+	RequestPrimitive(PRIMITIVE_TORUS, DEFAULT_TORUS_SEGMENTS, DEFAULT_TORUS_RINGS);
+
+	if (mRecook)
+		stats.cache = MESH_CACHE_STALE;
+	if (mCachePath.empty() || mRecook || !ULoadCooked())
+	{
+		UCreatePlaneMesh(gPlaneMesh);
+		UCreatePrismMesh(gPrismMesh);
+		UCreateBoxMesh(gBoxMesh);
+		UCreatePyramid3Mesh(gPyramid3Mesh);
+		UCreatePyramid4Mesh(gPyramid4Mesh);
+		for (auto& entry : mPrimitives)
+		{
+			PrimitiveMesh& primitive = entry.second;
+			UCreatePrimitiveMesh(primitive.mesh, primitive.type, primitive.segments, primitive.rings);
+		}
+
+		CookedPool storage;
+		const PoolStreams streams = UCookPool(storage);
+		UUploadPool(streams);
+		if (!mCachePath.empty())
+			stats.cooked = UWriteCooked(streams);
+
+		// the CPU copies are no longer needed
+		mPoolVertices.clear();
+		mPoolVertices.shrink_to_fit();
+		mPoolIndices.clear();
+		mPoolIndices.shrink_to_fit();
+	}
+
+	gConeMesh = GetPrimitive(PRIMITIVE_CONE, DEFAULT_SEGMENTS, 1);
+	gCylinderMesh = GetPrimitive(PRIMITIVE_CYLINDER, DEFAULT_SEGMENTS, 1);
+	gTaperedCylinderMesh = GetPrimitive(PRIMITIVE_TAPERED_CYLINDER, DEFAULT_SEGMENTS, 1);
+	gSphereMesh = GetPrimitive(PRIMITIVE_SPHERE, DEFAULT_SPHERE_SEGMENTS, DEFAULT_SPHERE_RINGS);
+	gTorusMesh = GetPrimitive(PRIMITIVE_TORUS, DEFAULT_TORUS_SEGMENTS, DEFAULT_TORUS_RINGS);
 }
 
 ///////////////////////////////////////////////////
@@ -44,15 +122,78 @@ void Meshes::CreateMeshes()
 ///////////////////////////////////////////////////
 void Meshes::DestroyMeshes()
 {
-	UDestroyMesh(gBoxMesh);
-	UDestroyMesh(gConeMesh);
-	UDestroyMesh(gCylinderMesh);
-	UDestroyMesh(gPlaneMesh);
-	UDestroyMesh(gPyramid3Mesh);
-	UDestroyMesh(gPyramid4Mesh);
-	UDestroyMesh(gPrismMesh);
-	UDestroyMesh(gSphereMesh);
-	UDestroyMesh(gTorusMesh);
+	// every mesh references the same shared VAO and buffers
+	GLState::DeleteVertexArrays(1, &mPoolVao);
+	GLState::DeleteBuffers(1, &mPoolVbo);
+	GLState::DeleteBuffers(1, &mPoolEbo);
+	mPoolVao = mPoolVbo = mPoolEbo = 0;
+
+	GLState::DeleteVertexArrays(1, &mDepthVao);
+	GLState::DeleteBuffers(1, &mPositionVbo);
+	mDepthVao = mPositionVbo = 0;
+}
+
+///////////////////////////////////////////////////
+//	RequestPrimitive(PrimitiveType, GLuint, GLuint)
+//
+//	type: cylinder, tapered cylinder, cone, sphere or torus
+//	segments: columns around the y axis, or around
+//		the main radius of the torus
+//	rings: bands up the height, latitude bands of
+//		the sphere or columns around the torus tube
+//
+//	Record a resolution for CreateMeshes() to build.
+//	Asking twice for the same one builds it once.
+///////////////////////////////////////////////////
+void Meshes::RequestPrimitive(PrimitiveType type, GLuint segments, GLuint rings)
+{
+	const uint64_t key = UPrimitiveKey(type, segments, rings);
+	if (mPrimitives.count(key) != 0)
+		return;
+
+	PrimitiveMesh& primitive = mPrimitives[key];
+	primitive.type = type;
+	primitive.segments = segments;
+	primitive.rings = rings;
+	primitive.mesh = {};
+}
+
+///////////////////////////////////////////////////
+//	GetPrimitive(PrimitiveType, GLuint, GLuint)
+//
+//	type: cylinder, tapered cylinder, cone, sphere or torus
+//	segments, rings: resolution passed to
+//		RequestPrimitive()
+//
+//	Return the mesh built for that resolution, or
+//	the default one of the type when it was never
+//	requested
+///////////////////////////////////////////////////
+const Meshes::GLMesh& Meshes::GetPrimitive(PrimitiveType type, GLuint segments, GLuint rings) const
+{
+	std::map<uint64_t, PrimitiveMesh>::const_iterator found = mPrimitives.find(UPrimitiveKey(type, segments, rings));
+	if (found != mPrimitives.end())
+		return found->second.mesh;
+
+	if (type == PRIMITIVE_SPHERE)
+		return mPrimitives.at(UPrimitiveKey(type, DEFAULT_SPHERE_SEGMENTS, DEFAULT_SPHERE_RINGS)).mesh;
+	if (type == PRIMITIVE_TORUS)
+		return mPrimitives.at(UPrimitiveKey(type, DEFAULT_TORUS_SEGMENTS, DEFAULT_TORUS_RINGS)).mesh;
+	return mPrimitives.at(UPrimitiveKey(type, DEFAULT_SEGMENTS, 1)).mesh;
+}
+
+///////////////////////////////////////////////////
+//	UPrimitiveKey(PrimitiveType, GLuint, GLuint)
+//
+//	Cache key of a resolution, after raising it to
+//	the minimum the generator builds, so requests
+//	that end up as the same geometry share a mesh
+///////////////////////////////////////////////////
+uint64_t Meshes::UPrimitiveKey(PrimitiveType type, GLuint segments, GLuint rings)
+{
+	segments = std::max(segments, MIN_PRIMITIVE_SEGMENTS);
+	rings = std::max(rings, MinPrimitiveRings(type));
+	return ((uint64_t)type << 48) | ((uint64_t)(segments & 0xffffff) << 24) | (rings & 0xffffff);
 }
 
 ///////////////////////////////////////////////////
@@ -92,30 +233,12 @@ void Meshes::UCreatePlaneMesh(GLMesh &mesh)
 	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
 	mesh.nIndices = sizeof(indices) / sizeof(indices[0]);
 
-	// Generate the VAO for the mesh
-	glGenVertexArrays(1, &mesh.vao);
-	glBindVertexArray(mesh.vao);	// activate the VAO
+	// store the draw commands that render the mesh
+	mesh.nRanges = 0;
+	USetDrawRange(mesh, GL_TRIANGLES, 0, mesh.nIndices, true);
 
-	// Create VBOs for the mesh
-	glGenBuffers(2, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	// Strides between vertex coordinates
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
-
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	// pack the mesh into the shared geometry buffers
+	UAddToPool(mesh, "Plane", verts, indices);
 }
 
 ///////////////////////////////////////////////////
@@ -163,23 +286,12 @@ void Meshes::UCreatePyramid3Mesh(GLMesh &mesh)
 	// Calculate total defined vertices
 	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerColor + floatsPerUV));
 
-	glGenVertexArrays(1, &mesh.vao);			// Creates 1 VAO
-	glGenBuffers(1, mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(mesh.vao);				// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-	// Strides between sets of attribute data
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerColor + floatsPerUV);
+	// store the draw commands that render the mesh
+	mesh.nRanges = 0;
+	USetDrawRange(mesh, GL_TRIANGLE_STRIP, 0, mesh.nVertices, false);
 
-	// Creates the Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, floatsPerColor, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* (floatsPerVertex + floatsPerColor)));
-	glEnableVertexAttribArray(2);
+	// pack the mesh into the shared geometry buffers
+	UAddToPool(mesh, "Pyramid3", verts, NULL);
 }
 
 ///////////////////////////////////////////////////
@@ -236,23 +348,12 @@ void Meshes::UCreatePyramid4Mesh(GLMesh &mesh)
 	// Calculate total defined vertices
 	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerColor + floatsPerUV));
 
-	glGenVertexArrays(1, &mesh.vao);			// Creates 1 VAO
-	glGenBuffers(1, mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(mesh.vao);				// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-	// Strides between sets of attribute data
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerColor + floatsPerUV);
+	// store the draw commands that render the mesh
+	mesh.nRanges = 0;
+	USetDrawRange(mesh, GL_TRIANGLE_STRIP, 0, mesh.nVertices, false);
 
-	// Creates the Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, floatsPerColor, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* (floatsPerVertex + floatsPerColor)));
-	glEnableVertexAttribArray(2);
+	// pack the mesh into the shared geometry buffers
+	UAddToPool(mesh, "Pyramid4", verts, NULL);
 }
 
 ///////////////////////////////////////////////////
@@ -323,26 +424,12 @@ void Meshes::UCreatePrismMesh(GLMesh &mesh)
 
 	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
 
-	glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(mesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(1, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	// Strides between vertex coordinates is 6 (x, y, z, r, g, b, a). A tightly packed stride is 0.
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);// The number of floats before each
-
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(1);
+	// store the draw commands that render the mesh
+	mesh.nRanges = 0;
+	USetDrawRange(mesh, GL_TRIANGLE_STRIP, 0, mesh.nVertices, false);
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	// pack the mesh into the shared geometry buffers
+	UAddToPool(mesh, "Prism", verts, NULL);
 }
 
 ///////////////////////////////////////////////////
@@ -423,1910 +510,545 @@ void Meshes::UCreateBoxMesh(GLMesh &mesh)
 	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
 	mesh.nIndices = sizeof(indices) / sizeof(indices[0]);
 
-	glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(mesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(2, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	// Strides between vertex coordinates is 6 (x, y, z, r, g, b, a). A tightly packed stride is 0.
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);// The number of floats before each
-
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(1);
+	// store the draw commands that render the mesh
+	mesh.nRanges = 0;
+	USetDrawRange(mesh, GL_TRIANGLES, 0, mesh.nIndices, true);
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	// pack the mesh into the shared geometry buffers
+	UAddToPool(mesh, "Box", verts, indices);
 }
 
 ///////////////////////////////////////////////////
-//	UCreateConeMesh(GLMesh&)
+//	UCreatePrimitiveMesh(GLMesh&, PrimitiveType, GLuint, GLuint)
 //
 //	mesh: reference to mesh structure for storing data
+//	type: cylinder, tapered cylinder, cone, sphere or torus
+//	segments: columns around the y axis, or around
+//		the main radius of the torus
+//	rings: bands up the height, latitude bands of
+//		the sphere or columns around the torus tube
 //
-//	Create a cone mesh and store it in a VAO/VBO
+//	Generate a round primitive at the given
+//	resolution and store it in the shared buffers,
+//	followed by its chain of detail levels (see
+//	PrimitiveLodChain()). Each level is stored in
+//	the pool like a mesh of its own.
 //
-//  Correct triangle drawing commands:
+//  Correct triangle drawing command:
 //
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
+//	glDrawElements(GL_TRIANGLES, mesh.lods[level].nIndices, GL_UNSIGNED_INT, (void*)0);
 ///////////////////////////////////////////////////
-void Meshes::UCreateConeMesh(GLMesh &mesh)
+void Meshes::UCreatePrimitiveMesh(GLMesh &mesh, PrimitiveType type, GLuint segments, GLuint rings)
 {
-	GLfloat verts[] = {
-		// cone bottom			// normals			// texture coords
-		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 0.0f, -0.34f,		0.0f, -1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 0.0f, -0.64f,		0.0f, -1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 0.0f, -0.77f,		0.0f, -1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 0.0f, -0.94f,		0.0f, -1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 0.0f, -0.98f,		0.0f, -1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 0.0f, -1.0f,		0.0f, -1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 0.0f, -0.98f,	0.0f, -1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 0.0f, -0.94f,	0.0f, -1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 0.0f, -0.77f,	0.0f, -1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 0.0f, -0.64f,	0.0f, -1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 0.0f, -0.34f,	0.0f, -1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 0.0f, -0.17f,	0.0f, -1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 0.0f, 1.0f,		0.0f, -1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cone sides		// normals									// texture coords
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f, 		0.0f,0.0f,
-		0.0f, 1.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f, 		0.5f, 1.0f,
-		.98f, 0.0f, -0.17f,		0.993150651f, 0.0f, 0.116841137f, 		0.0277,0.0,
-		.98f, 0.0f, -0.17f,		0.973417103f, 0.0f, 0.229039446f, 		0.0277,0.0,
-		0.0f, 1.0f, 0.0f,		0.973417103f, 0.0f, 0.229039446f, 		0.5f, 1.0f,
-		.94f, 0.0f, -0.34f,		0.973417103f, 0.0f, 0.229039446f, 		0.0554,0.0f,
-		.94f, 0.0f, -0.34f,		0.916157305f, 0.0f, 0.400818795f, 		0.0554,0.0f,
-		0.0f, 1.0f, 0.0f,		0.916157305f, 0.0f, 0.400818795f, 		0.5f, 1.0f,
-		.87f, 0.0f, -0.5f,		0.916157305f, 0.0f, 0.400818795f, 		0.0831,0.0f,
-		.87f, 0.0f, -0.5f,		0.813733339f, 0.0f, 0.581238329f, 		0.0831,0.0f,
-		0.0f, 1.0f, 0.0f,		0.813733339f, 0.0f, 0.581238329f, 		0.5f, 1.0f,
-		.77f, 0.0f, -0.64f,		0.813733339f, 0.0f, 0.581238329f, 		0.1108f, 0.0f,
-		.77f, 0.0f, -0.64f,		0.707106769f, 0.0f, 0.707106769f, 		0.1108f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.707106769f, 0.0f, 0.707106769f, 		0.5f, 1.0f,
-		.64f, 0.0f, -0.77f,		0.707106769f, 0.0f, 0.707106769f, 		0.1385f, 0.0f,
-		.64f, 0.0f, -0.77f,		0.581238329f, 0.0f, 0.813733339f, 		0.1385f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.581238329f, 0.0f, 0.813733339f, 		0.5f, 1.0f,
-		.5f, 0.0f, -0.87f,		0.581238329f, 0.0f, 0.813733339f, 		0.1662f, 0.0f,
-		.5f, 0.0f, -0.87f,		0.400818795f, 0.0f, 0.916157305f, 		0.1662f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.400818795f, 0.0f, 0.916157305f, 		0.5f, 1.0f,
-		.34f, 0.0f, -0.94f,		0.400818795f, 0.0f, 0.916157305f, 		0.1939f, 0.0f,
-		.34f, 0.0f, -0.94f,		0.229039446f, 0.0f, 0.973417103f, 		0.1939f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.229039446f, 0.0f, 0.973417103f, 		0.5f, 1.0f,
-		.17f, 0.0f, -0.98f,		0.229039446f, 0.0f, 0.973417103f, 		0.2216f, 0.0f,
-		.17f, 0.0f, -0.98f,		0.116841137f, 0.0f, 0.993150651f, 		0.2216f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.116841137f, 0.0f, 0.993150651f, 		0.5f, 1.0f,
-		0.0f, 0.0f, -1.0f,		0.116841137f, 0.0f, 0.993150651f, 		0.2493f, 0.0f,
-
-		0.0f, 0.0f, -1.0f,		-0.116841137f, 0.0f, 0.993150651f, 		0.2493f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.116841137f, 0.0f, 0.993150651f, 		0.5f, 1.0f,
-		-.17f, 0.0f, -0.98f,	-0.116841137f, 0.0f, 0.993150651f, 		0.277f, 0.0f,
-		-.17f, 0.0f, -0.98f,	-0.229039446f, 0.0f, 0.973417103f, 		0.277f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.229039446f, 0.0f, 0.973417103f, 		0.5f, 1.0f,
-		-.34f, 0.0f, -0.94f,	-0.229039446f, 0.0f, 0.973417103f, 		0.3047f, 0.0f,
-		-.34f, 0.0f, -0.94f,	-0.400818795f, 0.0f, 0.916157305f, 		0.3047f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.400818795f, 0.0f, 0.916157305f, 		0.5f, 1.0f,
-		-.5f, 0.0f, -0.87f,		-0.400818795f, 0.0f, 0.916157305f, 		0.3324f, 0.0f,
-		-.5f, 0.0f, -0.87f,		-0.581238329f, 0.0f, 0.813733339f, 		0.3324f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.581238329f, 0.0f, 0.813733339f, 		0.5f, 1.0f,
-		-.64f, 0.0f, -0.77f,	-0.581238329f, 0.0f, 0.813733339f, 		0.3601f, 0.0f,
-		-.64f, 0.0f, -0.77f,	-0.707106769f, 0.0f, 0.707106769f, 		0.3601f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.707106769f, 0.0f, 0.707106769f, 		0.5f, 1.0f,
-		-.77f, 0.0f, -0.64f,	-0.707106769f, 0.0f, 0.707106769f, 		0.3878f, 0.0f,
-		-.77f, 0.0f, -0.64f,	-0.813733339f, 0.0f, 0.581238329f, 		0.3878f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.813733339f, 0.0f, 0.581238329f, 		0.5f, 1.0f,
-		-.87f, 0.0f, -0.5f,		-0.813733339f, 0.0f, 0.581238329f, 		0.4155f, 0.0f,
-		-.87f, 0.0f, -0.5f,		-0.916157305f, 0.0f, 0.400818795f, 		0.4155f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.916157305f, 0.0f, 0.400818795f, 		0.5f, 1.0f,
-		-.94f, 0.0f, -0.34f,	-0.916157305f, 0.0f, 0.400818795f, 		0.4432f, 0.0f,
-		-.94f, 0.0f, -0.34f,	-0.973417103f, 0.0f, 0.229039446f, 		0.4432f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.973417103f, 0.0f, 0.229039446f, 		0.5f, 1.0f,
-		-.98f, 0.0f, -0.17f,	-0.973417103f, 0.0f, 0.229039446f, 		0.4709f, 0.0f,
-		-.98f, 0.0f, -0.17f,	-0.993150651f, 0.0f, 0.116841137f, 		0.4709f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.993150651f, 0.0f, 0.116841137f, 		0.5f, 1.0f,
-		-1.0f, 0.0f, 0.0f,		-0.993150651f, 0.0f, 0.116841137f, 		0.4986f, 0.0f,
-		-1.0f, 0.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f, 		0.4986f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f, 		0.5f, 1.0f,
-		-.98f, 0.0f, 0.17f,		-0.993150651f, 0.0f, -0.116841137f, 		0.5263f, 0.0f,
-		-.98f, 0.0f, 0.17f,		-0.973417103f, 0.0f, -0.229039446f, 		0.5263f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.973417103f, 0.0f, -0.229039446f, 		0.5f, 1.0f,
-		-.94f, 0.0f, 0.34f,		-0.973417103f, 0.0f, -0.229039446f, 		0.554f, 0.0f,
-		-.94f, 0.0f, 0.34f,		-0.916157305f, 0.0f, -0.400818795f, 		0.554f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.916157305f, 0.0f, -0.400818795f, 		0.5f, 1.0f,
-		-.87f, 0.0f, 0.5f,		-0.916157305f, 0.0f, -0.400818795f, 		0.5817f, 0.0f,
-		-.87f, 0.0f, 0.5f,		-0.813733339f, 0.0f, -0.581238329f, 		0.5817f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.813733339f, 0.0f, -0.581238329f, 		0.5f, 1.0f,
-		-.77f, 0.0f, 0.64f,		-0.813733339f, 0.0f, -0.581238329f, 		0.6094f, 0.0f,
-		-.77f, 0.0f, 0.64f,		-0.707106769f, 0.0f, -0.707106769f, 		0.6094f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.707106769f, 0.0f, -0.707106769f, 		0.5f, 1.0f,
-		-.64f, 0.0f, 0.77f,		-0.707106769f, 0.0f, -0.707106769f, 		0.6371f, 0.0f,
-		-.64f, 0.0f, 0.77f,		-0.581238329f, 0.0f, -0.813733339f, 		0.6371f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.581238329f, 0.0f, -0.813733339f, 		0.5f, 1.0f,
-		-.5f, 0.0f, 0.87f,		-0.581238329f, 0.0f, -0.813733339f, 		0.6648f, 0.0f,
-		-.5f, 0.0f, 0.87f,		-0.400818795f, 0.0f, -0.916157305f, 		0.6648f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.400818795f, 0.0f, -0.916157305f, 		0.5f, 1.0f,
-		-.34f, 0.0f, 0.94f,		-0.400818795f, 0.0f, -0.916157305f, 		0.6925f, 0.0f,
-		-.34f, 0.0f, 0.94f,		-0.229039446f, 0.0f, -0.973417103f, 		0.6925f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.229039446f, 0.0f, -0.973417103f, 		0.5f, 1.0f,
-		-.17f, 0.0f, 0.98f,		-0.229039446f, 0.0f, -0.973417103f, 		0.7202f, 0.0f,
-		-.17f, 0.0f, 0.98f,		-0.116841137f, 0.0f, -0.993150651f, 		0.7202f, 0.0f,
-		0.0f, 1.0f, 0.0f,		-0.116841137f, 0.0f, -0.993150651f, 		0.5f, 1.0f,
-		0.0f, 0.0f, 1.0f,		-0.116841137f, 0.0f, -0.993150651f, 		0.7479f, 0.0f,
-
-		0.0f, 0.0f, 1.0f,		0.116841137f, 0.0f, -0.993150651f, 	0.7479f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.116841137f, 0.0f, -0.993150651f, 	0.5f, 1.0f,
-		.17f, 0.0f, 0.98f,		0.116841137f, 0.0f, -0.993150651f, 	0.7756f, 0.0f,
-		.17f, 0.0f, 0.98f,		0.229039446f, 0.0f, -0.973417103f, 	0.7756f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.229039446f, 0.0f, -0.973417103f, 	0.5f, 1.0f,
-		.34f, 0.0f, 0.94f,		0.229039446f, 0.0f, -0.973417103f, 	0.8033f, 0.0f,
-		.34f, 0.0f, 0.94f,		0.400818795f, 0.0f, -0.916157305f, 	0.8033f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.400818795f, 0.0f, -0.916157305f, 	0.5f, 1.0f,
-		.5f, 0.0f, 0.87f,		0.400818795f, 0.0f, -0.916157305f, 	0.831f, 0.0f,
-		.5f, 0.0f, 0.87f,		0.581238329f, 0.0f, -0.813733339f, 	0.831f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.581238329f, 0.0f, -0.813733339f, 	0.5f, 1.0f,
-		.64f, 0.0f, 0.77f,		0.581238329f, 0.0f, -0.813733339f, 	0.8587f, 0.0f,
-		.64f, 0.0f, 0.77f,		0.707106769f, 0.0f, -0.707106769f, 	0.8587f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.707106769f, 0.0f, -0.707106769f, 	0.5f, 1.0f,
-		.77f, 0.0f, 0.64f,		0.707106769f, 0.0f, -0.707106769f, 	0.8864f, 0.0f,
-		.77f, 0.0f, 0.64f,		0.813733339f, 0.0f, -0.581238329f, 	0.8864f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.813733339f, 0.0f, -0.581238329f, 	0.5f, 1.0f,
-		.87f, 0.0f, 0.5f,		0.813733339f, 0.0f, -0.581238329f, 	0.9141f, 0.0f,
-		.87f, 0.0f, 0.5f,		0.916157305f, 0.0f, -0.400818795f, 	0.9141f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.916157305f, 0.0f, -0.400818795f, 	0.5f, 1.0f,
-		.94f, 0.0f, 0.34f,		0.916157305f, 0.0f, -0.400818795f, 	0.9418f, 0.0f,
-		.94f, 0.0f, 0.34f,		0.973417103f, 0.0f, -0.229039446f, 	0.9418f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.973417103f, 0.0f, -0.229039446f, 	0.5f, 1.0f,
-		.98f, 0.0f, 0.17f,		0.973417103f, 0.0f, -0.229039446f, 	0.9695f, 0.0f,
-		.98f, 0.0f, 0.17f,		0.993150651f, 0.0f, -0.116841137f, 	0.9695f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.993150651f, 0.0f, -0.116841137f, 	0.5f, 1.0f,
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, -0.116841137f, 	0.0f, 0.0f
-	};
-
-	// total float values per each type
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerNormal = 3;
-	const GLuint floatsPerUV = 2;
-
-	// store vertex and index count
-	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-	mesh.nIndices = 0;
+	GLuint levelSegments[MAX_LODS];
+	GLuint levelRings[MAX_LODS];
+	const GLuint levels = PrimitiveLodChain(type, segments, rings, MAX_LODS, levelSegments, levelRings);
 
-	// Create VAO
-	glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(mesh.vao);
+	PrimitiveGeometry geometry;
+	for (GLuint level = 0; level < levels; ++level)
+	{
+		GeneratePrimitive(type, levelSegments[level], levelRings[level], geometry);
 
-	// Create VBO
-	glGenBuffers(1, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+		// coarser levels go through a scratch mesh, only their placement in the pool is kept
+		GLMesh levelMesh = {};
+		GLMesh& target = level == 0 ? mesh : levelMesh;
 
-	// Strides between vertex coordinates
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
+		// store vertex and index count
+		target.nVertices = (GLuint)(geometry.vertices.size() / FLOATS_PER_VERTEX);
+		target.nIndices = (GLuint)geometry.indices.size();
 
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, (void*)0);
-	glEnableVertexAttribArray(0);
+		// store the draw commands that render the mesh
+		target.nRanges = 0;
+		USetDrawRange(target, GL_TRIANGLES, 0, target.nIndices, true);
 
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex)));
-	glEnableVertexAttribArray(1);
+		// pack the mesh into the shared geometry buffers
+		std::string name = std::string(PrimitiveName(type)) + " " + std::to_string(levelSegments[level]) + "x" + std::to_string(levelRings[level]);
+		if (level > 0)
+			name += " level " + std::to_string(level);
+		UAddToPool(target, name, geometry.vertices.data(), geometry.indices.data());
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+		mesh.lods[level] = target.lods[0];
+		mesh.lods[level].error = PrimitiveError(type, levelSegments[level], levelRings[level]);
+		mesh.nLods = level + 1;
+	}
 }
 
-void Meshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+///////////////////////////////////////////////////
+//	CalculateTriangleNormal(const glm::vec3&, const glm::vec3&, const glm::vec3&)
+//
+//	p0, p1, p2: corner positions, counter-clockwise
+//	seen from the front
+///////////////////////////////////////////////////
+glm::vec3 Meshes::CalculateTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
 {
-	glm::vec3 Normal(0, 0, 0);
-	float v1x = p1.x - p0.x;
-	float v1y = p1.y - p0.y;
-	float v1z = p1.z - p0.z;
-	float v2x = p2.x - p1.x;
-	float v2y = p2.y - p1.y;
-	float v2z = p2.z - p1.z;
-	Normal.x = v1y * v2z - v1z * v2y;
-	Normal.y = v1z * v2x - v1x * v2z;
-	Normal.y = v1x * v2y - v1y * v2x;
-	float len = (float)sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
-	if (len == 0)
-	{
-		//throw Exception();
-	}
-	else
-	{
-		Normal.x /= len;
-		Normal.y /= len;
-		Normal.z /= len;
-	}
-	//return Normal;
+	glm::vec3 normal;
+	TriangleNormal(&p0.x, &p1.x, &p2.x, &normal.x);
+	const float length = glm::length(normal);
+	return length > 0.0f ? normal / length : glm::vec3(0.0f);
 }
 
 ///////////////////////////////////////////////////
-//	UCreateCylinderMesh(GLMesh&)
+//	USetDrawRange(GLMesh&, GLenum, GLint, GLsizei, bool)
 //
 //	mesh: reference to mesh structure for storing data
+//	mode: primitive type passed to the draw call
+//	first, count: vertex (or index) range to draw
+//	indexed: draw with glDrawElements instead of glDrawArrays
 //
-//	Create a cylinder mesh and store it in a VAO/VBO
-//
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//	Append one of the draw commands needed to render
+//	the mesh, so callers don't have to hard code them
 ///////////////////////////////////////////////////
-void Meshes::UCreateCylinderMesh(GLMesh &mesh)
+void Meshes::USetDrawRange(GLMesh &mesh, GLenum mode, GLint first, GLsizei count, bool indexed)
 {
-	GLfloat verts[] = {
-		// cylinder bottom		// normals			// texture coords
-		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 0.0f, -0.34f,		0.0f, -1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 0.0f, -0.64f,		0.0f, -1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 0.0f, -0.77f,		0.0f, -1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 0.0f, -0.94f,		0.0f, -1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 0.0f, -0.98f,		0.0f, -1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 0.0f, -1.0f,		0.0f, -1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 0.0f, -0.98f,	0.0f, -1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 0.0f, -0.94f,	0.0f, -1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 0.0f, -0.77f,	0.0f, -1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 0.0f, -0.64f,	0.0f, -1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 0.0f, -0.34f,	0.0f, -1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 0.0f, -0.17f,	0.0f, -1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 0.0f, 1.0f,		0.0f, -1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder top			// normals			// texture coords
-		1.0f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 1.0f, -0.17f,		0.0f, 1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 1.0f, -0.34f,		0.0f, 1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 1.0f, -0.5f,		0.0f, 1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 1.0f, -0.64f,		0.0f, 1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 1.0f, -0.77f,		0.0f, 1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 1.0f, -0.87f,		0.0f, 1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 1.0f, -0.94f,		0.0f, 1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 1.0f, -0.98f,		0.0f, 1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 1.0f, -1.0f,		0.0f, 1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 1.0f, -0.98f,	0.0f, 1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 1.0f, -0.94f,	0.0f, 1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 1.0f, -0.87f,		0.0f, 1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 1.0f, -0.77f,	0.0f, 1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 1.0f, -0.64f,	0.0f, 1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 1.0f, -0.5f,		0.0f, 1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 1.0f, -0.34f,	0.0f, 1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 1.0f, -0.17f,	0.0f, 1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 1.0f, 0.34f,		0.0f, 1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 1.0f, 0.5f,		0.0f, 1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 1.0f, 0.64f,		0.0f, 1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 1.0f, 0.77f,		0.0f, 1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 1.0f, 0.87f,		0.0f, 1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 1.0f, 0.94f,		0.0f, 1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 1.0f, 0.98f,		0.0f, 1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 1.0f, 1.0f,		0.0f, 1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 1.0f, 0.98f,		0.0f, 1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 1.0f, 0.94f,		0.0f, 1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 1.0f, 0.87f,		0.0f, 1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 1.0f, 0.77f,		0.0f, 1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 1.0f, 0.64f,		0.0f, 1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 1.0f, 0.5f,		0.0f, 1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 1.0f, 0.34f,		0.0f, 1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder body		// normals				// texture coords
-		1.0f, 1.0f, 0.0f,		1.0f, 0.0f, 0.0f,		0.0,1.0,
-		1.0f, 0.0f, 0.0f,		1.0f, 0.0f, 0.0f,		0.0,0.0,
-		.98f, 0.0f, -0.17f,		1.0f, 0.0f, 0.0f,		0.0277,0.0,
-		1.0f, 1.0f, 0.0f,		0.92f, 0.0f, -0.08f,	0.0,1.0,
-		.98f, 1.0f, -0.17f,		0.92f, 0.0f, -0.08f,	0.0277,1.0,
-		.98f, 0.0f, -0.17f,		0.92f, 0.0f, -0.08f,	0.0277,0.0,
-		.94f, 0.0f, -0.34f,		0.83f, 0.0f, -0.17f,	0.0554,0.0,
-		.98f, 1.0f, -0.17f,		0.83f, 0.0f, -0.17f,	0.0277,1.0,
-		.94f, 1.0f, -0.34f,		0.83f, 0.0f, -0.17f,	0.0554,1.0,
-		.94f, 0.0f, -0.34f,		0.75f, 0.0f, -0.25f,	0.0554,0.0,
-		.87f, 0.0f, -0.5f,		0.75f, 0.0f, -0.25f,	0.0831,0.0,
-		.94f, 1.0f, -0.34f,		0.75f, 0.0f, -0.25f,	0.0554,1.0,
-		.87f, 1.0f, -0.5f,		0.67f, 0.0f, -0.33f,	0.0831,1.0,
-		.87f, 0.0f, -0.5f,		0.67f, 0.0f, -0.33f,	0.0831,0.0,
-		.77f, 0.0f, -0.64f,		0.67f, 0.0f, -0.33f,	0.1108,0.0,
-		.87f, 1.0f, -0.5f,		0.58f, 0.0f, -0.42f,	0.0831,1.0,
-		.77f, 1.0f, -0.64f,		0.58f, 0.0f, -0.42f,	0.1108,1.0,
-		.77f, 0.0f, -0.64f,		0.58f, 0.0f, -0.42f,	0.1108,0.0,
-		.64f, 0.0f, -0.77f,		0.5f, 0.0f, -0.5f,		0.1385,0.0,
-		.77f, 1.0f, -0.64f,		0.5f, 0.0f, -0.5f,		0.1108,1.0,
-		.64f, 1.0f, -0.77f,		0.5f, 0.0f, -0.5f,		0.1385,1.0,
-		.64f, 0.0f, -0.77f,		0.42f, 0.0f, -0.58f,	0.1385,0.0,
-		.5f, 0.0f, -0.87f,		0.42f, 0.0f, -0.58f,	0.1662,0.0,
-		.64f, 1.0f, -0.77f,		0.42f, 0.0f, -0.58f,	0.1385, 1.0,
-		.5f, 1.0f, -0.87f,		0.33f, 0.0f, -0.67f,	0.1662, 1.0,
-		.5f, 0.0f, -0.87f,		0.33f, 0.0f, -0.67f,	0.1662, 0.0,
-		.34f, 0.0f, -0.94f,		0.33f, 0.0f, -0.67f,	0.1939, 0.0,
-		.5f, 1.0f, -0.87f,		0.25f, 0.0f, -0.75f,	0.1662, 1.0,
-		.34f, 1.0f, -0.94f,		0.25f, 0.0f, -0.75f,	0.1939, 1.0,
-		.34f, 0.0f, -0.94f,		0.25f, 0.0f, -0.75f,	0.1939, 0.0,
-		.17f, 0.0f, -0.98f,		0.17f, 0.0f, -0.83f,	0.2216, 0.0,
-		.34f, 1.0f, -0.94f,		0.17f, 0.0f, -0.83f,	0.1939, 1.0,
-		.17f, 1.0f, -0.98f,		0.17f, 0.0f, -0.83f,	0.2216, 1.0,
-		.17f, 0.0f, -0.98f,		0.08f, 0.0f, -0.92f,	0.2216, 0.0,
-		0.0f, 0.0f, -1.0f,		0.08f, 0.0f, -0.92f,	0.2493, 0.0,
-		.17f, 1.0f, -0.98f,		0.08f, 0.0f, -0.92f,	0.2216, 1.0,
-		0.0f, 1.0f, -1.0f,		0.0f, 0.0f, -1.0f,		0.2493, 1.0,
-		0.0f, 0.0f, -1.0f,		0.0f, 0.0f, -1.0f,		0.2493, 0.0,
-		-.17f, 0.0f, -0.98f,	0.0f, 0.0f, -1.0f,		0.277, 0.0,
-		0.0f, 1.0f, -1.0f,		0.08f, 0.0f, -1.08f,	0.2493, 1.0,
-		-.17f, 1.0f, -0.98f,	-0.08f, 0.0f, -0.92f,	0.277, 1.0,
-		-.17f, 0.0f, -0.98f,	-0.08f, 0.0f, -0.92f,	0.277, 0.0,
-		-.34f, 0.0f, -0.94f,	-0.08f, 0.0f, -0.92f,	0.3047, 0.0,
-		-.17f, 1.0f, -0.98f,	-0.08f, 0.0f, -0.92f,	0.277, 1.0,
-		-.34f, 1.0f, -0.94f,	-0.17f, 0.0f, -0.83f,	0.3047, 1.0,
-		-.34f, 0.0f, -0.94f,	-0.17f, 0.0f, -0.83f,	0.3047, 0.0,
-		-.5f, 0.0f, -0.87f,		-0.17f, 0.0f, -0.83f,	0.3324, 0.0,
-		-.34f, 1.0f, -0.94f,	-0.25f, 0.0f, -0.75f,	0.3047, 1.0,
-		-.5f, 1.0f, -0.87f,		-0.25f, 0.0f, -0.75f,	0.3324, 1.0,
-		-.5f, 0.0f, -0.87f,		-0.25f, 0.0f, -0.75f,	0.3324, 0.0,
-		-.64f, 0.0f, -0.77f,	-0.33f, 0.0f, -0.67f,	0.3601, 0.0,
-		-.5f, 1.0f, -0.87f,		-0.33f, 0.0f, -0.67f,	0.3324, 1.0,
-		-.64f, 1.0f, -0.77f,	-0.33f, 0.0f, -0.67f,	0.3601, 1.0,
-		-.64f, 0.0f, -0.77f,	-0.42f, 0.0f, -0.58f,	0.3601, 0.0,
-		-.77f, 0.0f, -0.64f,	-0.42f, 0.0f, -0.58f,	0.3878, 0.0,
-		-.64f, 1.0f, -0.77f,	-0.42f, 0.0f, -0.58f,	0.3601, 1.0,
-		-.77f, 1.0f, -0.64f,	-0.5f, 0.0f, -0.5f,		0.3878, 1.0,
-		-.77f, 0.0f, -0.64f,	-0.5f, 0.0f, -0.5f,		0.3878, 0.0,
-		-.87f, 0.0f, -0.5f,		-0.5f, 0.0f, -0.5f,		0.4155, 0.0,
-		-.77f, 1.0f, -0.64f,	-0.58f, 0.0f, -0.42f,	0.3878, 1.0,
-		-.87f, 1.0f, -0.5f,		-0.58f, 0.0f, -0.42f,	0.4155, 1.0,
-		-.87f, 0.0f, -0.5f,		-0.58f, 0.0f, -0.42f,	0.4155, 0.0,
-		-.94f, 0.0f, -0.34f,	-0.67f, 0.0f, -0.33f,	0.4432, 0.0,
-		-.87f, 1.0f, -0.5f,		-0.67f, 0.0f, -0.33f,	0.4155, 1.0,
-		-.94f, 1.0f, -0.34f,	-0.67f, 0.0f, -0.33f,	0.4432, 1.0,
-		-.94f, 0.0f, -0.34f,	-0.75f, 0.0f, -0.25f,	0.4432, 0.0,
-		-.98f, 0.0f, -0.17f,	-0.75f, 0.0f, -0.25f,	0.4709, 0.0,
-		-.94f, 1.0f, -0.34f,	-0.75f, 0.0f, -0.25f,	0.4432, 1.0,
-		-.98f, 1.0f, -0.17f,	-0.83f, 0.0f, -0.17f,	0.4709, 1.0,
-		-.98f, 0.0f, -0.17f,	-0.83f, 0.0f, -0.17f,	0.4709, 0.0,
-		-1.0f, 0.0f, 0.0f,		-0.83f, 0.0f, -0.17f,	0.4986, 0.0,
-		-.98f, 1.0f, -0.17f,	-0.92f, 0.0f, -0.08f,	0.4709, 1.0,
-		-1.0f, 1.0f, 0.0f,		-0.92f, 0.0f, -0.08f,	0.4986, 1.0,
-		-1.0f, 0.0f, 0.0f,		-0.92f, 0.0f, -0.08f,	0.4986, 0.0,
-		-.98f, 0.0f, 0.17f,		-1.0f, 0.0f, 0.0f,		0.5263, 0.0,
-		-1.0f, 1.0f, 0.0f,		-1.0f, 0.0f, 0.0f,		0.4986, 1.0,
-		-.98f, 1.0f, 0.17f,		-1.0f, 0.0f, 0.0f,		0.5263, 1.0,
-		-.98f, 0.0f, 0.17f,		-0.92f, 0.0f, 0.08f,	0.5263, 0.0,
-		-.94f, 0.0f, 0.34f,		-0.92f, 0.0f, 0.08f,	0.554, 0.0,
-		-.98f, 1.0f, 0.17f,		-0.92f, 0.0f, 0.08f,	0.5263, 1.0,
-		-.94f, 1.0f, 0.34f,		-0.83f, 0.0f, 0.17f,	0.554, 1.0,
-		-.94f, 0.0f, 0.34f,		-0.83f, 0.0f, 0.17f,	0.554, 0.0,
-		-.87f, 0.0f, 0.5f,		-0.83f, 0.0f, 0.17f,	0.5817, 0.0,
-		-.94f, 1.0f, 0.34f,		-0.75f, 0.0f, 0.25f,	0.554, 1.0,
-		-.87f, 1.0f, 0.5f,		-0.75f, 0.0f, 0.25f,	0.5817, 1.0,
-		-.87f, 0.0f, 0.5f,		-0.75f, 0.0f, 0.25f,	0.5817, 0.0,
-		-.77f, 0.0f, 0.64f,		-0.67f, 0.0f, 0.33f,	0.6094, 0.0,
-		-.87f, 1.0f, 0.5f,		-0.67f, 0.0f, 0.33f,	0.5817, 1.0,
-		-.77f, 1.0f, 0.64f,		-0.67f, 0.0f, 0.33f,	0.6094, 1.0,
-		-.77f, 0.0f, 0.64f,		-0.58f, 0.0f, 0.42f,	0.6094, 0.0,
-		-.64f, 0.0f, 0.77f,		-0.58f, 0.0f, 0.42f,	0.6371, 0.0,
-		-.77f, 1.0f, 0.64f,		-0.58f, 0.0f, 0.42f,	0.6094, 1.0,
-		-.64f, 1.0f, 0.77f,		-0.5f, 0.0f, 0.5f,		0.6371, 1.0,
-		-.64f, 0.0f, 0.77f,		-0.5f, 0.0f, 0.5f,		0.6371, 0.0,
-		-.5f, 0.0f, 0.87f,		-0.5f, 0.0f, 0.5f,		0.6648, 0.0,
-		-.64f, 1.0f, 0.77f,		-0.42f, 0.0f, 0.58f,	0.6371, 1.0,
-		-.5f, 1.0f, 0.87f,		-0.42f, 0.0f, 0.58f,	0.6648, 1.0,
-		-.5f, 0.0f, 0.87f,		-0.42f, 0.0f, 0.58f,	0.6648, 0.0,
-		-.34f, 0.0f, 0.94f,		-0.33f, 0.0f, 0.67f,	0.6925, 0.0,
-		-.5f, 1.0f, 0.87f,		-0.33f, 0.0f, 0.67f,	0.6648, 1.0,
-		-.34f, 1.0f, 0.94f,		-0.33f, 0.0f, 0.67f,	0.6925, 1.0,
-		-.34f, 0.0f, 0.94f,		-0.25f, 0.0f, 0.75f,	0.6925, 0.0,
-		-.17f, 0.0f, 0.98f,		-0.25f, 0.0f, 0.75f,	0.7202, 0.0,
-		-.34f, 1.0f, 0.94f,		-0.25f, 0.0f, 0.75f,	0.6925, 1.0,
-		-.17f, 1.0f, 0.98f,		-0.17f, 0.0f, 0.83f,	0.7202, 1.0,
-		-.17f, 0.0f, 0.98f,		-0.17f, 0.0f, 0.83f,	0.7202, 0.0,
-		0.0f, 0.0f, 1.0f,		-0.17f, 0.0f, 0.83f,	0.7479, 0.0,
-		-.17f, 1.0f, 0.98f,		-0.08f, 0.0f, 0.92f,	0.7202, 1.0,
-		0.0f, 1.0f, 1.0f,		-0.08f, 0.0f, 0.92f,	0.7479, 1.0,
-		0.0f, 0.0f, 1.0f,		-0.08f, 0.0f, 0.92f,	0.7479, 0.0,
-		.17f, 0.0f, 0.98f,		-0.0f, 0.0f, 1.0f,		0.7756, 0.0,
-		0.0f, 1.0f, 1.0f,		-0.0f, 0.0f, 1.0f,		0.7479, 1.0,
-		.17f, 1.0f, 0.98f,		-0.0f, 0.0f, 1.0f,		0.7756, 1.0,
-		.17f, 0.0f, 0.98f,		0.08f, 0.0f, 0.92f,		0.7756, 0.0,
-		.34f, 0.0f, 0.94f,		0.08f, 0.0f, 0.92f,		0.8033, 0.0,
-		.17f, 1.0f, 0.98f,		0.08f, 0.0f, 0.92f,		0.7756, 1.0,
-		.34f, 1.0f, 0.94f,		0.17f, 0.0f, 0.83f,		0.8033, 1.0,
-		.34f, 0.0f, 0.94f,		0.17f, 0.0f, 0.83f,		0.8033, 0.0,
-		.5f, 0.0f, 0.87f,		0.17f, 0.0f, 0.83f,		0.831, 0.0,
-		.34f, 1.0f, 0.94f,		0.25f, 0.0f, 0.75f,		0.8033, 1.0,
-		.5f, 1.0f, 0.87f,		0.25f, 0.0f, 0.75f,		0.831, 1.0,
-		.5f, 0.0f, 0.87f,		0.25f, 0.0f, 0.75f,		0.831, 0.0,
-		.64f, 0.0f, 0.77f,		0.33f, 0.0f, 0.67f,		0.8587, 0.0,
-		.5f, 1.0f, 0.87f,		0.33f, 0.0f, 0.67f,		0.831, 1.0,
-		.64f, 1.0f, 0.77f,		0.33f, 0.0f, 0.67f,		0.8587, 1.0,
-		.64f, 0.0f, 0.77f,		0.42f, 0.0f, 0.58f,		0.8587, 0.0,
-		.77f, 0.0f, 0.64f,		0.42f, 0.0f, 0.58f,		0.8864, 0.0,
-		.64f, 1.0f, 0.77f,		0.42f, 0.0f, 0.58f,		0.8587, 1.0,
-		.77f, 1.0f, 0.64f,		0.5f, 0.0f, 0.5f,		0.8864, 1.0,
-		.77f, 0.0f, 0.64f,		0.5f, 0.0f, 0.5f,		0.8864, 0.0,
-		.87f, 0.0f, 0.5f,		0.5f, 0.0f, 0.5f,		0.9141, 0.0,
-		.77f, 1.0f, 0.64f,		0.58f, 0.0f, 0.42f,		0.8864, 1.0,
-		.87f, 1.0f, 0.5f,		0.58f, 0.0f, 0.42f,		0.9141, 1.0,
-		.87f, 0.0f, 0.5f,		0.58f, 0.0f, 0.42f,		0.9141, 0.0,
-		.94f, 0.0f, 0.34f,		0.67f, 0.0f, 0.33f,		0.9418, 0.0,
-		.87f, 1.0f, 0.5f,		0.67f, 0.0f, 0.33f,		0.9141, 1.0,
-		.94f, 1.0f, 0.34f,		0.67f, 0.0f, 0.33f,		0.9418, 1.0,
-		.94f, 0.0f, 0.34f,		0.75f, 0.0f, 0.25f,		0.9418, 0.0,
-		.98f, 0.0f, 0.17f,		0.75f, 0.0f, 0.25f,		0.9695, 0.0,
-		.94f, 1.0f, 0.34f,		0.75f, 0.0f, 0.25f,		0.9418, 0.0,
-		.98f, 1.0f, 0.17f,		0.83f, 0.0f, 0.17f,		0.9695, 1.0,
-		.98f, 0.0f, 0.17f,		0.83f, 0.0f, 0.17f,		0.9695, 0.0,
-		1.0f, 0.0f, 0.0f,		0.83f, 0.0f, 0.17f,		1.0, 0.0,
-		.98f, 1.0f, 0.17f,		0.92f, 0.0f, 0.08f,		0.9695, 1.0,
-		1.0f, 1.0f, 0.0f,		0.92f, 0.0f, 0.08f,		1.0, 1.0,
-		1.0f, 0.0f, 0.0f,		0.92f, 0.0f, 0.08f,		1.0, 0.0
-	};
-
-	// total float values per each type
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerNormal = 3;
-	const GLuint floatsPerUV = 2;
-
-	// store vertex and index count
-	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-	mesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(mesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	// Strides between vertex coordinates
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
-
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, (void*)0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex)));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	GLDrawRange &range = mesh.ranges[mesh.nRanges++];
+	range.mode = mode;
+	range.first = first;
+	range.count = count;
+	range.indexed = indexed;
 }
 
 ///////////////////////////////////////////////////
-//	UCreateTaperedCylinderMesh(GLMesh&)
+//	UAddToPool(GLMesh&, const std::string&, const GLfloat*, const GLuint*)
 //
-//	mesh: reference to mesh structure for storing data
-//
-//	Create a tapered cylinder mesh and store it in a VAO/VBO
+//	mesh: mesh whose counts and draw ranges are set
+//	name: what the mesh is listed as in weldReport
+//	verts: interleaved position/normal/uv vertex data
+//	indices: index data, or NULL for array draws
 //
-//  Correct triangle drawing commands:
-//
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 72);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//	Append the mesh to the shared vertex and index
+//	buffers and compute its bounds. Fans and strips
+//	are expanded into a single indexed triangle list
+//	so every mesh is drawn with one glDrawElements
+//	style command. Duplicated vertices are welded,
+//	then the triangles are reordered for the
+//	post-transform cache and the vertices for fetch
+//	locality.
 ///////////////////////////////////////////////////
-void Meshes::UCreateTaperedCylinderMesh(GLMesh &mesh)
+void Meshes::UAddToPool(GLMesh &mesh, const std::string& name, const GLfloat* verts, const GLuint* indices)
 {
-	GLfloat verts[] = {
-		// cylinder bottom		// normals			// texture coords
-		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 0.0f, -0.34f,		0.0f, -1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 0.0f, -0.64f,		0.0f, -1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 0.0f, -0.77f,		0.0f, -1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 0.0f, -0.94f,		0.0f, -1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 0.0f, -0.98f,		0.0f, -1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 0.0f, -1.0f,		0.0f, -1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 0.0f, -0.98f,	0.0f, -1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 0.0f, -0.94f,	0.0f, -1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 0.0f, -0.77f,	0.0f, -1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 0.0f, -0.64f,	0.0f, -1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 0.0f, -0.34f,	0.0f, -1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 0.0f, -0.17f,	0.0f, -1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 0.0f, 1.0f,		0.0f, -1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder top			// normals			// texture coords
-		0.5f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f,1.0f,
-		.49f, 1.0f, -0.085f,	0.0f, 1.0f, 0.0f,	0.41f, 0.983f,
-		.47f, 1.0f, -0.17f,		0.0f, 1.0f, 0.0f,	0.33f, 0.96f,
-		.435f, 1.0f, -0.25f,	0.0f, 1.0f, 0.0f,	0.25f, 0.92f,
-		.385f, 1.0f, -0.32f,	0.0f, 1.0f, 0.0f,	0.17f, 0.87f,
-		.32f, 1.0f, -0.385f,	0.0f, 1.0f, 0.0f,	0.13f, 0.83f,
-		.25f, 1.0f, -0.435f,	0.0f, 1.0f, 0.0f,	0.08f, 0.77f,
-		.17f, 1.0f, -0.47f,		0.0f, 1.0f, 0.0f,	0.04f, 0.68f,
-		.085f, 1.0f, -0.49f,	0.0f, 1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 1.0f, -0.5f,		0.0f, 1.0f, 0.0f,	0.0f,0.5f,
-		-.085f, 1.0f, -0.49f,	0.0f, 1.0f, 0.0f,	0.017f, 0.41f,
-		-.17f, 1.0f, -0.47f,	0.0f, 1.0f, 0.0f,	0.04f, 0.33f,
-		-.25f, 1.0f, -0.435f,	0.0f, 1.0f, 0.0f,	0.08f, 0.25f,
-		-.32f, 1.0f, -0.385f,	0.0f, 1.0f, 0.0f,	0.13f, 0.17f,
-		-.385f, 1.0f, -0.32f,	0.0f, 1.0f, 0.0f,	0.17f, 0.13f,
-		-.435f, 1.0f, -0.25f,	0.0f, 1.0f, 0.0f,	0.25f, 0.08f,
-		-.47f, 1.0f, -0.17f,	0.0f, 1.0f, 0.0f,	0.33f, 0.04f,
-		-.49f, 1.0f, -0.085f,	0.0f, 1.0f, 0.0f,	0.41f, 0.017f,
-		-0.5f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f, 0.0f,
-		-.49f, 1.0f, 0.085f,	0.0f, 1.0f, 0.0f,	0.6f, 0.017f,
-		-.47f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.68f, 0.04f,
-		-.435f, 1.0f, 0.25f,	0.0f, 1.0f, 0.0f,	0.77f, 0.08f,
-		-.385f, 1.0f, 0.32f,	0.0f, 1.0f, 0.0f,	0.83f, 0.13f,
-		-.32f, 1.0f, 0.385f,	0.0f, 1.0f, 0.0f,	0.87f, 0.17f,
-		-.25f, 1.0f, 0.435f,	0.0f, 1.0f, 0.0f,	0.92f, 0.25f,
-		-.17f, 1.0f, 0.47f,		0.0f, 1.0f, 0.0f,	0.96f, 0.33f,
-		-.085f, 1.0f, 0.49f,	0.0f, 1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 1.0f, 0.5f,		0.0f, 1.0f, 0.0f,	1.0f, 0.5f,
-		.085f, 1.0f, 0.49f,		0.0f, 1.0f, 0.0f,	0.983f, 0.6f,
-		.17f, 1.0f, 0.47f,		0.0f, 1.0f, 0.0f,	0.96f, 0.68f,
-		.25f, 1.0f, 0.435f,		0.0f, 1.0f, 0.0f,	0.92f, 0.77f,
-		.32f, 1.0f, 0.385f,		0.0f, 1.0f, 0.0f,	0.87f, 0.83f,
-		.385f, 1.0f, 0.32f,		0.0f, 1.0f, 0.0f,	0.83f, 0.87f,
-		.435f, 1.0f, 0.25f,		0.0f, 1.0f, 0.0f,	0.77f, 0.92f,
-		.47f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.68f, 0.96f,
-		.49f, 1.0f, 0.085f,		0.0f, 1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder body		// normals				// texture coords
-		0.5f, 1.0f, 0.0f,		1.0f, 0.0f, 0.0f,		0.25,1.0,
-		1.0f, 0.0f, 0.0f,		1.0f, 0.0f, 0.0f,		0.0,0.0,
-		.98f, 0.0f, -0.17f,		1.0f, 0.0f, 0.0f,		0.0277,0.0,
-		0.5f, 1.0f, 0.0f,		0.92f, 0.0f, -0.08f,	0.25,1.0,
-		.49f, 1.0f, -0.085f,	0.92f, 0.0f, -0.08f,	0.2635,1.0,
-		.98f, 0.0f, -0.17f,		0.92f, 0.0f, -0.08f,	0.0277,0.0,
-		.94f, 0.0f, -0.34f,		0.83f, 0.0f, -0.17f,	0.0554,0.0,
-		.49f, 1.0f, -0.085f,	0.83f, 0.0f, -0.17f,	0.2635,1.0,
-		.47f, 1.0f, -0.17f,		0.83f, 0.0f, -0.17f,	0.277,1.0,
-		.94f, 0.0f, -0.34f,		0.75f, 0.0f, -0.25f,	0.0554,0.0,
-		.87f, 0.0f, -0.5f,		0.75f, 0.0f, -0.25f,	0.0831,0.0,
-		.47f, 1.0f, -0.17f,		0.75f, 0.0f, -0.25f,	0.277,1.0,
-		.435f, 1.0f, -0.25f,	0.67f, 0.0f, -0.33f,	0.2905,1.0,
-		.87f, 0.0f, -0.5f,		0.67f, 0.0f, -0.33f,	0.0831,0.0,
-		.77f, 0.0f, -0.64f,		0.67f, 0.0f, -0.33f,	0.1108,0.0,
-		.435f, 1.0f, -0.25f,	0.58f, 0.0f, -0.42f,	0.2905,1.0,
-		.385f, 1.0f, -0.32f,	0.58f, 0.0f, -0.42f,	0.304,1.0,
-		.77f, 0.0f, -0.64f,		0.58f, 0.0f, -0.42f,	0.1108,0.0,
-		.64f, 0.0f, -0.77f,		0.5f, 0.0f, -0.5f,		0.1385,0.0,
-		.385f, 1.0f, -0.32f,	0.5f, 0.0f, -0.5f,		0.304,1.0,
-		.32f, 1.0f, -0.385f,	0.5f, 0.0f, -0.5f,		0.3175,1.0,
-		.64f, 0.0f, -0.77f,		0.42f, 0.0f, -0.58f,	0.1385,0.0,
-		.5f, 0.0f, -0.87f,		0.42f, 0.0f, -0.58f,	0.1662,0.0,
-		.32f, 1.0f, -0.385f,	0.42f, 0.0f, -0.58f,	0.3175, 1.0,
-		.25f, 1.0f, -0.435f,	0.33f, 0.0f, -0.67f,	0.331, 1.0,
-		.5f, 0.0f, -0.87f,		0.33f, 0.0f, -0.67f,	0.1662, 0.0,
-		.34f, 0.0f, -0.94f,		0.33f, 0.0f, -0.67f,	0.1939, 0.0,
-		.25f, 1.0f, -0.435f,	0.25f, 0.0f, -0.75f,	0.331, 1.0,
-		.17f, 1.0f, -0.47f,		0.25f, 0.0f, -0.75f,	0.3445, 1.0,
-		.34f, 0.0f, -0.94f,		0.25f, 0.0f, -0.75f,	0.1939, 0.0,
-		.17f, 0.0f, -0.98f,		0.17f, 0.0f, -0.83f,	0.2216, 0.0,
-		.17f, 1.0f, -0.47f,		0.17f, 0.0f, -0.83f,	0.3445, 1.0,
-		.085f, 1.0f, -0.49f,	0.17f, 0.0f, -0.83f,	0.358, 1.0,
-		.17f, 0.0f, -0.98f,		0.08f, 0.0f, -0.92f,	0.2216, 0.0,
-		0.0f, 0.0f, -1.0f,		0.08f, 0.0f, -0.92f,	0.2493, 0.0,
-		.085f, 1.0f, -0.49f,	0.08f, 0.0f, -0.92f,	0.358, 1.0,
-		0.0f, 1.0f, -0.5f,		0.0f, 0.0f, -1.0f,		0.3715, 1.0,
-		0.0f, 0.0f, -1.0f,		0.0f, 0.0f, -1.0f,		0.2493, 0.0,
-		-.17f, 0.0f, -0.98f,	0.0f, 0.0f, -1.0f,		0.277, 0.0,
-		0.0f, 1.0f, -0.5f,		0.08f, 0.0f, -1.08f,	0.3715, 1.0,
-		-.085f, 1.0f, -0.49f,	-0.08f, 0.0f, -0.92f,	0.385, 1.0,
-		-.17f, 0.0f, -0.98f,	-0.08f, 0.0f, -0.92f,	0.277, 0.0,
-		-.34f, 0.0f, -0.94f,	-0.08f, 0.0f, -0.92f,	0.3047, 0.0,
-		-.085f, 1.0f, -0.49f,	-0.08f, 0.0f, -0.92f,	0.385, 1.0,
-		-.17f, 1.0f, -0.47f,	-0.17f, 0.0f, -0.83f,	0.3985, 1.0,
-		-.34f, 0.0f, -0.94f,	-0.17f, 0.0f, -0.83f,	0.3047, 0.0,
-		-.5f, 0.0f, -0.87f,		-0.17f, 0.0f, -0.83f,	0.3324, 0.0,
-		-.17f, 1.0f, -0.47f,	-0.25f, 0.0f, -0.75f,	0.3985, 1.0,
-		-.25f, 1.0f, -0.435f,	-0.25f, 0.0f, -0.75f,	0.412, 1.0,
-		-.5f, 0.0f, -0.87f,		-0.25f, 0.0f, -0.75f,	0.3324, 0.0,
-		-.64f, 0.0f, -0.77f,	-0.33f, 0.0f, -0.67f,	0.3601, 0.0,
-		-.25f, 1.0f, -0.435f,	-0.33f, 0.0f, -0.67f,	0.412, 1.0,
-		-.32f, 1.0f, -0.385f,	-0.33f, 0.0f, -0.67f,	0.4255, 1.0,
-		-.64f, 0.0f, -0.77f,	-0.42f, 0.0f, -0.58f,	0.3601, 0.0,
-		-.77f, 0.0f, -0.64f,	-0.42f, 0.0f, -0.58f,	0.3878, 0.0,
-		-.32f, 1.0f, -0.385f,	-0.42f, 0.0f, -0.58f,	0.4255, 1.0,
-		-.385f, 1.0f, -0.32f,	-0.5f, 0.0f, -0.5f,		0.439, 1.0,
-		-.77f, 0.0f, -0.64f,	-0.5f, 0.0f, -0.5f,		0.3878, 0.0,
-		-.87f, 0.0f, -0.5f,		-0.5f, 0.0f, -0.5f,		0.4155, 0.0,
-		-.385f, 1.0f, -0.32f,	-0.58f, 0.0f, -0.42f,	0.439, 1.0,
-		-.435f, 1.0f, -0.25f,	-0.58f, 0.0f, -0.42f,	0.4525, 1.0,
-		-.87f, 0.0f, -0.5f,		-0.58f, 0.0f, -0.42f,	0.4155, 0.0,
-		-.94f, 0.0f, -0.34f,	-0.67f, 0.0f, -0.33f,	0.4432, 0.0,
-		-.435f, 1.0f, -0.25f,	-0.67f, 0.0f, -0.33f,	0.4525, 1.0,
-		-.47f, 1.0f, -0.17f,	-0.67f, 0.0f, -0.33f,	0.466, 1.0,
-		-.94f, 0.0f, -0.34f,	-0.75f, 0.0f, -0.25f,	0.4432, 0.0,
-		-.98f, 0.0f, -0.17f,	-0.75f, 0.0f, -0.25f,	0.4709, 0.0,
-		-.47f, 1.0f, -0.17f,	-0.75f, 0.0f, -0.25f,	0.466, 1.0,
-		-.49f, 1.0f, -0.085f,	-0.83f, 0.0f, -0.17f,	0.4795, 1.0,
-		-.98f, 0.0f, -0.17f,	-0.83f, 0.0f, -0.17f,	0.4709, 0.0,
-		-1.0f, 0.0f, 0.0f,		-0.83f, 0.0f, -0.17f,	0.4986, 0.0,
-		-.49f, 1.0f, -0.085f,	-0.92f, 0.0f, -0.08f,	0.4795, 1.0,
-		-0.5f, 1.0f, 0.0f,		-0.92f, 0.0f, -0.08f,	0.493, 1.0,
-		-1.0f, 0.0f, 0.0f,		-0.92f, 0.0f, -0.08f,	0.4986, 0.0,
-		-.98f, 0.0f, 0.17f,		-1.0f, 0.0f, 0.0f,		0.5263, 0.0,
-		-0.5f, 1.0f, 0.0f,		-1.0f, 0.0f, 0.0f,		0.493, 1.0,
-		-.49f, 1.0f, 0.085f,	-1.0f, 0.0f, 0.0f,		0.5065, 1.0,
-		-.98f, 0.0f, 0.17f,		-0.92f, 0.0f, 0.08f,	0.5263, 0.0,
-		-.94f, 0.0f, 0.34f,		-0.92f, 0.0f, 0.08f,	0.554, 0.0,
-		-.49f, 1.0f, 0.085f,	-0.92f, 0.0f, 0.08f,	0.5065, 1.0,
-		-.47f, 1.0f, 0.17f,		-0.83f, 0.0f, 0.17f,	0.52, 1.0,
-		-.94f, 0.0f, 0.34f,		-0.83f, 0.0f, 0.17f,	0.554, 0.0,
-		-.87f, 0.0f, 0.5f,		-0.83f, 0.0f, 0.17f,	0.5817, 0.0,
-		-.47f, 1.0f, 0.17f,		-0.75f, 0.0f, 0.25f,	0.52, 1.0,
-		-.435f, 1.0f, 0.25f,	-0.75f, 0.0f, 0.25f,	0.5335, 1.0,
-		-.87f, 0.0f, 0.5f,		-0.75f, 0.0f, 0.25f,	0.5817, 0.0,
-		-.77f, 0.0f, 0.64f,		-0.67f, 0.0f, 0.33f,	0.6094, 0.0,
-		-.435f, 1.0f, 0.25f,	-0.67f, 0.0f, 0.33f,	0.5335, 1.0,
-		-.385f, 1.0f, 0.32f,	-0.67f, 0.0f, 0.33f,	0.547, 1.0,
-		-.77f, 0.0f, 0.64f,		-0.58f, 0.0f, 0.42f,	0.6094, 0.0,
-		-.64f, 0.0f, 0.77f,		-0.58f, 0.0f, 0.42f,	0.6371, 0.0,
-		-.385f, 1.0f, 0.32f,	-0.58f, 0.0f, 0.42f,	0.547, 1.0,
-		-.32f, 1.0f, 0.385f,	-0.5f, 0.0f, 0.5f,		0.5605, 1.0,
-		-.64f, 0.0f, 0.77f,		-0.5f, 0.0f, 0.5f,		0.6371, 0.0,
-		-.5f, 0.0f, 0.87f,		-0.5f, 0.0f, 0.5f,		0.6648, 0.0,
-		-.32f, 1.0f, 0.385f,	-0.42f, 0.0f, 0.58f,	0.5605, 1.0,
-		-.25f, 1.0f, 0.435f,	-0.42f, 0.0f, 0.58f,	0.574, 1.0,
-		-.5f, 0.0f, 0.87f,		-0.42f, 0.0f, 0.58f,	0.6648, 0.0,
-		-.34f, 0.0f, 0.94f,		-0.33f, 0.0f, 0.67f,	0.6925, 0.0,
-		-.25f, 1.0f, 0.435f,	-0.33f, 0.0f, 0.67f,	0.574, 1.0,
-		-.17f, 1.0f, 0.47f,		-0.33f, 0.0f, 0.67f,	0.5875, 1.0,
-		-.34f, 0.0f, 0.94f,		-0.25f, 0.0f, 0.75f,	0.6925, 0.0,
-		-.17f, 0.0f, 0.98f,		-0.25f, 0.0f, 0.75f,	0.7202, 0.0,
-		-.17f, 1.0f, 0.47f,		-0.25f, 0.0f, 0.75f,	0.5875, 1.0,
-		-.085f, 1.0f, 0.49f,	-0.17f, 0.0f, 0.83f,	0.601, 1.0,
-		-.17f, 0.0f, 0.98f,		-0.17f, 0.0f, 0.83f,	0.7202, 0.0,
-		0.0f, 0.0f, 1.0f,		-0.17f, 0.0f, 0.83f,	0.7479, 0.0,
-		-.085f, 1.0f, 0.49f,	-0.08f, 0.0f, 0.92f,	0.601, 1.0,
-		0.0f, 1.0f, 0.5f,		-0.08f, 0.0f, 0.92f,	0.6145, 1.0,
-		0.0f, 0.0f, 1.0f,		-0.08f, 0.0f, 0.92f,	0.7479, 0.0,
-		.17f, 0.0f, 0.98f,		-0.0f, 0.0f, 1.0f,		0.7756, 0.0,
-		0.0f, 1.0f, 0.5f,		-0.0f, 0.0f, 1.0f,		0.6145, 1.0,
-		.085f, 1.0f, 0.49f,		-0.0f, 0.0f, 1.0f,		0.628, 1.0,
-		.17f, 0.0f, 0.98f,		0.08f, 0.0f, 0.92f,		0.7756, 0.0,
-		.34f, 0.0f, 0.94f,		0.08f, 0.0f, 0.92f,		0.8033, 0.0,
-		.085f, 1.0f, 0.49f,		0.08f, 0.0f, 0.92f,		0.628, 1.0,
-		.17f, 1.0f, 0.47f,		0.17f, 0.0f, 0.83f,		0.6415, 1.0,
-		.34f, 0.0f, 0.94f,		0.17f, 0.0f, 0.83f,		0.8033, 0.0,
-		.5f, 0.0f, 0.87f,		0.17f, 0.0f, 0.83f,		0.831, 0.0,
-		.17f, 1.0f, 0.47f,		0.25f, 0.0f, 0.75f,		0.6415, 1.0,
-		.25f, 1.0f, 0.435f,		0.25f, 0.0f, 0.75f,		0.655, 1.0,
-		.5f, 0.0f, 0.87f,		0.25f, 0.0f, 0.75f,		0.831, 0.0,
-		.64f, 0.0f, 0.77f,		0.33f, 0.0f, 0.67f,		0.8587, 0.0,
-		.25f, 1.0f, 0.435f,		0.33f, 0.0f, 0.67f,		0.655, 1.0,
-		.32f, 1.0f, 0.385f,		0.33f, 0.0f, 0.67f,		0.6685, 1.0,
-		.64f, 0.0f, 0.77f,		0.42f, 0.0f, 0.58f,		0.8587, 0.0,
-		.77f, 0.0f, 0.64f,		0.42f, 0.0f, 0.58f,		0.8864, 0.0,
-		.32f, 1.0f, 0.385f,		0.42f, 0.0f, 0.58f,		0.6685, 1.0,
-		.385f, 1.0f, 0.32f,		0.5f, 0.0f, 0.5f,		0.682, 1.0,
-		.77f, 0.0f, 0.64f,		0.5f, 0.0f, 0.5f,		0.8864, 0.0,
-		.87f, 0.0f, 0.5f,		0.5f, 0.0f, 0.5f,		0.9141, 0.0,
-		.385f, 1.0f, 0.32f,		0.58f, 0.0f, 0.42f,		0.682, 1.0,
-		.435f, 1.0f, 0.25f,		0.58f, 0.0f, 0.42f,		0.6955, 1.0,
-		.87f, 0.0f, 0.5f,		0.58f, 0.0f, 0.42f,		0.9141, 0.0,
-		.94f, 0.0f, 0.34f,		0.67f, 0.0f, 0.33f,		0.9418, 0.0,
-		.435f, 1.0f, 0.25f,		0.67f, 0.0f, 0.33f,		0.6955, 1.0,
-		.47f, 1.0f, 0.17f,		0.67f, 0.0f, 0.33f,		0.709, 1.0,
-		.94f, 0.0f, 0.34f,		0.75f, 0.0f, 0.25f,		0.9418, 0.0,
-		.98f, 0.0f, 0.17f,		0.75f, 0.0f, 0.25f,		0.9695, 0.0,
-		.47f, 1.0f, 0.17f,		0.75f, 0.0f, 0.25f,		0.709, 0.0,
-		.49f, 1.0f, 0.085f,		0.83f, 0.0f, 0.17f,		0.7225, 1.0,
-		.98f, 0.0f, 0.17f,		0.83f, 0.0f, 0.17f,		0.9695, 0.0,
-		1.0f, 0.0f, 0.0f,		0.83f, 0.0f, 0.17f,		1.0, 0.0,
-		.49f, 1.0f, 0.085f,		0.92f, 0.0f, 0.08f,		0.7225, 1.0,
-		0.5f, 1.0f, 0.0f,		0.92f, 0.0f, 0.08f,		0.75, 1.0,
-		1.0f, 0.0f, 0.0f,		0.92f, 0.0f, 0.08f,		1.0, 0.0
-	};
-
-	// total float values per each type
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerNormal = 3;
-	const GLuint floatsPerUV = 2;
+	mesh.baseVertex = (GLint)(mPoolVertices.size() / FLOATS_PER_VERTEX);
+	mesh.firstIndex = (GLuint)mPoolIndices.size();
 
-	// store vertex and index count
-	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-	mesh.nIndices = 0;
+	mPoolVertices.insert(mPoolVertices.end(), verts, verts + mesh.nVertices * FLOATS_PER_VERTEX);
 
-	// Create VAO
-	glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(mesh.vao);
+	// convert every draw range into triangle list indices relative to baseVertex
+	for (GLuint r = 0; r < mesh.nRanges; ++r)
+	{
+		const GLDrawRange& range = mesh.ranges[r];
+		for (GLsizei i = 0; i < range.count; ++i)
+		{
+			GLuint a, b, c;
+			if (range.mode == GL_TRIANGLES)
+			{
+				if (i % 3 != 0 || i + 2 >= range.count)
+					continue;
+				a = range.first + i;
+				b = a + 1;
+				c = a + 2;
+			}
+			else if (range.mode == GL_TRIANGLE_FAN)
+			{
+				if (i < 1 || i + 1 >= range.count)
+					continue;
+				a = range.first;
+				b = range.first + i;
+				c = b + 1;
+			}
+			else // GL_TRIANGLE_STRIP, odd triangles are flipped to keep the winding
+			{
+				if (i + 2 >= range.count)
+					continue;
+				a = range.first + i + (i & 1);
+				b = range.first + i + 1 - (i & 1);
+				c = range.first + i + 2;
+			}
 
-	// Create VBO
-	glGenBuffers(1, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+			if (range.indexed)
+			{
+				a = indices[a];
+				b = indices[b];
+				c = indices[c];
+			}
+			mPoolIndices.push_back(a);
+			mPoolIndices.push_back(b);
+			mPoolIndices.push_back(c);
+		}
+	}
 
-	// Strides between vertex coordinates
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
+	// the whole mesh is now one indexed triangle list
+	mesh.nIndices = (GLuint)mPoolIndices.size() - mesh.firstIndex;
+
+	GLuint* meshIndices = mPoolIndices.data() + mesh.firstIndex;
+	GLfloat* meshVertices = mPoolVertices.data() + (size_t)mesh.baseVertex * FLOATS_PER_VERTEX;
+
+	// keep one copy of each distinct vertex and point the indices at it
+	std::vector<GLuint> remap(mesh.nVertices);
+	const GLuint sourceVertices = mesh.nVertices;
+	mesh.nVertices = WeldVertices(meshVertices, FLOATS_PER_VERTEX, mesh.nVertices, remap.data());
+	for (GLuint i = 0; i < mesh.nIndices; ++i)
+		meshIndices[i] = remap[meshIndices[i]];
+	mPoolVertices.resize(((size_t)mesh.baseVertex + mesh.nVertices) * FLOATS_PER_VERTEX);
+	weldReport.push_back({ name, sourceVertices, mesh.nVertices, mesh.nIndices / 3 });
+
+	stats.meshes++;
+	stats.sourceVertices += sourceVertices;
+	stats.vertices += mesh.nVertices;
+	stats.triangles += mesh.nIndices / 3;
+	stats.missesBefore += SimulateCacheMisses(meshIndices, mesh.nIndices, mesh.nVertices);
+	OptimizeVertexCache(meshIndices, mesh.nIndices, mesh.nVertices);
+	OptimizeVertexFetch(meshVertices, FLOATS_PER_VERTEX, mesh.nVertices, meshIndices, mesh.nIndices);
+	stats.missesAfter += SimulateCacheMisses(meshIndices, mesh.nIndices, mesh.nVertices);
+
+	// bounding box of the positions, and a sphere around the box centre that encloses them
+	mesh.boundsMin = mesh.boundsMax = glm::vec3(meshVertices[0], meshVertices[1], meshVertices[2]);
+	for (GLuint v = 1; v < mesh.nVertices; ++v)
+	{
+		const GLfloat* p = meshVertices + v * FLOATS_PER_VERTEX;
+		mesh.boundsMin = glm::min(mesh.boundsMin, glm::vec3(p[0], p[1], p[2]));
+		mesh.boundsMax = glm::max(mesh.boundsMax, glm::vec3(p[0], p[1], p[2]));
+	}
+	mesh.sphereCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+	mesh.sphereRadius = 0.0f;
+	for (GLuint v = 0; v < mesh.nVertices; ++v)
+	{
+		const GLfloat* p = meshVertices + v * FLOATS_PER_VERTEX;
+		mesh.sphereRadius = std::max(mesh.sphereRadius, glm::distance(mesh.sphereCenter, glm::vec3(p[0], p[1], p[2])));
+	}
 
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, (void*)0);
-	glEnableVertexAttribArray(0);
+	mesh.nRanges = 0;
+	USetDrawRange(mesh, GL_TRIANGLES, mesh.firstIndex, mesh.nIndices, true);
 
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex)));
-	glEnableVertexAttribArray(1);
+	// a single detail level until the caller adds coarser ones
+	mesh.lods[0] = { mesh.nVertices, mesh.nIndices, mesh.baseVertex, mesh.firstIndex, 0.0f };
+	mesh.nLods = 1;
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	// float vertices are stored as they are, UCookPool() changes this when packing
+	mesh.positionOffset = glm::vec3(0.0f);
+	mesh.positionScale = 1.0f;
 }
 
 ///////////////////////////////////////////////////
-//	UCreateTorusMesh(GLMesh&)
-//
-//	mesh: reference to mesh structure for storing data
+//	UAllMeshes()
 //
-//	Create a torus mesh and store it in a VAO/VBO
+//	Every mesh in the pool, in the order the cooked
+//	file stores them
+///////////////////////////////////////////////////
+std::vector<Meshes::GLMesh*> Meshes::UAllMeshes()
+{
+	std::vector<GLMesh*> allMeshes = { &gBoxMesh, &gPlaneMesh, &gPrismMesh, &gPyramid3Mesh, &gPyramid4Mesh };
+	for (auto& entry : mPrimitives)
+		allMeshes.push_back(&entry.second.mesh);
+	return allMeshes;
+}
+
+///////////////////////////////////////////////////
+//	UCookPool(CookedPool&)
 //
-//	Correct triangle drawing command:
+//	storage: holds the streams that are not the CPU
+//		copies themselves
 //
-//	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
+//	Turn the CPU copies into the bytes the buffers
+//	get: the vertices as they are or packed, a
+//	position-only copy of them for the depth VAO and
+//	the indices at 32 or 16 bits. With packed
+//	vertices each mesh and its detail levels are
+//	packed inside one cube around all of them.
 ///////////////////////////////////////////////////
-void Meshes::UCreateTorusMesh(GLMesh &mesh)
+Meshes::PoolStreams Meshes::UCookPool(CookedPool& storage)
 {
-	int _mainSegments = 30;
-	int _tubeSegments = 30;
-	float _mainRadius = 1.0f;
-	float _tubeRadius = .1f;
-
-	auto mainSegmentAngleStep = glm::radians(360.0f / float(_mainSegments));
-	auto tubeSegmentAngleStep = glm::radians(360.0f / float(_tubeSegments));
-
-	std::vector<glm::vec3> vertex_list;
-	std::vector<std::vector<glm::vec3>> segments_list;
-	std::vector<glm::vec3> normals_list;
-	std::vector<glm::vec2> texture_coords;
-	glm::vec3 center(0.0f, 0.0f, 0.0f);
-	glm::vec3 normal;
-	glm::vec3 vertex;
-	glm::vec2 text_coord;
-
-	// generate the torus vertices
-	auto currentMainSegmentAngle = 0.0f;
-	for (auto i = 0; i < _mainSegments; i++)
+	const size_t vertexCount = mPoolVertices.size() / FLOATS_PER_VERTEX;
+	PoolStreams streams = {};
+	GLuint largestMesh = 0;
+	if (mPacked)
 	{
-		// Calculate sine and cosine of main segment angle
-		auto sinMainSegment = sin(currentMainSegmentAngle);
-		auto cosMainSegment = cos(currentMainSegmentAngle);
-		auto currentTubeSegmentAngle = 0.0f;
-		std::vector<glm::vec3> segment_points;
-		for (auto j = 0; j < _tubeSegments; j++)
+		storage.vertices.resize(sizeof(PackedVertex) * vertexCount);
+		PackedVertex* packed = (PackedVertex*)storage.vertices.data();
+		for (GLMesh* mesh : UAllMeshes())
 		{
-			// Calculate sine and cosine of tube segment angle
-			auto sinTubeSegment = sin(currentTubeSegmentAngle);
-			auto cosTubeSegment = cos(currentTubeSegmentAngle);
-
-			// Calculate vertex position on the surface of torus
-			auto surfacePosition = glm::vec3(
-				(_mainRadius + _tubeRadius * cosTubeSegment)*cosMainSegment,
-				(_mainRadius + _tubeRadius * cosTubeSegment)*sinMainSegment,
-				_tubeRadius*sinTubeSegment);
+			glm::vec3 low = mesh->boundsMin;
+			glm::vec3 high = mesh->boundsMax;
+			for (GLuint level = 0; level < mesh->nLods; ++level)
+			{
+				const GLMeshLod& lod = mesh->lods[level];
+				for (GLuint v = 0; v < lod.nVertices; ++v)
+				{
+					const GLfloat* p = &mPoolVertices[((size_t)lod.baseVertex + v) * FLOATS_PER_VERTEX];
+					low = glm::min(low, glm::vec3(p[0], p[1], p[2]));
+					high = glm::max(high, glm::vec3(p[0], p[1], p[2]));
+				}
+			}
 
-			//vertex_list.push_back(surfacePosition);
-			segment_points.push_back(surfacePosition);
+			// one scale for every axis keeps the decode a uniform scale
+			const glm::vec3 size = high - low;
+			mesh->positionOffset = low;
+			mesh->positionScale = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
 
-			// Update current tube angle
-			currentTubeSegmentAngle += tubeSegmentAngleStep;
+			for (GLuint level = 0; level < mesh->nLods; ++level)
+			{
+				const GLMeshLod& lod = mesh->lods[level];
+				PackVertices(&mPoolVertices[(size_t)lod.baseVertex * FLOATS_PER_VERTEX], lod.nVertices,
+					mesh->positionOffset, mesh->positionScale, &packed[lod.baseVertex]);
+				largestMesh = std::max(largestMesh, lod.nVertices);
+			}
 		}
-		segments_list.push_back(segment_points);
-		segment_points.clear();
 
-		// Update main segment angle
-		currentMainSegmentAngle += mainSegmentAngleStep;
-	}
-
-	float horizontalStep = 1.0 / _mainSegments;
-	float verticalStep = 1.0 / _tubeSegments;
-	float u = 0.0;
-	float v = 0.0;
+		// the same shorts as the packed vertices, so both passes compute the same depth
+		storage.positions.resize(sizeof(GLushort) * 4 * vertexCount);
+		GLushort* positions = (GLushort*)storage.positions.data();
+		for (size_t v = 0; v < vertexCount; ++v)
+			std::copy(packed[v].position, packed[v].position + 4, &positions[v * 4]);
 
-	// connect the various segments together, forming triangles
-	for (int i = 0; i < _mainSegments; i++)
+		streams.vertices = storage.vertices.data();
+		streams.vertexBytes = storage.vertices.size();
+	}
+	else
 	{
-		for (int j = 0; j < _tubeSegments; j++)
+		// Pull the positions out of the interleaved data, vertex order is unchanged
+		storage.positions.resize(sizeof(GLfloat) * FLOATS_PER_POSITION * vertexCount);
+		GLfloat* positions = (GLfloat*)storage.positions.data();
+		for (size_t v = 0; v < vertexCount; ++v)
 		{
-			if (((i + 1) < _mainSegments) && ((j + 1) < _tubeSegments))
-			{
-				vertex_list.push_back(segments_list[i][j]);
-				normal = normalize(segments_list[i][j] - center);
-				normals_list.push_back(normal);
-				texture_coords.push_back(glm::vec2(u, v));
-				vertex_list.push_back(segments_list[i][j + 1]);
-				normal = normalize(segments_list[i][j+1] - center);
-				normals_list.push_back(normal);
-				texture_coords.push_back(glm::vec2(u, v+verticalStep));
-				vertex_list.push_back(segments_list[i + 1][j + 1]);
-				normal = normalize(segments_list[i+1][j+1] - center);
-				normals_list.push_back(normal);
-				texture_coords.push_back(glm::vec2(u+horizontalStep, v+verticalStep));
-				vertex_list.push_back(segments_list[i][j]);
-				normal = normalize(segments_list[i][j] - center);
-				normals_list.push_back(normal);
-				texture_coords.push_back(glm::vec2(u, v));
-				vertex_list.push_back(segments_list[i + 1][j]);
-				normal = normalize(segments_list[i+1][j] - center);
-				normals_list.push_back(normal);
-				texture_coords.push_back(glm::vec2(u+horizontalStep, v));
-				vertex_list.push_back(segments_list[i + 1][j + 1]);
-				normal = normalize(segments_list[i+1][j+1] - center);
-				normals_list.push_back(normal);
-				texture_coords.push_back(glm::vec2(u+horizontalStep, v-verticalStep));
-				vertex_list.push_back(segments_list[i][j]);
-				normal = normalize(segments_list[i][j] - center);
-				normals_list.push_back(normal);
-				texture_coords.push_back(glm::vec2(u, v));
-			}
-			else
-			{
-				if (((i + 1) == _mainSegments) && ((j + 1) == _tubeSegments))
-				{
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][0]);
-					normal = normalize(segments_list[i][0] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, 0));
-					vertex_list.push_back(segments_list[0][0]);
-					normal = normalize(segments_list[0][0] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(0, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[0][j]);
-					normal = normalize(segments_list[0][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(0, v));
-					vertex_list.push_back(segments_list[0][0]);
-					normal = normalize(segments_list[0][0] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(0, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-				}
-				else if ((i + 1) == _mainSegments)
-				{
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][j + 1]);
-					normal = normalize(segments_list[i][j+1] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v+verticalStep));
-					vertex_list.push_back(segments_list[0][j + 1]);
-					normal = normalize(segments_list[0][j+1] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(0, v+verticalStep));
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[0][j]);
-					normal = normalize(segments_list[0][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(0, v));
-					vertex_list.push_back(segments_list[0][j + 1]);
-					normal = normalize(segments_list[0][j+1] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(0, v+verticalStep));
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-				}
-				else if ((j + 1) == _tubeSegments)
-				{
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][0]);
-					normal = normalize(segments_list[i][0] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, 0));
-					vertex_list.push_back(segments_list[i + 1][0]);
-					normal = normalize(segments_list[i+1][0] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u+horizontalStep, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i + 1][j]);
-					normal = normalize(segments_list[i+1][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u+horizontalStep, v));
-					vertex_list.push_back(segments_list[i + 1][0]);
-					normal = normalize(segments_list[i+1][0] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u+horizontalStep, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					normal = normalize(segments_list[i][j] - center);
-					normals_list.push_back(normal);
-					texture_coords.push_back(glm::vec2(u, v));
-				}
-				
-			}
-			v += verticalStep;
+			for (GLuint i = 0; i < FLOATS_PER_POSITION; ++i)
+				positions[v * FLOATS_PER_POSITION + i] = mPoolVertices[v * FLOATS_PER_VERTEX + i];
 		}
-		v = 0.0;
-		u += horizontalStep;
+
+		streams.vertices = mPoolVertices.data();
+		streams.vertexBytes = sizeof(GLfloat) * mPoolVertices.size();
 	}
+	streams.positions = storage.positions.data();
+	streams.positionBytes = storage.positions.size();
 
-	std::vector<GLfloat> combined_values;
+	// indices are relative to each mesh's baseVertex, so 16 bits do while no mesh is larger
+	mIndexType = mPacked && largestMesh <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	if (mIndexType == GL_UNSIGNED_SHORT)
+	{
+		storage.indices.resize(sizeof(GLushort) * mPoolIndices.size());
+		std::copy(mPoolIndices.begin(), mPoolIndices.end(), (GLushort*)storage.indices.data());
+		streams.indices = storage.indices.data();
+		streams.indexBytes = storage.indices.size();
+	}
+	else
+	{
+		streams.indices = mPoolIndices.data();
+		streams.indexBytes = sizeof(GLuint) * mPoolIndices.size();
+	}
+	return streams;
+}
 
-	// combine interleaved vertices, normals, and texture coords
-	for (int i = 0; i < vertex_list.size(); i++)
+///////////////////////////////////////////////////
+//	UUploadPool(const PoolStreams&)
+//
+//	streams: bytes of the three buffers, cooked just
+//		now or mapped from the cooked file
+//
+//	Send the shared vertex and index buffers to the
+//	GPU and point every mesh at the shared VAO. The
+//	position-only copy of the vertices gets its own
+//	VAO sharing the index buffer, so depth-only
+//	passes fetch only the positions.
+///////////////////////////////////////////////////
+void Meshes::UUploadPool(const PoolStreams& streams)
+{
+	// Generate the shared VAO
+	glGenVertexArrays(1, &mPoolVao);
+	GLState::BindVertexArray(mPoolVao);
+
+	// Create the shared vertex and index buffers
+	glGenBuffers(1, &mPoolVbo);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, mPoolVbo);
+	stats.vertexBytes = streams.vertexBytes;
+	glBufferData(GL_ARRAY_BUFFER, streams.vertexBytes, streams.vertices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &mPoolEbo);
+	GLState::BindElementBuffer(mPoolVao, mPoolEbo);
+	stats.indexBytes = streams.indexBytes;
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, streams.indexBytes, streams.indices, GL_STATIC_DRAW);
+
+	if (mPacked)
 	{
-		vertex = vertex_list[i];
-		normal = normals_list[i];
-		text_coord = texture_coords[i];
-		combined_values.push_back(vertex.x);
-		combined_values.push_back(vertex.y);
-		combined_values.push_back(vertex.z);
-		combined_values.push_back(normal.x);
-		combined_values.push_back(normal.y);
-		combined_values.push_back(normal.z);
-		combined_values.push_back(text_coord.x);
-		combined_values.push_back(text_coord.y);
+		// positions and normals are normalized integers, the normal's w of 0 marks it octahedral
+		const GLsizei stride = sizeof(PackedVertex);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+		glEnableVertexAttribArray(0);
+
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+		glEnableVertexAttribArray(1);
+
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, uv));
+		glEnableVertexAttribArray(2);
 	}
+	else
+	{
+		// Strides between vertex coordinates
+		const GLuint floatsPerVertex = 3;
+		const GLuint floatsPerNormal = 3;
+		GLint stride = sizeof(float) * FLOATS_PER_VERTEX;
 
-	// total float values per each type
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerNormal = 3;
-	const GLuint floatsPerUV = 2;
+		// Create Vertex Attribute Pointers
+		glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
+		glEnableVertexAttribArray(0);
 
-	// store vertex and index count
-	mesh.nVertices = vertex_list.size();
-	mesh.nIndices = 0;
+		glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
+		glEnableVertexAttribArray(1);
 
-	// Create VAO
-	glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(mesh.vao);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
+		glEnableVertexAttribArray(2);
+	}
 
-	// Create VBOs
-	glGenBuffers(1, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+	GLState::BindVertexArray(0);
 
-	// Strides between vertex coordinates
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
+	glGenVertexArrays(1, &mDepthVao);
+	GLState::BindVertexArray(mDepthVao);
 
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
+	glGenBuffers(1, &mPositionVbo);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, mPositionVbo);
+	stats.vertexBytes += streams.positionBytes;
+	glBufferData(GL_ARRAY_BUFFER, streams.positionBytes, streams.positions, GL_STATIC_DRAW);
+	if (mPacked)
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GLushort) * 4, 0);
+	else
+		glVertexAttribPointer(0, FLOATS_PER_POSITION, GL_FLOAT, GL_FALSE, sizeof(float) * FLOATS_PER_POSITION, 0);
 	glEnableVertexAttribArray(0);
 
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(1);
+	// the index buffer is shared, its binding is part of this VAO too
+	GLState::BindElementBuffer(mDepthVao, mPoolEbo);
+
+	GLState::BindVertexArray(0);
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	for (GLMesh* mesh : UAllMeshes())
+	{
+		mesh->vao = mPoolVao;
+		mesh->vbos[0] = mPoolVbo;
+		mesh->vbos[1] = mPoolEbo;
+	}
 }
 
 ///////////////////////////////////////////////////
-//	UCreateSphereMesh(GLMesh&)
-//
-//	mesh: reference to mesh structure for storing data
-//
-//	Create a sphere mesh and store it in a VAO/VBO
-//
-//  Correct triangle drawing command:
+//	UCookKey()
 //
-//	glDrawElements(GL_TRIANGLES, meshes.gSphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+//	Hash of everything the cooked file depends on
+//	that can change without MESH_COOK_VERSION being
+//	bumped: the vertex format, the requested
+//	resolutions and the constants the generators,
+//	the detail levels and the reordering use. The
+//	struct sizes catch a changed GLMesh or MeshStats.
 ///////////////////////////////////////////////////
-void Meshes::UCreateSphereMesh(GLMesh &mesh)
+uint64_t Meshes::UCookKey() const
 {
-	GLfloat verts[] = {
-		// vertex data					// index
-		// top center point
-		0.0f, 1.0f, 0.0f,				//0
-		// ring 1
-		0.0f, 0.9808f, 0.1951f,			//1
-		0.0747f, 0.9808f, 0.1802f,		//2
-		0.1379f, 0.9808f, 0.1379f,		//3
-		0.1802f, 0.9808f, 0.0747f,		//4
-		0.1951f, 0.9808, 0.0f,			//5
-		0.1802f, 0.9808f, -0.0747f,		//6
-		0.1379f, 0.9808f, -0.1379f,		//7
-		0.0747f, 0.9808f, -0.1802f,		//8
-		0.0f, 0.9808f, -0.1951f,		//9
-		-0.0747f, 0.9808f, -0.1802f,	//10
-		-0.1379f, 0.9808f, -0.1379f,	//11
-		-0.1802f, 0.9808f, -0.0747f,	//12
-		-0.1951f, 0.9808, 0.0f,			//13
-		-0.1802f, 0.9808f, 0.0747f,		//14
-		-0.1379f, 0.9808f, 0.1379f,		//15
-		-0.0747f, 0.9808f, 0.1802f,		//16
-		// ring 2
-		0.0f, 0.9239f, 0.3827f,			//17
-		0.1464f, 0.9239f, 0.3536f,		//18
-		0.2706f, 0.9239f, 0.2706f,		//19
-		0.3536f, 0.9239f, 0.1464f,		//20
-		0.3827f, 0.9239f, 0.0f,			//21
-		0.3536f, 0.9239f, -0.1464f,		//22
-		0.2706f, 0.9239f, -0.2706f,		//23
-		0.1464f, 0.9239f, -0.3536f,		//24
-		0.0f, 0.9239f, -0.3827f,		//25
-		-0.1464f, 0.9239f, -0.3536f,	//26
-		-0.2706f, 0.9239f, -0.2706f,	//27
-		-0.3536f, 0.9239f, -0.1464f,	//28
-		-0.3827f, 0.9239f, 0.0f,		//29
-		-0.3536f, 0.9239f, 0.1464f,		//30
-		-0.2706f, 0.9239f, 0.2706f,		//31
-		-0.1464f, 0.9239f, 0.3536f,		//32
-		// ring 3
-		0.0f, 0.8315f, 0.5556f,			//33
-		0.2126f, 0.8315f, 0.5133f,		//34
-		0.3928f, 0.8315f, 0.3928f,		//35
-		0.5133f, 0.8315f, 0.2126f,		//36
-		0.5556f, 0.8315f, 0.0f,			//37
-		0.5133f, 0.8315f, -0.2126f,		//38
-		0.3928f, 0.8315f, -0.3928f,		//39
-		0.2126f, 0.8315f, -0.5133f,		//40
-		0.0f, 0.8315f, -0.5556f,		//41
-		-0.2126f, 0.8315f, -0.5133f,	//42
-		-0.3928f, 0.8315f, -0.3928f,	//43
-		-0.5133f, 0.8315f, -0.2126f,	//44
-		-0.5556f, 0.8315f, 0.0f,		//45
-		-0.5133f, 0.8315f, 0.2126f,		//46
-		-0.3928f, 0.8315f, 0.3928f,		//47
-		-0.2126f, 0.8315f, 0.5133f,		//48
-		// ring 4
-		0.0f, 0.7071f, 0.7071f,			//49
-		0.2706f, 0.7071f, 0.6533f,		//50
-		0.5f, 0.7071f, 0.5f,			//51
-		0.6533f, 0.7071f, 0.2706f,		//52
-		0.7071f, 0.7071f, 0.0f,			//53
-		0.6533f, 0.7071f, -0.2706f,		//54
-		0.5f, 0.7071f, -0.5f,			//55
-		0.2706f, 0.7071f, -0.6533f,		//56
-		0.0f, 0.7071f, -0.7071f,		//57
-		-0.2706f, 0.7071f, -0.6533f,	//58
-		-0.5f, 0.7071f, -0.5f,			//59
-		-0.6533f, 0.7071f, -0.2706f,	//60
-		-0.7071f, 0.7071f, 0.0f,		//61
-		-0.6533f, 0.7071f, 0.2706f,		//62
-		-0.5f, 0.7071f, 0.5f,			//63
-		-0.2706f, 0.7071f, 0.6533f,		//64
-		// ring 5
-		0.0f, 0.5556f, 0.8315f,			//65
-		0.3182f, 0.5556f, 0.7682f,		//66
-		0.5879f, 0.5556f, 0.5879f,		//67
-		0.7682f, 0.5556f, 0.3182f,		//68
-		0.8315f, 0.5556f, 0.0f,			//69
-		0.7682f, 0.5556f, -0.3182f,		//70
-		0.5879f, 0.5556f, -0.5879f,		//71
-		0.3182f, 0.5556f, -0.7682f,		//72
-		0.0f, 0.5556f, -0.8315f,		//73
-		-0.3182f, 0.5556f, -0.7682f,	//74
-		-0.5879f, 0.5556f, -0.5879f,	//75
-		-0.7682f, 0.5556f, -0.3182f,	//76
-		-0.8315f, 0.5556f, 0.0f,		//77
-		-0.7682f, 0.5556f, 0.3182f,		//78
-		-0.5879f, 0.5556f, 0.5879f,		//79
-		-0.3182f, 0.5556f, 0.7682f,		//80
-		//ring 6
-		0.0f, 0.3827f, 0.9239f,			//81
-		0.3536f, 0.3827f, 0.8536f,		//82
-		0.6533f, 0.3827f, 0.6533f,		//83
-		0.8536f, 0.3827f, 0.3536f,		//84
-		0.9239f, 0.3827f, 0.0f,			//85
-		0.8536f, 0.3827f, -0.3536f,		//86
-		0.6533f, 0.3827f, -0.6533f,		//87
-		0.3536f, 0.3827f, -0.8536f,		//88
-		0.0f, 0.3827f, -0.9239f,		//89
-		-0.3536f, 0.3827f, -0.8536f,	//90
-		-0.6533f, 0.3827f, -0.6533f,	//91
-		-0.8536f, 0.3827f, -0.3536f,	//92
-		-0.9239f, 0.3827f, 0.0f,		//93
-		-0.8536f, 0.3827f, 0.3536f,		//94
-		-0.6533f, 0.3827f, 0.6533f,		//95
-		-0.3536f, 0.3827f, 0.8536f,		//96
-		// ring 7
-		0.0f, 0.1951f, 0.9808f,			//97
-		0.3753f, 0.1915f, 0.9061f,		//98
-		0.6935f, 0.1915f, 0.6935f,		//99
-		0.9061f, 0.1915f, 0.3753f,		//100
-		0.9808f, 0.1915f, 0.0f,			//101
-		0.9061f, 0.1915f, -0.3753f,		//102
-		0.6935f, 0.1915f, -0.6935f,		//103
-		0.3753f, 0.1915f, -0.9061f,		//104
-		0.0f, 0.1915f, -0.9808f,		//105
-		-0.3753f, 0.1915f, -0.9061f,	//106
-		-0.6935f, 0.1915f, -0.6935f,	//107
-		-0.9061f, 0.1915f, -0.3753f,	//108
-		-0.9808f, 0.1915f, 0.0f,		//109
-		-0.9061f, 0.1915f, 0.3753f,		//110
-		-0.6935f, 0.1915f, 0.6935f,		//111
-		-0.3753f, 0.1915f, 0.9061f,		//112
-		// ring 8
-		0.0f, 0.0f, 1.0f,				//113
-		0.3827f, 0.0f, 0.9239f,			//114
-		0.7071f, 0.0f, 0.7071f,			//115
-		0.9239f, 0.0f, 0.3827f,			//116
-		1.0f, 0.0f, 0.0f,				//117
-		0.9239f, 0.0f, -0.3827f,		//118
-		0.7071f, 0.0f, -0.7071f,		//119
-		0.3827f, 0.0f, -0.9239f,		//120
-		0.0f, 0.0f, -1.0f,				//121
-		-0.3827f, 0.0f, -0.9239f,		//122
-		-0.7071f, 0.0f, -0.7071f,		//123
-		-0.9239f, 0.0f, -0.3827f,		//124
-		-1.0f, 0.0f, 0.0f,				//125
-		-0.9239f, 0.0f, 0.3827f,		//126
-		-0.7071, 0.0, 0.7071f,			//127
-		-0.3827f, 0.0f, 0.9239f,		//128
-		// ring 9
-		0.0f, -0.1915f, 0.9808f,		//129
-		0.3753f, -0.1915f, 0.9061f,		//130
-		0.6935f, -0.1915f, 0.6935f,		//131
-		0.9061f, -0.1915f, 0.3753f,		//132
-		0.9808f, -0.1915f, 0.0f,		//133
-		0.9061f, -0.1915f, -0.3753f,	//134
-		0.6935f, -0.1915f, -0.6935f,	//135
-		0.3753f, -0.1915f, -0.9061f,	//136
-		0.0f, -0.1915f, -0.9808f,		//137
-		-0.3753f, -0.1915f, -0.9061f,	//138
-		-0.6935f, -0.1915f, -0.6935f,	//139
-		-0.9061f, -0.1915f, -0.3753f,	//140
-		-0.9808f, -0.1915f, 0.0f,		//141
-		-0.9061f, -0.1915f, 0.3753f,	//142
-		-0.6935f, -0.1915f, 0.6935f,	//143
-		-0.3753f, -0.1915f, 0.9061f,	//144
-		// ring 10
-		0.0f, -0.3827f, 0.9239f,		//145
-		0.3536f, -0.3827f, 0.8536f,		//146
-		0.6533f, -0.3827f, 0.6533f,		//147
-		0.8536f, -0.3827f, 0.3536f,		//148
-		0.9239f, -0.3827f, 0.0f,		//149
-		0.8536f, -0.3827f, -0.3536f,	//150
-		0.6533f, -0.3827f, -0.6533f,	//151
-		0.3536f, -0.3827f, -0.8536f,	//152
-		0.0f, -0.3827f, -0.9239f,		//153
-		-0.3536f, -0.3827f, -0.8536f,	//154
-		-0.6533f, -0.3827f, -0.6533f,	//155
-		-0.8536f, -0.3827f, -0.3536f,	//156
-		-0.9239f, -0.3827f, 0.0f,		//157
-		-0.8536f, -0.3827f, 0.3536f,	//158
-		-0.6533f, -0.3827f, 0.6533f,	//159
-		-0.3536f, -0.3827f, 0.8536f,	//160
-		// ring 11
-		0.0f, -0.5556f, 0.8315f,		//161
-		0.3182f, -0.5556f, 0.7682f,		//162
-		0.5879f, -0.5556f, 0.5879f,		//163
-		0.7682f, -0.5556f, 0.3182f,		//164
-		0.8315f, -0.5556f, 0.0f,		//165
-		0.7682f, -0.5556f, -0.3182f,	//166
-		0.5879f, -0.5556f, -0.5879f,	//167
-		0.3182f, -0.5556f, -0.7682f,	//168
-		0.0f, -0.5556f, -0.8315f,		//169
-		-0.3182f, -0.5556f, -0.7682f,	//170
-		-0.5879f, 0.5556f, -0.5879f,	//171
-		-0.7682f, -0.5556f, -0.3182f,	//172
-		-0.8315f, -0.5556f, 0.0f,		//173
-		-0.7682f, -0.5556f, 0.3182f,	//174
-		-0.5879f, -0.5556f, 0.5879f,	//175
-		-0.3182f, -0.5556f, 0.7682f,	//176
-		// ring 12
-		0.0f, -0.7071f, 0.7071f,		//177
-		0.2706f, -0.7071f, 0.6533f,		//178
-		0.5f, -0.7071f, 0.5f,			//179
-		0.6533f, -0.7071f, 0.2706f,		//180
-		0.7071f, -0.7071f, 0.0f,		//181
-		0.6533f, -0.7071f, -0.2706f,	//182
-		0.5f, -0.7071f, -0.5f,			//183
-		0.2706f, -0.7071f, -0.6533f,	//184
-		0.0f, -0.7071f, -0.7071f,		//185
-		-0.2706f, -0.7071f, -0.6533f,	//186
-		-0.5f, -0.7071f, -0.5f,			//187
-		-0.6533f, -0.7071f, -0.2706f,	//188
-		-0.7071f, -0.7071f, 0.0f,		//189
-		-0.6533f, -0.7071f, 0.2706f,	//190
-		-0.5f, -0.7071f, 0.5f,			//191
-		-0.2706f, -0.7071f, 0.6533f,	//192
-		// ring 13
-		0.0f, -0.8315f, 0.5556f,		//193
-		0.2126f, -0.8315f, 0.5133f,		//194
-		0.3928f, -0.8315f, 0.3928f,		//195
-		0.5133f, -0.8315f, 0.2126f,		//196
-		0.5556f, -0.8315f, 0.0f,		//197
-		0.5133f, -0.8315f, -0.2126f,	//198
-		0.3928f, -0.8315f, -0.3928f,	//199
-		0.2126f, -0.8315f, -0.5133f,	//200
-		0.0f, -0.8315f, -0.5556f,		//201
-		-0.2126f, -0.8315f, -0.5133f,	//202
-		-0.3928f, -0.8315f, -0.3928f,	//203
-		-0.5133f, -0.8315f, -0.2126f,	//204
-		-0.5556f, -0.8315f, 0.0f,		//205
-		-0.5133f, -0.8315f, 0.2126f,	//206
-		-0.3928f, -0.8315f, 0.3928f,	//207
-		-0.2126f, -0.8315f, 0.5133f,	//208
-		// ring 14
-		0.0f, -0.9239f, 0.3827f,		//209
-		0.1464f, -0.9239f, 0.3536f,		//210
-		0.2706f, -0.9239f, 0.2706f,		//211
-		0.3536f, -0.9239f, 0.1464f,		//212
-		0.3827f, -0.9239f, 0.0f,		//213
-		0.3536f, -0.9239f, -0.1464f,	//214
-		0.2706f, -0.9239f, -0.2706f,	//215
-		0.1464f, -0.9239f, -0.3536f,	//216
-		0.0f, -0.9239f, -0.3827f,		//217
-		-0.1464f, -0.9239f, -0.3536f,	//218
-		-0.2706f, -0.9239f, -0.2706f,	//219
-		-0.3536f, -0.9239f, -0.1464f,	//220
-		-0.3827f, -0.9239f, 0.0f,		//221
-		-0.3536f, -0.9239f, 0.1464f,	//222
-		-0.2706f, -0.9239f, 0.2706f,	//223
-		-0.1464f, -0.9239f, 0.3536f,	//224
-		// ring 15
-		0.0f, -0.9808f, 0.1951f,		//225
-		0.0747f, -0.9808f, 0.1802f,		//226
-		0.1379f, -0.9808f, 0.1379f,		//227
-		0.1802f, -0.9808f, 0.0747f,		//228
-		0.1951f, -0.9808, 0.0f,			//229
-		0.1802f, -0.9808f, -0.0747f,	//230
-		0.1379f, -0.9808f, -0.1379f,	//231
-		0.0747f, -0.9808f, -0.1802f,	//232
-		0.0f, -0.9808f, -0.1951f,		//233
-		-0.0747f, -0.9808f, -0.1802f,	//234
-		-0.1379f, -0.9808f, -0.1379f,	//235
-		-0.1802f, -0.9808f, -0.0747f,	//236
-		-0.1951f, -0.9808, 0.0f,		//237
-		-0.1802f, -0.9808f, 0.0747f,	//238
-		-0.1379f, -0.9808f, 0.1379f,	//239
-		-0.0747f, -0.9808f, 0.1802f,	//240
-		// bottom center point
-		0.0f, -1.0f, 0.0f,				//241
+	const uint32_t parameters[] = {
+		MESH_COOK_VERSION,
+		mPacked ? 1u : 0u,
+		FLOATS_PER_VERTEX,
+		MAX_LODS,
+		VERTEX_CACHE_SIZE,
+		MIN_LOD_SEGMENTS,
+		(uint32_t)sizeof(GLMesh),
+		(uint32_t)sizeof(CookedWeld),
+		(uint32_t)sizeof(CookedSummary),
+		(uint32_t)sizeof(PackedVertex)
 	};
+	uint64_t key = HashBytes(parameters, sizeof(parameters));
+	key = HashBytes(&TORUS_TUBE_RADIUS, sizeof(TORUS_TUBE_RADIUS), key);
 
-	// index data
-	GLuint indices[] = {
-		//ring 1 - top
-		0,1,2,
-		0,2,3,
-		0,3,4,
-		0,4,5,
-		0,5,6,
-		0,6,7,
-		0,7,8,
-		0,8,9,
-		0,9,10,
-		0,10,11,
-		0,11,12,
-		0,12,13,
-		0,13,14,
-		0,14,15,
-		0,15,16,
-		0,16,1,
-
-		// ring 1 to ring 2
-		1,17,18,
-		1,2,18,
-		2,18,19,
-		2,3,19,
-		3,19,20,
-		3,4,20,
-		4,20,21,
-		4,5,21,
-		5,21,22,
-		5,6,22,
-		6,22,23,
-		6,7,23,
-		7,23,24,
-		7,8,24,
-		8,24,25,
-		8,9,25,
-		9,25,26,
-		9,10,26,
-		10,26,27,
-		10,11,27,
-		11,27,28,
-		11,12,28,
-		12,28,29,
-		12,13,29,
-		13,29,30,
-		13,14,30,
-		14,30,31,
-		14,15,31,
-		15,31,32,
-		15,16,32,
-		16,32,17,
-		16,1,17,
-
-		// ring 2 to ring 3
-		17,33,34,
-		17,18,34,
-		18,34,35,
-		18,19,35,
-		19,35,36,
-		19,20,36,
-		20,36,37,
-		20,21,37,
-		21,37,38,
-		21,22,38,
-		22,38,39,
-		22,23,39,
-		23,39,40,
-		23,24,40,
-		24,40,41,
-		24,25,41,
-		25,41,42,
-		25,26,42,
-		26,42,43,
-		26,27,43,
-		27,43,44,
-		27,28,44,
-		28,44,45,
-		28,29,45,
-		29,45,46,
-		29,30,46,
-		30,46,47,
-		30,31,47,
-		31,47,48,
-		31,32,48,
-		32,48,33,
-		32,17,33,
-
-		// ring 3 to ring 4
-		33,49,50,
-		33,34,50,
-		34,50,51,
-		34,35,51,
-		35,51,52,
-		35,36,52,
-		36,52,53,
-		36,37,53,
-		37,53,54,
-		37,38,54,
-		38,54,55,
-		38,39,55,
-		39,55,56,
-		39,40,56,
-		40,56,57,
-		40,41,57,
-		41,57,58,
-		41,42,58,
-		42,58,59,
-		42,43,59,
-		43,59,60,
-		43,44,60,
-		44,60,61,
-		44,45,61,
-		45,61,62,
-		45,46,62,
-		46,62,63,
-		46,47,63,
-		47,63,64,
-		47,48,64,
-		48,64,49,
-		48,33,49,
-		
-		// ring 4 to ring 5
-		49,65,66,
-		49,50,66,
-		50,66,67,
-		50,51,67,
-		51,67,68,
-		51,52,68,
-		52,68,69,
-		52,53,69,
-		53,69,70,
-		53,54,70,
-		54,70,71,
-		54,55,71,
-		55,71,72,
-		55,56,72,
-		56,72,73,
-		56,57,73,
-		57,73,74,
-		57,58,74,
-		58,74,75,
-		58,59,75,
-		59,75,76,
-		59,60,76,
-		60,76,77,
-		60,61,77,
-		61,77,78,
-		61,62,78,
-		62,78,79,
-		62,63,79,
-		63,79,80,
-		63,64,80,
-		64,80,65,
-		64,49,65,
-
-		// ring 5 to ring 6
-		65,81,82,
-		65,66,82,
-		66,82,83,
-		66,67,83,
-		67,83,84,
-		67,68,84,
-		68,84,85,
-		68,69,85,
-		69,85,86,
-		69,70,86,
-		70,86,87,
-		70,71,87,
-		71,87,88,
-		71,72,88,
-		72,88,89,
-		72,73,89,
-		73,89,90,
-		73,74,90,
-		74,90,91,
-		74,75,91,
-		75,91,92,
-		75,76,92,
-		76,92,93,
-		76,77,93,
-		77,93,94,
-		77,78,94,
-		78,94,95,
-		78,79,95,
-		79,95,96,
-		79,80,96,
-		80,96,81,
-		80,65,81,
-
-		// ring 6 to ring 7
-		81,97,98,
-		81,82,98,
-		82,98,99,
-		82,83,99,
-		83,99,100,
-		83,84,100,
-		84,100,101,
-		84,85,101,
-		85,101,102,
-		85,86,102,
-		86,102,103,
-		86,87,103,
-		87,103,104,
-		87,88,104,
-		88,104,105,
-		88,89,105,
-		89,105,106,
-		89,90,106,
-		90,106,107,
-		90,91,107,
-		91,107,108,
-		91,92,108,
-		92,108,109,
-		92,93,109,
-		93,109,110,
-		93,94,110,
-		94,110,111,
-		94,95,111,
-		95,111,112,
-		95,96,112,
-		96,112,97,
-		96,81,97,
-
-		// ring 7 to ring 8
-		97,113,114,
-		97,98,114,
-		98,114,115,
-		98,99,115,
-		99,115,116,
-		99,100,116,
-		100,116,117,
-		100,101,117,
-		101,117,118,
-		101,102,118,
-		102,118,119,
-		102,103,119,
-		103,119,120,
-		103,104,120,
-		104,120,121,
-		104,105,121,
-		105,121,122,
-		105,106,122,
-		106,122,123,
-		106,107,123,
-		107,123,124,
-		107,108,124,
-		108,124,125,
-		108,109,125,
-		109,125,126,
-		109,110,126,
-		110,126,127,
-		110,111,127,
-		111,127,128,
-		111,112,128,
-		112,128,113,
-		112,97,113,
-
-		// ring 8 to ring 9
-		113,129,130,
-		113,114,130,
-		114,130,131,
-		114,115,131,
-		115,131,132,
-		115,116,132,
-		116,132,133,
-		116,117,133,
-		117,133,134,
-		117,118,134,
-		118,134,135,
-		118,119,135,
-		119,135,136,
-		119,120,136,
-		120,136,137,
-		120,121,137,
-		121,137,138,
-		121,122,138,
-		122,138,139,
-		122,123,139,
-		123,139,140,
-		123,124,140,
-		124,140,141,
-		124,125,141,
-		125,141,142,
-		125,126,142,
-		126,142,143,
-		126,127,143,
-		127,143,144,
-		127,128,144,
-		128,144,129,
-		128,113,129,
-
-		// ring 9 to ring 10
-		129,145,146,
-		129,130,146,
-		130,146,147,
-		130,131,147,
-		131,147,148,
-		131,132,148,
-		132,148,149,
-		132,133,149,
-		133,149,150,
-		133,134,150,
-		134,150,151,
-		134,135,151,
-		135,151,152,
-		135,136,152,
-		136,152,153,
-		136,137,153,
-		137,153,154,
-		137,138,154,
-		138,154,155,
-		138,139,155,
-		139,155,156,
-		139,140,156,
-		140,156,157,
-		140,141,157,
-		141,157,158,
-		141,142,158,
-		142,158,159,
-		142,143,159,
-		143,159,160,
-		143,144,160,
-		144,160,145,
-		144,129,145,
-
-		// ring 10 to ring 11
-		145,161,162,
-		145,146,162,
-		146,162,163,
-		146,147,163,
-		147,163,164,
-		147,148,164,
-		148,164,165,
-		148,149,165,
-		149,165,166,
-		149,150,166,
-		150,166,167,
-		150,151,167,
-		151,167,168,
-		151,152,168,
-		152,168,169,
-		152,153,169,
-		153,169,170,
-		153,154,170,
-		154,170,171,
-		154,155,171,
-		155,171,172,
-		155,156,172,
-		156,172,173,
-		156,157,173,
-		157,173,174,
-		157,158,174,
-		158,174,175,
-		158,159,175,
-		159,175,176,
-		159,160,176,
-		160,176,161,
-		160,145,161,
-
-		// ring 11 to ring 12
-		161,177,178,
-		161,162,178,
-		162,178,179,
-		162,163,179,
-		163,179,180,
-		163,164,180,
-		164,180,181,
-		164,165,181,
-		165,181,182,
-		165,166,182,
-		166,182,183,
-		166,167,183,
-		167,183,184,
-		167,168,184,
-		168,184,185,
-		168,169,185,
-		169,185,186,
-		169,170,186,
-		170,186,187,
-		170,171,187,
-		171,187,188,
-		171,172,188,
-		172,188,189,
-		172,173,189,
-		173,189,190,
-		173,174,190,
-		174,190,191,
-		174,175,191,
-		175,191,192,
-		175,176,192,
-		176,192,177,
-		176, 161,177,
-
-		// ring 12 to ring 13
-		177,193,194,
-		177,178,194,
-		178,194,195,
-		178,179,195,
-		179,195,196,
-		179,180,196,
-		180,196,197,
-		180,181,197,
-		181,197,198,
-		181,182,198,
-		182,198,199,
-		182,183,199,
-		183,199,200,
-		183,184,200,
-		184,200,201,
-		184,185,201,
-		185,201,202,
-		185,186,202,
-		186,202,203,
-		186,187,203,
-		187,203,204,
-		187,188,204,
-		188,204,205,
-		188,189,205,
-		189,205,206,
-		189,190,206,
-		190,206,207,
-		190,191,207,
-		191,207,208,
-		191,192,208,
-		192,208,193,
-		192,177,193,
-
-		// ring 13 to ring 14
-		193,209,210,
-		193,194,210,
-		194,210,211,
-		194,195,211,
-		195,211,212,
-		195,196,212,
-		196,212,213,
-		196,197,213,
-		197,213,214,
-		197,198,214,
-		198,214,215,
-		198,199,215,
-		199,215,216,
-		199,200,216,
-		200,216,217,
-		200,201,217,
-		201,217,218,
-		201,202,218,
-		202,218,219,
-		202,203,219,
-		203,219,220,
-		203,204,220,
-		204,220,221,
-		204,205,221,
-		205,221,222,
-		205,206,222,
-		206,222,223,
-		206,207,223,
-		207,223,224,
-		207,208,224,
-		208,224,209,
-		208,193,209,
-
-		// ring 14 to ring 15
-		209,225,226,
-		209,210,226,
-		210,226,227,
-		210,211,227,
-		211,227,228,
-		211,212,228,
-		212,228,229,
-		212,213,229,
-		213,229,230,
-		213,214,230,
-		214,230,231,
-		214,215,231,
-		215,231,232,
-		215,216,232,
-		216,232,233,
-		216,217,233,
-		217,233,234,
-		217,218,234,
-		218,234,235,
-		218,219,235,
-		219,235,236,
-		219,220,236,
-		220,236,237,
-		220,221,237,
-		221,237,238,
-		221,222,238,
-		222,238,239,
-		222,223,239,
-		223,239,240,
-		223,224,240,
-		224,240,225,
-		224,209,225,
-
-		// ring 15 - bottom
-		225,226,241,
-		226,227,241,
-		227,228,241,
-		228,229,241,
-		229,239,241,
-		230,231,241,
-		231,232,241,
-		232,233,241,
-		233,234,241,
-		234,235,241,
-		235,236,241,
-		236,237,241,
-		237,238,241,
-		238,239,241,
-		239,240,241,
-		240,225,241
-	};
-
-	// total float values per each type
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerNormal = 3;
-	const GLuint floatsPerUV = 2;
-
-	// store vertex and index count
-	mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex));
-	mesh.nIndices = sizeof(indices) / (sizeof(indices[0]));
-
-	glm::vec3 normal;
-	glm::vec3 vert;
-	glm::vec3 center(0.0f, 0.0f, 0.0f);
-	float u, v;
-	std::vector<GLfloat> combined_values;
-
-	// combine interleaved vertices, normals, and texture coords
-	for (int i = 0; i < sizeof(verts) / (sizeof(verts[0])); i += 3)
+	for (const auto& entry : mPrimitives)
 	{
-		vert = glm::vec3(verts[i], verts[i + 1], verts[i + 2]);
-		normal = normalize(vert - center);
-		u = atan2(normal.x, normal.z) / (2 * M_PI) + 0.5;
-		v = normal.y * 0.5 + 0.5;
-		combined_values.push_back(vert.x);
-		combined_values.push_back(vert.y);
-		combined_values.push_back(vert.z);
-		combined_values.push_back(normal.x);
-		combined_values.push_back(normal.y);
-		combined_values.push_back(normal.z);
-		combined_values.push_back(u);
-		combined_values.push_back(v);
+		const PrimitiveMesh& primitive = entry.second;
+		const uint32_t request[] = { (uint32_t)primitive.type, primitive.segments, primitive.rings };
+		key = HashBytes(request, sizeof(request), key);
 	}
+	return key;
+}
 
-	// Create VAO
-	glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(mesh.vao);
-
-	// Create VBOs
-	glGenBuffers(2, mesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); // Activates the vertex buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]); // Activates the index buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+///////////////////////////////////////////////////
+//	ULoadCooked()
+//
+//	Map the cooked file and, when it was cooked with
+//	the current key, restore the meshes, the stats
+//	and the weld report from it and upload the
+//	buffers straight from the mapping. Returns false,
+//	with the reason in stats.cache, when the meshes
+//	have to be generated.
+///////////////////////////////////////////////////
+bool Meshes::ULoadCooked()
+{
+	MeshCache cache;
+	stats.cache = cache.Open(mCachePath, UCookKey(), COOKED_SECTION_COUNT);
+	if (stats.cache != MESH_CACHE_LOADED)
+		return false;
+
+	const std::vector<GLMesh*> allMeshes = UAllMeshes();
+	if (cache.SectionBytes(COOKED_MESHES) != sizeof(GLMesh) * allMeshes.size() ||
+		cache.SectionBytes(COOKED_WELDS) % sizeof(CookedWeld) != 0 ||
+		cache.SectionBytes(COOKED_SUMMARY) != sizeof(CookedSummary))
+	{
+		stats.cache = MESH_CACHE_DAMAGED;
+		return false;
+	}
 
-	// Strides between vertex coordinates
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
+	// the records are small, the buffers are the bulk and stay in the mapping
+	const GLMesh* meshes = (const GLMesh*)cache.Section(COOKED_MESHES);
+	for (size_t m = 0; m < allMeshes.size(); ++m)
+		*allMeshes[m] = meshes[m];
+
+	const CookedWeld* welds = (const CookedWeld*)cache.Section(COOKED_WELDS);
+	const size_t weldCount = cache.SectionBytes(COOKED_WELDS) / sizeof(CookedWeld);
+	for (size_t w = 0; w < weldCount; ++w)
+		weldReport.push_back({ welds[w].name, welds[w].sourceVertices, welds[w].vertices, welds[w].triangles });
+
+	const CookedSummary& summary = *(const CookedSummary*)cache.Section(COOKED_SUMMARY);
+	stats = summary.stats;
+	stats.cache = MESH_CACHE_LOADED;
+	stats.cooked = false;
+	mIndexType = summary.indexType;
+
+	PoolStreams streams;
+	streams.vertices = cache.Section(COOKED_VERTICES);
+	streams.vertexBytes = cache.SectionBytes(COOKED_VERTICES);
+	streams.positions = cache.Section(COOKED_POSITIONS);
+	streams.positionBytes = cache.SectionBytes(COOKED_POSITIONS);
+	streams.indices = cache.Section(COOKED_INDICES);
+	streams.indexBytes = cache.SectionBytes(COOKED_INDICES);
+	UUploadPool(streams);
+
+	// glBufferData() has copied the buffers, the mapping is closed with cache
+	return true;
+}
 
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
+///////////////////////////////////////////////////
+//	UWriteCooked(const PoolStreams&)
+//
+//	streams: the buffers just uploaded
+//
+//	Write the meshes, the stats, the weld report and
+//	the buffers to the cooked file, for ULoadCooked()
+//	to find on the next start.
+///////////////////////////////////////////////////
+bool Meshes::UWriteCooked(const PoolStreams& streams)
+{
+	std::vector<GLMesh> meshes;
+	for (const GLMesh* mesh : UAllMeshes())
+		meshes.push_back(*mesh);
 
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(1);
+	std::vector<CookedWeld> welds(weldReport.size());
+	for (size_t w = 0; w < weldReport.size(); ++w)
+	{
+		std::memset(welds[w].name, 0, sizeof(welds[w].name));
+		weldReport[w].name.copy(welds[w].name, sizeof(welds[w].name) - 1);
+		welds[w].sourceVertices = weldReport[w].sourceVertices;
+		welds[w].vertices = weldReport[w].vertices;
+		welds[w].triangles = weldReport[w].triangles;
+	}
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-	glEnableVertexAttribArray(2);
+	CookedSummary summary = {};
+	summary.stats = stats;
+	summary.indexType = mIndexType;
+
+	MeshCacheWriter writer;
+	writer.AddSection(meshes.data(), sizeof(GLMesh) * meshes.size());
+	writer.AddSection(welds.data(), sizeof(CookedWeld) * welds.size());
+	writer.AddSection(&summary, sizeof(summary));
+	writer.AddSection(streams.vertices, streams.vertexBytes);
+	writer.AddSection(streams.positions, streams.positionBytes);
+	writer.AddSection(streams.indices, streams.indexBytes);
+	return writer.Write(mCachePath, UCookKey());
 }
-
-void Meshes::UDestroyMesh(GLMesh &mesh)
-{
-	glDeleteVertexArrays(1, &mesh.vao);
-	glDeleteBuffers(2, mesh.vbos);
-}
\ No newline at end of file
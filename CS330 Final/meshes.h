@@ -13,18 +13,112 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "meshcache.h"
+#include "meshgeometry.h"
+#include "primitives.h"
+
 class Meshes
 {
+public:
+	// One glDrawArrays/glDrawElements call needed to render (part of) a mesh
+	struct GLDrawRange
+	{
+		GLenum mode;        // Primitive type, e.g. GL_TRIANGLES or GL_TRIANGLE_FAN
+		GLint first;        // First vertex (arrays) or first index (elements)
+		GLsizei count;      // Number of vertices or indices to draw
+		bool indexed;       // Draw with glDrawElements instead of glDrawArrays
+	};
+
+	// Most detail levels a mesh carries, level 0 being the mesh itself
+	static const GLuint MAX_LODS = 4;
+
+	// One detail level of a mesh, drawn from the same shared buffers
+	struct GLMeshLod
+	{
+		GLuint nVertices;
+		GLuint nIndices;
+		GLint baseVertex;
+		GLuint firstIndex;
+		float error;        // Largest distance from its facets to the exact shape, object space
+	};
+
 	// Stores the GL data relative to a given mesh
 	struct GLMesh
 	{
-		GLuint vao;         // Handle for the vertex array object
-		GLuint vbos[2];     // Handles for the vertex buffer objects
+		GLuint vao;         // Handle for the (shared) vertex array object
+		GLuint vbos[2];     // Handles for the (shared) vertex and index buffers
 		GLuint nVertices;	// Number of vertices for the mesh
 		GLuint nIndices;    // Number of indices for the mesh
+		GLint baseVertex;   // First vertex of the mesh in the shared vertex buffer
+		GLuint firstIndex;  // First index of the mesh in the shared index buffer
+		glm::vec3 boundsMin;    // Object space bounding box
+		glm::vec3 boundsMax;
+		glm::vec3 sphereCenter; // Object space bounding sphere
+		float sphereRadius;
+		GLDrawRange ranges[3];	// Draw commands that render the whole mesh
+		GLuint nRanges;     // Number of valid entries in ranges
+		GLMeshLod lods[MAX_LODS];   // Detail levels, finest first; lods[0] is the mesh itself
+		GLuint nLods;       // Number of valid entries in lods
+		glm::vec3 positionOffset;   // Stored positions decode to positionOffset + positionScale * stored,
+		float positionScale;        // (0, 1) unless the vertices are packed
 	};
 
-public:
+	// Floats per interleaved vertex: position, normal, texture coordinate
+	static const GLuint FLOATS_PER_VERTEX = 8;
+	// Floats per vertex of the position-only stream read by depth-only passes
+	static const GLuint FLOATS_PER_POSITION = 3;
+	// The interleaved vertex as ComputeNormals() sees it, without tangents
+	static const GeometryLayout VERTEX_LAYOUT;
+
+	// Unit normal of the counter-clockwise triangle p0 p1 p2, zero when it has no area
+	static glm::vec3 CalculateTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
+
+	// Post-transform cache figures of every mesh and detail level in the pool,
+	// with the triangles in the order the generators emit them and after
+	// OptimizeVertexCache(); divide by triangles for the ACMR
+	struct MeshStats
+	{
+		GLuint meshes;              // Meshes and detail levels added to the pool
+		GLuint vertices;
+		GLuint triangles;
+		unsigned long missesBefore; // Vertices transformed by a VERTEX_CACHE_SIZE FIFO cache
+		unsigned long missesAfter;
+		GLuint sourceVertices;      // Vertices handed in before welding
+		size_t vertexBytes;         // Uploaded, both streams
+		size_t indexBytes;
+		MeshCacheStatus cache;      // How the cooked file was found, when there is one
+		bool cooked;                // The meshes were generated and the file written again
+	};
+
+	// Vertex count of one mesh or detail level before and after welding
+	struct MeshWeld
+	{
+		std::string name;
+		GLuint sourceVertices;
+		GLuint vertices;
+		GLuint triangles;
+	};
+
+	MeshStats stats = {};
+	// One entry per mesh and detail level, in the order they were added to the pool
+	std::vector<MeshWeld> weldReport;
+
+	// Bumped whenever a generator, a hand written table, the welding or the
+	// reordering change what gets uploaded, so older cooked files are cooked again
+	static const GLuint MESH_COOK_VERSION = 1;
+
+	// Resolution of the built-in cone, cylinders, sphere and torus
+	static const GLuint DEFAULT_SEGMENTS = 36;
+	static const GLuint DEFAULT_SPHERE_SEGMENTS = 16;
+	static const GLuint DEFAULT_SPHERE_RINGS = 16;
+	static const GLuint DEFAULT_TORUS_SEGMENTS = 30;
+	static const GLuint DEFAULT_TORUS_RINGS = 30;
+
 	GLMesh gBoxMesh;
 	GLMesh gConeMesh;
 	GLMesh gCylinderMesh;
@@ -40,19 +134,99 @@ public:
 	void CreateMeshes();
 	void DestroyMeshes();
 
+	// Have CreateMeshes() store the vertices in the 16 byte PackedVertex layout, with
+	// 16-bit indices when every mesh has few enough vertices. The vertex shaders
+	// must decode the octahedral normals (see vertexformat.h).
+	void SetPackedVertices(bool packed) { mPacked = packed; }
+	bool PackedVertices() const { return mPacked; }
+
+	// Have CreateMeshes() upload the meshes from the cooked file at path when it was
+	// cooked with the same parameters, and generate and cook them into it otherwise.
+	// recook skips the load. Without a path the meshes are generated every time.
+	void SetCachePath(const std::string& path, bool recook = false) { mCachePath = path; mRecook = recook; }
+	const std::string& CachePath() const { return mCachePath; }
+
+	// Have CreateMeshes() also build type at this resolution, so an object can use
+	// fewer vertices than the built-in mesh. Requests after CreateMeshes() are ignored.
+	void RequestPrimitive(PrimitiveType type, GLuint segments, GLuint rings);
+	// Mesh of a requested resolution, the built-in mesh of the type for any other
+	const GLMesh& GetPrimitive(PrimitiveType type, GLuint segments, GLuint rings) const;
+
+	// Shared VAO that every mesh is drawn from
+	GLuint GetVao() const { return mPoolVao; }
+	// Same vertices and indices, but only the positions are fetched
+	GLuint GetDepthVao() const { return mDepthVao; }
+	// GL_UNSIGNED_INT or GL_UNSIGNED_SHORT, the type of the shared index buffer
+	GLenum GetIndexType() const { return mIndexType; }
+	GLsizei GetIndexSize() const { return mIndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+
 private:
 	void UCreatePlaneMesh(GLMesh& mesh);
 	void UCreatePrismMesh(GLMesh& mesh);
 	void UCreateBoxMesh(GLMesh& mesh);
-	void UCreateConeMesh(GLMesh& mesh);
-	void UCreateCylinderMesh(GLMesh& mesh);
-	void UCreateTaperedCylinderMesh(GLMesh& mesh);
-	void UCreateTorusMesh(GLMesh& mesh);
 	void UCreatePyramid3Mesh(GLMesh& mesh);
 	void UCreatePyramid4Mesh(GLMesh& mesh);
-	void UCreateSphereMesh(GLMesh& mesh);
+	void UCreatePrimitiveMesh(GLMesh& mesh, PrimitiveType type, GLuint segments, GLuint rings);
+
+	static uint64_t UPrimitiveKey(PrimitiveType type, GLuint segments, GLuint rings);
+
+	void USetDrawRange(GLMesh& mesh, GLenum mode, GLint first, GLsizei count, bool indexed);
+
+	void UAddToPool(GLMesh& mesh, const std::string& name, const GLfloat* verts, const GLuint* indices);
+
+	// Bytes of the shared buffers as they are uploaded
+	struct PoolStreams
+	{
+		const void* vertices;
+		size_t vertexBytes;
+		const void* positions;      // Position-only copy for the depth VAO
+		size_t positionBytes;
+		const void* indices;
+		size_t indexBytes;
+	};
+
+	// Streams UCookPool() had to build rather than point at the CPU copies
+	struct CookedPool
+	{
+		std::vector<unsigned char> vertices;
+		std::vector<unsigned char> positions;
+		std::vector<unsigned char> indices;
+	};
+
+	std::vector<GLMesh*> UAllMeshes();
+	PoolStreams UCookPool(CookedPool& storage);
+	void UUploadPool(const PoolStreams& streams);
+
+	uint64_t UCookKey() const;
+	bool ULoadCooked();
+	bool UWriteCooked(const PoolStreams& streams);
+
+	// One requested resolution of a round primitive
+	struct PrimitiveMesh
+	{
+		PrimitiveType type;
+		GLuint segments;
+		GLuint rings;
+		GLMesh mesh;
+	};
+
+	// Every requested resolution, each built once, keyed by UPrimitiveKey()
+	std::map<uint64_t, PrimitiveMesh> mPrimitives;
+
+	// CPU side copy of the shared geometry until it is uploaded
+	std::vector<GLfloat> mPoolVertices;
+	std::vector<GLuint> mPoolIndices;
+
+	bool mPacked = false;
+	std::string mCachePath;
+	bool mRecook = false;
+	GLenum mIndexType = GL_UNSIGNED_INT;
 
-	void UDestroyMesh(GLMesh& mesh);
+	GLuint mPoolVao = 0;
+	GLuint mPoolVbo = 0;
+	GLuint mPoolEbo = 0;
 
-	void CalculateTriangleNormal(glm::vec3 px, glm::vec3 py, glm::vec3 pz);
+	// De-interleaved copy of the positions, indexed by the same baseVertex/firstIndex
+	GLuint mDepthVao = 0;
+	GLuint mPositionVbo = 0;
 };
@@ -0,0 +1,468 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.cpp
+// ========
+// smooth normals and tangent frames of indexed triangle meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshgeometry.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "workerpool.h"
+
+namespace
+{
+	// Triangles and vertices per ParallelFor() chunk, the triangle grain a multiple of 4
+	const GLuint TRIANGLE_GRAIN = 4096;
+	const GLuint VERTEX_GRAIN = 4096;
+	// Floats kept per vertex or corner: a normal as xyz0, or a tangent and a bitangent
+	const size_t FLOATS_PER_NORMAL = 4;
+	const size_t FLOATS_PER_FRAME = 8;
+
+	// Attributes of the vertices of one call
+	struct VertexArray
+	{
+		unsigned char* base;
+		const GeometryLayout* layout;
+
+		float* Get(uint32_t vertex, size_t offset) const { return (float*)(base + (size_t)vertex * layout->stride + offset); }
+	};
+
+	// Corners around every vertex, packed: the corners of v are
+	// corners[first[v]] to corners[first[v + 1] - 1], corner i being indices[i]
+	struct CornerAdjacency
+	{
+		std::vector<uint32_t> first;
+		std::vector<uint32_t> corners;
+	};
+
+	void UBuildCorners(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, CornerAdjacency& adjacency)
+	{
+		adjacency.first.assign((size_t)vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency.first[indices[i] + 1]++;
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			adjacency.first[v + 1] += adjacency.first[v];
+
+		std::vector<uint32_t> fill(adjacency.first.begin(), adjacency.first.end() - 1);
+		adjacency.corners.resize(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency.corners[fill[indices[i]]++] = (uint32_t)i;
+	}
+
+	// xyz0 of a 3 float attribute
+	__m128 ULoad3(const float* source)
+	{
+		return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)source)), _mm_load_ss(source + 2));
+	}
+
+	// xy00 of a 2 float attribute
+	__m128 ULoad2(const float* source)
+	{
+		return _mm_castpd_ps(_mm_load_sd((const double*)source));
+	}
+
+	///////////////////////////////////////////////////
+	//	UGather(...)
+	//
+	//	Load COMPONENTS floats at offset of the given
+	//	corner of triangles first to first + 3 into
+	//	one register per component. Lanes past last
+	//	repeat it, their results are never stored.
+	///////////////////////////////////////////////////
+	template <int COMPONENTS>
+	void UGather(const VertexArray& vertices, const uint32_t* indices, uint32_t first, uint32_t last, uint32_t corner, size_t offset, __m128* out)
+	{
+		__m128 rows[4];
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			const uint32_t t = std::min(first + lane, last);
+			const float* attribute = vertices.Get(indices[(size_t)t * 3 + corner], offset);
+			rows[lane] = COMPONENTS == 3 ? ULoad3(attribute) : ULoad2(attribute);
+		}
+		_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+		for (int c = 0; c < COMPONENTS; ++c)
+			out[c] = rows[c];
+	}
+
+	// Turn x, y and z lanes into one xyz0 row per lane
+	void UTranspose(__m128 x, __m128 y, __m128 z, __m128* rows)
+	{
+		__m128 w = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		rows[0] = x;
+		rows[1] = y;
+		rows[2] = z;
+		rows[3] = w;
+	}
+
+	// Dot products of the vectors in a and b, one per lane
+	inline __m128 UDot(const __m128* a, const __m128* b)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+	}
+
+	// Remove from value its component along the unit vectors normal
+	inline void UProject(__m128* value, const __m128* normal)
+	{
+		const __m128 along = UDot(normal, value);
+		for (int c = 0; c < 3; ++c)
+			value[c] = _mm_sub_ps(value[c], _mm_mul_ps(normal[c], along));
+	}
+
+	// 1 / sqrt(x) to about 22 bits: the estimate and one Newton-Raphson step, e * (1.5 - 0.5 * x * e * e)
+	__m128 UReciprocalSqrt(__m128 x)
+	{
+		const __m128 estimate = _mm_rsqrt_ps(x);
+		const __m128 halfX = _mm_mul_ps(x, _mm_set1_ps(0.5f));
+		return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(halfX, _mm_mul_ps(estimate, estimate))));
+	}
+
+	// Scale the vectors of value by scale over their length, lanes where the length or keep is zero become zero
+	inline void UNormalize(__m128* value, __m128 scale, __m128 keep)
+	{
+		const __m128 length2 = UDot(value, value);
+		const __m128 valid = _mm_and_ps(keep, _mm_cmpgt_ps(length2, _mm_setzero_ps()));
+		const __m128 factor = _mm_and_ps(_mm_mul_ps(scale, UReciprocalSqrt(length2)), valid);
+		for (int c = 0; c < 3; ++c)
+			value[c] = _mm_mul_ps(value[c], factor);
+	}
+
+	// Arc cosine of x in [-1, 1], Abramowitz and Stegun 4.4.45, within 7e-5 radians
+	__m128 UArcCos(__m128 x)
+	{
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 magnitude = _mm_andnot_ps(signBit, x);
+		__m128 poly = _mm_set1_ps(-0.0187293f);
+		poly = _mm_add_ps(_mm_mul_ps(poly, magnitude), _mm_set1_ps(0.0742610f));
+		poly = _mm_add_ps(_mm_mul_ps(poly, magnitude), _mm_set1_ps(-0.2121144f));
+		poly = _mm_add_ps(_mm_mul_ps(poly, magnitude), _mm_set1_ps(1.5707288f));
+		const __m128 angle = _mm_mul_ps(poly, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), magnitude)));
+
+		// acos(-x) = pi - acos(x)
+		const __m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+		return _mm_or_ps(_mm_andnot_ps(negative, angle), _mm_and_ps(negative, _mm_sub_ps(_mm_set1_ps(3.14159265f), angle)));
+	}
+
+	void UStore3(__m128 value, float* target)
+	{
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, value);
+		target[0] = lanes[0];
+		target[1] = lanes[1];
+		target[2] = lanes[2];
+	}
+
+	// Dot product in every lane of two xyz0 rows
+	__m128 URowDot(__m128 a, __m128 b)
+	{
+		__m128 sum = _mm_mul_ps(a, b);
+		sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	}
+
+	// a.yzx * b.zxy - a.zxy * b.yzx of two xyz0 rows, with one shuffle of each input
+	__m128 URowCross(__m128 a, __m128 b)
+	{
+		const __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		const __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		const __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	// Unit length row, or zero for a zero vector
+	__m128 URowNormalize(__m128 value)
+	{
+		const __m128 length2 = URowDot(value, value);
+		const __m128 valid = _mm_cmpgt_ps(length2, _mm_setzero_ps());
+		return _mm_and_ps(_mm_div_ps(value, _mm_sqrt_ps(length2)), valid);
+	}
+
+	// Add rows to target, count floats apart
+	void UAccumulate(float* target, const __m128* rows, size_t count)
+	{
+		for (size_t r = 0; r < count; ++r)
+			_mm_storeu_ps(target + r * 4, _mm_add_ps(_mm_loadu_ps(target + r * 4), rows[r]));
+	}
+
+	// Cross product of the edges of triangle t as an xyz0 row
+	__m128 UFaceNormal(const VertexArray& vertices, const uint32_t* indices, uint32_t t)
+	{
+		const size_t position = vertices.layout->position;
+		const uint32_t* triangle = indices + (size_t)t * 3;
+		const __m128 p0 = ULoad3(vertices.Get(triangle[0], position));
+		const __m128 p1 = ULoad3(vertices.Get(triangle[1], position));
+		const __m128 p2 = ULoad3(vertices.Get(triangle[2], position));
+		return URowCross(_mm_sub_ps(p1, p0), _mm_sub_ps(p2, p0));
+	}
+
+	///////////////////////////////////////////////////
+	//	UCornerFrames(...)
+	//
+	//	What the corners of triangles t to t + 3 add
+	//	to the frames of their vertices, the way
+	//	MikkTSpace weighs them. The face tangent and
+	//	bitangent are normalized and flipped when the
+	//	texture space area is negative; each corner
+	//	projects them into the plane of its vertex
+	//	normal, normalizes them again and scales them
+	//	by the angle its edges make in that plane.
+	//	Lane l, corner k goes to rows[(l * 3 + k) * 2]
+	//	and rows[(l * 3 + k) * 2 + 1]. A face without
+	//	texture space area adds nothing.
+	///////////////////////////////////////////////////
+	void UCornerFrames(const VertexArray& vertices, const uint32_t* indices, uint32_t t, uint32_t last, __m128* rows)
+	{
+		const GeometryLayout& layout = *vertices.layout;
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		__m128 p[3][3], uv[3][2], n[3][3];
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			UGather<3>(vertices, indices, t, last, k, layout.position, p[k]);
+			UGather<2>(vertices, indices, t, last, k, layout.texCoord, uv[k]);
+			UGather<3>(vertices, indices, t, last, k, layout.normal, n[k]);
+			UNormalize(n[k], one, _mm_cmpeq_ps(zero, zero));
+		}
+
+		const __m128 du1 = _mm_sub_ps(uv[1][0], uv[0][0]);
+		const __m128 dv1 = _mm_sub_ps(uv[1][1], uv[0][1]);
+		const __m128 du2 = _mm_sub_ps(uv[2][0], uv[0][0]);
+		const __m128 dv2 = _mm_sub_ps(uv[2][1], uv[0][1]);
+		const __m128 area = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(dv1, du2));
+		const __m128 sign = _mm_or_ps(_mm_and_ps(area, _mm_set1_ps(-0.0f)), one);
+		const __m128 hasArea = _mm_cmpneq_ps(area, zero);
+
+		__m128 faceTangent[3], faceBitangent[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			const __m128 e1 = _mm_sub_ps(p[1][c], p[0][c]);
+			const __m128 e2 = _mm_sub_ps(p[2][c], p[0][c]);
+			faceTangent[c] = _mm_sub_ps(_mm_mul_ps(e1, dv2), _mm_mul_ps(e2, dv1));
+			faceBitangent[c] = _mm_sub_ps(_mm_mul_ps(e2, du1), _mm_mul_ps(e1, du2));
+		}
+		UNormalize(faceTangent, sign, hasArea);
+		UNormalize(faceBitangent, sign, hasArea);
+
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			__m128 edge1[3], edge2[3], tangent[3], bitangent[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				edge1[c] = _mm_sub_ps(p[(k + 1) % 3][c], p[k][c]);
+				edge2[c] = _mm_sub_ps(p[(k + 2) % 3][c], p[k][c]);
+				tangent[c] = faceTangent[c];
+				bitangent[c] = faceBitangent[c];
+			}
+			UProject(edge1, n[k]);
+			UProject(edge2, n[k]);
+			UProject(tangent, n[k]);
+			UProject(bitangent, n[k]);
+			UNormalize(tangent, one, hasArea);
+			UNormalize(bitangent, one, hasArea);
+
+			const __m128 lengths = _mm_mul_ps(UDot(edge1, edge1), UDot(edge2, edge2));
+			const __m128 hasAngle = _mm_cmpgt_ps(lengths, zero);
+			__m128 cosine = _mm_mul_ps(UDot(edge1, edge2), UReciprocalSqrt(lengths));
+			cosine = _mm_min_ps(_mm_max_ps(cosine, _mm_set1_ps(-1.0f)), one);
+			const __m128 angle = _mm_and_ps(UArcCos(cosine), hasAngle);
+
+			__m128 tangentRows[4], bitangentRows[4];
+			UTranspose(_mm_mul_ps(tangent[0], angle), _mm_mul_ps(tangent[1], angle), _mm_mul_ps(tangent[2], angle), tangentRows);
+			UTranspose(_mm_mul_ps(bitangent[0], angle), _mm_mul_ps(bitangent[1], angle), _mm_mul_ps(bitangent[2], angle), bitangentRows);
+			for (uint32_t lane = 0; lane < 4; ++lane)
+			{
+				rows[(lane * 3 + k) * 2] = tangentRows[lane];
+				rows[(lane * 3 + k) * 2 + 1] = bitangentRows[lane];
+			}
+		}
+	}
+
+	// Normalize the summed face normals of v into its normal, unless they cancel out
+	void UFinishNormal(const VertexArray& vertices, uint32_t v, __m128 sum)
+	{
+		const __m128 length2 = URowDot(sum, sum);
+		if (_mm_cvtss_f32(length2) > 0.0f)
+			UStore3(_mm_div_ps(sum, _mm_sqrt_ps(length2)), vertices.Get(v, vertices.layout->normal));
+	}
+
+	///////////////////////////////////////////////////
+	//	UFinishFrame(...)
+	//
+	//	Orthogonalize the summed corner tangents of v
+	//	against its normal once more, since the sum of
+	//	vectors in the plane drifts off it by rounding,
+	//	and take the handedness from the side the
+	//	summed bitangents are on
+	///////////////////////////////////////////////////
+	void UFinishFrame(const VertexArray& vertices, uint32_t v, __m128 tangentSum, __m128 bitangentSum)
+	{
+		const GeometryLayout& layout = *vertices.layout;
+		const __m128 normal = URowNormalize(ULoad3(vertices.Get(v, layout.normal)));
+
+		__m128 tangent = URowNormalize(_mm_sub_ps(tangentSum, _mm_mul_ps(normal, URowDot(normal, tangentSum))));
+		if (_mm_cvtss_f32(URowDot(tangent, tangent)) == 0.0f)
+		{
+			// no texture space derivatives: any direction in the plane
+			const float* n = vertices.Get(v, layout.normal);
+			const __m128 axis = n[0] < 0.9f && n[0] > -0.9f ? _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f) : _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+			tangent = URowNormalize(_mm_sub_ps(axis, _mm_mul_ps(normal, URowDot(normal, axis))));
+		}
+		UStore3(tangent, vertices.Get(v, layout.tangent));
+
+		if (layout.bitangent != NO_ATTRIBUTE)
+		{
+			__m128 bitangent = URowCross(normal, tangent);
+			if (_mm_cvtss_f32(URowDot(bitangent, bitangentSum)) < 0.0f)
+				bitangent = _mm_sub_ps(_mm_setzero_ps(), bitangent);
+			UStore3(bitangent, vertices.Get(v, layout.bitangent));
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	TriangleNormal(const float*, const float*, const float*, float*)
+//
+//	p0, p1, p2: corner positions, counter-clockwise
+//	normal: receives the 3 floats of the normal
+///////////////////////////////////////////////////
+void TriangleNormal(const float* p0, const float* p1, const float* p2, float* normal)
+{
+	const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+///////////////////////////////////////////////////
+//	ComputeNormals(...)
+//
+//	vertices: interleaved vertex data, normals written
+//	layout: where the position and normal are
+//	vertexCount: number of vertices
+//	indices: triangle list
+//	indexCount: number of indices, a multiple of 3
+//	pool: splits large meshes when not null
+//
+//	On one thread the face normals are added to
+//	their vertices as they are made. With a pool
+//	they are stored per face, and the vertex pass
+//	gathers them through the corner adjacency in
+//	the same triangle order, so both give the same
+//	bits.
+///////////////////////////////////////////////////
+void ComputeNormals(void* vertices, const GeometryLayout& layout, uint32_t vertexCount, const uint32_t* indices, size_t indexCount, WorkerPool* pool)
+{
+	const uint32_t triangleCount = (uint32_t)(indexCount / 3);
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	const VertexArray array = { (unsigned char*)vertices, &layout };
+	if (pool == nullptr || triangleCount < GEOMETRY_PARALLEL_TRIANGLES)
+	{
+		std::vector<float> sums((size_t)vertexCount * FLOATS_PER_NORMAL, 0.0f);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const __m128 normal = UFaceNormal(array, indices, t);
+			for (uint32_t k = 0; k < 3; ++k)
+				UAccumulate(&sums[(size_t)indices[(size_t)t * 3 + k] * FLOATS_PER_NORMAL], &normal, 1);
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			UFinishNormal(array, v, _mm_loadu_ps(&sums[(size_t)v * FLOATS_PER_NORMAL]));
+		return;
+	}
+
+	CornerAdjacency adjacency;
+	UBuildCorners(indices, (size_t)triangleCount * 3, vertexCount, adjacency);
+
+	std::vector<float> faces((size_t)triangleCount * FLOATS_PER_NORMAL);
+	pool->ParallelFor(triangleCount, TRIANGLE_GRAIN, [&](GLuint begin, GLuint end, GLuint) {
+		for (uint32_t t = begin; t < end; ++t)
+			_mm_storeu_ps(&faces[(size_t)t * FLOATS_PER_NORMAL], UFaceNormal(array, indices, t));
+	});
+
+	pool->ParallelFor(vertexCount, VERTEX_GRAIN, [&](GLuint begin, GLuint end, GLuint) {
+		for (uint32_t v = begin; v < end; ++v)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t a = adjacency.first[v]; a < adjacency.first[v + 1]; ++a)
+				sum = _mm_add_ps(sum, _mm_loadu_ps(&faces[(size_t)(adjacency.corners[a] / 3) * FLOATS_PER_NORMAL]));
+			UFinishNormal(array, v, sum);
+		}
+	});
+}
+
+///////////////////////////////////////////////////
+//	ComputeTangentFrames(...)
+//
+//	vertices: interleaved vertex data, tangents and
+//		bitangents written
+//	layout: where every attribute is
+//	vertexCount: number of vertices
+//	indices: triangle list
+//	indexCount: number of indices, a multiple of 3
+//	pool: splits large meshes when not null
+//
+//	Split the same way as ComputeNormals(), with
+//	the corner contributions stored per corner
+//	instead of per face.
+///////////////////////////////////////////////////
+void ComputeTangentFrames(void* vertices, const GeometryLayout& layout, uint32_t vertexCount, const uint32_t* indices, size_t indexCount, WorkerPool* pool)
+{
+	const uint32_t triangleCount = (uint32_t)(indexCount / 3);
+	if (vertexCount == 0)
+		return;
+
+	const VertexArray array = { (unsigned char*)vertices, &layout };
+	if (pool == nullptr || triangleCount < GEOMETRY_PARALLEL_TRIANGLES)
+	{
+		std::vector<float> sums((size_t)vertexCount * FLOATS_PER_FRAME, 0.0f);
+		for (uint32_t t = 0; t < triangleCount; t += 4)
+		{
+			__m128 rows[24];
+			UCornerFrames(array, indices, t, triangleCount - 1, rows);
+			for (uint32_t corner = 0; corner < std::min(triangleCount - t, 4u) * 3; ++corner)
+				UAccumulate(&sums[(size_t)indices[(size_t)t * 3 + corner] * FLOATS_PER_FRAME], &rows[corner * 2], 2);
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			UFinishFrame(array, v, _mm_loadu_ps(&sums[(size_t)v * FLOATS_PER_FRAME]), _mm_loadu_ps(&sums[(size_t)v * FLOATS_PER_FRAME + 4]));
+		return;
+	}
+
+	CornerAdjacency adjacency;
+	UBuildCorners(indices, (size_t)triangleCount * 3, vertexCount, adjacency);
+
+	std::vector<float> corners((size_t)triangleCount * 3 * FLOATS_PER_FRAME);
+	pool->ParallelFor(triangleCount, TRIANGLE_GRAIN, [&](GLuint begin, GLuint end, GLuint) {
+		for (uint32_t t = begin; t < end; t += 4)
+		{
+			__m128 rows[24];
+			UCornerFrames(array, indices, t, end - 1, rows);
+			for (uint32_t corner = 0; corner < std::min(end - t, 4u) * 3; ++corner)
+			{
+				_mm_storeu_ps(&corners[((size_t)t * 3 + corner) * FLOATS_PER_FRAME], rows[corner * 2]);
+				_mm_storeu_ps(&corners[((size_t)t * 3 + corner) * FLOATS_PER_FRAME + 4], rows[corner * 2 + 1]);
+			}
+		}
+	});
+
+	pool->ParallelFor(vertexCount, VERTEX_GRAIN, [&](GLuint begin, GLuint end, GLuint) {
+		for (uint32_t v = begin; v < end; ++v)
+		{
+			__m128 tangentSum = _mm_setzero_ps();
+			__m128 bitangentSum = _mm_setzero_ps();
+			for (uint32_t a = adjacency.first[v]; a < adjacency.first[v + 1]; ++a)
+			{
+				const float* corner = &corners[(size_t)adjacency.corners[a] * FLOATS_PER_FRAME];
+				tangentSum = _mm_add_ps(tangentSum, _mm_loadu_ps(corner));
+				bitangentSum = _mm_add_ps(bitangentSum, _mm_loadu_ps(corner + 4));
+			}
+			UFinishFrame(array, v, tangentSum, bitangentSum);
+		}
+	});
+}
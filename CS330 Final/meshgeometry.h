@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.h
+// ========
+// smooth normals and tangent frames of indexed triangle meshes
+//
+// Both kernels work on any interleaved vertex array described by a
+// GeometryLayout, so the Meshes pool vertices and the Vertex struct of
+// mesh.h go through the same code. The work is per triangle: the cross
+// product of two edges, which is twice the area long and so weights the
+// normal by area, or the tangent frame contributions of the three corners,
+// computed four triangles at a time with the triangles in the SSE lanes.
+// On one thread the results are added straight into per vertex sums. With
+// a WorkerPool and a large mesh they are stored per triangle or corner in
+// one ParallelFor() and summed per vertex in a second one, through the
+// list of corners around each vertex. Both add in triangle order, so the
+// bits do not depend on the thread count.
+//
+// The tangents follow MikkTSpace: per face tangent and bitangent scaled by
+// the sign of the texture space area, projected into the plane of the
+// vertex normal and weighted by the corner angle there, the arc cosine
+// being a polynomial good to 7e-5 radians. The bitangent written is
+// handedness * cross(normal, tangent), what a shader using MikkTSpace
+// normal maps rebuilds. Unlike MikkTSpace no vertices are split, so a
+// vertex on a mirrored UV seam takes the handedness of the larger side.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class WorkerPool;
+
+// Offset of an attribute the layout does not have
+const size_t NO_ATTRIBUTE = ~(size_t)0;
+
+// Byte offsets of the attributes of one vertex in an interleaved array.
+// Positions, normals, tangents and bitangents are 3 floats, texture
+// coordinates 2.
+struct GeometryLayout
+{
+	size_t stride;      // Bytes from one vertex to the next
+	size_t position;
+	size_t normal;
+	size_t texCoord;    // Only read by ComputeTangentFrames()
+	size_t tangent;     // Only written by ComputeTangentFrames()
+	size_t bitangent;   // NO_ATTRIBUTE to write the tangents only
+};
+
+// Meshes with fewer triangles are done on the calling thread even with a pool
+const uint32_t GEOMETRY_PARALLEL_TRIANGLES = 16384;
+
+// Cross product of the edges p0 p1 and p0 p2: the normal of the counter-clockwise
+// face, twice the triangle's area long
+void TriangleNormal(const float* p0, const float* p1, const float* p2, float* normal);
+
+// Write the area weighted average of the face normals around every vertex.
+// Vertices no triangle uses, or whose faces cancel out, keep their normal.
+void ComputeNormals(void* vertices, const GeometryLayout& layout, uint32_t vertexCount, const uint32_t* indices, size_t indexCount, WorkerPool* pool = nullptr);
+
+// Write the tangent, and the bitangent when the layout has one, of every vertex
+// from the normals already in the array and the texture coordinates. A vertex
+// without texture space derivatives gets some tangent perpendicular to its normal.
+void ComputeTangentFrames(void* vertices, const GeometryLayout& layout, uint32_t vertexCount, const uint32_t* indices, size_t indexCount, WorkerPool* pool = nullptr);
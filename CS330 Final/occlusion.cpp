@@ -0,0 +1,333 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusion.cpp
+// ========
+// CPU software occlusion culling against a small set of chosen occluders
+///////////////////////////////////////////////////////////////////////////////
+
+#include "occlusion.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <xmmintrin.h>
+
+namespace
+{
+	// Clip w below which a corner counts as behind the eye
+	const float MIN_W = 1e-3f;
+
+	// Two triangles per face of a box whose corner i has x, y, z from bits 0, 1, 2,
+	// wound counter-clockwise when seen from outside
+	const int BOX_TRIANGLES[12][3] = {
+		{ 0, 2, 3 }, { 0, 3, 1 },   // -z
+		{ 4, 5, 7 }, { 4, 7, 6 },   // +z
+		{ 0, 4, 6 }, { 0, 6, 2 },   // -x
+		{ 1, 3, 7 }, { 1, 7, 5 },   // +x
+		{ 0, 1, 5 }, { 0, 5, 4 },   // -y
+		{ 2, 6, 7 }, { 2, 7, 3 },   // +y
+	};
+
+	// Corner i of a box, see BOX_TRIANGLES
+	glm::vec3 UBoxCorner(glm::vec3 boxMin, glm::vec3 boxMax, int i)
+	{
+		return glm::vec3((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+	}
+}
+
+OcclusionCuller::OcclusionCuller()
+	: mViewProjection(1.0f),
+	mDepth(WIDTH * HEIGHT, 1.0f),
+	mTileMax(TILES_X * TILES_Y, 1.0f)
+{
+}
+
+///////////////////////////////////////////////////
+//	Render(const Scene&, const glm::mat4&, const unsigned char*)
+//
+//	scene: entities and their occluder proxies
+//	viewProjection: camera of the frame
+//	visible: frustum result, or null to use every
+//		occluder
+//
+//	Project every proxy box to screen triangles, then
+//	rasterize one band of tile rows per pool thread.
+//	The bands share no pixels, so no locking is
+//	needed.
+///////////////////////////////////////////////////
+void OcclusionCuller::Render(const Scene& scene, const glm::mat4& viewProjection, const unsigned char* visible)
+{
+	mViewProjection = viewProjection;
+	mTriangles.clear();
+	stats = {};
+
+	for (const SceneOccluder& occluder : scene.occluders)
+	{
+		if (visible != nullptr && !visible[occluder.entity])
+			continue;
+		UAddBox(scene.models[occluder.entity], occluder.boxMin, occluder.boxMax);
+	}
+	stats.triangles = (GLuint)mTriangles.size();
+
+	// every band walks every triangle, so make no more bands than there are threads
+	const GLuint tileRows = TILES_Y;
+	const GLuint threads = mPool != nullptr ? mPool->ThreadCount() : 1;
+	const GLuint tileRowsPerBand = (tileRows + threads - 1) / threads;
+	const auto rasterize = [this](GLuint begin, GLuint end, GLuint) {
+		URasterizeBand((int)begin * TILE_SIZE, (int)end * TILE_SIZE);
+	};
+
+	if (mPool != nullptr)
+		mPool->ParallelFor(tileRows, tileRowsPerBand, rasterize);
+	else
+		rasterize(0, tileRows, 0);
+}
+
+///////////////////////////////////////////////////
+//	Cull(const Scene&, std::vector<unsigned char>&)
+//
+//	scene: entities whose world boxes are tested
+//	visible: frustum result, updated in place
+///////////////////////////////////////////////////
+void OcclusionCuller::Cull(const Scene& scene, std::vector<unsigned char>& visible)
+{
+	// an occluder proxy sits inside its own entity, which must never hide itself
+	std::vector<unsigned char> isOccluder(scene.Count(), 0);
+	for (const SceneOccluder& occluder : scene.occluders)
+		isOccluder[occluder.entity] = 1;
+
+	for (size_t i = 0; i < scene.Count(); ++i)
+	{
+		if (!visible[i] || isOccluder[i])
+			continue;
+
+		stats.tested++;
+		if (!TestBox(scene.boundsMin[i], scene.boundsMax[i]))
+		{
+			visible[i] = 0;
+			stats.occluded++;
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	TestBox(glm::vec3, glm::vec3)
+//
+//	boxMin, boxMax: world space box
+//
+//	Find the screen rectangle and nearest depth of
+//	the box, then look for any pixel under the
+//	rectangle that is farther than that depth. Tiles
+//	whose farthest depth is nearer are skipped whole.
+//	Boxes crossing the eye plane are always visible.
+///////////////////////////////////////////////////
+bool OcclusionCuller::TestBox(glm::vec3 boxMin, glm::vec3 boxMax) const
+{
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+	for (int i = 0; i < 8; ++i)
+	{
+		const glm::vec4 clip = mViewProjection * glm::vec4(UBoxCorner(boxMin, boxMax, i), 1.0f);
+		if (clip.w < MIN_W)
+			return true;
+
+		const float x = (clip.x / clip.w * 0.5f + 0.5f) * WIDTH;
+		const float y = (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z / clip.w * 0.5f + 0.5f);
+	}
+
+	// every pixel the rectangle touches
+	const int x0 = std::max(0, (int)std::floor(minX));
+	const int x1 = std::min(WIDTH - 1, (int)std::ceil(maxX));
+	const int y0 = std::max(0, (int)std::floor(minY));
+	const int y1 = std::min(HEIGHT - 1, (int)std::ceil(maxY));
+	// off screen is the frustum culler's call
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	const __m128 nearest = _mm_set1_ps(minZ);
+	const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+	for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ++ty)
+	{
+		for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; ++tx)
+		{
+			if (mTileMax[ty * TILES_X + tx] < minZ)
+				continue;
+
+			const int rowStart = std::max(y0, ty * TILE_SIZE);
+			const int rowEnd = std::min(y1, ty * TILE_SIZE + TILE_SIZE - 1);
+			const int colStart = std::max(x0, tx * TILE_SIZE);
+			const int colEnd = std::min(x1, tx * TILE_SIZE + TILE_SIZE - 1);
+
+			// lanes outside [colStart, colEnd] are masked off
+			const __m128 laneMin = _mm_set1_ps((float)colStart);
+			const __m128 laneMax = _mm_set1_ps((float)colEnd);
+			for (int y = rowStart; y <= rowEnd; ++y)
+			{
+				const float* row = &mDepth[y * WIDTH];
+				for (int x = colStart & ~3; x <= colEnd; x += 4)
+				{
+					const __m128 column = _mm_add_ps(_mm_set1_ps((float)x), lane);
+					const __m128 inside = _mm_and_ps(_mm_cmpge_ps(column, laneMin), _mm_cmple_ps(column, laneMax));
+					const __m128 farther = _mm_cmpge_ps(_mm_loadu_ps(row + x), nearest);
+					if (_mm_movemask_ps(_mm_and_ps(inside, farther)) != 0)
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////
+//	UAddBox(const glm::mat4&, glm::vec3, glm::vec3)
+//
+//	model: world matrix of the occluding entity
+//	boxMin, boxMax: proxy box in object space
+//
+//	Project the proxy to buffer pixels and keep its
+//	front facing triangles. A proxy that crosses the
+//	eye plane is dropped, which only loses occlusion.
+///////////////////////////////////////////////////
+void OcclusionCuller::UAddBox(const glm::mat4& model, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+	const glm::mat4 toClip = mViewProjection * model;
+
+	glm::vec3 screen[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		const glm::vec4 clip = toClip * glm::vec4(UBoxCorner(boxMin, boxMax, i), 1.0f);
+		if (clip.w < MIN_W)
+			return;
+		screen[i] = glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * WIDTH, (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT, clip.z / clip.w * 0.5f + 0.5f);
+	}
+
+	// a mirroring model matrix turns the winding around
+	const glm::vec3 c0(model[0]), c1(model[1]), c2(model[2]);
+	const float facing = glm::dot(glm::cross(c0, c1), c2) < 0.0f ? -1.0f : 1.0f;
+
+	stats.occluders++;
+	for (const int* corners : BOX_TRIANGLES)
+	{
+		ScreenTriangle tri;
+		for (int v = 0; v < 3; ++v)
+		{
+			tri.x[v] = screen[corners[v]].x;
+			tri.y[v] = screen[corners[v]].y;
+			tri.z[v] = screen[corners[v]].z;
+		}
+
+		const float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+		if (area * facing <= 0.0f)
+			continue;
+		if (facing < 0.0f)
+		{
+			std::swap(tri.x[1], tri.x[2]);
+			std::swap(tri.y[1], tri.y[2]);
+			std::swap(tri.z[1], tri.z[2]);
+		}
+
+		tri.minX = std::max(0, (int)std::floor(std::min(tri.x[0], std::min(tri.x[1], tri.x[2]))));
+		tri.maxX = std::min(WIDTH - 1, (int)std::ceil(std::max(tri.x[0], std::max(tri.x[1], tri.x[2]))));
+		tri.minY = std::max(0, (int)std::floor(std::min(tri.y[0], std::min(tri.y[1], tri.y[2]))));
+		tri.maxY = std::min(HEIGHT - 1, (int)std::ceil(std::max(tri.y[0], std::max(tri.y[1], tri.y[2]))));
+		if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+			continue;
+
+		mTriangles.push_back(tri);
+	}
+}
+
+///////////////////////////////////////////////////
+//	URasterizeBand(int, int)
+//
+//	firstRow, endRow: rows [firstRow, endRow) of
+//		the buffer, whole tile rows
+//
+//	Clear the band, rasterize every triangle that
+//	overlaps it 4 pixels at a time keeping the
+//	nearest depth, then refresh the tile maxima
+///////////////////////////////////////////////////
+void OcclusionCuller::URasterizeBand(int firstRow, int endRow)
+{
+	std::fill(mDepth.begin() + firstRow * WIDTH, mDepth.begin() + endRow * WIDTH, 1.0f);
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 laneOffset = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+	for (const ScreenTriangle& tri : mTriangles)
+	{
+		const int rowStart = std::max(tri.minY, firstRow);
+		const int rowEnd = std::min(tri.maxY, endRow - 1);
+		if (rowStart > rowEnd)
+			continue;
+
+		// edge functions a * x + b * y + c, positive inside a counter-clockwise triangle
+		__m128 a[3], b[3], c[3];
+		for (int e = 0; e < 3; ++e)
+		{
+			const int n = (e + 1) % 3;
+			const float ea = tri.y[e] - tri.y[n];
+			const float eb = tri.x[n] - tri.x[e];
+			a[e] = _mm_set1_ps(ea);
+			b[e] = _mm_set1_ps(eb);
+			c[e] = _mm_set1_ps(-(ea * tri.x[e] + eb * tri.y[e]));
+		}
+
+		// depth plane through the three vertices
+		const float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+		const float dzdx = ((tri.z[1] - tri.z[0]) * (tri.y[2] - tri.y[0]) - (tri.z[2] - tri.z[0]) * (tri.y[1] - tri.y[0])) / area;
+		const float dzdy = ((tri.x[1] - tri.x[0]) * (tri.z[2] - tri.z[0]) - (tri.x[2] - tri.x[0]) * (tri.z[1] - tri.z[0])) / area;
+		const __m128 zdx = _mm_set1_ps(dzdx);
+		const __m128 zBase = _mm_set1_ps(tri.z[0] - dzdx * tri.x[0] - dzdy * tri.y[0]);
+
+		for (int y = rowStart; y <= rowEnd; ++y)
+		{
+			const __m128 py = _mm_set1_ps(y + 0.5f);
+			const __m128 rowZ = _mm_add_ps(zBase, _mm_mul_ps(_mm_set1_ps(dzdy), py));
+			__m128 rowEdge[3];
+			for (int e = 0; e < 3; ++e)
+				rowEdge[e] = _mm_add_ps(_mm_mul_ps(b[e], py), c[e]);
+
+			float* row = &mDepth[y * WIDTH];
+			for (int x = tri.minX & ~3; x <= tri.maxX; x += 4)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a[0], px), rowEdge[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a[1], px), rowEdge[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a[2], px), rowEdge[2]), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				const __m128 z = _mm_add_ps(rowZ, _mm_mul_ps(zdx, px));
+				const __m128 depth = _mm_loadu_ps(row + x);
+				const __m128 nearer = _mm_min_ps(depth, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+			}
+		}
+	}
+
+	for (int ty = firstRow / TILE_SIZE; ty < endRow / TILE_SIZE; ++ty)
+	{
+		for (int tx = 0; tx < TILES_X; ++tx)
+		{
+			__m128 farthest = _mm_setzero_ps();
+			for (int y = ty * TILE_SIZE; y < ty * TILE_SIZE + TILE_SIZE; ++y)
+			{
+				const float* row = &mDepth[y * WIDTH + tx * TILE_SIZE];
+				for (int x = 0; x < TILE_SIZE; x += 4)
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(row + x));
+			}
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, farthest);
+			mTileMax[ty * TILES_X + tx] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+		}
+	}
+}
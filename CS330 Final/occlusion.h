@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusion.h
+// ========
+// CPU software occlusion culling against a small set of chosen occluders
+//
+// Occluder proxies (boxes that fit inside big solid props such as the amps
+// and the heater) are rasterized with SSE into a low resolution depth
+// buffer. Each entity's world box is then projected to a screen rectangle
+// with its nearest depth, and the entity is culled when every pixel under
+// that rectangle already holds something nearer. A per-tile maximum depth
+// lets most rectangles be rejected or accepted without touching pixels.
+//
+// The buffer is split into horizontal bands of whole tiles, one per thread of
+// the WorkerPool, and each band is rasterized by its own job. Nothing here
+// touches OpenGL.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "scene.h"
+#include "workerpool.h"
+
+// Counters describing the last occlusion pass
+struct OcclusionStats
+{
+	GLuint occluders;   // Occluder proxies rasterized
+	GLuint triangles;   // Front facing proxy triangles rasterized
+	GLuint tested;      // Entities tested against the depth buffer
+	GLuint occluded;    // Entities found hidden
+};
+
+class OcclusionCuller
+{
+	// Proxy triangle in buffer pixels, depth in [0, 1]
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		int minX, maxX;
+		int minY, maxY;
+	};
+
+public:
+	// Depth buffer size in pixels, 4:3 like the window; both multiples of TILE_SIZE
+	static const int WIDTH = 256;
+	static const int HEIGHT = 192;
+	// Square tile with a single conservative (farthest) depth
+	static const int TILE_SIZE = 16;
+	static const int TILES_X = WIDTH / TILE_SIZE;
+	static const int TILES_Y = HEIGHT / TILE_SIZE;
+
+	OcclusionStats stats = {};
+
+public:
+	OcclusionCuller();
+
+	// Bands are rasterized on the pool when one is set, as one band otherwise
+	void SetWorkerPool(WorkerPool* pool) { mPool = pool; }
+
+	// Clear the buffer and rasterize the scene's occluders whose entity is flagged
+	// visible (all of them when visible is null)
+	void Render(const Scene& scene, const glm::mat4& viewProjection, const unsigned char* visible);
+
+	// Clear visible[i] for every entity hidden behind the occluders. Occluders themselves
+	// are kept, as are entities already culled.
+	void Cull(const Scene& scene, std::vector<unsigned char>& visible);
+
+	// True when some part of the world box may be seen
+	bool TestBox(glm::vec3 boxMin, glm::vec3 boxMax) const;
+
+	// Row-major depth values, row 0 at the bottom of the view
+	const float* Depth() const { return mDepth.data(); }
+
+private:
+	void UAddBox(const glm::mat4& model, glm::vec3 boxMin, glm::vec3 boxMax);
+	void URasterizeBand(int firstRow, int endRow);
+
+	glm::mat4 mViewProjection;
+	WorkerPool* mPool = nullptr;
+
+	std::vector<float> mDepth;              // WIDTH * HEIGHT
+	std::vector<float> mTileMax;            // TILES_X * TILES_Y, farthest depth in each tile
+	std::vector<ScreenTriangle> mTriangles;
+};
@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionqueries.cpp
+// ========
+// GPU occlusion queries on entity bounding boxes, consumed a frame or more late
+///////////////////////////////////////////////////////////////////////////////
+
+#include "occlusionqueries.h"
+
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "glstate.h"
+#include "programreflection.h"
+
+namespace
+{
+	// Corner i of the unit box has x, y, z from bits 0, 1, 2
+	const GLfloat BOX_CORNERS[] = {
+		0.0f, 0.0f, 0.0f,   1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f,   1.0f, 0.0f, 1.0f,   0.0f, 1.0f, 1.0f,   1.0f, 1.0f, 1.0f,
+	};
+
+	// Two triangles per face, winding does not matter with face culling off
+	const GLuint BOX_INDICES[] = {
+		0, 2, 3,   0, 3, 1,     // -z
+		4, 5, 7,   4, 7, 6,     // +z
+		0, 4, 6,   0, 6, 2,     // -x
+		1, 3, 7,   1, 7, 5,     // +x
+		0, 1, 5,   0, 5, 4,     // -y
+		2, 6, 7,   2, 7, 3,     // +y
+	};
+
+	// Boxes the eye is this close to are drawn without a query, the near plane would clip them
+	const float EYE_MARGIN = 0.2f;
+}
+
+///////////////////////////////////////////////////
+//	Create()
+//
+//	Create the unit box drawn for every query
+///////////////////////////////////////////////////
+void OcclusionQueries::Create()
+{
+	glGenVertexArrays(1, &mBoxVao);
+	glGenBuffers(2, mBoxVbos);
+
+	GLState::BindVertexArray(mBoxVao);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, mBoxVbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BOX_CORNERS), BOX_CORNERS, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, 0);
+	glEnableVertexAttribArray(0);
+
+	GLState::BindElementBuffer(mBoxVao, mBoxVbos[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(BOX_INDICES), BOX_INDICES, GL_STATIC_DRAW);
+	GLState::BindVertexArray(0);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	mFrame = 0;
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Release the queries and the box buffers
+///////////////////////////////////////////////////
+void OcclusionQueries::Destroy()
+{
+	UResize(0);
+
+	GLState::DeleteVertexArrays(1, &mBoxVao);
+	GLState::DeleteBuffers(2, mBoxVbos);
+	mBoxVao = 0;
+	mBoxVbos[0] = mBoxVbos[1] = 0;
+}
+
+///////////////////////////////////////////////////
+//	Attach(GLuint)
+//
+//	program: linked and reflected box program
+///////////////////////////////////////////////////
+void OcclusionQueries::Attach(GLuint program)
+{
+	const ProgramReflection* reflection = ProgramReflection::Find(program);
+	if (reflection == NULL)
+		return;
+
+	mProgram = program;
+	mBoxMinLocation = reflection->Location("uBoxMin");
+	mBoxMaxLocation = reflection->Location("uBoxMax");
+}
+
+///////////////////////////////////////////////////
+//	BeginFrame(const Scene&, std::vector<unsigned char>&)
+//
+//	scene: entities about to be drawn
+//	visible: CPU culling result, updated in place
+//		in READBACK mode
+//
+//	Poll the oldest query set without waiting, then
+//	prepare the draw conditions from the previous
+//	frame's set
+///////////////////////////////////////////////////
+void OcclusionQueries::BeginFrame(const Scene& scene, std::vector<unsigned char>& visible)
+{
+	if (mHidden.size() != scene.Count())
+		UResize(scene.Count());
+
+	stats = {};
+	if (mode == OFF)
+		return;
+
+	// the set issued two frames ago is the one most likely to be answered
+	UPoll((mFrame + 1) % SETS);
+
+	// IssueQueries() must still test what READBACK hides below, or it would stay hidden
+	mCandidates = visible;
+
+	const GLuint previous = (mFrame + SETS - 1) % SETS;
+	for (size_t i = 0; i < visible.size(); ++i)
+	{
+		if (!visible[i])
+			continue;
+
+		if (mHidden[i])
+			stats.hidden++;
+
+		if (mode == CONDITIONAL)
+		{
+			mConditions[i] = mIssued[previous][i] ? mQueries[previous][i] : 0;
+			if (mConditions[i] == 0)
+				stats.unqueried++;
+		}
+		else if (mHidden[i])
+		{
+			visible[i] = 0;
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	Conditions()
+//
+//	Per-entity query to pass to SceneRenderer::Draw
+///////////////////////////////////////////////////
+const GLuint* OcclusionQueries::Conditions() const
+{
+	return mode == CONDITIONAL && !mConditions.empty() ? mConditions.data() : nullptr;
+}
+
+///////////////////////////////////////////////////
+//	IssueQueries(const Scene&, glm::vec3)
+//
+//	scene: entities just drawn
+//	eye: camera position in world space
+//
+//	Draw the world box of every candidate against
+//	the finished depth buffer inside its own query.
+//	Colour and depth writes are off, so the frame
+//	itself is left untouched. Box faces can lie in
+//	the surface they bound, like the floor's flat box,
+//	so GL_LEQUAL counts them as visible instead of
+//	leaving it to depth rounding.
+///////////////////////////////////////////////////
+void OcclusionQueries::IssueQueries(const Scene& scene, glm::vec3 eye)
+{
+	if (mode == OFF)
+	{
+		// answers from before the mode was switched off would be stale
+		for (GLuint s = 0; s < SETS; ++s)
+			std::fill(mIssued[s].begin(), mIssued[s].end(), 0);
+		std::fill(mHidden.begin(), mHidden.end(), 0);
+		return;
+	}
+
+	const GLuint current = mFrame % SETS;
+
+	GLState::UseProgram(mProgram);
+	GLState::BindVertexArray(mBoxVao);
+	GLState::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	GLState::DepthMask(GL_FALSE);
+	GLState::DepthFunc(GL_LEQUAL);
+
+	for (size_t i = 0; i < mCandidates.size(); ++i)
+	{
+		mIssued[current][i] = 0;
+		if (!mCandidates[i])
+		{
+			// nothing is known about it once it leaves the frustum
+			mHidden[i] = 0;
+			continue;
+		}
+
+		const glm::vec3 boxMin = scene.boundsMin[i];
+		const glm::vec3 boxMax = scene.boundsMax[i];
+		if (eye.x >= boxMin.x - EYE_MARGIN && eye.x <= boxMax.x + EYE_MARGIN &&
+			eye.y >= boxMin.y - EYE_MARGIN && eye.y <= boxMax.y + EYE_MARGIN &&
+			eye.z >= boxMin.z - EYE_MARGIN && eye.z <= boxMax.z + EYE_MARGIN)
+		{
+			mHidden[i] = 0;
+			continue;
+		}
+
+		glUniform3fv(mBoxMinLocation, 1, glm::value_ptr(boxMin));
+		glUniform3fv(mBoxMaxLocation, 1, glm::value_ptr(boxMax));
+		glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, mQueries[current][i]);
+		glDrawElements(GL_TRIANGLES, sizeof(BOX_INDICES) / sizeof(BOX_INDICES[0]), GL_UNSIGNED_INT, 0);
+		glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+
+		mIssued[current][i] = 1;
+		stats.issued++;
+	}
+
+	GLState::DepthFunc(GL_LESS);
+	GLState::DepthMask(GL_TRUE);
+	GLState::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	mFrame++;
+}
+
+///////////////////////////////////////////////////
+//	ModeName(Mode)
+///////////////////////////////////////////////////
+const char* OcclusionQueries::ModeName(Mode mode)
+{
+	switch (mode)
+	{
+	case CONDITIONAL:
+		return "conditional render";
+	case READBACK:
+		return "asynchronous readback";
+	default:
+		return "off";
+	}
+}
+
+///////////////////////////////////////////////////
+//	UResize(size_t)
+//
+//	count: entities in the scene
+//
+//	Replace every query object, all answers are lost
+///////////////////////////////////////////////////
+void OcclusionQueries::UResize(size_t count)
+{
+	for (GLuint s = 0; s < SETS; ++s)
+	{
+		if (!mQueries[s].empty())
+			glDeleteQueries((GLsizei)mQueries[s].size(), mQueries[s].data());
+
+		mQueries[s].assign(count, 0);
+		if (count > 0)
+			glGenQueries((GLsizei)count, mQueries[s].data());
+		mIssued[s].assign(count, 0);
+	}
+
+	mConditions.assign(count, 0);
+	mHidden.assign(count, 0);
+	mCandidates.assign(count, 0);
+}
+
+///////////////////////////////////////////////////
+//	UPoll(GLuint)
+//
+//	set: query set to read
+//
+//	Take every answer that has arrived; the rest
+//	keep the entity's previous state
+///////////////////////////////////////////////////
+void OcclusionQueries::UPoll(GLuint set)
+{
+	for (size_t i = 0; i < mQueries[set].size(); ++i)
+	{
+		if (!mIssued[set][i])
+			continue;
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(mQueries[set][i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			stats.pending++;
+			continue;
+		}
+
+		GLuint samplesPassed = 0;
+		glGetQueryObjectuiv(mQueries[set][i], GL_QUERY_RESULT, &samplesPassed);
+		mHidden[i] = samplesPassed == 0 ? 1 : 0;
+	}
+}
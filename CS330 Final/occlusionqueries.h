@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionqueries.h
+// ========
+// GPU occlusion queries on entity bounding boxes, consumed a frame or more late
+//
+// After the scene is drawn, the world box of every entity that survived the
+// CPU culling is drawn against the finished depth buffer inside a
+// GL_ANY_SAMPLES_PASSED_CONSERVATIVE query, with colour and depth writes
+// off. The next frames use those answers in one of two ways:
+//
+//	CONDITIONAL: each entity is drawn on its own inside
+//		glBeginConditionalRender(query, GL_QUERY_NO_WAIT), so the GPU skips
+//		it when its box was hidden last frame. The CPU never reads a result.
+//	READBACK: results are polled with GL_QUERY_RESULT_AVAILABLE and folded
+//		into the visibility flags, so batching is kept. A result that has not
+//		arrived yet leaves the entity's last known state in place.
+//
+// Queries live in a ring of SETS frames so a set is never re-issued while
+// the GPU may still be answering it. Nothing ever waits on a query.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "scene.h"
+
+// Counters describing the query traffic of the last frame
+struct QueryStats
+{
+	GLuint issued;      // Box queries issued this frame
+	GLuint unqueried;   // Entities drawn unconditionally (no answer yet, or camera inside the box)
+	GLuint hidden;      // Entities whose latest available answer was "hidden"
+	GLuint pending;     // Queries polled but not answered yet
+};
+
+class OcclusionQueries
+{
+public:
+	enum Mode { OFF, CONDITIONAL, READBACK, MODE_COUNT };
+
+	// Frames of queries kept in flight, matches PersistentRingBuffer::SEGMENTS
+	static const GLuint SETS = 3;
+
+	Mode mode = OFF;
+	QueryStats stats = {};
+
+public:
+	void Create();
+	void Destroy();
+
+	// Resolve the box program's uniforms, the program must declare FrameBlock
+	void Attach(GLuint program);
+
+	// Start a frame: in READBACK mode, clear visible[i] for entities whose latest
+	// answered query says hidden
+	void BeginFrame(const Scene& scene, std::vector<unsigned char>& visible);
+
+	// Query object per entity to condition its draw on, 0 to draw unconditionally.
+	// Null unless mode is CONDITIONAL.
+	const GLuint* Conditions() const;
+
+	// Issue this frame's box queries for every entity BeginFrame() was given as
+	// visible, after the scene has been drawn. Changes the program and VAO.
+	void IssueQueries(const Scene& scene, glm::vec3 eye);
+
+	static const char* ModeName(Mode mode);
+
+private:
+	void UResize(size_t count);
+	void UPoll(GLuint set);
+
+	GLuint mProgram = 0;
+	GLint mBoxMinLocation = -1;
+	GLint mBoxMaxLocation = -1;
+	GLuint mBoxVao = 0;
+	GLuint mBoxVbos[2] = {};
+
+	GLuint mFrame = 0;
+	std::vector<GLuint> mQueries[SETS];         // One query object per entity and set
+	std::vector<unsigned char> mIssued[SETS];   // The query was begun in that set's frame
+	std::vector<GLuint> mConditions;            // Query of the previous frame, 0 when none
+	std::vector<unsigned char> mHidden;         // Latest answer per entity
+	std::vector<unsigned char> mCandidates;     // Entities queried this frame
+};
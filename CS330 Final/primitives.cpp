@@ -0,0 +1,447 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitives.cpp
+// ========
+// parametric generators for the round primitives: cylinder, tapered
+// cylinder, cone, sphere and torus
+///////////////////////////////////////////////////////////////////////////////
+
+#include "primitives.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <emmintrin.h>
+
+namespace
+{
+	const float TWO_PI = 6.28318530717958647692f;
+	const float PI = 3.14159265358979323846f;
+
+	// Cephes single precision constants: pi/4 split in three parts for an exact
+	// range reduction, and the minimax polynomials on [-pi/4, pi/4]
+	const float FOUR_OVER_PI = 1.27323954473516f;
+	const float DP1 = 0.78515625f;
+	const float DP2 = 2.4187564849853515625e-4f;
+	const float DP3 = 3.77489497744594108e-8f;
+	const float SIN_P0 = -1.9515295891e-4f;
+	const float SIN_P1 = 8.3321608736e-3f;
+	const float SIN_P2 = -1.6666654611e-1f;
+	const float COS_P0 = 2.443315711809948e-5f;
+	const float COS_P1 = -1.388731625493765e-3f;
+	const float COS_P2 = 4.166664568298827e-2f;
+
+	///////////////////////////////////////////////////
+	//	USinCos4(__m128, __m128&, __m128&)
+	//
+	//	x: four angles in radians
+	//	s, c: receive the sines and cosines
+	//
+	//	Reduce each angle to an octant j and an offset
+	//	within +-pi/4, evaluate both polynomials and
+	//	pick per lane which one is the sine. The sign
+	//	of each result follows from j.
+	///////////////////////////////////////////////////
+	void USinCos4(__m128 x, __m128& s, __m128& c)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+		__m128 signSin = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		// octant, rounded up to even so the offset stays within +-pi/4
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		const __m128 y = _mm_cvtepi32_ps(j);
+
+		// octants 4 to 7 flip the sine, octants 2 to 5 flip the cosine
+		const __m128 flipSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+		const __m128 flipCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		// octants 2 and 6 swap the two polynomials
+		const __m128 sinPoly = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+		signSin = _mm_xor_ps(signSin, flipSin);
+
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+		const __m128 z = _mm_mul_ps(x, x);
+
+		__m128 cosine = _mm_set1_ps(COS_P0);
+		cosine = _mm_add_ps(_mm_mul_ps(cosine, z), _mm_set1_ps(COS_P1));
+		cosine = _mm_add_ps(_mm_mul_ps(cosine, z), _mm_set1_ps(COS_P2));
+		cosine = _mm_mul_ps(_mm_mul_ps(cosine, z), z);
+		cosine = _mm_sub_ps(cosine, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		cosine = _mm_add_ps(cosine, _mm_set1_ps(1.0f));
+
+		__m128 sine = _mm_set1_ps(SIN_P0);
+		sine = _mm_add_ps(_mm_mul_ps(sine, z), _mm_set1_ps(SIN_P1));
+		sine = _mm_add_ps(_mm_mul_ps(sine, z), _mm_set1_ps(SIN_P2));
+		sine = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sine, z), x), x);
+
+		s = _mm_or_ps(_mm_and_ps(sinPoly, sine), _mm_andnot_ps(sinPoly, cosine));
+		c = _mm_or_ps(_mm_and_ps(sinPoly, cosine), _mm_andnot_ps(sinPoly, sine));
+		s = _mm_xor_ps(s, signSin);
+		c = _mm_xor_ps(c, flipCos);
+	}
+
+	// Sines and cosines of count + 1 evenly spaced angles from start to end
+	void UAngles(float start, float end, GLuint count, std::vector<float>& sines, std::vector<float>& cosines)
+	{
+		std::vector<float> angles(count + 1);
+		for (GLuint i = 0; i <= count; ++i)
+			angles[i] = start + (end - start) * i / count;
+
+		sines.resize(count + 1);
+		cosines.resize(count + 1);
+		SinCos(angles.data(), count + 1, sines.data(), cosines.data());
+	}
+
+	void UPushVertex(PrimitiveGeometry& geometry, float x, float y, float z, float nx, float ny, float nz, float u, float v)
+	{
+		const GLfloat vertex[] = { x, y, z, nx, ny, nz, u, v };
+		geometry.vertices.insert(geometry.vertices.end(), vertex, vertex + 8);
+	}
+
+	void UPushTriangle(PrimitiveGeometry& geometry, GLuint a, GLuint b, GLuint c)
+	{
+		geometry.indices.push_back(a);
+		geometry.indices.push_back(b);
+		geometry.indices.push_back(c);
+	}
+
+	///////////////////////////////////////////////////
+	//	UGenerateFrustum(GLuint, GLuint, float, PrimitiveGeometry&)
+	//
+	//	segments: columns around the axis
+	//	rings: bands from the base to the top
+	//	topRadius: 1 for a cylinder, 0 for a cone
+	//	geometry: receives the vertices and indices
+	//
+	//	The side is a grid of rings + 1 rows with a
+	//	seam column repeated at the end for the texture
+	//	wrap. Side normals lean up by the slope of the
+	//	wall. The caps are fans around a centre vertex,
+	//	mapped flat onto the texture like the tables.
+	///////////////////////////////////////////////////
+	void UGenerateFrustum(GLuint segments, GLuint rings, float topRadius, PrimitiveGeometry& geometry)
+	{
+		std::vector<float> sines, cosines;
+		UAngles(0.0f, TWO_PI, segments, sines, cosines);
+		// the seam column lands exactly on the first one
+		sines[segments] = sines[0];
+		cosines[segments] = cosines[0];
+
+		// the outward normal of a wall narrowing by (1 - topRadius) per unit of height
+		const float slope = 1.0f - topRadius;
+		const float normalScale = 1.0f / std::sqrt(1.0f + slope * slope);
+
+		for (GLuint r = 0; r <= rings; ++r)
+		{
+			const float y = (float)r / rings;
+			const float radius = 1.0f + (topRadius - 1.0f) * y;
+			for (GLuint s = 0; s <= segments; ++s)
+			{
+				UPushVertex(geometry, radius * cosines[s], y, -radius * sines[s],
+					cosines[s] * normalScale, slope * normalScale, -sines[s] * normalScale,
+					(float)s / segments, y);
+			}
+		}
+
+		const GLuint row = segments + 1;
+		for (GLuint r = 0; r < rings; ++r)
+		{
+			for (GLuint s = 0; s < segments; ++s)
+			{
+				const GLuint a = r * row + s;
+				UPushTriangle(geometry, a, a + 1, a + row + 1);
+				// the top row of a cone meets in the apex, its upper triangles have no area
+				if (topRadius > 0.0f || r + 1 < rings)
+					UPushTriangle(geometry, a, a + row + 1, a + row);
+			}
+		}
+
+		// bottom cap, then the top one unless the top is a point
+		const GLuint caps = topRadius > 0.0f ? 2 : 1;
+		for (GLuint cap = 0; cap < caps; ++cap)
+		{
+			const float y = (float)cap;
+			const float radius = cap == 0 ? 1.0f : topRadius;
+			const float ny = cap == 0 ? -1.0f : 1.0f;
+
+			const GLuint centre = (GLuint)(geometry.vertices.size() / 8);
+			UPushVertex(geometry, 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+			for (GLuint s = 0; s < segments; ++s)
+			{
+				UPushVertex(geometry, radius * cosines[s], y, -radius * sines[s], 0.0f, ny, 0.0f,
+					0.5f - 0.5f * sines[s], 0.5f + 0.5f * cosines[s]);
+			}
+
+			for (GLuint s = 0; s < segments; ++s)
+			{
+				const GLuint first = centre + 1 + s;
+				const GLuint second = centre + 1 + (s + 1) % segments;
+				if (cap == 0)
+					UPushTriangle(geometry, centre, second, first);
+				else
+					UPushTriangle(geometry, centre, first, second);
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UGenerateSphere(GLuint, GLuint, PrimitiveGeometry&)
+	//
+	//	segments: columns around the axis
+	//	rings: latitude bands from pole to pole
+	//	geometry: receives the vertices and indices
+	//
+	//	A latitude-longitude grid from the top pole
+	//	down. The poles get one vertex per column so
+	//	each column keeps its own u, and the triangles
+	//	that would collapse into a pole are left out.
+	///////////////////////////////////////////////////
+	void UGenerateSphere(GLuint segments, GLuint rings, PrimitiveGeometry& geometry)
+	{
+		std::vector<float> sines, cosines;
+		UAngles(0.0f, TWO_PI, segments, sines, cosines);
+		// the seam column lands exactly on the first one
+		sines[segments] = sines[0];
+		cosines[segments] = cosines[0];
+		std::vector<float> ringSines, ringCosines;
+		UAngles(0.0f, PI, rings, ringSines, ringCosines);
+
+		for (GLuint r = 0; r <= rings; ++r)
+		{
+			// snap the poles, the polynomial leaves sin(pi) a hair off zero
+			const float radius = (r == 0 || r == rings) ? 0.0f : ringSines[r];
+			const float y = r == 0 ? 1.0f : (r == rings ? -1.0f : ringCosines[r]);
+			for (GLuint s = 0; s <= segments; ++s)
+			{
+				const float x = radius * cosines[s];
+				const float z = -radius * sines[s];
+				UPushVertex(geometry, x, y, z, x, y, z, (float)s / segments, 1.0f - (float)r / rings);
+			}
+		}
+
+		const GLuint row = segments + 1;
+		for (GLuint r = 0; r < rings; ++r)
+		{
+			for (GLuint s = 0; s < segments; ++s)
+			{
+				// a, b on the lower row, d, c above them
+				const GLuint d = r * row + s;
+				const GLuint a = d + row;
+				if (r + 1 < rings)
+					UPushTriangle(geometry, a, a + 1, d + 1);
+				if (r > 0)
+					UPushTriangle(geometry, a, d + 1, d);
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UGenerateTorus(GLuint, GLuint, PrimitiveGeometry&)
+	//
+	//	segments: columns around the main radius
+	//	rings: columns around the tube
+	//	geometry: receives the vertices and indices
+	//
+	//	A grid wrapping both ways, with the seam row
+	//	and column repeated for the texture wrap. u
+	//	goes around the main radius and v around the
+	//	tube; the normal points away from the tube's
+	//	centre line.
+	///////////////////////////////////////////////////
+	void UGenerateTorus(GLuint segments, GLuint rings, PrimitiveGeometry& geometry)
+	{
+		std::vector<float> sines, cosines;
+		UAngles(0.0f, TWO_PI, segments, sines, cosines);
+		sines[segments] = sines[0];
+		cosines[segments] = cosines[0];
+		std::vector<float> tubeSines, tubeCosines;
+		UAngles(0.0f, TWO_PI, rings, tubeSines, tubeCosines);
+		tubeSines[rings] = tubeSines[0];
+		tubeCosines[rings] = tubeCosines[0];
+
+		for (GLuint r = 0; r <= rings; ++r)
+		{
+			const float radius = 1.0f + TORUS_TUBE_RADIUS * tubeCosines[r];
+			for (GLuint s = 0; s <= segments; ++s)
+			{
+				UPushVertex(geometry, radius * cosines[s], radius * sines[s], TORUS_TUBE_RADIUS * tubeSines[r],
+					tubeCosines[r] * cosines[s], tubeCosines[r] * sines[s], tubeSines[r],
+					(float)s / segments, (float)r / rings);
+			}
+		}
+
+		// the main angle then the tube angle turn counter-clockwise seen from outside
+		const GLuint row = segments + 1;
+		for (GLuint r = 0; r < rings; ++r)
+		{
+			for (GLuint s = 0; s < segments; ++s)
+			{
+				const GLuint a = r * row + s;
+				UPushTriangle(geometry, a, a + 1, a + row + 1);
+				UPushTriangle(geometry, a, a + row + 1, a + row);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	SinCos(const float*, GLuint, float*, float*)
+//
+//	angles: angles in radians
+//	count: number of angles
+//	sines, cosines: receive count results each
+//
+//	Four angles per step; the last partial group is
+//	padded through a small buffer.
+///////////////////////////////////////////////////
+void SinCos(const float* angles, GLuint count, float* sines, float* cosines)
+{
+	GLuint i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 s, c;
+		USinCos4(_mm_loadu_ps(angles + i), s, c);
+		_mm_storeu_ps(sines + i, s);
+		_mm_storeu_ps(cosines + i, c);
+	}
+
+	if (i < count)
+	{
+		float in[4] = {}, outSin[4], outCos[4];
+		std::copy(angles + i, angles + count, in);
+
+		__m128 s, c;
+		USinCos4(_mm_loadu_ps(in), s, c);
+		_mm_storeu_ps(outSin, s);
+		_mm_storeu_ps(outCos, c);
+		std::copy(outSin, outSin + (count - i), sines + i);
+		std::copy(outCos, outCos + (count - i), cosines + i);
+	}
+}
+
+///////////////////////////////////////////////////
+//	GeneratePrimitive(PrimitiveType, GLuint, GLuint, PrimitiveGeometry&)
+//
+//	type: primitive to generate
+//	segments: columns around the y axis, or around
+//		the main radius of the torus
+//	rings: bands up the height, latitude bands of
+//		the sphere or columns around the torus tube
+//	geometry: cleared and filled with the result
+///////////////////////////////////////////////////
+void GeneratePrimitive(PrimitiveType type, GLuint segments, GLuint rings, PrimitiveGeometry& geometry)
+{
+	geometry.vertices.clear();
+	geometry.indices.clear();
+
+	segments = std::max(segments, MIN_PRIMITIVE_SEGMENTS);
+	rings = std::max(rings, MinPrimitiveRings(type));
+
+	switch (type)
+	{
+	case PRIMITIVE_CYLINDER:
+		UGenerateFrustum(segments, rings, 1.0f, geometry);
+		break;
+	case PRIMITIVE_TAPERED_CYLINDER:
+		UGenerateFrustum(segments, rings, 0.5f, geometry);
+		break;
+	case PRIMITIVE_CONE:
+		UGenerateFrustum(segments, rings, 0.0f, geometry);
+		break;
+	case PRIMITIVE_SPHERE:
+		UGenerateSphere(segments, rings, geometry);
+		break;
+	case PRIMITIVE_TORUS:
+		UGenerateTorus(segments, rings, geometry);
+		break;
+	default:
+		break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	PrimitiveError(PrimitiveType, GLuint, GLuint)
+//
+//	type: primitive generated
+//	segments, rings: resolution passed to
+//		GeneratePrimitive()
+//
+//	The sagitta of the widest arc a facet cuts off:
+//	the base circle of radius 1 for the cylinders
+//	and the cone, whose walls are straight, the
+//	longitude or latitude arc of the sphere, and
+//	the outer rim or the tube circle of the torus
+///////////////////////////////////////////////////
+float PrimitiveError(PrimitiveType type, GLuint segments, GLuint rings)
+{
+	segments = std::max(segments, MIN_PRIMITIVE_SEGMENTS);
+	rings = std::max(rings, MinPrimitiveRings(type));
+	const float around = 1.0f - std::cos(PI / segments);
+	if (type == PRIMITIVE_SPHERE)
+		return std::max(around, 1.0f - std::cos(PI / (2.0f * rings)));
+	if (type == PRIMITIVE_TORUS)
+		return std::max((1.0f + TORUS_TUBE_RADIUS) * around, TORUS_TUBE_RADIUS * (1.0f - std::cos(PI / rings)));
+	return around;
+}
+
+///////////////////////////////////////////////////
+//	PrimitiveName(PrimitiveType)
+//
+//	type: primitive generated
+///////////////////////////////////////////////////
+const char* PrimitiveName(PrimitiveType type)
+{
+	static const char* names[PRIMITIVE_COUNT] = { "cylinder", "tapered", "cone", "sphere", "torus" };
+	return type < PRIMITIVE_COUNT ? names[type] : "unknown";
+}
+
+///////////////////////////////////////////////////
+//	MinPrimitiveRings(PrimitiveType)
+//
+//	type: primitive generated
+///////////////////////////////////////////////////
+GLuint MinPrimitiveRings(PrimitiveType type)
+{
+	if (type == PRIMITIVE_SPHERE)
+		return MIN_SPHERE_RINGS;
+	if (type == PRIMITIVE_TORUS)
+		return MIN_PRIMITIVE_SEGMENTS;
+	return 1;
+}
+
+///////////////////////////////////////////////////
+//	PrimitiveLodChain(PrimitiveType, GLuint, GLuint, GLuint, GLuint*, GLuint*)
+//
+//	type: primitive generated
+//	segments, rings: resolution of level 0
+//	maxLevels: room in the two arrays
+//	levelSegments, levelRings: resolution per level
+///////////////////////////////////////////////////
+GLuint PrimitiveLodChain(PrimitiveType type, GLuint segments, GLuint rings, GLuint maxLevels, GLuint* levelSegments, GLuint* levelRings)
+{
+	const GLuint minRings = MinPrimitiveRings(type);
+	// the torus tube is a circle too, it stops where the main circle does
+	const GLuint minLodRings = type == PRIMITIVE_TORUS ? MIN_LOD_SEGMENTS : minRings;
+	segments = std::max(segments, MIN_PRIMITIVE_SEGMENTS);
+	rings = std::max(rings, minRings);
+
+	GLuint levels = 0;
+	while (levels < maxLevels)
+	{
+		levelSegments[levels] = segments;
+		levelRings[levels] = rings;
+		levels++;
+
+		// a resolution already under the floor is never raised to it
+		const GLuint coarserSegments = std::max(segments / 2, std::min(segments, MIN_LOD_SEGMENTS));
+		const GLuint coarserRings = std::max(rings / 2, std::min(rings, minLodRings));
+		if (coarserSegments == segments && coarserRings == rings)
+			break;
+		segments = coarserSegments;
+		rings = coarserRings;
+	}
+	return levels;
+}
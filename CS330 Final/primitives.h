@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitives.h
+// ========
+// parametric generators for the round primitives: cylinder, tapered
+// cylinder, cone, sphere and torus
+//
+// Every primitive is generated at a given resolution: segments around the
+// y axis and rings of bands up its height (latitude bands for the sphere).
+// The shapes match the old hardcoded tables: a radius 1 base on y = 0 and
+// the top on y = 1 for the cylinders and the cone, a unit sphere around the
+// origin. Angles go from +x towards -z, the way the tables were laid out.
+// The torus lies in the xy plane around the z axis like the old generated
+// one: segments around its main radius of 1, rings around a tube of
+// TORUS_TUBE_RADIUS.
+//
+// The sines and cosines of a whole row of angles are computed four at a
+// time by SinCos(), so a high resolution costs little more than copying
+// the vertices out.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+enum PrimitiveType { PRIMITIVE_CYLINDER, PRIMITIVE_TAPERED_CYLINDER, PRIMITIVE_CONE, PRIMITIVE_SPHERE, PRIMITIVE_TORUS, PRIMITIVE_COUNT };
+
+// Indexed triangle list of one generated primitive
+struct PrimitiveGeometry
+{
+	std::vector<GLfloat> vertices;  // Interleaved position, normal, texture coordinate
+	std::vector<GLuint> indices;    // Counter-clockwise seen from outside
+};
+
+// Lower case name of the type, for reports
+const char* PrimitiveName(PrimitiveType type);
+
+// Sine and cosine of count angles in radians, good to a few float ulps for
+// angles within +-8192. The arrays may have any length and alignment.
+void SinCos(const float* angles, GLuint count, float* sines, float* cosines);
+
+// Smallest resolution each primitive is generated at, lower requests are raised to it
+const GLuint MIN_PRIMITIVE_SEGMENTS = 3;
+const GLuint MIN_SPHERE_RINGS = 2;
+// Rings the type is raised to: 1 for the cylinders and the cone
+GLuint MinPrimitiveRings(PrimitiveType type);
+
+// Radius of the torus tube, its main radius being 1
+const float TORUS_TUBE_RADIUS = 0.1f;
+
+// Replace geometry with type at segments around the axis and rings up the height
+void GeneratePrimitive(PrimitiveType type, GLuint segments, GLuint rings, PrimitiveGeometry& geometry);
+// Largest distance between the facets of that resolution and the exact shape
+float PrimitiveError(PrimitiveType type, GLuint segments, GLuint rings);
+
+// Coarsest segment count a chain of detail levels goes down to
+const GLuint MIN_LOD_SEGMENTS = 4;
+
+// Fill levelSegments and levelRings with a chain of detail levels that starts at
+// segments x rings and halves both per level. Return the number of levels, at
+// most maxLevels; the chain ends early once halving changes nothing.
+GLuint PrimitiveLodChain(PrimitiveType type, GLuint segments, GLuint rings, GLuint maxLevels, GLuint* levelSegments, GLuint* levelRings);
@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////
+// programreflection.cpp
+// ========
+// link-time reflection of a shader program's uniforms, blocks and samplers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "programreflection.h"
+
+namespace
+{
+	// Every reflected program, keyed by program id
+	std::unordered_map<GLuint, ProgramReflection> gPrograms;
+
+	// glGetUniformLocation calls made so far
+	unsigned long gLocationQueries = 0;
+
+	bool IsSamplerType(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_1D_SHADOW:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_1D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_SAMPLER_BUFFER:
+		case GL_SAMPLER_2D_RECT:
+		case GL_INT_SAMPLER_2D:
+		case GL_INT_SAMPLER_3D:
+		case GL_INT_SAMPLER_2D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_3D:
+		case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	Reflect(GLuint)
+//
+//	program: successfully linked program
+//
+//	Enumerate the program's active uniforms, blocks
+//	and samplers and cache them under the program id.
+//	Re-reflecting a relinked program replaces the
+//	previous entry.
+///////////////////////////////////////////////////
+ProgramReflection& ProgramReflection::Reflect(GLuint program)
+{
+	ProgramReflection& reflection = gPrograms[program];
+	reflection.UEnumerate(program);
+	return reflection;
+}
+
+///////////////////////////////////////////////////
+//	Find(GLuint)
+//
+//	program: program id
+//
+//	Return the cached reflection, or NULL if the
+//	program was never reflected
+///////////////////////////////////////////////////
+const ProgramReflection* ProgramReflection::Find(GLuint program)
+{
+	std::unordered_map<GLuint, ProgramReflection>::const_iterator it = gPrograms.find(program);
+	return it == gPrograms.end() ? NULL : &it->second;
+}
+
+///////////////////////////////////////////////////
+//	Forget(GLuint)
+//
+//	program: program id about to be deleted
+///////////////////////////////////////////////////
+void ProgramReflection::Forget(GLuint program)
+{
+	gPrograms.erase(program);
+}
+
+///////////////////////////////////////////////////
+//	LocationQueries()
+//
+//	Running count of glGetUniformLocation calls.
+//	Only Reflect() queries locations, so the count
+//	must not move during steady-state frames.
+///////////////////////////////////////////////////
+unsigned long ProgramReflection::LocationQueries()
+{
+	return gLocationQueries;
+}
+
+///////////////////////////////////////////////////
+//	Location(const std::string&)
+//
+//	name: uniform name as GLSL spells it; an array
+//		is found by its plain name, "name[0]" or any
+//		element "name[i]"
+//
+//	Look up a cached location, -1 if the uniform is
+//	not active (e.g. optimised out by the compiler)
+///////////////////////////////////////////////////
+GLint ProgramReflection::Location(const std::string& name) const
+{
+	std::unordered_map<std::string, GLint>::const_iterator it = mLocations.find(name);
+	return it == mLocations.end() ? -1 : it->second;
+}
+
+///////////////////////////////////////////////////
+//	BlockIndex(const std::string&)
+//
+//	name: uniform block name
+///////////////////////////////////////////////////
+GLuint ProgramReflection::BlockIndex(const std::string& name) const
+{
+	for (const BlockInfo& block : mBlocks)
+	{
+		if (block.name == name)
+			return block.index;
+	}
+	return GL_INVALID_INDEX;
+}
+
+///////////////////////////////////////////////////
+//	UEnumerate(GLuint)
+//
+//	program: successfully linked program
+//
+//	Query every active uniform and uniform block once
+///////////////////////////////////////////////////
+void ProgramReflection::UEnumerate(GLuint program)
+{
+	mProgram = program;
+	mUniforms.clear();
+	mBlocks.clear();
+	mSamplers.clear();
+	mLocations.clear();
+
+	GLint count = 0;
+	GLint maxLength = 0;
+
+	// uniforms
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+
+	for (GLint i = 0; i < count; ++i)
+	{
+		UniformInfo uniform;
+		GLsizei length = 0;
+		glGetActiveUniform(program, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &uniform.size, &uniform.type, nameBuffer.data());
+		uniform.name.assign(nameBuffer.data(), length);
+
+		uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+		gLocationQueries++;
+		mLocations[uniform.name] = uniform.location;
+
+		// an array of basic types is reported once as "name[0]", with members of struct
+		// arrays such as "lights[1].position" each reported on their own. The plain name
+		// and the other elements are looked up as well, like glGetUniformLocation would.
+		const std::string ARRAY_SUFFIX = "[0]";
+		if (uniform.location != -1 && uniform.name.size() > ARRAY_SUFFIX.size() &&
+			uniform.name.compare(uniform.name.size() - ARRAY_SUFFIX.size(), ARRAY_SUFFIX.size(), ARRAY_SUFFIX) == 0)
+		{
+			const std::string base = uniform.name.substr(0, uniform.name.size() - ARRAY_SUFFIX.size());
+			mLocations[base] = uniform.location;
+			for (GLint element = 1; element < uniform.size; ++element)
+			{
+				const std::string elementName = base + "[" + std::to_string(element) + "]";
+				mLocations[elementName] = glGetUniformLocation(program, elementName.c_str());
+				gLocationQueries++;
+			}
+		}
+
+		if (IsSamplerType(uniform.type))
+			mSamplers.push_back((GLuint)mUniforms.size());
+
+		mUniforms.push_back(uniform);
+	}
+
+	// uniform blocks
+	count = 0;
+	maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+	nameBuffer.resize(maxLength > 0 ? maxLength : 1);
+
+	for (GLint i = 0; i < count; ++i)
+	{
+		BlockInfo block;
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(program, (GLuint)i, (GLsizei)nameBuffer.size(), &length, nameBuffer.data());
+		block.name.assign(nameBuffer.data(), length);
+		block.index = (GLuint)i;
+		glGetActiveUniformBlockiv(program, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+		glGetActiveUniformBlockiv(program, block.index, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+		mBlocks.push_back(block);
+	}
+}
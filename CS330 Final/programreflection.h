@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// programreflection.h
+// ========
+// link-time reflection of a shader program's uniforms, blocks and samplers
+//
+// Every active uniform is enumerated once right after the program links, so
+// render code resolves its locations up front and never calls
+// glGetUniformLocation while drawing a frame. Programs are registered by id,
+// which lets the raw-id paths (UCreateShaderProgram, LoadShaders) and the
+// Shader class share the same cache.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ProgramReflection
+{
+public:
+	// One active uniform of the program
+	struct UniformInfo
+	{
+		std::string name;   // Name as reported, "[0]" included for arrays
+		GLenum type;        // GL_FLOAT_VEC3, GL_SAMPLER_2D, ...
+		GLint size;         // Array length, 1 for non-arrays
+		GLint location;     // -1 for uniforms that live in a block
+	};
+
+	// One active uniform block of the program
+	struct BlockInfo
+	{
+		std::string name;
+		GLuint index;       // Block index passed to glUniformBlockBinding
+		GLint dataSize;     // Minimum buffer size in bytes
+		GLint binding;      // Binding point at link time
+	};
+
+public:
+	// Enumerate the program and register it under its id
+	static ProgramReflection& Reflect(GLuint program);
+	// Cached reflection of a program, or NULL if it was never reflected
+	static const ProgramReflection* Find(GLuint program);
+	// Drop the cached reflection when the program is deleted
+	static void Forget(GLuint program);
+
+	// Number of glGetUniformLocation calls made by the process so far
+	static unsigned long LocationQueries();
+
+	GLuint Program() const { return mProgram; }
+
+	// Location of a uniform, or -1 if it is not active. Never calls into GL.
+	GLint Location(const std::string& name) const;
+	// Block index of a uniform block, or GL_INVALID_INDEX
+	GLuint BlockIndex(const std::string& name) const;
+
+	const std::vector<UniformInfo>& Uniforms() const { return mUniforms; }
+	const std::vector<BlockInfo>& Blocks() const { return mBlocks; }
+	// Indices into Uniforms() of every sampler uniform
+	const std::vector<GLuint>& Samplers() const { return mSamplers; }
+
+private:
+	void UEnumerate(GLuint program);
+
+	GLuint mProgram = 0;
+	std::vector<UniformInfo> mUniforms;
+	std::vector<BlockInfo> mBlocks;
+	std::vector<GLuint> mSamplers;
+	std::unordered_map<std::string, GLint> mLocations;
+};
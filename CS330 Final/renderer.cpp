@@ -0,0 +1,385 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderer.cpp
+// ========
+// submission layer that turns the scene store into instanced draw calls
+///////////////////////////////////////////////////////////////////////////////
+
+#include "renderer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+#include "glstate.h"
+#include "programreflection.h"
+
+namespace
+{
+	// Draw records the ring buffer starts out with per frame, it grows on demand
+	const GLuint INITIAL_DRAW_RECORDS = 256;
+}
+
+///////////////////////////////////////////////////
+//	Create(Meshes&)
+//
+//	meshes: meshes whose shared VAO reads the draw records
+//
+//	Create the draw record ring buffer, material and
+//	indirect command buffers, and describe the draw
+//	record layout to the shared mesh VAOs
+///////////////////////////////////////////////////
+void SceneRenderer::Create(Meshes& meshes)
+{
+	mVao = meshes.GetVao();
+	mDepthVao = meshes.GetDepthVao();
+	mIndexType = meshes.GetIndexType();
+	mIndexSize = meshes.GetIndexSize();
+	mDrawRecords.Create(sizeof(DrawRecord) * INITIAL_DRAW_RECORDS);
+	mDrawCommands.Create(sizeof(DrawElementsIndirectCommand) * INITIAL_DRAW_RECORDS);
+
+	UDescribeInstances(mVao);
+	UDescribeInstances(mDepthVao);
+
+	glGenBuffers(1, &mMaterialUbo);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, mMaterialUbo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialRecord) * MAX_MATERIALS, NULL, GL_STATIC_DRAW);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, mMaterialUbo);
+
+	mBatched = false;
+	stats.stalls = 0;
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Release the draw record, indirect command and
+//	material buffers
+///////////////////////////////////////////////////
+void SceneRenderer::Destroy()
+{
+	mDrawRecords.Destroy();
+	mDrawCommands.Destroy();
+	GLState::DeleteBuffers(1, &mMaterialUbo);
+	mMaterialUbo = 0;
+}
+
+///////////////////////////////////////////////////
+//	Attach(GLuint)
+//
+//	program: linked and reflected program
+//
+//	Assign the program's MaterialBlock to
+//	MATERIAL_BINDING
+///////////////////////////////////////////////////
+void SceneRenderer::Attach(GLuint program) const
+{
+	const ProgramReflection* reflection = ProgramReflection::Find(program);
+	if (reflection == NULL)
+		return;
+
+	const GLuint blockIndex = reflection->BlockIndex("MaterialBlock");
+	if (blockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, blockIndex, MATERIAL_BINDING);
+}
+
+///////////////////////////////////////////////////
+//	BuildBatches(const Scene&)
+//
+//	scene: entities to group
+//
+//	Refresh the per-entity pass and state the draw
+//	list keys on, and the material table. Prepare()
+//	calls it again whenever the scene's state version
+//	moves.
+///////////////////////////////////////////////////
+void SceneRenderer::BuildBatches(const Scene& scene)
+{
+	mMaterialsFit = UUploadMaterials(scene);
+	if (mMaterialsFit)
+		mDrawList.SetStates(scene);
+
+	mBatched = true;
+	mBatchedVersion = scene.StateVersion();
+}
+
+///////////////////////////////////////////////////
+//	Draw(const Scene&, const glm::mat4&, const SurfaceUniforms&, const unsigned char*, const GLuint*)
+//
+//	Single pass: Prepare(), DrawSurface(),
+//	DrawTransparent() and Finish() in one call
+///////////////////////////////////////////////////
+void SceneRenderer::Draw(const Scene& scene, const glm::mat4& view, const SurfaceUniforms& uniforms,
+	const unsigned char* visible, const GLuint* conditions)
+{
+	Prepare(scene, view, visible);
+	DrawSurface(uniforms, conditions);
+	DrawTransparent(uniforms, conditions);
+	Finish();
+}
+
+///////////////////////////////////////////////////
+//	Prepare(const Scene&, const glm::mat4&, const unsigned char*, const unsigned char*)
+//
+//	scene: entities to draw
+//	view: camera view matrix, for the depth in the keys
+//	visible: one flag per entity from the culler, or
+//		nullptr to draw everything
+//	levels: detail level per entity from the
+//		LodSelector, or nullptr for full detail
+//
+//	Build this frame's draw list, writing the draw
+//	records straight into the ring segment, then copy
+//	the commands after them. Every pass of the frame
+//	reads the same records.
+///////////////////////////////////////////////////
+void SceneRenderer::Prepare(const Scene& scene, const glm::mat4& view, const unsigned char* visible, const unsigned char* levels)
+{
+	if (!mBatched || scene.StateVersion() != mBatchedVersion)
+		BuildBatches(scene);
+
+	stats.batches = mMaterialsFit ? mDrawList.StateCount() : 0;
+	stats.commands = 0;
+	stats.entities = 0;
+	stats.drawCalls = 0;
+	stats.textureChanges = 0;
+	stats.transparent = 0;
+
+	// the draw records would index past the end of MaterialBlock
+	if (!mMaterialsFit)
+		return;
+
+	const GLuint recordCount = mDrawList.Queue(scene, view, visible, levels);
+	if (recordCount == 0)
+		return;
+
+	// the workers write the draw records straight into mapped memory
+	DrawRecord* records = (DrawRecord*)mDrawRecords.Begin((GLsizeiptr)(sizeof(DrawRecord) * recordCount));
+	mDrawList.Write(scene, records);
+
+	const std::vector<DrawElementsIndirectCommand>& frameCommands = mDrawList.Commands();
+	DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)mDrawCommands.Begin(
+		(GLsizeiptr)(sizeof(DrawElementsIndirectCommand) * frameCommands.size()));
+	std::copy(frameCommands.begin(), frameCommands.end(), commands);
+
+	stats.entities = recordCount;
+	stats.commands = (GLuint)frameCommands.size();
+	stats.transparent = mDrawList.TransparentCount();
+	stats.stalls = mDrawRecords.stalls + mDrawCommands.stalls;
+	mPrepared = true;
+}
+
+///////////////////////////////////////////////////
+//	DrawDepth()
+//
+//	Depth-only pass over the prepared opaque records
+//	from the position-only VAO. Textures don't
+//	matter here, so every opaque command goes out in
+//	one multi-draw. The depth program must be in use
+//	and colour writes should be masked.
+///////////////////////////////////////////////////
+void SceneRenderer::DrawDepth()
+{
+	if (!mPrepared || mDrawList.OpaqueCommandCount() == 0)
+		return;
+
+	GLState::BindVertexArray(mDepthVao);
+	glBindVertexBuffer(INSTANCE_BINDING, mDrawRecords.Buffer(), mDrawRecords.Offset(), sizeof(DrawRecord));
+	GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, mDrawCommands.Buffer());
+
+	// opaque commands come first in the queue
+	glMultiDrawElementsIndirect(GL_TRIANGLES, mIndexType, (void*)mDrawCommands.Offset(), (GLsizei)mDrawList.OpaqueCommandCount(), 0);
+	stats.drawCalls++;
+}
+
+///////////////////////////////////////////////////
+//	DrawSurface(const SurfaceUniforms&, const GLuint*)
+//
+//	uniforms: surface program locations set per group
+//	conditions: query object per entity to condition
+//		its draw on, or nullptr
+//
+//	Shade the prepared opaque records with one
+//	multi-draw per texture. The surface program must
+//	already be in use.
+///////////////////////////////////////////////////
+void SceneRenderer::DrawSurface(const SurfaceUniforms& uniforms, const GLuint* conditions)
+{
+	UDrawGroups(RenderQueue::PASS_OPAQUE, uniforms, conditions);
+}
+
+///////////////////////////////////////////////////
+//	DrawTransparent(const SurfaceUniforms&, const GLuint*)
+//
+//	uniforms: surface program locations set per group
+//	conditions: query object per entity to condition
+//		its draw on, or nullptr
+//
+//	Shade the prepared transparent records back to
+//	front. The caller sets up blending and turns
+//	depth writes off.
+///////////////////////////////////////////////////
+void SceneRenderer::DrawTransparent(const SurfaceUniforms& uniforms, const GLuint* conditions)
+{
+	UDrawGroups(RenderQueue::PASS_TRANSPARENT, uniforms, conditions);
+}
+
+///////////////////////////////////////////////////
+//	Finish()
+//
+//	Close the frame after its last pass
+///////////////////////////////////////////////////
+void SceneRenderer::Finish()
+{
+	if (!mPrepared)
+		return;
+
+	// the segments can be reused once the draws of every pass have completed
+	mDrawRecords.End();
+	mDrawCommands.End();
+	mPrepared = false;
+}
+
+///////////////////////////////////////////////////
+//	UDrawGroups(RenderQueue::Pass, const SurfaceUniforms&, const GLuint*)
+//
+//	pass: pass whose groups are drawn
+//	uniforms: surface program locations set per group
+//	conditions: query object per entity, or nullptr
+//
+//	One multi-draw per group of the pass. The texture
+//	slot uniform is only set when it changes.
+///////////////////////////////////////////////////
+void SceneRenderer::UDrawGroups(RenderQueue::Pass pass, const SurfaceUniforms& uniforms, const GLuint* conditions)
+{
+	if (!mPrepared)
+		return;
+
+	// every mesh lives in the shared buffers, so the VAO is bound once; it stays bound for the next pass
+	GLState::BindVertexArray(mVao);
+	glBindVertexBuffer(INSTANCE_BINDING, mDrawRecords.Buffer(), mDrawRecords.Offset(), sizeof(DrawRecord));
+	GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, mDrawCommands.Buffer());
+
+	GLint boundSlot = -1;
+	for (const DrawListBuilder::Group& group : mDrawList.Groups())
+	{
+		if (group.pass != pass)
+			continue;
+
+		//reference the group's texture slot before drawing
+		if (group.textureSlot != boundSlot)
+		{
+			glUniform1i(uniforms.texture, group.textureSlot);
+			boundSlot = group.textureSlot;
+			stats.textureChanges++;
+		}
+
+		if (conditions != nullptr)
+		{
+			UDrawConditional(group, conditions);
+			continue;
+		}
+
+		// Draws every mesh and instance of the group
+		glMultiDrawElementsIndirect(GL_TRIANGLES, mIndexType,
+			(void*)(mDrawCommands.Offset() + sizeof(DrawElementsIndirectCommand) * group.firstCommand), group.commandCount, 0);
+		stats.drawCalls++;
+	}
+}
+
+///////////////////////////////////////////////////
+//	UDrawConditional(const DrawListBuilder::Group&, const GLuint*)
+//
+//	group: commands sharing the bound texture slot
+//	conditions: query object per entity, 0 for none
+//
+//	Draw each instance of the group on its own so
+//	the GPU can skip it when its query from an
+//	earlier frame found nothing. GL_QUERY_NO_WAIT
+//	draws anyway if the answer is not in yet, so
+//	the pipeline never stalls on a query.
+///////////////////////////////////////////////////
+void SceneRenderer::UDrawConditional(const DrawListBuilder::Group& group, const GLuint* conditions)
+{
+	const std::vector<DrawElementsIndirectCommand>& commands = mDrawList.Commands();
+	const std::vector<GLuint>& recordEntities = mDrawList.RecordEntities();
+
+	for (GLuint c = group.firstCommand; c < group.firstCommand + group.commandCount; ++c)
+	{
+		const DrawElementsIndirectCommand& command = commands[c];
+		for (GLuint i = command.baseInstance; i < command.baseInstance + command.instanceCount; ++i)
+		{
+			const GLuint query = conditions[recordEntities[i]];
+			if (query != 0)
+				glBeginConditionalRender(query, GL_QUERY_NO_WAIT);
+
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, mIndexType,
+				(void*)((size_t)mIndexSize * command.firstIndex), 1, command.baseVertex, i);
+			stats.drawCalls++;
+
+			if (query != 0)
+				glEndConditionalRender();
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	UDescribeInstances(GLuint)
+//
+//	vao: shared mesh VAO that reads draw records
+//
+//	Add the per-instance model matrix and material
+//	attributes, sourced from INSTANCE_BINDING
+///////////////////////////////////////////////////
+void SceneRenderer::UDescribeInstances(GLuint vao)
+{
+	GLState::BindVertexArray(vao);
+
+	// a mat4 attribute takes one location per column
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glVertexAttribFormat(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * column);
+		glVertexAttribBinding(INSTANCE_MODEL_LOCATION + column, INSTANCE_BINDING);
+		glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+	}
+	glVertexAttribIFormat(INSTANCE_MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, offsetof(DrawRecord, material));
+	glVertexAttribBinding(INSTANCE_MATERIAL_LOCATION, INSTANCE_BINDING);
+	glEnableVertexAttribArray(INSTANCE_MATERIAL_LOCATION);
+
+	// one record per instance; the buffer itself is bound per frame at the ring offset
+	glVertexBindingDivisor(INSTANCE_BINDING, 1);
+	GLState::BindVertexArray(0);
+}
+
+///////////////////////////////////////////////////
+//	UUploadMaterials(const Scene&)
+//
+//	scene: scene whose material table is uploaded
+//
+//	Copy the material table into MaterialBlock.
+//	Returns false, with nothing uploaded, when the
+//	table has more entries than the block holds.
+///////////////////////////////////////////////////
+bool SceneRenderer::UUploadMaterials(const Scene& scene)
+{
+	const size_t count = scene.materialTable.size();
+	if (count > MAX_MATERIALS)
+	{
+		std::cout << "ERROR: The scene has " << count << " materials, MaterialBlock holds " << MAX_MATERIALS
+			<< ". Nothing is drawn until it fits." << std::endl;
+		return false;
+	}
+
+	std::vector<MaterialRecord> records(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const SceneMaterial& mat = scene.materialTable[i];
+		records[i].objectColor = mat.objectColor;
+		records[i].light1Color = glm::vec4(mat.light1Color, 0.0f);
+		records[i].light1Position = glm::vec4(mat.light1Position, 1.0f);
+		records[i].light1Specular = glm::vec4(mat.specularIntensity1, mat.highlightSize1, 0.0f, 0.0f);
+	}
+
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, mMaterialUbo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MaterialRecord) * count, records.data());
+	return true;
+}
@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderer.h
+// ========
+// submission layer that turns the scene store into instanced draw calls
+//
+// Every frame the visible entities go through a RenderQueue keyed on pass,
+// program, texture, mesh and view depth. Runs of queued draws that share a
+// mesh and texture slot are collapsed into one instanced command; each
+// detail level of a mesh (see LodSelector) batches as a mesh of its own. That CPU
+// work is done by a DrawListBuilder, spread over a WorkerPool when one is
+// set; only the GL calls stay on the calling thread. Every mesh
+// lives in one shared vertex/index buffer, so all commands with the same
+// texture are submitted together as one glMultiDrawElementsIndirect call.
+// Per-draw data (model matrix and material index) is written once per frame
+// into a persistently mapped ring buffer, in queue order, and fetched as
+// per-instance attributes; materials live in a uniform block indexed by the
+// draw record. Opaque instances are therefore drawn front-to-back inside
+// each command, and transparent entities (material alpha below 1) are drawn
+// back-to-front after them.
+// When per-entity occlusion query conditions are given, every instance is
+// drawn on its own inside a conditional render instead.
+//
+// A frame can be split into passes: Prepare() writes the records once,
+// DrawDepth() lays down depth from the position-only stream and
+// DrawSurface() shades against it, then Finish() closes the frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "drawlist.h"
+#include "meshes.h"
+#include "renderqueue.h"
+#include "ringbuffer.h"
+#include "scene.h"
+
+// Uniform locations of the surface program that change between batches
+struct SurfaceUniforms
+{
+	GLint texture;
+};
+
+// Counters describing the last submitted frame
+struct RenderStats
+{
+	GLuint entities;    // Entities submitted (after culling)
+	GLuint batches;     // Unique pass/mesh/texture combinations in the scene
+	GLuint commands;    // Indirect draw commands submitted
+	GLuint drawCalls;   // glDraw* calls issued
+	GLuint textureChanges;  // Texture slot uniform updates
+	GLuint transparent;     // Entities drawn in the transparent pass
+	GLuint stalls;      // Frames so far that waited on the GPU for a free ring segment
+};
+
+// std140 layout of one MaterialBlock entry
+struct MaterialRecord
+{
+	glm::vec4 objectColor;
+	glm::vec4 light1Color;      // rgb key light colour
+	glm::vec4 light1Position;   // xyz key light position
+	glm::vec4 light1Specular;   // x specular intensity, y highlight size
+};
+
+class SceneRenderer
+{
+public:
+	// Attribute locations of the per-draw model matrix columns and material index
+	static const GLuint INSTANCE_MODEL_LOCATION = 3;
+	static const GLuint INSTANCE_MATERIAL_LOCATION = 7;
+	// Vertex buffer binding the draw records are fetched from
+	static const GLuint INSTANCE_BINDING = 3;
+	// Uniform buffer binding of MaterialBlock, MAX_MATERIALS must match the GLSL array
+	static const GLuint MATERIAL_BINDING = 1;
+	static const GLuint MAX_MATERIALS = 64;
+
+	RenderStats stats;
+
+public:
+	void Create(Meshes& meshes);
+	void Destroy();
+
+	// Point the program's MaterialBlock (if it declares one) at MATERIAL_BINDING
+	void Attach(GLuint program) const;
+
+	// Spread the CPU side of Prepare() over the pool's threads
+	void SetWorkerPool(WorkerPool* pool) { mDrawList.SetWorkerPool(pool); }
+
+	void BuildBatches(const Scene& scene);
+	// conditions: optional query object per entity, 0 draws the entity unconditionally.
+	// Transparent entities blend with the blend state current at the call.
+	void Draw(const Scene& scene, const glm::mat4& view, const SurfaceUniforms& uniforms,
+		const unsigned char* visible = nullptr, const GLuint* conditions = nullptr);
+
+	// The passes Draw() runs, for frames that lay down depth first or set up blending
+	void Prepare(const Scene& scene, const glm::mat4& view, const unsigned char* visible = nullptr, const unsigned char* levels = nullptr);
+	void DrawDepth();
+	void DrawSurface(const SurfaceUniforms& uniforms, const GLuint* conditions = nullptr);
+	void DrawTransparent(const SurfaceUniforms& uniforms, const GLuint* conditions = nullptr);
+	void Finish();
+
+	const QueueStats& QueueStatistics() const { return mDrawList.QueueStatistics(); }
+
+private:
+	void UDrawGroups(RenderQueue::Pass pass, const SurfaceUniforms& uniforms, const GLuint* conditions);
+	void UDescribeInstances(GLuint vao);
+	bool UUploadMaterials(const Scene& scene);
+	void UDrawConditional(const DrawListBuilder::Group& group, const GLuint* conditions);
+
+	PersistentRingBuffer mDrawRecords;
+	PersistentRingBuffer mDrawCommands;
+	GLuint mMaterialUbo = 0;
+	GLuint mVao = 0;
+	GLuint mDepthVao = 0;
+	GLenum mIndexType = GL_UNSIGNED_INT;    // Of the shared mesh index buffer
+	GLsizei mIndexSize = sizeof(GLuint);
+	bool mPrepared = false;
+
+	DrawListBuilder mDrawList;
+	bool mBatched = false;
+	GLuint mBatchedVersion = 0;     // Scene::StateVersion() the batches were built at
+	bool mMaterialsFit = false;     // False when the table is larger than MaterialBlock
+};
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ========
+// per-frame draw queue ordered by a packed 64-bit sort key
+///////////////////////////////////////////////////////////////////////////////
+
+#include "renderqueue.h"
+
+#include <cstring>
+
+namespace
+{
+	const GLuint STATE_BITS = RenderQueue::PROGRAM_BITS + RenderQueue::TEXTURE_BITS + RenderQueue::MESH_BITS;
+	const uint64_t STATE_MASK = (1ull << STATE_BITS) - 1;
+	const GLuint BUCKETS = 1u << RenderQueue::RADIX_BITS;
+	const GLuint DIGITS = 64 / RenderQueue::RADIX_BITS;
+
+	// Bit pattern of a non-negative float, orders like the float
+	uint32_t UDepthBits(float depth)
+	{
+		if (!(depth > 0.0f))
+			return 0;
+
+		uint32_t bits;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return bits;
+	}
+}
+
+///////////////////////////////////////////////////
+//	MakeState(GLuint, GLuint, GLuint)
+//
+//	program: small id of the program
+//	texture: texture slot
+//	mesh: small id of the mesh
+//
+//	Ids wider than their field are truncated, which
+//	only costs batching, never correctness
+///////////////////////////////////////////////////
+uint64_t RenderQueue::MakeState(GLuint program, GLuint texture, GLuint mesh)
+{
+	const uint64_t p = program & ((1u << PROGRAM_BITS) - 1);
+	const uint64_t t = texture & ((1u << TEXTURE_BITS) - 1);
+	const uint64_t m = mesh & ((1u << MESH_BITS) - 1);
+	return (p << (TEXTURE_BITS + MESH_BITS)) | (t << MESH_BITS) | m;
+}
+
+///////////////////////////////////////////////////
+//	MakeKey(Pass, uint64_t, float)
+//
+//	pass: pass the draw belongs to
+//	state: result of MakeState()
+//	depth: view space distance along the view axis
+//
+//	Opaque keys put the state above the depth,
+//	transparent keys put the inverted depth above
+//	the state
+///////////////////////////////////////////////////
+uint64_t RenderQueue::MakeKey(Pass pass, uint64_t state, float depth)
+{
+	const uint64_t passBits = (uint64_t)pass << 62;
+	const uint64_t depthBits = UDepthBits(depth);
+
+	if (pass == PASS_OPAQUE)
+		return passBits | ((state & STATE_MASK) << 32) | depthBits;
+
+	// far to near, so the farthest draw comes first
+	return passBits | ((~depthBits & 0xFFFFFFFFull) << STATE_BITS) | (state & STATE_MASK);
+}
+
+///////////////////////////////////////////////////
+//	KeyState(uint64_t)
+///////////////////////////////////////////////////
+uint64_t RenderQueue::KeyState(uint64_t key)
+{
+	if (KeyPass(key) == PASS_OPAQUE)
+		return (key >> 32) & STATE_MASK;
+	return key & STATE_MASK;
+}
+
+///////////////////////////////////////////////////
+//	Sort()
+//
+//	LSD radix sort of the items, 8 bits per pass.
+//	Every histogram is counted in one read of the
+//	keys; a byte that every key shares is skipped.
+///////////////////////////////////////////////////
+void RenderQueue::Sort()
+{
+	const size_t count = mItems.size();
+	stats.items = (GLuint)count;
+	stats.radixPasses = 0;
+	stats.skippedPasses = 0;
+
+	if (count < 2)
+		return;
+
+	GLuint histograms[DIGITS][BUCKETS];
+	std::memset(histograms, 0, sizeof(histograms));
+	for (const Item& item : mItems)
+	{
+		for (GLuint d = 0; d < DIGITS; ++d)
+			histograms[d][(item.key >> (d * RADIX_BITS)) & (BUCKETS - 1)]++;
+	}
+
+	mScratch.resize(count);
+	for (GLuint d = 0; d < DIGITS; ++d)
+	{
+		const GLuint shift = d * RADIX_BITS;
+		GLuint* histogram = histograms[d];
+		if (histogram[(mItems[0].key >> shift) & (BUCKETS - 1)] == count)
+		{
+			stats.skippedPasses++;
+			continue;
+		}
+
+		// bucket counts to first output slots
+		GLuint offset = 0;
+		for (GLuint b = 0; b < BUCKETS; ++b)
+		{
+			const GLuint bucketCount = histogram[b];
+			histogram[b] = offset;
+			offset += bucketCount;
+		}
+
+		for (const Item& item : mItems)
+			mScratch[histogram[(item.key >> shift) & (BUCKETS - 1)]++] = item;
+
+		mItems.swap(mScratch);
+		stats.radixPasses++;
+	}
+}
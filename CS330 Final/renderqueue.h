@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ========
+// per-frame draw queue ordered by a packed 64-bit sort key
+//
+// Every visible entity is pushed with one key that holds everything its
+// draw order depends on, most significant field first:
+//
+//	opaque:      pass(2) | program(6) | texture(8) | mesh(16) | depth(32)
+//	transparent: pass(2) | ~depth(32) | program(6) | texture(8) | mesh(16)
+//
+// Opaque draws come out grouped by state and front-to-back inside each
+// state, which feeds early-Z. Transparent draws come out back-to-front so
+// they blend correctly, with state only breaking ties. The depth is the
+// float's bit pattern, which orders like the float itself for values >= 0.
+//
+// Keys are sorted with an LSD radix sort, 8 bits per pass. A pass whose
+// byte is the same for every key is skipped, so the unused high bits of the
+// state fields cost nothing.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+// Counters describing the last sort
+struct QueueStats
+{
+	GLuint items;           // Draws queued
+	GLuint radixPasses;     // Byte passes that moved items
+	GLuint skippedPasses;   // Byte passes skipped because every key shared the byte
+};
+
+class RenderQueue
+{
+public:
+	// Order of the passes, the queue sorts them in this order
+	enum Pass { PASS_OPAQUE, PASS_TRANSPARENT };
+
+	// Draw waiting in the queue
+	struct Item
+	{
+		uint64_t key;
+		GLuint entity;
+	};
+
+	// Widths of the key fields
+	static const GLuint PROGRAM_BITS = 6;
+	static const GLuint TEXTURE_BITS = 8;
+	static const GLuint MESH_BITS = 16;
+	static const GLuint RADIX_BITS = 8;
+
+	QueueStats stats = {};
+
+public:
+	// Program, texture and mesh ids packed into the low bits of one field
+	static uint64_t MakeState(GLuint program, GLuint texture, GLuint mesh);
+	static uint64_t MakeKey(Pass pass, uint64_t state, float depth);
+
+	static Pass KeyPass(uint64_t key) { return (Pass)(key >> 62); }
+	// The state field of either key layout
+	static uint64_t KeyState(uint64_t key);
+
+	void Clear() { mItems.clear(); }
+	void Push(uint64_t key, GLuint entity) { mItems.push_back({ key, entity }); }
+	// Append items queued elsewhere, for example by a worker thread
+	void Append(const std::vector<Item>& items) { mItems.insert(mItems.end(), items.begin(), items.end()); }
+
+	// Stable sort by key, ascending
+	void Sort();
+
+	const std::vector<Item>& Items() const { return mItems; }
+
+private:
+	std::vector<Item> mItems;
+	std::vector<Item> mScratch;
+};
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// ringbuffer.cpp
+// ========
+// persistently mapped buffer split into one segment per frame in flight
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ringbuffer.h"
+
+#include <cstddef>
+
+#include "glstate.h"
+
+namespace
+{
+	// Flags shared by the storage and the mapping
+	const GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	// How long one glClientWaitSync may block before polling again (1 ms)
+	const GLuint64 WAIT_TIMEOUT = 1000000;
+}
+
+///////////////////////////////////////////////////
+//	Create(GLsizeiptr)
+//
+//	segmentSize: bytes available to one frame
+///////////////////////////////////////////////////
+void PersistentRingBuffer::Create(GLsizeiptr segmentSize)
+{
+	mSegment = 0;
+	stalls = 0;
+	UAllocate(segmentSize);
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Wait for the GPU to finish with every segment,
+//	then unmap and release the buffer
+///////////////////////////////////////////////////
+void PersistentRingBuffer::Destroy()
+{
+	for (GLuint i = 0; i < SEGMENTS; ++i)
+		UWait(i);
+
+	if (mBuffer != 0)
+	{
+		GLState::BindBuffer(GL_ARRAY_BUFFER, mBuffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::DeleteBuffers(1, &mBuffer);
+	}
+
+	mBuffer = 0;
+	mMapping = nullptr;
+	mSegmentSize = 0;
+}
+
+///////////////////////////////////////////////////
+//	Begin(GLsizeiptr)
+//
+//	bytes: size the caller is about to write
+//
+//	Return a write pointer to the current segment.
+//	Coherent mapping means no flush is needed after
+//	writing.
+///////////////////////////////////////////////////
+void* PersistentRingBuffer::Begin(GLsizeiptr bytes)
+{
+	if (bytes > mSegmentSize)
+	{
+		// the GPU may still read the old storage, drain it before replacing it
+		GLsizeiptr segmentSize = mSegmentSize > 0 ? mSegmentSize : bytes;
+		while (segmentSize < bytes)
+			segmentSize *= 2;
+		Destroy();
+		mSegment = 0;
+		UAllocate(segmentSize);
+	}
+
+	UWait(mSegment);
+	return mMapping + Offset();
+}
+
+///////////////////////////////////////////////////
+//	End()
+//
+//	Fence the commands that read the current segment
+//	and advance to the next one. Call after the last
+//	draw that sources the segment.
+///////////////////////////////////////////////////
+void PersistentRingBuffer::End()
+{
+	mFences[mSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mSegment = (mSegment + 1) % SEGMENTS;
+}
+
+///////////////////////////////////////////////////
+//	UAllocate(GLsizeiptr)
+//
+//	segmentSize: bytes available to one frame
+//
+//	Create immutable storage for every segment and
+//	map it for the lifetime of the buffer
+///////////////////////////////////////////////////
+void PersistentRingBuffer::UAllocate(GLsizeiptr segmentSize)
+{
+	mSegmentSize = segmentSize;
+
+	glGenBuffers(1, &mBuffer);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, mBuffer);
+	glBufferStorage(GL_ARRAY_BUFFER, mSegmentSize * SEGMENTS, NULL, MAP_FLAGS);
+	mMapping = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, mSegmentSize * SEGMENTS, MAP_FLAGS);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+///////////////////////////////////////////////////
+//	UWait(GLuint)
+//
+//	segment: segment about to be written
+//
+//	Block until the GPU has consumed the segment's
+//	previous contents
+///////////////////////////////////////////////////
+void PersistentRingBuffer::UWait(GLuint segment)
+{
+	GLsync& fence = mFences[segment];
+	if (fence == 0)
+		return;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		stalls++;
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(fence);
+	fence = 0;
+}
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// ringbuffer.h
+// ========
+// persistently mapped buffer split into one segment per frame in flight
+//
+// The CPU writes a frame's data straight into mapped GPU memory while the
+// GPU may still be reading the segments of up to SEGMENTS - 1 earlier
+// frames. A fence per segment stops the CPU from overwriting a segment the
+// GPU has not finished with, which also bounds how far the CPU can run
+// ahead.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+class PersistentRingBuffer
+{
+public:
+	// Frames in flight
+	static const GLuint SEGMENTS = 3;
+
+public:
+	void Create(GLsizeiptr segmentSize);
+	void Destroy();
+
+	// Wait for the current segment to be free and return its mapping.
+	// Grows every segment first if bytes does not fit.
+	void* Begin(GLsizeiptr bytes);
+	// Fence the current segment and move on to the next one
+	void End();
+
+	GLuint Buffer() const { return mBuffer; }
+	// Offset of the current segment from the start of Buffer()
+	GLintptr Offset() const { return (GLintptr)(mSegmentSize * mSegment); }
+
+	// Times Begin() had to block on the GPU
+	GLuint stalls = 0;
+
+private:
+	void UAllocate(GLsizeiptr segmentSize);
+	void UWait(GLuint segment);
+
+	GLuint mBuffer = 0;
+	GLsizeiptr mSegmentSize = 0;
+	GLuint mSegment = 0;
+	unsigned char* mMapping = nullptr;
+	GLsync mFences[SEGMENTS] = {};
+};
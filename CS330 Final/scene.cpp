@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// scene.cpp
+// ========
+// structure-of-arrays store for every object drawn by URender()
+///////////////////////////////////////////////////////////////////////////////
+
+#include "scene.h"
+
+#include <algorithm>
+
+#include <glm/gtx/transform.hpp>
+
+///////////////////////////////////////////////////
+//	AddMaterial(const SceneMaterial&)
+//
+//	material: colour and key light settings
+//
+//	Append a material to the material table and
+//	return its index
+///////////////////////////////////////////////////
+GLuint Scene::AddMaterial(const SceneMaterial& material)
+{
+	materialTable.push_back(material);
+	mStateVersion++;
+	return (GLuint)(materialTable.size() - 1);
+}
+
+///////////////////////////////////////////////////
+//	AddGroup(const char*, GLint, glm::vec3)
+//
+//	name: debug name of the group
+//	parent: parent node, or NO_PARENT
+//	translation: position relative to the parent
+//
+//	Append a transform node with nothing to draw,
+//	used as the anchor of a composite prop. Return
+//	the node index.
+///////////////////////////////////////////////////
+GLuint Scene::AddGroup(const char* name, GLint parent, glm::vec3 translation)
+{
+	return UAddNode(name, parent, glm::translate(translation), -1);
+}
+
+///////////////////////////////////////////////////
+//	AddEntity(...)
+//
+//	name: debug name of the entity
+//	mesh: mesh drawn by the entity
+//	material: index returned by AddMaterial()
+//	textureSlot: texture unit the entity samples
+//	scale, angle, axis, translation: model transform,
+//		relative to the parent node
+//	parent: parent node, or NO_PARENT
+//
+//	Append one entity to every column and return
+//	its index. Use entityNodes[index] to move it.
+///////////////////////////////////////////////////
+GLuint Scene::AddEntity(const char* name, const Meshes::GLMesh& mesh, GLuint material, GLint textureSlot,
+	glm::vec3 scale, float angle, glm::vec3 axis, glm::vec3 translation, GLint parent)
+{
+	const GLuint entity = (GLuint)models.size();
+
+	// Model matrix: transformations are applied right-to-left order
+	const glm::mat4 local = glm::translate(translation) * glm::rotate(angle, axis) * glm::scale(scale);
+	const GLuint node = UAddNode(name, parent, local, (GLint)entity);
+
+	models.push_back(nodeWorlds[node]);
+	entityNodes.push_back(node);
+	meshes.push_back(&mesh);
+
+	// copy the mesh's draw commands so the entity owns its slice of the range table
+	rangeFirst.push_back((GLuint)drawRanges.size());
+	rangeCount.push_back(mesh.nRanges);
+	for (GLuint i = 0; i < mesh.nRanges; ++i)
+		drawRanges.push_back(mesh.ranges[i]);
+
+	materials.push_back(material);
+	textureSlots.push_back(textureSlot);
+	names.push_back(name);
+	mStateVersion++;
+
+	boundsX.push_back(0.0f);
+	boundsY.push_back(0.0f);
+	boundsZ.push_back(0.0f);
+	boundsRadius.push_back(0.0f);
+	boundsMin.push_back(glm::vec3(0.0f));
+	boundsMax.push_back(glm::vec3(0.0f));
+	UUpdateBounds(entity);
+
+	return entity;
+}
+
+///////////////////////////////////////////////////
+//	AddOccluder(GLuint, glm::vec3, glm::vec3)
+//
+//	entity: solid entity that hides what is behind it
+//	boxMin, boxMax: object space box fully inside the
+//		entity's mesh
+//
+//	Register a box for the software occlusion pass.
+//	A box larger than the mesh would hide objects
+//	that are really in view.
+///////////////////////////////////////////////////
+void Scene::AddOccluder(GLuint entity, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+	occluders.push_back({ entity, boxMin, boxMax });
+}
+
+///////////////////////////////////////////////////
+//	SetLocalTransform(GLuint, const glm::mat4&)
+//
+//	node: node to move
+//	local: new transform relative to the parent
+//
+//	Only flags the node; the node and its subtree are
+//	recomputed by the next UpdateTransforms()
+///////////////////////////////////////////////////
+void Scene::SetLocalTransform(GLuint node, const glm::mat4& local)
+{
+	nodeLocals[node] = local;
+	nodeDirty[node] = 1;
+}
+
+///////////////////////////////////////////////////
+//	SetMaterial(GLuint, GLuint)
+//
+//	entity: entity to change
+//	material: index returned by AddMaterial()
+//
+//	The new material may move the entity to the
+//	other pass, so the renderer re-keys it
+///////////////////////////////////////////////////
+void Scene::SetMaterial(GLuint entity, GLuint material)
+{
+	materials[entity] = material;
+	mStateVersion++;
+}
+
+///////////////////////////////////////////////////
+//	SetTextureSlot(GLuint, GLint)
+//
+//	entity: entity to change
+//	textureSlot: texture unit the entity samples
+///////////////////////////////////////////////////
+void Scene::SetTextureSlot(GLuint entity, GLint textureSlot)
+{
+	textureSlots[entity] = textureSlot;
+	mStateVersion++;
+}
+
+///////////////////////////////////////////////////
+//	UpdateMaterial(GLuint, const SceneMaterial&)
+//
+//	material: index returned by AddMaterial()
+//	settings: new colour and key light settings
+//
+//	The renderer uploads the table again and re-keys
+//	the entities, whose pass follows the alpha
+///////////////////////////////////////////////////
+void Scene::UpdateMaterial(GLuint material, const SceneMaterial& settings)
+{
+	materialTable[material] = settings;
+	mStateVersion++;
+}
+
+///////////////////////////////////////////////////
+//	UpdateTransforms()
+//
+//	Refresh the world matrix of every dirty node and
+//	every node below one, and copy the result into
+//	the entity model column. Parents precede their
+//	children, so a parent is always final before its
+//	children are visited. Return the number of
+//	matrices recomputed, zero for a static frame.
+///////////////////////////////////////////////////
+GLuint Scene::UpdateTransforms()
+{
+	GLuint updated = 0;
+
+	for (size_t i = 0; i < nodeLocals.size(); ++i)
+	{
+		const GLint parent = nodeParents[i];
+
+		// a dirty parent passes its flag down to the whole subtree
+		if (parent != NO_PARENT && nodeDirty[parent])
+			nodeDirty[i] = 1;
+
+		if (!nodeDirty[i])
+			continue;
+
+		nodeWorlds[i] = parent == NO_PARENT ? nodeLocals[i] : nodeWorlds[parent] * nodeLocals[i];
+		if (nodeEntities[i] >= 0)
+		{
+			models[nodeEntities[i]] = nodeWorlds[i];
+			UUpdateBounds((GLuint)nodeEntities[i]);
+		}
+		updated++;
+	}
+
+	// cleared after the pass, children read their parent's flag above
+	if (updated > 0)
+		std::fill(nodeDirty.begin(), nodeDirty.end(), 0);
+
+	return updated;
+}
+
+///////////////////////////////////////////////////
+//	UUpdateBounds(GLuint)
+//
+//	entity: entity whose model matrix changed
+//
+//	Move the mesh's object space bounds into world
+//	space. The sphere radius grows with the largest
+//	axis scale; the box is re-fitted around the
+//	transformed box (Arvo's method).
+///////////////////////////////////////////////////
+void Scene::UUpdateBounds(GLuint entity)
+{
+	const glm::mat4& m = models[entity];
+	const Meshes::GLMesh& mesh = *meshes[entity];
+
+	const glm::vec3 center(m * glm::vec4(mesh.sphereCenter, 1.0f));
+	const float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+	boundsX[entity] = center.x;
+	boundsY[entity] = center.y;
+	boundsZ[entity] = center.z;
+	boundsRadius[entity] = mesh.sphereRadius * scale;
+
+	const glm::vec3 boxCenter(m * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+	const glm::vec3 boxExtent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+	const glm::vec3 worldExtent =
+		glm::abs(glm::vec3(m[0])) * boxExtent.x +
+		glm::abs(glm::vec3(m[1])) * boxExtent.y +
+		glm::abs(glm::vec3(m[2])) * boxExtent.z;
+	boundsMin[entity] = boxCenter - worldExtent;
+	boundsMax[entity] = boxCenter + worldExtent;
+}
+
+///////////////////////////////////////////////////
+//	UAddNode(const char*, GLint, const glm::mat4&, GLint)
+//
+//	name: debug name of the node
+//	parent: parent node, or NO_PARENT
+//	local: transform relative to the parent
+//	entity: entity drawn with the node, -1 for groups
+//
+//	Append a node with its world matrix already
+//	resolved and return its index
+///////////////////////////////////////////////////
+GLuint Scene::UAddNode(const char* name, GLint parent, const glm::mat4& local, GLint entity)
+{
+	nodeLocals.push_back(local);
+	nodeWorlds.push_back(parent == NO_PARENT ? local : nodeWorlds[parent] * local);
+	nodeParents.push_back(parent);
+	nodeEntities.push_back(entity);
+	nodeDirty.push_back(0);
+	nodeNames.push_back(name);
+
+	return (GLuint)(nodeLocals.size() - 1);
+}
+
+///////////////////////////////////////////////////
+//	Clear()
+//
+//	Remove every entity, node and material
+///////////////////////////////////////////////////
+void Scene::Clear()
+{
+	models.clear();
+	meshes.clear();
+	rangeFirst.clear();
+	rangeCount.clear();
+	materials.clear();
+	textureSlots.clear();
+	names.clear();
+	entityNodes.clear();
+	boundsX.clear();
+	boundsY.clear();
+	boundsZ.clear();
+	boundsRadius.clear();
+	boundsMin.clear();
+	boundsMax.clear();
+	nodeLocals.clear();
+	nodeWorlds.clear();
+	nodeParents.clear();
+	nodeEntities.clear();
+	nodeDirty.clear();
+	nodeNames.clear();
+	drawRanges.clear();
+	materialTable.clear();
+	occluders.clear();
+	mStateVersion++;
+}
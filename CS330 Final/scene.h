@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// scene.h
+// ========
+// structure-of-arrays store for every object drawn by URender()
+//
+// Each entity is one row spread across the column vectors below, so the
+// render loop walks a handful of contiguous arrays instead of hand written
+// draw blocks.
+//
+// Placement is a parent/child transform hierarchy stored the same way. Every
+// entity owns one node, and group nodes tie the parts of a composite prop
+// together. Parents are always created before their children, so one
+// forward pass over the node columns can refresh the world matrices. Only
+// nodes flagged dirty (or under a dirty parent) are recomputed.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "meshes.h"
+
+// Colour and key light settings shared by all entities that reference them
+struct SceneMaterial
+{
+	glm::vec4 objectColor;      // Colour used when the entity has no texture
+	glm::vec3 light1Color;      // Key light colour
+	glm::vec3 light1Position;   // Key light position in world space
+	float specularIntensity1;   // Key light specular intensity
+	float highlightSize1;       // Key light specular highlight size
+};
+
+// Box inside a solid entity that is rasterized to hide what is behind it
+struct SceneOccluder
+{
+	GLuint entity;      // Entity the box moves with
+	glm::vec3 boxMin;   // Box in the entity's object space, must not poke out of the mesh
+	glm::vec3 boxMax;
+};
+
+class Scene
+{
+public:
+	// Parent index of root nodes
+	static const GLint NO_PARENT = -1;
+
+	// Entity columns: index i of every vector describes entity i
+	std::vector<glm::mat4> models;                  // World (model) matrix, copied from the entity's node
+	std::vector<const Meshes::GLMesh*> meshes;      // Mesh the entity draws
+	std::vector<GLuint> rangeFirst;                 // First entry in drawRanges
+	std::vector<GLuint> rangeCount;                 // Number of entries in drawRanges
+	std::vector<GLuint> materials;                  // Index into materialTable, change with SetMaterial()
+	std::vector<GLint> textureSlots;                // Texture unit sampled by uTexture, change with SetTextureSlot()
+	std::vector<std::string> names;                 // Debug name, only read off the hot path
+	std::vector<GLuint> entityNodes;                // Transform node of the entity
+
+	// World space bounds of each entity, split per component so culling can load 4-8 at once
+	std::vector<float> boundsX;                     // Bounding sphere centre
+	std::vector<float> boundsY;
+	std::vector<float> boundsZ;
+	std::vector<float> boundsRadius;
+	std::vector<glm::vec3> boundsMin;               // Bounding box
+	std::vector<glm::vec3> boundsMax;
+
+	// Node columns: index i of every vector describes transform node i
+	std::vector<glm::mat4> nodeLocals;              // Transform relative to the parent
+	std::vector<glm::mat4> nodeWorlds;              // Cached parent world * local
+	std::vector<GLint> nodeParents;                 // Parent node, NO_PARENT for roots
+	std::vector<GLint> nodeEntities;                // Entity drawn with the node, -1 for groups
+	std::vector<unsigned char> nodeDirty;           // Local changed since the last update
+	std::vector<std::string> nodeNames;             // Debug name, only read off the hot path
+
+	// Shared tables referenced by the columns
+	std::vector<Meshes::GLDrawRange> drawRanges;
+	std::vector<SceneMaterial> materialTable;       // Change entries with UpdateMaterial()
+	std::vector<SceneOccluder> occluders;
+
+public:
+	GLuint AddMaterial(const SceneMaterial& material);
+	GLuint AddGroup(const char* name, GLint parent, glm::vec3 translation);
+	GLuint AddEntity(const char* name, const Meshes::GLMesh& mesh, GLuint material, GLint textureSlot,
+		glm::vec3 scale, float angle, glm::vec3 axis, glm::vec3 translation, GLint parent = NO_PARENT);
+
+	void AddOccluder(GLuint entity, glm::vec3 boxMin, glm::vec3 boxMax);
+
+	void SetLocalTransform(GLuint node, const glm::mat4& local);
+	GLuint UpdateTransforms();
+
+	// Changes to what the renderer groups entities by; each one bumps StateVersion()
+	void SetMaterial(GLuint entity, GLuint material);
+	void SetTextureSlot(GLuint entity, GLint textureSlot);
+	void UpdateMaterial(GLuint material, const SceneMaterial& settings);
+	// Changes whenever entities, materials or texture slots are added or changed
+	GLuint StateVersion() const { return mStateVersion; }
+
+	size_t Count() const { return models.size(); }
+	void Clear();
+
+private:
+	void UUpdateBounds(GLuint entity);
+	GLuint UAddNode(const char* name, GLint parent, const glm::mat4& local, GLint entity);
+
+	GLuint mStateVersion = 0;
+};
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// simulationclock.cpp
+// ========
+// fixed-step clock that drives the simulation on the input thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "simulationclock.h"
+
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////
+//	Start(double)
+//
+//	now: glfwGetTime() seconds
+///////////////////////////////////////////////////
+void SimulationClock::Start(double now)
+{
+	mStepTime = now;
+	stats = {};
+}
+
+///////////////////////////////////////////////////
+//	Advance(double)
+//
+//	now: glfwGetTime() seconds
+//
+//	Move the clock one STEP at a time while a whole
+//	step of accumulated time is left. The part of a
+//	step left over stays in the accumulator for the
+//	next call.
+///////////////////////////////////////////////////
+GLuint SimulationClock::Advance(double now)
+{
+	const double step = STEP;
+
+	GLuint steps = 0;
+	while (now - mStepTime >= step && steps < MAX_STEPS)
+	{
+		mStepTime += step;
+		steps++;
+	}
+
+	// too far behind to catch up within MAX_STEPS, give up the whole steps still due
+	if (now - mStepTime >= step)
+	{
+		const double dropped = std::floor((now - mStepTime) / step) * step;
+		mStepTime += dropped;
+		stats.dropped += dropped;
+	}
+
+	stats.steps += steps;
+	return steps;
+}
+
+///////////////////////////////////////////////////
+//	TimeToNextStep(double)
+//
+//	now: glfwGetTime() seconds
+///////////////////////////////////////////////////
+double SimulationClock::TimeToNextStep(double now) const
+{
+	return std::max(0.0, mStepTime + STEP - now);
+}
+
+///////////////////////////////////////////////////
+//	Alpha(double, double)
+//
+//	stepTime: StepTime() of the state being drawn
+//	now: glfwGetTime() seconds of the frame
+//
+//	A frame at stepTime shows the previous step, one
+//	a full STEP later shows the latest. When the
+//	simulation falls behind the latest step is held.
+///////////////////////////////////////////////////
+float SimulationClock::Alpha(double stepTime, double now)
+{
+	const double alpha = (now - stepTime) / STEP;
+	return (float)std::min(1.0, std::max(0.0, alpha));
+}
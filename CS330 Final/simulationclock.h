@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// simulationclock.h
+// ========
+// fixed-step clock that drives the simulation on the input thread
+//
+// The simulation only ever advances by STEP seconds, so camera movement and
+// anything animated later come out the same at any frame rate. Advance()
+// works out how many steps are due: the accumulator is the wall time since
+// the latest step, and every whole STEP in it is one more step to run. At
+// most MAX_STEPS run per call; time beyond that is dropped rather than
+// caught up, so a stall cannot snowball into ever longer catch-up bursts.
+//
+// The render thread draws one step behind and blends between the two
+// latest steps by Alpha(), so motion stays smooth whatever rate it draws at.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+// Counters since Start()
+struct SimulationStats
+{
+	unsigned long steps;    // Steps run
+	double dropped;         // Seconds skipped because more than MAX_STEPS were due
+};
+
+class SimulationClock
+{
+public:
+	// Seconds of simulated time per step
+	static constexpr double STEP = 1.0 / 120.0;
+	// Steps one Advance() runs at most
+	static const GLuint MAX_STEPS = 8;
+
+	SimulationStats stats = {};
+
+public:
+	// Start counting from now, the state at this moment is the first step
+	void Start(double now);
+
+	// Number of steps due by now; the caller runs exactly that many
+	GLuint Advance(double now);
+
+	// Wall clock time the latest step stands for
+	double StepTime() const { return mStepTime; }
+	// Seconds until the next step is due, 0 when it already is
+	double TimeToNextStep(double now) const;
+
+	// Blend factor between the step before stepTime (0) and the step at stepTime (1)
+	// for a frame drawn at now, one step behind
+	static float Alpha(double stepTime, double now);
+
+private:
+	double mStepTime = 0.0;
+};
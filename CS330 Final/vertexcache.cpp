@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexcache.cpp
+// ========
+// reorder indexed triangle lists for the post-transform vertex cache and for
+// vertex fetch locality
+///////////////////////////////////////////////////////////////////////////////
+
+#include "vertexcache.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	const GLuint NO_VERTEX = ~0u;
+
+	// Triangles around every vertex, packed: the triangles of v are
+	// triangles[first[v]] to triangles[first[v + 1] - 1]
+	struct Adjacency
+	{
+		std::vector<GLuint> first;
+		std::vector<GLuint> triangles;
+	};
+
+	void UBuildAdjacency(const GLuint* indices, size_t indexCount, GLuint vertexCount, Adjacency& adjacency)
+	{
+		adjacency.first.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency.first[indices[i] + 1]++;
+		for (GLuint v = 0; v < vertexCount; ++v)
+			adjacency.first[v + 1] += adjacency.first[v];
+
+		std::vector<GLuint> fill(adjacency.first.begin(), adjacency.first.end() - 1);
+		adjacency.triangles.resize(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency.triangles[fill[indices[i]]++] = (GLuint)(i / 3);
+	}
+
+	///////////////////////////////////////////////////
+	//	USkipDeadEnd(...)
+	//
+	//	No vertex of the last fan has triangles left:
+	//	go back through the vertices emitted so far,
+	//	newest first, then scan forward from cursor
+	//	for any vertex that still has some
+	///////////////////////////////////////////////////
+	GLuint USkipDeadEnd(const std::vector<GLuint>& live, std::vector<GLuint>& deadEnds, GLuint& cursor, GLuint vertexCount)
+	{
+		while (!deadEnds.empty())
+		{
+			const GLuint v = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[v] > 0)
+				return v;
+		}
+
+		for (; cursor < vertexCount; ++cursor)
+		{
+			if (live[cursor] > 0)
+				return cursor;
+		}
+		return NO_VERTEX;
+	}
+}
+
+///////////////////////////////////////////////////
+//	SimulateCacheMisses(const GLuint*, size_t, GLuint, GLuint)
+//
+//	indices: triangle list
+//	indexCount: number of indices
+//	vertexCount: vertices the indices refer to
+//	cacheSize: FIFO entries
+///////////////////////////////////////////////////
+GLuint SimulateCacheMisses(const GLuint* indices, size_t indexCount, GLuint vertexCount, GLuint cacheSize)
+{
+	// a vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+	std::vector<GLuint> loadedAt(vertexCount, 0);
+	GLuint misses = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const GLuint v = indices[i];
+		if (loadedAt[v] == 0 || misses - (loadedAt[v] - 1) >= cacheSize)
+		{
+			misses++;
+			loadedAt[v] = misses;
+		}
+	}
+	return misses;
+}
+
+///////////////////////////////////////////////////
+//	OptimizeVertexCache(GLuint*, size_t, GLuint, GLuint)
+//
+//	indices: triangle list, reordered in place
+//	indexCount: number of indices, a multiple of 3
+//	vertexCount: vertices the indices refer to
+//	cacheSize: cache entries to plan for
+//
+//	Emit every unemitted triangle around the fanning
+//	vertex, giving each new vertex a time stamp. The
+//	next fanning vertex is the one of that fan still
+//	in the cache the longest that will stay there
+//	while its remaining triangles are emitted, with
+//	USkipDeadEnd() when none has triangles left.
+//	The input order is kept when the FIFO simulation
+//	says it was better already.
+///////////////////////////////////////////////////
+void OptimizeVertexCache(GLuint* indices, size_t indexCount, GLuint vertexCount, GLuint cacheSize)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2 || vertexCount == 0)
+		return;
+
+	Adjacency adjacency;
+	UBuildAdjacency(indices, indexCount, vertexCount, adjacency);
+
+	// triangles not yet emitted around each vertex
+	std::vector<GLuint> live(vertexCount);
+	for (GLuint v = 0; v < vertexCount; ++v)
+		live[v] = adjacency.first[v + 1] - adjacency.first[v];
+
+	std::vector<GLuint> stamps(vertexCount, 0);
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	std::vector<GLuint> deadEnds;
+	std::vector<GLuint> candidates;
+	std::vector<GLuint> output;
+	output.reserve(triangleCount * 3);
+
+	GLuint time = cacheSize + 1;
+	GLuint cursor = 0;
+	GLuint fan = USkipDeadEnd(live, deadEnds, cursor, vertexCount);
+	while (fan != NO_VERTEX)
+	{
+		candidates.clear();
+		for (GLuint a = adjacency.first[fan]; a < adjacency.first[fan + 1]; ++a)
+		{
+			const GLuint t = adjacency.triangles[a];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+
+			for (GLuint corner = 0; corner < 3; ++corner)
+			{
+				const GLuint v = indices[t * 3 + corner];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - stamps[v] > cacheSize)
+					stamps[v] = time++;
+			}
+		}
+
+		// the candidate that has been in the cache longest and will not fall out of it
+		GLuint next = NO_VERTEX;
+		int best = -1;
+		for (GLuint v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - stamps[v] + 2 * live[v] <= cacheSize)
+				priority = (int)(time - stamps[v]);
+			if (priority > best)
+			{
+				best = priority;
+				next = v;
+			}
+		}
+
+		fan = next != NO_VERTEX ? next : USkipDeadEnd(live, deadEnds, cursor, vertexCount);
+	}
+
+	// fans suit grids, a strip that is already in order can come out worse
+	if (SimulateCacheMisses(output.data(), indexCount, vertexCount, cacheSize) < SimulateCacheMisses(indices, indexCount, vertexCount, cacheSize))
+		std::copy(output.begin(), output.end(), indices);
+}
+
+///////////////////////////////////////////////////
+//	OptimizeVertexFetch(GLfloat*, GLuint, GLuint, GLuint*, size_t)
+//
+//	vertices: interleaved vertex data, reordered in place
+//	floatsPerVertex: stride of vertices in floats
+//	vertexCount: number of vertices
+//	indices: triangle list, renumbered in place
+//	indexCount: number of indices
+///////////////////////////////////////////////////
+void OptimizeVertexFetch(GLfloat* vertices, GLuint floatsPerVertex, GLuint vertexCount, GLuint* indices, size_t indexCount)
+{
+	std::vector<GLuint> remap(vertexCount, NO_VERTEX);
+	GLuint next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		GLuint& target = remap[indices[i]];
+		if (target == NO_VERTEX)
+			target = next++;
+		indices[i] = target;
+	}
+	for (GLuint v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] == NO_VERTEX)
+			remap[v] = next++;
+	}
+
+	const std::vector<GLfloat> source(vertices, vertices + (size_t)vertexCount * floatsPerVertex);
+	for (GLuint v = 0; v < vertexCount; ++v)
+		std::copy(&source[(size_t)v * floatsPerVertex], &source[(size_t)v * floatsPerVertex] + floatsPerVertex, vertices + (size_t)remap[v] * floatsPerVertex);
+}
@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexcache.h
+// ========
+// reorder indexed triangle lists for the post-transform vertex cache and for
+// vertex fetch locality
+//
+// The GPU keeps the last few transformed vertices, so a triangle that reuses
+// them skips the vertex shader for those corners. How often that happens is
+// measured as the ACMR, vertices transformed per triangle: 3 with no reuse,
+// about 0.5 for a closed grid in an ideal order.
+//
+// OptimizeVertexCache() is Tipsify (Sander, Nehab and Barczak, "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007). It
+// fans out around one vertex at a time and picks the next fan among the
+// vertices just emitted, preferring ones still in the cache. It runs in
+// linear time, so every mesh and detail level goes through it at startup.
+//
+// OptimizeVertexFetch() then renumbers the vertices in the order the new
+// index list first uses them, so the vertex fetch walks memory forward.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+// Entries of the post-transform cache the reorder targets and the ACMR is measured with
+const GLuint VERTEX_CACHE_SIZE = 16;
+
+// Vertices a FIFO cache of cacheSize entries transforms for the indices, divide by the
+// triangle count for the ACMR
+GLuint SimulateCacheMisses(const GLuint* indices, size_t indexCount, GLuint vertexCount, GLuint cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder the triangles of an indexed list in place for a cache of cacheSize entries,
+// unless the order they are in already misses less
+void OptimizeVertexCache(GLuint* indices, size_t indexCount, GLuint vertexCount, GLuint cacheSize = VERTEX_CACHE_SIZE);
+
+// Renumber the vertices in first use order and move the interleaved vertex data to
+// match. Vertices no index uses keep their relative order at the end.
+void OptimizeVertexFetch(GLfloat* vertices, GLuint floatsPerVertex, GLuint vertexCount, GLuint* indices, size_t indexCount);
@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.cpp
+// ========
+// packed 16 byte vertex layout and the encoders behind it
+///////////////////////////////////////////////////////////////////////////////
+
+#include "vertexformat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Floats per interleaved position, normal, texture coordinate vertex
+	const GLuint FLOATS_PER_VERTEX = 8;
+	// Largest magnitude of a 10-bit signed normalized field
+	const float SNORM10_MAX = 511.0f;
+
+	float USignNotZero(float value)
+	{
+		return value < 0.0f ? -1.0f : 1.0f;
+	}
+
+	GLuint UPackSnorm10(float value)
+	{
+		const int quantized = (int)std::lround(std::min(std::max(value, -1.0f), 1.0f) * SNORM10_MAX);
+		return (GLuint)quantized & 0x3ffu;
+	}
+
+	float UUnpackSnorm10(GLuint bits)
+	{
+		// sign extend the 10-bit field, then the GL 4.2 rule: c / 511 clamped to -1
+		const int value = (int)(bits << 22) >> 22;
+		return std::max(value / SNORM10_MAX, -1.0f);
+	}
+}
+
+///////////////////////////////////////////////////
+//	FloatToHalf(float)
+//
+//	value: float to convert
+//
+//	Values below the smallest normal half become
+//	denormals, NaN stays NaN.
+///////////////////////////////////////////////////
+GLushort FloatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const GLushort sign = (GLushort)((bits >> 16) & 0x8000u);
+	const uint32_t magnitude = bits & 0x7fffffffu;
+
+	if (magnitude >= 0x7f800000u)
+		return sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u);
+	// 65520 and up round to infinity
+	if (magnitude >= 0x477ff000u)
+		return sign | 0x7c00u;
+
+	if (magnitude < 0x38800000u)
+	{
+		// denormal half: shift the mantissa with its implicit bit into place, rounding to nearest even
+		if (magnitude < 0x33000000u)
+			return sign;
+		const uint32_t exponent = magnitude >> 23;
+		const uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+		const uint32_t shift = 126 - exponent;
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return sign | (GLushort)half;
+	}
+
+	// rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits to nearest even
+	uint32_t half = (magnitude - 0x38000000u) >> 13;
+	const uint32_t remainder = magnitude & 0x1fffu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1)))
+		half++;
+	return sign | (GLushort)half;
+}
+
+///////////////////////////////////////////////////
+//	HalfToFloat(GLushort)
+//
+//	half: half float bits
+///////////////////////////////////////////////////
+float HalfToFloat(GLushort half)
+{
+	const uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1fu;
+	const uint32_t mantissa = half & 0x3ffu;
+
+	float value;
+	if (exponent == 0)
+		value = std::ldexp((float)mantissa, -24);
+	else if (exponent == 31)
+		value = mantissa == 0 ? INFINITY : NAN;
+	else
+		value = std::ldexp((float)(mantissa | 0x400u), (int)exponent - 25);
+
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	bits |= sign;
+	std::memcpy(&value, &bits, sizeof(bits));
+	return value;
+}
+
+///////////////////////////////////////////////////
+//	EncodeOctahedral(const glm::vec3&)
+//
+//	normal: unit vector
+//
+//	Project onto the octahedron |x|+|y|+|z| = 1 and
+//	fold the lower half over the upper one, giving a
+//	point in the [-1, 1] square.
+///////////////////////////////////////////////////
+GLuint EncodeOctahedral(const glm::vec3& normal)
+{
+	const float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	float x = sum > 0.0f ? normal.x / sum : 0.0f;
+	float y = sum > 0.0f ? normal.y / sum : 0.0f;
+	if (normal.z < 0.0f)
+	{
+		const float foldedX = (1.0f - std::fabs(y)) * USignNotZero(x);
+		const float foldedY = (1.0f - std::fabs(x)) * USignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+	return UPackSnorm10(x) | (UPackSnorm10(y) << 10);
+}
+
+///////////////////////////////////////////////////
+//	DecodeOctahedral(GLuint)
+//
+//	packed: word written by EncodeOctahedral()
+//
+//	The same steps as the surface vertex shader
+///////////////////////////////////////////////////
+glm::vec3 DecodeOctahedral(GLuint packed)
+{
+	const float x = UUnpackSnorm10(packed & 0x3ffu);
+	const float y = UUnpackSnorm10((packed >> 10) & 0x3ffu);
+	glm::vec3 normal(x, y, 1.0f - std::fabs(x) - std::fabs(y));
+	if (normal.z < 0.0f)
+	{
+		normal.x = (1.0f - std::fabs(y)) * USignNotZero(x);
+		normal.y = (1.0f - std::fabs(x)) * USignNotZero(y);
+	}
+	return glm::normalize(normal);
+}
+
+///////////////////////////////////////////////////
+//	PackVertices(const GLfloat*, GLuint, const glm::vec3&, float, PackedVertex*)
+//
+//	vertices: interleaved position/normal/uv floats
+//	count: number of vertices
+//	offset, scale: cube the positions are stored in
+//	packed: receives count vertices
+///////////////////////////////////////////////////
+void PackVertices(const GLfloat* vertices, GLuint count, const glm::vec3& offset, float scale, PackedVertex* packed)
+{
+	const float toUnit = 1.0f / scale;
+	for (GLuint v = 0; v < count; ++v)
+	{
+		const GLfloat* source = vertices + v * FLOATS_PER_VERTEX;
+		PackedVertex& target = packed[v];
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float unit = std::min(std::max((source[axis] - offset[axis]) * toUnit, 0.0f), 1.0f);
+			target.position[axis] = (GLushort)std::lround(unit * 65535.0f);
+		}
+		target.position[3] = 0;
+
+		target.normal = EncodeOctahedral(glm::vec3(source[3], source[4], source[5]));
+		target.uv[0] = FloatToHalf(source[6]);
+		target.uv[1] = FloatToHalf(source[7]);
+	}
+}
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.h
+// ========
+// packed 16 byte vertex layout and the encoders behind it
+//
+// The float layout spends 32 bytes per vertex. The packed one stores:
+//   - the position as three 16-bit unsigned normalized values inside the
+//     cube around the mesh's bounding box, plus one pad short
+//   - the normal octahedral encoded in the x and y fields of a
+//     GL_INT_2_10_10_10_REV word, with w left at 0 so the vertex shader can
+//     tell it from a float normal, whose missing w reads as 1
+//   - the texture coordinate as two half floats
+//
+// The cube is one scale on all three axes, so the decode, offset plus
+// scale times the stored value, is a uniform scale and translation. It is
+// folded into the model matrix of each draw (see DrawListBuilder::Write)
+// and normals need no correction. The error is at most half a step of
+// 1/65535 of the largest side, far below a pixel.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// One vertex of the packed layout
+struct PackedVertex
+{
+	GLushort position[4];   // xyz unsigned normalized inside the mesh's cube, w unused
+	GLuint normal;          // GL_INT_2_10_10_10_REV, octahedral x and y, z and w 0
+	GLushort uv[2];         // Half floats
+};
+
+// Half float bits of value, rounded to nearest even; out of range values saturate to infinity
+GLushort FloatToHalf(float value);
+float HalfToFloat(GLushort half);
+
+// Unit vector to and from the GL_INT_2_10_10_10_REV octahedral word
+GLuint EncodeOctahedral(const glm::vec3& normal);
+glm::vec3 DecodeOctahedral(GLuint packed);
+
+// Pack count interleaved position/normal/uv float vertices. A position p is
+// stored as (p - offset) / scale, which must fall inside the unit cube.
+void PackVertices(const GLfloat* vertices, GLuint count, const glm::vec3& offset, float scale, PackedVertex* packed);
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexweld.cpp
+// ========
+// merge duplicated vertices of an interleaved vertex array
+///////////////////////////////////////////////////////////////////////////////
+
+#include "vertexweld.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const GLuint EMPTY_SLOT = ~0u;
+
+	// FNV-1a over the float bits, then a final mix so the low bits the table uses spread well
+	uint32_t UHashVertex(const GLfloat* vertex, GLuint floatsPerVertex)
+	{
+		uint32_t hash = 2166136261u;
+		for (GLuint i = 0; i < floatsPerVertex; ++i)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &vertex[i], sizeof(bits));
+			hash = (hash ^ bits) * 16777619u;
+		}
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6bu;
+		hash ^= hash >> 13;
+		return hash;
+	}
+}
+
+///////////////////////////////////////////////////
+//	WeldVertices(GLfloat*, GLuint, GLuint, GLuint*)
+//
+//	vertices: interleaved vertex data, packed in place
+//	floatsPerVertex: stride of vertices in floats
+//	vertexCount: number of vertices
+//	remap: receives vertexCount new indices
+//
+//	Open addressing with linear probing in a table
+//	at most half full. A vertex is only ever moved
+//	to an index at or below its own, so the packing
+//	can overwrite the array as it goes.
+///////////////////////////////////////////////////
+GLuint WeldVertices(GLfloat* vertices, GLuint floatsPerVertex, GLuint vertexCount, GLuint* remap)
+{
+	for (size_t i = 0; i < (size_t)vertexCount * floatsPerVertex; ++i)
+	{
+		if (vertices[i] == 0.0f)
+			vertices[i] = 0.0f;
+	}
+
+	GLuint capacity = 16;
+	while (capacity < vertexCount * 2)
+		capacity *= 2;
+	std::vector<GLuint> table(capacity, EMPTY_SLOT);
+
+	const size_t vertexBytes = sizeof(GLfloat) * floatsPerVertex;
+	GLuint unique = 0;
+	for (GLuint v = 0; v < vertexCount; ++v)
+	{
+		const GLfloat* vertex = vertices + (size_t)v * floatsPerVertex;
+		GLuint slot = UHashVertex(vertex, floatsPerVertex) & (capacity - 1);
+		while (table[slot] != EMPTY_SLOT &&
+			std::memcmp(vertices + (size_t)table[slot] * floatsPerVertex, vertex, vertexBytes) != 0)
+		{
+			slot = (slot + 1) & (capacity - 1);
+		}
+
+		if (table[slot] == EMPTY_SLOT)
+		{
+			if (unique != v)
+				std::copy(vertex, vertex + floatsPerVertex, vertices + (size_t)unique * floatsPerVertex);
+			table[slot] = unique++;
+		}
+		remap[v] = table[slot];
+	}
+	return unique;
+}
@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexweld.h
+// ========
+// merge duplicated vertices of an interleaved vertex array
+//
+// The hand written tables and the array ranges repeat a vertex once per
+// triangle that touches it. WeldVertices() keeps one copy of each distinct
+// vertex, found through a hash table over the raw float bits, and gives
+// the remap that rewrites the indices to the copies kept. Vertices that
+// differ in any attribute, such as the two sides of a texture seam or the
+// faces meeting at a hard edge, stay separate.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+// Pack the distinct vertices to the front of vertices in the order they first
+// appear and return how many there are. remap[v] receives the new index of
+// vertex v. -0.0f is turned into 0.0f first so the two compare equal.
+GLuint WeldVertices(GLfloat* vertices, GLuint floatsPerVertex, GLuint vertexCount, GLuint* remap);
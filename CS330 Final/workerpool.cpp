@@ -0,0 +1,469 @@
+///////////////////////////////////////////////////////////////////////////////
+// workerpool.cpp
+// ========
+// work-stealing job scheduler shared by every system that splits its work
+///////////////////////////////////////////////////////////////////////////////
+
+#include "workerpool.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Failed rounds over every deque before an idle worker goes to sleep
+	const int SPIN_ROUNDS = 64;
+
+	// Pool and slot of the calling thread, set for workers and for a thread borrowing slot 0
+	thread_local WorkerPool* tPool = nullptr;
+	thread_local GLuint tSlot = 0;
+}
+
+///////////////////////////////////////////////////
+//	JobDeque::Push(const Job&)
+//
+//	Owner only. False when the deque is full.
+///////////////////////////////////////////////////
+bool WorkerPool::JobDeque::Push(const Job& job)
+{
+	const int64_t bottom = mBottom.load(std::memory_order_relaxed);
+	const int64_t top = mTop.load(std::memory_order_acquire);
+	if (bottom - top >= (int64_t)DEQUE_CAPACITY)
+		return false;
+
+	mJobs[bottom & (DEQUE_CAPACITY - 1)] = job;
+	std::atomic_thread_fence(std::memory_order_release);
+	mBottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	JobDeque::Pop(Job&)
+//
+//	Owner only. Take the newest job; the last one
+//	left is raced for against thieves on mTop.
+///////////////////////////////////////////////////
+bool WorkerPool::JobDeque::Pop(Job& job)
+{
+	const int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+	mBottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = mTop.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		mBottom.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	job = mJobs[bottom & (DEQUE_CAPACITY - 1)];
+	if (top == bottom)
+	{
+		const bool won = mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		mBottom.store(bottom + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	JobDeque::Steal(Job&)
+//
+//	Any thread. Take the oldest job; false when the
+//	deque is empty or another thread got it first.
+///////////////////////////////////////////////////
+bool WorkerPool::JobDeque::Steal(Job& job)
+{
+	int64_t top = mTop.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t bottom = mBottom.load(std::memory_order_acquire);
+	if (top >= bottom)
+		return false;
+
+	// the copy may be torn by a racing pop and push, the exchange then fails and drops it
+	job = mJobs[top & (DEQUE_CAPACITY - 1)];
+	return mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////
+//	JobDeque::Empty()
+///////////////////////////////////////////////////
+bool WorkerPool::JobDeque::Empty() const
+{
+	return mTop.load(std::memory_order_seq_cst) >= mBottom.load(std::memory_order_seq_cst);
+}
+
+///////////////////////////////////////////////////
+//	~WorkerPool()
+///////////////////////////////////////////////////
+WorkerPool::~WorkerPool()
+{
+	Stop();
+}
+
+///////////////////////////////////////////////////
+//	Start(unsigned)
+//
+//	count: threads including the caller, 0 for one
+//		per hardware thread
+///////////////////////////////////////////////////
+void WorkerPool::Start(unsigned count)
+{
+	Stop();
+
+	if (count == 0)
+		count = std::max(1u, std::thread::hardware_concurrency());
+
+	mSlots.clear();
+	for (unsigned i = 0; i < count; ++i)
+		mSlots.emplace_back(new Slot());
+
+	mStopping = false;
+	for (unsigned i = 1; i < count; ++i)
+		mWorkers.emplace_back(&WorkerPool::UWorkerLoop, this, (GLuint)i);
+}
+
+///////////////////////////////////////////////////
+//	Stop()
+//
+//	Wake every worker and join it. Jobs still
+//	queued are dropped, Wait() first.
+///////////////////////////////////////////////////
+void WorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+
+	for (std::thread& worker : mWorkers)
+		worker.join();
+	mWorkers.clear();
+}
+
+///////////////////////////////////////////////////
+//	Run(JobFunction, void*, GLuint, GLuint, JobCounter&, const JobCounter*)
+//
+//	function: called once as function(data, begin, end)
+//	counter: counts the job until it has run
+//	after: must be done before the job starts, or null
+///////////////////////////////////////////////////
+void WorkerPool::Run(JobFunction function, void* data, GLuint begin, GLuint end, JobCounter& counter, const JobCounter* after)
+{
+	const Job job = { function, data, begin, end, &counter, after };
+	counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+	if (mWorkers.empty())
+	{
+		UExecute(job);
+		return;
+	}
+
+	const bool borrowed = UBorrowSlot();
+	UPush(job);
+	UReturnSlot(borrowed);
+}
+
+///////////////////////////////////////////////////
+//	Wait(const JobCounter&)
+//
+//	counter: batch to wait for
+//
+//	Run jobs from this thread's deque, or stolen
+//	from the others, until the batch is done. The
+//	jobs run need not belong to the batch.
+///////////////////////////////////////////////////
+void WorkerPool::Wait(const JobCounter& counter)
+{
+	if (counter.Done())
+		return;
+
+	const bool borrowed = UBorrowSlot();
+	while (!counter.Done())
+	{
+		if (!URunOne())
+			std::this_thread::yield();
+	}
+	UReturnSlot(borrowed);
+}
+
+///////////////////////////////////////////////////
+//	ParallelFor(GLuint, GLuint, const ChunkFunction&)
+//
+//	count: items in the loop
+//	grain: items per chunk
+//	function: called once per chunk, from any thread
+//
+//	Split the whole chunk range on this thread, then
+//	help until every half that was pushed has run
+///////////////////////////////////////////////////
+void WorkerPool::ParallelFor(GLuint count, GLuint grain, const ChunkFunction& function)
+{
+	const GLuint chunks = ChunkCount(count, grain);
+	if (chunks == 0)
+		return;
+
+	if (chunks == 1 || mWorkers.empty())
+	{
+		for (GLuint c = 0; c < chunks; ++c)
+			function(c * grain, std::min(count, (c + 1) * grain), c);
+		return;
+	}
+
+	JobCounter counter;
+	Loop loop = { this, &function, count, grain, &counter };
+
+	const bool borrowed = UBorrowSlot();
+	URunLoop(&loop, 0, chunks);
+	while (!counter.Done())
+	{
+		if (!URunOne())
+			std::this_thread::yield();
+	}
+	UReturnSlot(borrowed);
+}
+
+///////////////////////////////////////////////////
+//	Statistics()
+///////////////////////////////////////////////////
+JobStats WorkerPool::Statistics() const
+{
+	JobStats stats = {};
+	for (const std::unique_ptr<Slot>& slot : mSlots)
+	{
+		stats.executed += slot->executed.load(std::memory_order_relaxed);
+		stats.stolen += slot->stolen.load(std::memory_order_relaxed);
+		stats.overflowed += slot->overflowed.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+///////////////////////////////////////////////////
+//	ResetStatistics()
+///////////////////////////////////////////////////
+void WorkerPool::ResetStatistics()
+{
+	for (const std::unique_ptr<Slot>& slot : mSlots)
+	{
+		slot->executed = 0;
+		slot->stolen = 0;
+		slot->overflowed = 0;
+	}
+}
+
+///////////////////////////////////////////////////
+//	URunLoop(void*, GLuint, GLuint)
+//
+//	data: the Loop
+//	firstChunk, endChunk: chunks [firstChunk, endChunk)
+//
+//	Push the upper half until one chunk is left, then
+//	run it. Every half pushed counts in the loop's
+//	counter before this job finishes, so the counter
+//	cannot drain early.
+///////////////////////////////////////////////////
+void WorkerPool::URunLoop(void* data, GLuint firstChunk, GLuint endChunk)
+{
+	const Loop& loop = *(const Loop*)data;
+
+	while (endChunk - firstChunk > 1)
+	{
+		const GLuint middle = firstChunk + (endChunk - firstChunk) / 2;
+		loop.counter->pending.fetch_add(1, std::memory_order_relaxed);
+		loop.pool->UPush({ &WorkerPool::URunLoop, data, middle, endChunk, loop.counter, nullptr });
+		endChunk = middle;
+	}
+
+	const GLuint begin = firstChunk * loop.grain;
+	(*loop.function)(begin, std::min(loop.count, begin + loop.grain), firstChunk);
+}
+
+///////////////////////////////////////////////////
+//	UBorrowSlot()
+//
+//	A worker, or a thread already inside a call,
+//	keeps its slot. Any other thread waits its turn
+//	for slot 0.
+///////////////////////////////////////////////////
+bool WorkerPool::UBorrowSlot()
+{
+	if (tPool == this)
+		return false;
+
+	mExternal.lock();
+	tPool = this;
+	tSlot = 0;
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UReturnSlot(bool)
+//
+//	borrowed: what UBorrowSlot() returned
+///////////////////////////////////////////////////
+void WorkerPool::UReturnSlot(bool borrowed)
+{
+	if (!borrowed)
+		return;
+
+	tPool = nullptr;
+	mExternal.unlock();
+}
+
+///////////////////////////////////////////////////
+//	UWorkerLoop(GLuint)
+//
+//	slot: the worker's deque
+//
+//	Run jobs while there are any, spin a little when
+//	there are none, then sleep until a push wakes it
+///////////////////////////////////////////////////
+void WorkerPool::UWorkerLoop(GLuint slot)
+{
+	tPool = this;
+	tSlot = slot;
+
+	int idleRounds = 0;
+	while (!mStopping.load(std::memory_order_relaxed))
+	{
+		if (URunOne())
+		{
+			idleRounds = 0;
+			continue;
+		}
+
+		if (++idleRounds < SPIN_ROUNDS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// count as sleeping before the last look, a push after it sees the count and wakes us
+		std::unique_lock<std::mutex> lock(mMutex);
+		mSleeping.fetch_add(1, std::memory_order_seq_cst);
+		if (!mStopping && !UHasWork())
+			mWake.wait(lock);
+		mSleeping.fetch_sub(1, std::memory_order_relaxed);
+		idleRounds = 0;
+	}
+
+	tPool = nullptr;
+}
+
+///////////////////////////////////////////////////
+//	UPush(const Job&)
+//
+//	Queue on the calling thread's deque, which the
+//	caller owns or has borrowed. A full deque runs
+//	the job right away instead.
+///////////////////////////////////////////////////
+void WorkerPool::UPush(const Job& job)
+{
+	Slot& slot = *mSlots[tSlot];
+	if (!slot.deque.Push(job))
+	{
+		slot.overflowed.fetch_add(1, std::memory_order_relaxed);
+		UExecute(job);
+		return;
+	}
+
+	UWake();
+}
+
+///////////////////////////////////////////////////
+//	UExecute(const Job&)
+//
+//	Help until the job's dependency is done, run it,
+//	then release its counter. The counter may be
+//	freed as soon as it drains, so it is the last
+//	thing touched.
+///////////////////////////////////////////////////
+void WorkerPool::UExecute(const Job& job)
+{
+	if (job.after != nullptr)
+	{
+		while (!job.after->Done())
+		{
+			if (!URunOne())
+				std::this_thread::yield();
+		}
+	}
+
+	job.function(job.data, job.begin, job.end);
+
+	if (tPool == this)
+		mSlots[tSlot]->executed.fetch_add(1, std::memory_order_relaxed);
+	job.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+///////////////////////////////////////////////////
+//	URunOne()
+//
+//	Run the newest job of the calling thread's own
+//	deque, or failing that the oldest job of the
+//	first other deque that has one. False when every
+//	deque came up empty, or the calling thread has
+//	no slot.
+///////////////////////////////////////////////////
+bool WorkerPool::URunOne()
+{
+	// only a worker or the thread holding slot 0 may pop
+	if (tPool != this)
+		return false;
+
+	Slot& own = *mSlots[tSlot];
+	Job job;
+	if (own.deque.Pop(job))
+	{
+		UExecute(job);
+		return true;
+	}
+
+	// start where the last steal left off so thieves spread over the victims
+	const GLuint count = (GLuint)mSlots.size();
+	for (GLuint i = 0; i < count; ++i)
+	{
+		const GLuint victim = (own.nextVictim + i) % count;
+		if (victim == tSlot)
+			continue;
+
+		if (mSlots[victim]->deque.Steal(job))
+		{
+			own.nextVictim = victim;
+			own.stolen.fetch_add(1, std::memory_order_relaxed);
+			UExecute(job);
+			return true;
+		}
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////
+//	UHasWork()
+///////////////////////////////////////////////////
+bool WorkerPool::UHasWork() const
+{
+	for (const std::unique_ptr<Slot>& slot : mSlots)
+	{
+		if (!slot->deque.Empty())
+			return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////
+//	UWake()
+//
+//	Wake the sleeping workers after a push. The
+//	fence orders the push before the look at the
+//	sleeper count, pairing with UWorkerLoop().
+///////////////////////////////////////////////////
+void WorkerPool::UWake()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (mSleeping.load(std::memory_order_relaxed) == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mWake.notify_all();
+}
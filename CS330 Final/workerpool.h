@@ -0,0 +1,164 @@
+///////////////////////////////////////////////////////////////////////////////
+// workerpool.h
+// ========
+// work-stealing job scheduler shared by every system that splits its work
+//
+// Each thread of the pool owns a Chase-Lev deque. It pushes and pops jobs at
+// the bottom without locking, and idle threads steal from the top of
+// another thread's deque. A job is a plain function pointer with a context
+// pointer and a range, so queueing one never allocates. Every job counts
+// against a JobCounter; Wait() runs queued jobs until its counter drains,
+// and a job can name a counter that must drain before it starts.
+//
+// ParallelFor() is built on top. The caller splits [0, chunks) in halves,
+// pushing the upper half each time, and runs the first chunk; thieves take
+// the big halves and split them further. Chunk c always covers
+// [c * grain, min((c + 1) * grain, count)), which lets callers keep one
+// output list per chunk and merge them in order.
+//
+// Threads outside the pool (the render and input threads) borrow deque 0
+// while they queue or wait, one at a time. Workers spin briefly when they
+// run dry and then sleep on a condition variable. Nothing here touches
+// OpenGL; the thread that owns the context only ever runs its own jobs.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs of a batch that have not finished yet
+struct JobCounter
+{
+	std::atomic<GLuint> pending{ 0 };
+
+	bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Counters summed over every thread, since Start() or ResetStatistics()
+struct JobStats
+{
+	unsigned long executed;     // Jobs run, ParallelFor() halves included
+	unsigned long stolen;       // Jobs taken from another thread's deque
+	unsigned long overflowed;   // Jobs run at once because the deque was full
+};
+
+class WorkerPool
+{
+public:
+	// begin, end: item range of the chunk; chunk: chunk index
+	typedef std::function<void(GLuint begin, GLuint end, GLuint chunk)> ChunkFunction;
+	// data: context handed to Run(); begin, end: range handed to Run()
+	typedef void (*JobFunction)(void* data, GLuint begin, GLuint end);
+
+	// Jobs one deque holds, a power of two
+	static const GLuint DEQUE_CAPACITY = 4096;
+
+private:
+	struct Job
+	{
+		JobFunction function;
+		void* data;
+		GLuint begin;
+		GLuint end;
+		JobCounter* counter;
+		const JobCounter* after;
+	};
+
+	// Chase-Lev deque: the owner pushes and pops at the bottom, anyone steals at the top
+	class JobDeque
+	{
+	public:
+		bool Push(const Job& job);
+		bool Pop(Job& job);
+		bool Steal(Job& job);
+		bool Empty() const;
+
+	private:
+		std::atomic<int64_t> mTop{ 0 };
+		std::atomic<int64_t> mBottom{ 0 };
+		Job mJobs[DEQUE_CAPACITY];
+	};
+
+	// Deque and counters of one thread, on its own cache lines
+	struct alignas(64) Slot
+	{
+		JobDeque deque;
+		std::atomic<unsigned long> executed{ 0 };
+		std::atomic<unsigned long> stolen{ 0 };
+		std::atomic<unsigned long> overflowed{ 0 };
+		GLuint nextVictim = 0;
+	};
+
+public:
+	WorkerPool() = default;
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Start count - 1 workers, the calling thread is the last one. 0 picks one per core.
+	void Start(unsigned count = 0);
+	void Stop();
+
+	// Threads that run jobs, the caller included
+	unsigned ThreadCount() const { return (unsigned)mWorkers.size() + 1; }
+
+	static GLuint ChunkCount(GLuint count, GLuint grain) { return grain == 0 ? 0 : (count + grain - 1) / grain; }
+
+	// Queue function(data, begin, end) and count it in counter. With after set, the
+	// job starts only once after is done; the thread that picks it up runs other jobs
+	// meanwhile. counter and after must outlive the job. A pool that was never
+	// started runs the job inline.
+	void Run(JobFunction function, void* data, GLuint begin, GLuint end, JobCounter& counter, const JobCounter* after = nullptr);
+	// Run queued jobs until counter is done
+	void Wait(const JobCounter& counter);
+
+	// Run function over every chunk of [0, count) and wait for all of them. A loop
+	// of a single chunk, or a pool that was never started, runs inline.
+	void ParallelFor(GLuint count, GLuint grain, const ChunkFunction& function);
+
+	JobStats Statistics() const;
+	void ResetStatistics();
+
+private:
+	// The loop of a ParallelFor() call, jobs cover chunk ranges of it
+	struct Loop
+	{
+		WorkerPool* pool;
+		const ChunkFunction* function;
+		GLuint count;
+		GLuint grain;
+		JobCounter* counter;
+	};
+
+	static void URunLoop(void* data, GLuint firstChunk, GLuint endChunk);
+
+	// A thread outside the pool takes slot 0 for the call, false when it already runs here
+	bool UBorrowSlot();
+	void UReturnSlot(bool borrowed);
+
+	void UWorkerLoop(GLuint slot);
+	void UPush(const Job& job);
+	void UExecute(const Job& job);
+	bool URunOne();
+	bool UHasWork() const;
+	void UWake();
+
+	std::vector<std::thread> mWorkers;
+	std::vector<std::unique_ptr<Slot>> mSlots;      // Slot 0 is lent to threads outside the pool
+	std::mutex mExternal;                           // Held by the outside thread borrowing slot 0
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::atomic<GLuint> mSleeping{ 0 };
+	std::atomic<bool> mStopping{ false };
+};